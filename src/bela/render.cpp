@@ -12,6 +12,7 @@
 #include <libraries/Scope/Scope.h>
 
 #include "DetectHit.hpp"
+#include "FilterDesigner.hpp"
 #include "Triangular2DMesh.hpp"
 using meshcl = Triangular2DMesh;  // Because typing it every time was...
 
@@ -64,8 +65,14 @@ bool setup(BelaContext *context, void *userData)
     pinMode(context, 0, kDigLED, OUTPUT);
 
     // Internal setup
-    hit.SetHPFCoef(0.9996439371675712, -0.9996439371675712, -0.9992878743351423);
-    hit.SetLPFCoef(0.007073522215301396, 0.007073522215301396, -0.9858529555693972);
+    // First-order Butterworth: DC blocker at 5 Hz, envelope at 100 Hz
+    DSP::BiquadCoeffs c;
+    DSP::FilterDesigner::Highpass(&c, DSP::FilterDesigner::kButterworth, 1,
+        context->audioSampleRate, 5.f);
+    hit.SetHPFCoef(c.b0, c.b1, c.a1);
+    DSP::FilterDesigner::Lowpass(&c, DSP::FilterDesigner::kButterworth, 1,
+        context->audioSampleRate, 100.f);
+    hit.SetLPFCoef(c.b0, c.b1, c.a1);
 
     // Mesh setup
     meshcl::Properties p {
@@ -0,0 +1,248 @@
+#ifndef _AR_SMOOTHER_BANK_HPP_
+#define _AR_SMOOTHER_BANK_HPP_
+
+#include <cassert>
+#include "Filter.hpp"
+#include "SIMD.hpp"
+
+
+namespace DSP {
+
+/**
+ * @brief Memory of an attack/release smoother bank, all channels
+ *
+ */
+template <unsigned int n_channels>
+struct ARSmootherState {
+    float y[n_channels];
+};
+
+
+inline namespace __SIMD_ISA_NS {
+
+/**
+ * @brief Attack/release smoothers (see ARSmoother) for many envelopes at
+ * once, e.g. one per accelerometer axis or per voice. Each channel has its
+ * own attack and release; the channels are processed SIMD::kWidth at a
+ * time (the ones left over, one at a time), selecting attack or release
+ * per lane with a compare and a blend.
+ *
+ * Compiled for the build's instruction set (not picked at run time, see
+ * Dispatch).
+ *
+ * @tparam n_channels Number of interleaved channels
+ */
+template <unsigned int n_channels>
+class ARSmootherBank {
+
+ public:
+
+    /**
+     * @brief Memory of the smoothers
+     *
+     */
+    typedef ARSmootherState<n_channels> State;
+
+    /**
+     * @brief Construct a new ARSmootherBank object, every channel with
+     * the same coefficients
+     *
+     * @param alpha_attack Attack coefficient (see ARSmoother::GetAlpha())
+     * @param alpha_release Release coefficient
+     * @param s State (smoother memory). Allocate externally.
+     */
+    ARSmootherBank(float alpha_attack, float alpha_release, State *s);
+    /**
+     * @brief Reset memory of smoothers.
+     *
+     */
+    void Reset();
+    /**
+     * @brief Set coefficients of every channel
+     *
+     */
+    void SetAlphas(float alpha_attack, float alpha_release);
+    /**
+     * @brief Set coefficients of one channel
+     *
+     */
+    void SetAlphas(unsigned int channel, float alpha_attack,
+        float alpha_release);
+    /**
+     * @brief Set time constants of every channel (see
+     * ARSmoother::SetTimes())
+     *
+     */
+    void SetTimes(float attack_ms, float release_ms, float fs);
+    /**
+     * @brief Set time constants of one channel
+     *
+     */
+    void SetTimes(unsigned int channel, float attack_ms, float release_ms,
+        float fs);
+    /**
+     * @brief Process a single frame of data (in place).
+     *
+     * @param x Frame (has to be n_channels long)
+     */
+    void ProcessFrame(float *x);
+    /**
+     * @brief Process buffer of frames (in-place allowed).
+     *
+     * @param in Input buffer, interleaved
+     * @param out Output buffer, interleaved
+     * @param n_samples Number of frames in the buffers
+     */
+    void ProcessBuffer(const float *in, float *out, unsigned int n_samples);
+
+ private:
+
+    using V = SIMD;
+    // Channels in whole vectors, then one at a time
+    static constexpr unsigned int kVectors = n_channels / SIMD::kWidth;
+    static constexpr unsigned int kVectorChannels = kVectors * SIMD::kWidth;
+    static constexpr unsigned int kLeftover = n_channels - kVectorChannels;
+
+    /**
+     * @brief Coefficients and state of one vector of channels (or one
+     * channel)
+     *
+     */
+    template <class OPS_T>
+    struct Channels_ {
+        typename OPS_T::Vec alpha_a, alpha_r, y;
+    };
+
+    template <class OPS_T>
+    inline void Load_(Channels_<OPS_T> &ch, unsigned int first) const;
+    template <class OPS_T>
+    static inline void Step_(Channels_<OPS_T> &ch, const float *in,
+        float *out);
+
+    State *s_;
+    float alpha_a_[n_channels];
+    float alpha_r_[n_channels];
+};
+
+
+template<unsigned int n_channels>
+ARSmootherBank<n_channels>::ARSmootherBank(float alpha_attack,
+        float alpha_release, State *s) :
+        s_(s) {
+    SetAlphas(alpha_attack, alpha_release);
+    Reset();
+}
+
+
+template<unsigned int n_channels>
+void ARSmootherBank<n_channels>::Reset() {
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        s_->y[ch] = 0;
+    }
+}
+
+
+template<unsigned int n_channels>
+void ARSmootherBank<n_channels>::SetAlphas(float alpha_attack,
+        float alpha_release) {
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        SetAlphas(ch, alpha_attack, alpha_release);
+    }
+}
+
+
+template<unsigned int n_channels>
+void ARSmootherBank<n_channels>::SetAlphas(unsigned int channel,
+        float alpha_attack, float alpha_release) {
+    assert(channel < n_channels);
+    alpha_a_[channel] = alpha_attack;
+    alpha_r_[channel] = alpha_release;
+}
+
+
+template<unsigned int n_channels>
+void ARSmootherBank<n_channels>::SetTimes(float attack_ms, float release_ms,
+        float fs) {
+    SetAlphas(ARSmoother::GetAlpha(attack_ms, fs),
+        ARSmoother::GetAlpha(release_ms, fs));
+}
+
+
+template<unsigned int n_channels>
+void ARSmootherBank<n_channels>::SetTimes(unsigned int channel,
+        float attack_ms, float release_ms, float fs) {
+    SetAlphas(channel, ARSmoother::GetAlpha(attack_ms, fs),
+        ARSmoother::GetAlpha(release_ms, fs));
+}
+
+
+template<unsigned int n_channels>
+template<class OPS_T>
+inline void ARSmootherBank<n_channels>::Load_(Channels_<OPS_T> &ch,
+        unsigned int first) const {
+    ch.alpha_a = OPS_T::LoadU(alpha_a_ + first);
+    ch.alpha_r = OPS_T::LoadU(alpha_r_ + first);
+    ch.y = OPS_T::LoadU(s_->y + first);
+}
+
+
+template<unsigned int n_channels>
+template<class OPS_T>
+inline void ARSmootherBank<n_channels>::Step_(Channels_<OPS_T> &ch,
+        const float *in, float *out) {
+    using O = OPS_T;
+    typename O::Vec x = O::LoadU(in);
+    // Release unless rising, as ARSmoother
+    typename O::Vec alpha = O::Select(O::CmpLe(x, ch.y), ch.alpha_r,
+        ch.alpha_a);
+    ch.y = O::MulAdd(x, alpha, O::Mul(O::Sub(O::Set1(1.f), alpha), ch.y));
+    O::StoreU(out, ch.y);
+}
+
+
+template<unsigned int n_channels>
+void ARSmootherBank<n_channels>::ProcessFrame(float *x) {
+    ProcessBuffer(x, x, 1);
+}
+
+
+template<unsigned int n_channels>
+void ARSmootherBank<n_channels>::ProcessBuffer(const float *in, float *out,
+        unsigned int n_samples) {
+
+    // (+ 1: no empty arrays)
+    Channels_<SIMD> vec[kVectors + 1];
+    Channels_<SIMDScalar> one[kLeftover + 1];
+    for (unsigned int v = 0; v < kVectors; v++) {
+        Load_(vec[v], v * V::kWidth);
+    }
+    for (unsigned int ch = 0; ch < kLeftover; ch++) {
+        Load_(one[ch], kVectorChannels + ch);
+    }
+
+    // All channels advance together, so their recursions overlap
+    for (unsigned int n = 0; n < n_samples; n++) {
+        unsigned int frame = n * n_channels;
+        for (unsigned int v = 0; v < kVectors; v++) {
+            unsigned int i = frame + v * V::kWidth;
+            Step_(vec[v], in + i, out + i);
+        }
+        for (unsigned int ch = 0; ch < kLeftover; ch++) {
+            unsigned int i = frame + kVectorChannels + ch;
+            Step_(one[ch], in + i, out + i);
+        }
+    }
+
+    for (unsigned int v = 0; v < kVectors; v++) {
+        V::StoreU(s_->y + v * V::kWidth, vec[v].y);
+    }
+    for (unsigned int ch = 0; ch < kLeftover; ch++) {
+        s_->y[kVectorChannels + ch] = one[ch].y;
+    }
+}
+
+}  // inline namespace __SIMD_ISA_NS
+
+}  // namespace DSP
+
+#endif  // _AR_SMOOTHER_BANK_HPP_
@@ -0,0 +1,289 @@
+#ifndef _BIQUAD_KERNEL_HPP_
+#define _BIQUAD_KERNEL_HPP_
+
+#include "SIMD.hpp"
+
+
+namespace DSP {
+
+/**
+ * @brief Coefficients in a 5-number format (a0 ignored)
+ *
+ */
+struct BiquadCoeffs {
+    float b0;
+    float b1;
+    float b2;
+    float a1;
+    float a2;
+};
+
+
+/**
+ * @brief Memory of one second-order section, all channels
+ *
+ */
+template <unsigned int n_channels>
+struct BiquadState {
+    float z1[n_channels];
+    float z2[n_channels];
+};
+
+
+inline namespace __SIMD_ISA_NS {
+
+/**
+ * @brief Biquad cascade kernels for one instruction set (see Biquad for
+ * the API, and Dispatch for how the instruction set gets picked).
+ *
+ * Channels are filtered SIMD::kWidth at a time (the ones left over, one
+ * at a time), all of them a sample at a time through each section, with
+ * the state in registers for the whole buffer.
+ *
+ * A mono cascade of kPipelineSections or more runs as a software
+ * pipeline instead, sections packed across the lanes of a vector: while
+ * section s works on sample n, section s + 1 works on sample n - 1.
+ *
+ * @tparam n_channels Number of interleaved channels
+ */
+template <unsigned int n_channels>
+class BiquadKernel {
+
+ public:
+
+    /**
+     * @brief Run a cascade over an interleaved buffer, in place
+     *
+     * @tparam kTransposed Transposed direct form 2 (else direct form 2)
+     */
+    template <bool kTransposed>
+    static void Run(const BiquadCoeffs *c, BiquadState<n_channels> *s,
+        unsigned int n_sections, float *x, unsigned int n_samples);
+    /**
+     * @brief Run(), with the state passed untyped (for kernel tables)
+     *
+     */
+    template <bool kTransposed>
+    static void RunUntyped(const BiquadCoeffs *c, void *s,
+            unsigned int n_sections, float *x, unsigned int n_samples) {
+        Run<kTransposed>(c, static_cast<BiquadState<n_channels> *>(s),
+            n_sections, x, n_samples);
+    }
+
+ private:
+
+    // Channels in whole vectors, then one at a time
+    static constexpr unsigned int kVectors = n_channels / SIMD::kWidth;
+    static constexpr unsigned int kVectorChannels = kVectors * SIMD::kWidth;
+    static constexpr unsigned int kLeftover = n_channels - kVectorChannels;
+    // Mono cascades this deep are pipelined across vector lanes
+    static constexpr unsigned int kPipelineSections = 4;
+
+    /**
+     * @brief Coefficients, one section per lane or the same in all lanes
+     *
+     */
+    struct VecCoeffs_ {
+        SIMD::Vec b0, b1, b2, a1, a2;
+    };
+
+    /**
+     * @brief One sample through one section, per lane
+     *
+     */
+    template <bool kTransposed>
+    static SIMD::Vec Step_(const VecCoeffs_ &c, SIMD::Vec &z1, SIMD::Vec &z2,
+        SIMD::Vec in);
+    /**
+     * @brief Run one section over a buffer, all channels
+     *
+     * @param x First channel of the first frame
+     */
+    template <bool kTransposed>
+    static void Section_(const BiquadCoeffs &c, BiquadState<n_channels> &s,
+        float *x, unsigned int n_samples);
+    /**
+     * @brief Run sections [first, first + SIMD::kWidth) over a mono
+     * buffer as a pipeline, one section per lane (the ones past the end of
+     * the cascade pass samples through)
+     *
+     */
+    template <bool kTransposed>
+    static void Pipeline_(const BiquadCoeffs *c, BiquadState<n_channels> *s,
+        unsigned int n_sections, unsigned int first, float *x,
+        unsigned int n_samples);
+};
+
+
+template<unsigned int n_channels>
+template<bool kTransposed>
+void BiquadKernel<n_channels>::Run(const BiquadCoeffs *c,
+        BiquadState<n_channels> *s, unsigned int n_sections, float *x,
+        unsigned int n_samples) {
+
+    if (n_channels == 1 && SIMD::kWidth > 1 &&
+        n_sections >= kPipelineSections && n_samples > 1) {
+        for (unsigned int n = 0; n < n_sections; n += SIMD::kWidth) {
+            Pipeline_<kTransposed>(c, s, n_sections, n, x, n_samples);
+        }
+        return;
+    }
+    // Loop through SOS first, then samples (cache coefficients)
+    for (unsigned int n = 0; n < n_sections; n++) {
+        Section_<kTransposed>(c[n], s[n], x, n_samples);
+    }
+}
+
+
+template<unsigned int n_channels>
+template<bool kTransposed>
+inline SIMD::Vec BiquadKernel<n_channels>::Step_(const VecCoeffs_ &c,
+        SIMD::Vec &z1, SIMD::Vec &z2, SIMD::Vec in) {
+
+    using V = SIMD;
+    if (!kTransposed) {
+        V::Vec w = V::Sub(in, V::Add(V::Mul(c.a1, z1), V::Mul(c.a2, z2)));
+        V::Vec y = V::Add(V::Mul(c.b0, w),
+            V::Add(V::Mul(c.b1, z1), V::Mul(c.b2, z2)));
+        z2 = z1;
+        z1 = w;
+        return y;
+    } else {
+        V::Vec y = V::MulAdd(c.b0, in, z1);
+        z1 = V::Add(V::Sub(V::Mul(c.b1, in), V::Mul(c.a1, y)), z2);
+        z2 = V::Sub(V::Mul(c.b2, in), V::Mul(c.a2, y));
+        return y;
+    }
+}
+
+
+template<unsigned int n_channels>
+template<bool kTransposed>
+void BiquadKernel<n_channels>::Section_(const BiquadCoeffs &c,
+        BiquadState<n_channels> &s, float *x, unsigned int n_samples) {
+
+    using V = SIMD;
+    const VecCoeffs_ cv = { V::Set1(c.b0), V::Set1(c.b1), V::Set1(c.b2),
+        V::Set1(c.a1), V::Set1(c.a2) };
+    // State in registers for the whole buffer (+ 1: no empty arrays)
+    V::Vec z1[kVectors + 1];
+    V::Vec z2[kVectors + 1];
+    float t1[kLeftover + 1];
+    float t2[kLeftover + 1];
+    for (unsigned int v = 0; v < kVectors; v++) {
+        z1[v] = V::LoadU(s.z1 + v * V::kWidth);
+        z2[v] = V::LoadU(s.z2 + v * V::kWidth);
+    }
+    for (unsigned int ch = 0; ch < kLeftover; ch++) {
+        t1[ch] = s.z1[kVectorChannels + ch];
+        t2[ch] = s.z2[kVectorChannels + ch];
+    }
+
+    // All channels advance together, so their recursions overlap
+    for (unsigned int k = 0; k < n_samples; k++) {
+        for (unsigned int v = 0; v < kVectors; v++) {
+            float *p = x + v * V::kWidth;
+            V::StoreU(p, Step_<kTransposed>(cv, z1[v], z2[v], V::LoadU(p)));
+        }
+        for (unsigned int ch = 0; ch < kLeftover; ch++) {
+            float *p = x + kVectorChannels + ch;
+            float in = *p;
+            if (!kTransposed) {
+                float w = in - c.a1 * t1[ch] - c.a2 * t2[ch];
+                *p = c.b0 * w + c.b1 * t1[ch] + c.b2 * t2[ch];
+                t2[ch] = t1[ch];
+                t1[ch] = w;
+            } else {
+                float y = c.b0 * in + t1[ch];
+                t1[ch] = c.b1 * in - c.a1 * y + t2[ch];
+                t2[ch] = c.b2 * in - c.a2 * y;
+                *p = y;
+            }
+        }
+        x += n_channels;
+    }
+
+    for (unsigned int v = 0; v < kVectors; v++) {
+        V::StoreU(s.z1 + v * V::kWidth, z1[v]);
+        V::StoreU(s.z2 + v * V::kWidth, z2[v]);
+    }
+    for (unsigned int ch = 0; ch < kLeftover; ch++) {
+        s.z1[kVectorChannels + ch] = t1[ch];
+        s.z2[kVectorChannels + ch] = t2[ch];
+    }
+}
+
+
+template<unsigned int n_channels>
+template<bool kTransposed>
+void BiquadKernel<n_channels>::Pipeline_(const BiquadCoeffs *c,
+        BiquadState<n_channels> *s, unsigned int n_sections,
+        unsigned int first, float *x, unsigned int n_samples) {
+
+    using V = SIMD;
+    constexpr unsigned int kW = V::kWidth;
+    static const float kLanes[16] = { 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f,
+        7.f, 8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f };
+    static_assert(kW <= 16, "Lane indices only go up to 16");
+
+    // Gather one section per lane; missing ones pass samples through
+    // exactly (y = 1 * w, w = x - 0 - 0)
+    float b0[kW], b1[kW], b2[kW], a1[kW], a2[kW], s1[kW], s2[kW];
+    for (unsigned int l = 0; l < kW; l++) {
+        unsigned int n = first + l;
+        bool used = n < n_sections;
+        b0[l] = used ? c[n].b0 : 1.f;
+        b1[l] = used ? c[n].b1 : 0.f;
+        b2[l] = used ? c[n].b2 : 0.f;
+        a1[l] = used ? c[n].a1 : 0.f;
+        a2[l] = used ? c[n].a2 : 0.f;
+        s1[l] = used ? s[n].z1[0] : 0.f;
+        s2[l] = used ? s[n].z2[0] : 0.f;
+    }
+    const VecCoeffs_ cv = { V::LoadU(b0), V::LoadU(b1), V::LoadU(b2),
+        V::LoadU(a1), V::LoadU(a2) };
+    V::Vec z1 = V::LoadU(s1);
+    V::Vec z2 = V::LoadU(s2);
+    const V::Vec lanes = V::LoadU(kLanes);
+
+    // Step t feeds sample t to lane 0 and sample t - l to lane l: the
+    // pipeline fills for kW - 1 steps and drains for kW - 1 more, with
+    // idle lanes keeping their state
+    V::Vec out = V::Zero();
+    const unsigned int n_steps = n_samples + kW - 1;
+    for (unsigned int t = 0; t < n_steps; t++) {
+        V::Vec in = V::ShiftIn(out, (t < n_samples) ? x[t] : 0.f);
+        if (t >= kW - 1 && t < n_samples) {
+            out = Step_<kTransposed>(cv, z1, z2, in);
+        } else {
+            // Lane l is busy if t - n_samples < l <= t
+            V::Vec busy = V::CmpLe(lanes, V::Set1(static_cast<float>(t)));
+            if (t >= n_samples) {
+                busy = V::Select(V::CmpLe(lanes,
+                    V::Set1(static_cast<float>(t - n_samples))),
+                    V::Zero(), busy);
+            }
+            V::Vec z1_next = z1;
+            V::Vec z2_next = z2;
+            out = Step_<kTransposed>(cv, z1_next, z2_next, in);
+            z1 = V::Select(busy, z1_next, z1);
+            z2 = V::Select(busy, z2_next, z2);
+        }
+        if (t >= kW - 1) {
+            x[t - (kW - 1)] = V::Last(out);
+        }
+    }
+
+    V::StoreU(s1, z1);
+    V::StoreU(s2, z2);
+    for (unsigned int l = 0; l < kW && first + l < n_sections; l++) {
+        s[first + l].z1[0] = s1[l];
+        s[first + l].z2[0] = s2[l];
+    }
+}
+
+}  // inline namespace __SIMD_ISA_NS
+
+}  // namespace DSP
+
+#endif  // _BIQUAD_KERNEL_HPP_
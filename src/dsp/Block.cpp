@@ -1,4 +1,5 @@
 #include "Block.hpp"
+#include "Dispatch.hpp"
 
 #define __USE_STDLIB    1
 
@@ -27,27 +28,29 @@ void Block::Zeros(float *buffer, unsigned int n_channels, unsigned int n_samples
 
 
 void Block::Gain(float *buffer, float gain, unsigned int n_channels, unsigned int n_samples) {
-    __LOOP_THROUGH_BLOCK(*buffer++ *= gain);
+    Dispatch::GetKernels().gain(buffer, gain, n_channels * n_samples);
 }
 
 
 void Block::Accum(float *buffer, float *accum, unsigned int n_channels, unsigned int n_samples) {
-    __LOOP_THROUGH_BLOCK(*buffer++ += *accum++);
+    Dispatch::GetKernels().accum(buffer, accum, n_channels * n_samples);
 }
 
 
 void Block::Subtract(float *buffer, float *accum, unsigned int n_channels, unsigned int n_samples) {
-    __LOOP_THROUGH_BLOCK(*buffer++ -= *accum++);
+    Dispatch::GetKernels().subtract(buffer, accum, n_channels * n_samples);
 }
 
 
 void Block::AccumGain(float *buffer, float *accum, float gain, unsigned int n_channels, unsigned int n_samples) {
-    __LOOP_THROUGH_BLOCK(*buffer++ += gain * (*accum++));
+    Dispatch::GetKernels().accum_gain(buffer, accum, gain,
+        n_channels * n_samples);
 }
 
 
 void Block::Mix(float *buffer, float *buffer2, float gain1, float gain2, unsigned int n_channels, unsigned int n_samples) {
-    __LOOP_THROUGH_BLOCK(*buffer = (*buffer) * gain1 + (*buffer2++) * gain2; buffer++);
+    Dispatch::GetKernels().mix(buffer, buffer2, gain1, gain2,
+        n_channels * n_samples);
 }
 
 #undef __LOOP_THROUGH_BLOCK
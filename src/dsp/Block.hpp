@@ -1,6 +1,8 @@
 #ifndef _BLOCK_HPP_
 #define _BLOCK_HPP_
 
+#include "SIMD.hpp"
+
 
 #define __LOOP_THROUGH_BLOCK(statement)    \
     unsigned int n = n_channels * n_samples; while (n-- > 0) { statement; }
@@ -11,6 +13,12 @@ namespace DSP {
 /**
  * @brief Stateless block processing functions (add arrays, scale by gain, copy
  * contents...)
+ *
+ * Kernels run SIMD::kWidth floats at a time, for the CPU's best
+ * instruction set (see BlockKernels, Dispatch).
+ *
+ * Each call makes a pass over the block: to chain operations in a single
+ * pass, see BlockExpr.hpp.
  * 
  */
 class Block {
@@ -89,7 +97,9 @@ class Block {
      */
     static void Mix(float *buffer, float *buffer2, float gain1, float gain2, unsigned int n_channels, unsigned int n_samples);
     /**
-     * @brief Apply function fn to array element-wise
+     * @brief Apply function fn to array element-wise. A functor that
+     * takes a SIMD::Vec is given whole vectors instead (the tail padded
+     * out to one more).
      * 
      * @param buffer 
      * @param fn 
@@ -100,6 +110,37 @@ class Block {
     static void ApplyFn(float *buffer, FN_T fn,
         unsigned int n_channels,
         unsigned int n_samples) {
+        ApplyFn_(buffer, fn, n_channels, n_samples, 0);
+    }
+
+ private:
+
+    // Picked when fn(SIMD::Vec) compiles (0 is an int: better match)
+    template<typename FN_T>
+    static auto ApplyFn_(float *buffer, FN_T &fn,
+        unsigned int n_channels,
+        unsigned int n_samples, int) -> decltype(fn(SIMD::Vec()), void()) {
+        using V = SIMD;
+        unsigned int n = n_channels * n_samples;
+        unsigned int k = 0;
+        for (; k + V::kWidth <= n; k += V::kWidth) {
+            V::StoreU(buffer + k, fn(V::LoadU(buffer + k)));
+        }
+        if (k < n) {
+            float tail[V::kWidth] = { 0 };
+            for (unsigned int i = 0; i < n - k; i++) {
+                tail[i] = buffer[k + i];
+            }
+            V::StoreU(tail, fn(V::LoadU(tail)));
+            for (unsigned int i = 0; i < n - k; i++) {
+                buffer[k + i] = tail[i];
+            }
+        }
+    }
+    template<typename FN_T>
+    static void ApplyFn_(float *buffer, FN_T &fn,
+        unsigned int n_channels,
+        unsigned int n_samples, long) {
         __LOOP_THROUGH_BLOCK(*buffer = fn(*buffer); buffer++);
     }
 };
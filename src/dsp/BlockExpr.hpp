@@ -0,0 +1,269 @@
+#ifndef _BLOCK_EXPR_HPP_
+#define _BLOCK_EXPR_HPP_
+
+#include <type_traits>
+#include "SIMD.hpp"
+
+
+namespace DSP {
+
+inline namespace __SIMD_ISA_NS {
+
+/*
+ * Fused block expressions: a chain of element-wise operations on blocks
+ * builds a tree of types, and assigning it to a BlockOut runs the whole
+ * chain in one loop, SIMD::kWidth floats at a time, with no temporary
+ * buffers. E.g.
+ *
+ *     BlockOut(out, n_channels, n_samples) =
+ *         BlockIn(a) * g1 + BlockIn(b) * g2 + BlockIn(c);
+ *
+ * reads a, b and c once and writes out once, where Block::Gain(),
+ * Accum() and Mix() would make a pass each. The output may also be an
+ * input (each element only depends on its own inputs), and is read
+ * through itself, e.g. `out += BlockIn(a) * g`.
+ *
+ * Length comes from the output: inputs must be at least as long. Unlike
+ * Block, expressions are compiled where they're used, for the build's
+ * instruction set (not picked at run time, see Dispatch).
+ */
+
+// Tags expression nodes for the operators below
+struct BlockExprBase_ {};
+
+template <typename T>
+struct IsBlockExpr_ : std::is_base_of<BlockExprBase_, T> {};
+
+
+/**
+ * @brief Read-only block, as an expression
+ *
+ */
+class BlockIn : public BlockExprBase_ {
+
+ public:
+
+    explicit BlockIn(const float *buffer) : p_(buffer) {}
+
+    SIMD::Vec Load(unsigned int k) const { return SIMD::LoadU(p_ + k); }
+    float At(unsigned int k) const { return p_[k]; }
+
+ private:
+
+    const float *p_;
+};
+
+
+// A scalar, the same in every element
+class BlockConst_ : public BlockExprBase_ {
+
+ public:
+
+    explicit BlockConst_(float x) : x_(x), v_(SIMD::Set1(x)) {}
+
+    SIMD::Vec Load(unsigned int) const { return v_; }
+    float At(unsigned int) const { return x_; }
+
+ private:
+
+    float x_;
+    SIMD::Vec v_;
+};
+
+
+// Operators, on whole vectors (Vec) or single elements (Scalar: for the
+// scalar backend, SIMD::Vec is a float too)
+struct BlockAddOp_ {
+    static SIMD::Vec Vec(SIMD::Vec a, SIMD::Vec b) { return SIMD::Add(a, b); }
+    static float Scalar(float a, float b) { return a + b; }
+};
+struct BlockSubOp_ {
+    static SIMD::Vec Vec(SIMD::Vec a, SIMD::Vec b) { return SIMD::Sub(a, b); }
+    static float Scalar(float a, float b) { return a - b; }
+};
+struct BlockMulOp_ {
+    static SIMD::Vec Vec(SIMD::Vec a, SIMD::Vec b) { return SIMD::Mul(a, b); }
+    static float Scalar(float a, float b) { return a * b; }
+};
+struct BlockMinOp_ {
+    static SIMD::Vec Vec(SIMD::Vec a, SIMD::Vec b) { return SIMD::Min(a, b); }
+    static float Scalar(float a, float b) { return (a < b) ? a : b; }
+};
+struct BlockMaxOp_ {
+    static SIMD::Vec Vec(SIMD::Vec a, SIMD::Vec b) { return SIMD::Max(a, b); }
+    static float Scalar(float a, float b) { return (a > b) ? a : b; }
+};
+struct BlockNegOp_ {
+    static SIMD::Vec Vec(SIMD::Vec a) { return SIMD::Sub(SIMD::Zero(), a); }
+    static float Scalar(float a) { return -a; }
+};
+struct BlockAbsOp_ {
+    static SIMD::Vec Vec(SIMD::Vec a) { return SIMD::Abs(a); }
+    static float Scalar(float a) { return std::fabs(a); }
+};
+
+
+// Nodes hold their operands by value: leaves are a pointer (or a scalar)
+// each, so an expression can outlive the temporaries it's built from
+template <class OP_T, class L_T, class R_T>
+class BlockBinary_ : public BlockExprBase_ {
+
+ public:
+
+    BlockBinary_(const L_T &l, const R_T &r) : l_(l), r_(r) {}
+
+    SIMD::Vec Load(unsigned int k) const {
+        return OP_T::Vec(l_.Load(k), r_.Load(k));
+    }
+    float At(unsigned int k) const {
+        return OP_T::Scalar(l_.At(k), r_.At(k));
+    }
+
+ private:
+
+    L_T l_;
+    R_T r_;
+};
+
+template <class OP_T, class E_T>
+class BlockUnary_ : public BlockExprBase_ {
+
+ public:
+
+    explicit BlockUnary_(const E_T &e) : e_(e) {}
+
+    SIMD::Vec Load(unsigned int k) const { return OP_T::Vec(e_.Load(k)); }
+    float At(unsigned int k) const { return OP_T::Scalar(e_.At(k)); }
+
+ private:
+
+    E_T e_;
+};
+
+
+// Operands: expressions as they are, numbers as BlockConst_
+template <typename T, bool = std::is_arithmetic<T>::value>
+struct BlockOperand_ {
+    typedef T Type;
+    static const T &Wrap(const T &e) { return e; }
+};
+
+template <typename T>
+struct BlockOperand_<T, true> {
+    typedef BlockConst_ Type;
+    static BlockConst_ Wrap(T x) { return BlockConst_(static_cast<float>(x)); }
+};
+
+// Operators only take part with an expression on one side or both
+template <typename L_T, typename R_T>
+struct IsBlockOperands_ : std::integral_constant<bool,
+    (IsBlockExpr_<L_T>::value || IsBlockExpr_<R_T>::value) &&
+    (IsBlockExpr_<L_T>::value || std::is_arithmetic<L_T>::value) &&
+    (IsBlockExpr_<R_T>::value || std::is_arithmetic<R_T>::value)> {};
+
+
+#define __BLOCK_EXPR_BINARY(name, op)                                       \
+    template <typename L_T, typename R_T>                                   \
+    inline typename std::enable_if<IsBlockOperands_<L_T, R_T>::value,       \
+        BlockBinary_<op, typename BlockOperand_<L_T>::Type,                 \
+            typename BlockOperand_<R_T>::Type>>::type                       \
+    name(const L_T &l, const R_T &r) {                                      \
+        return BlockBinary_<op, typename BlockOperand_<L_T>::Type,          \
+            typename BlockOperand_<R_T>::Type>(                             \
+                BlockOperand_<L_T>::Wrap(l), BlockOperand_<R_T>::Wrap(r));  \
+    }
+
+__BLOCK_EXPR_BINARY(operator+, BlockAddOp_)
+__BLOCK_EXPR_BINARY(operator-, BlockSubOp_)
+__BLOCK_EXPR_BINARY(operator*, BlockMulOp_)
+__BLOCK_EXPR_BINARY(Min, BlockMinOp_)
+__BLOCK_EXPR_BINARY(Max, BlockMaxOp_)
+
+#undef __BLOCK_EXPR_BINARY
+
+template <typename E_T>
+inline typename std::enable_if<IsBlockExpr_<E_T>::value,
+    BlockUnary_<BlockNegOp_, E_T>>::type
+operator-(const E_T &e) {
+    return BlockUnary_<BlockNegOp_, E_T>(e);
+}
+
+template <typename E_T>
+inline typename std::enable_if<IsBlockExpr_<E_T>::value,
+    BlockUnary_<BlockAbsOp_, E_T>>::type
+Abs(const E_T &e) {
+    return BlockUnary_<BlockAbsOp_, E_T>(e);
+}
+
+
+/**
+ * @brief Block to evaluate expressions into (and read from, as an
+ * expression itself)
+ *
+ */
+class BlockOut : public BlockExprBase_ {
+
+ public:
+
+    BlockOut(float *buffer, unsigned int n_channels, unsigned int n_samples) :
+        p_(buffer), n_(n_channels * n_samples) {}
+
+    SIMD::Vec Load(unsigned int k) const { return SIMD::LoadU(p_ + k); }
+    float At(unsigned int k) const { return p_[k]; }
+
+    /**
+     * @brief Evaluate e into the block, in one pass
+     *
+     * @param e Expression or number
+     */
+    template <typename E_T>
+    typename std::enable_if<IsBlockOperands_<BlockOut, E_T>::value,
+        BlockOut &>::type operator=(const E_T &e) {
+        Run_(BlockOperand_<E_T>::Wrap(e));
+        return *this;
+    }
+    // Copies contents, not the view
+    BlockOut &operator=(const BlockOut &other) {
+        Run_(other);
+        return *this;
+    }
+    template <typename E_T>
+    typename std::enable_if<IsBlockOperands_<BlockOut, E_T>::value,
+        BlockOut &>::type operator+=(const E_T &e) {
+        return *this = *this + e;
+    }
+    template <typename E_T>
+    typename std::enable_if<IsBlockOperands_<BlockOut, E_T>::value,
+        BlockOut &>::type operator-=(const E_T &e) {
+        return *this = *this - e;
+    }
+    template <typename E_T>
+    typename std::enable_if<IsBlockOperands_<BlockOut, E_T>::value,
+        BlockOut &>::type operator*=(const E_T &e) {
+        return *this = *this * e;
+    }
+
+ private:
+
+    // Whole vectors, then the tail an element at a time (reads past the
+    // end would run into the inputs' bounds)
+    template <class E_T>
+    void Run_(const E_T &e) {
+        unsigned int k = 0;
+        for (; k + SIMD::kWidth <= n_; k += SIMD::kWidth) {
+            SIMD::StoreU(p_ + k, e.Load(k));
+        }
+        for (; k < n_; k++) {
+            p_[k] = e.At(k);
+        }
+    }
+
+    float *p_;
+    unsigned int n_;
+};
+
+}  // inline namespace __SIMD_ISA_NS
+
+}  // namespace DSP
+
+#endif  // _BLOCK_EXPR_HPP_
@@ -0,0 +1,104 @@
+#ifndef _BLOCK_KERNELS_HPP_
+#define _BLOCK_KERNELS_HPP_
+
+#include "SIMD.hpp"
+
+
+namespace DSP {
+
+inline namespace __SIMD_ISA_NS {
+
+/**
+ * @brief Block kernels for one instruction set (see Block for the API, and
+ * Dispatch for how the instruction set gets picked). Lengths are in
+ * floats.
+ *
+ * Kernels run SIMD::kWidth floats at a time, with aligned loads when all
+ * arrays are aligned (see SIMD::Align()) and unaligned ones otherwise; the
+ * tail is padded out to one more vector.
+ */
+class BlockKernels {
+
+ public:
+
+    static void Gain(float *buffer, float gain, unsigned int n) {
+        const SIMD::Vec g = SIMD::Set1(gain);
+        VectorOp_(buffer, buffer, n,
+            [g](SIMD::Vec x, SIMD::Vec) { return SIMD::Mul(x, g); });
+    }
+    static void Accum(float *buffer, const float *accum, unsigned int n) {
+        VectorOp_(buffer, accum, n, AddOp_());
+    }
+    static void Subtract(float *buffer, const float *accum, unsigned int n) {
+        VectorOp_(buffer, accum, n, SubOp_());
+    }
+    static void AccumGain(float *buffer, const float *accum, float gain,
+            unsigned int n) {
+        const SIMD::Vec g = SIMD::Set1(gain);
+        VectorOp_(buffer, accum, n,
+            [g](SIMD::Vec x, SIMD::Vec a) { return SIMD::MulAdd(g, a, x); });
+    }
+    static void Mix(float *buffer, const float *buffer2, float gain1,
+            float gain2, unsigned int n) {
+        const SIMD::Vec g1 = SIMD::Set1(gain1);
+        const SIMD::Vec g2 = SIMD::Set1(gain2);
+        VectorOp_(buffer, buffer2, n,
+            [g1, g2](SIMD::Vec x, SIMD::Vec y) {
+                return SIMD::MulAdd(y, g2, SIMD::Mul(x, g1));
+            });
+    }
+
+ private:
+
+    // Not captureless lambdas: their static thunks are built without the
+    // instruction set of the unit (see Dispatch)
+    struct AddOp_ {
+        SIMD::Vec operator()(SIMD::Vec x, SIMD::Vec a) const {
+            return SIMD::Add(x, a);
+        }
+    };
+    struct SubOp_ {
+        SIMD::Vec operator()(SIMD::Vec x, SIMD::Vec a) const {
+            return SIMD::Sub(x, a);
+        }
+    };
+
+    // buffer = op(buffer, src), a vector at a time; the tail goes through
+    // one more vector, copied in and out
+    template <typename OP_T>
+    static inline void VectorOp_(float *buffer, const float *src,
+            unsigned int n, OP_T op) {
+        using V = SIMD;
+        unsigned int k = 0;
+        unsigned int n_whole = n - n % V::kWidth;
+        if (V::IsAligned(buffer) && V::IsAligned(src)) {
+            for (; k < n_whole; k += V::kWidth) {
+                V::Store(buffer + k,
+                    op(V::Load(buffer + k), V::Load(src + k)));
+            }
+        } else {
+            for (; k < n_whole; k += V::kWidth) {
+                V::StoreU(buffer + k,
+                    op(V::LoadU(buffer + k), V::LoadU(src + k)));
+            }
+        }
+        if (k < n) {
+            float a[V::kWidth] = { 0 };
+            float b[V::kWidth] = { 0 };
+            for (unsigned int i = 0; i < n - k; i++) {
+                a[i] = buffer[k + i];
+                b[i] = src[k + i];
+            }
+            V::StoreU(a, op(V::LoadU(a), V::LoadU(b)));
+            for (unsigned int i = 0; i < n - k; i++) {
+                buffer[k + i] = a[i];
+            }
+        }
+    }
+};
+
+}  // inline namespace __SIMD_ISA_NS
+
+}  // namespace DSP
+
+#endif  // _BLOCK_KERNELS_HPP_
@@ -0,0 +1,119 @@
+#include "DSPMath.hpp"
+
+
+namespace DSP {
+
+inline namespace __SIMD_ISA_NS {
+
+// out = 2^(scale * in)
+template <Math::Accuracy kAccuracy>
+struct Pow2Op_ {
+    SIMD::Vec scale;
+    SIMD::Vec operator()(SIMD::Vec x) const {
+        return Math::Pow2<kAccuracy, SIMD>(SIMD::Mul(x, scale));
+    }
+};
+
+// out = scale * log2(in)
+template <Math::Accuracy kAccuracy>
+struct Log2Op_ {
+    SIMD::Vec scale;
+    SIMD::Vec operator()(SIMD::Vec x) const {
+        return SIMD::Mul(Math::Log2<kAccuracy, SIMD>(x), scale);
+    }
+};
+
+
+// A vector at a time; the tail goes through one more vector, padded
+// with ones (fine for either function)
+template <class OP_T>
+static void MapBlock(const float *in, float *out, unsigned int n,
+        const OP_T &op) {
+    using V = SIMD;
+    unsigned int k = 0;
+    for (; k + V::kWidth <= n; k += V::kWidth) {
+        V::StoreU(out + k, op(V::LoadU(in + k)));
+    }
+    if (k < n) {
+        float tail[V::kWidth];
+        for (unsigned int i = 0; i < V::kWidth; i++) {
+            tail[i] = (k + i < n) ? in[k + i] : 1.f;
+        }
+        V::StoreU(tail, op(V::LoadU(tail)));
+        for (unsigned int i = 0; i < n - k; i++) {
+            out[k + i] = tail[i];
+        }
+    }
+}
+
+
+static void Pow2Block(const float *in, float *out, unsigned int n,
+        float scale, Math::Accuracy accuracy) {
+    if (accuracy == Math::kFast) {
+        MapBlock(in, out, n, Pow2Op_<Math::kFast> { SIMD::Set1(scale) });
+    } else {
+        MapBlock(in, out, n, Pow2Op_<Math::kPrecise> { SIMD::Set1(scale) });
+    }
+}
+
+
+static void Log2Block(const float *in, float *out, unsigned int n,
+        float scale, Math::Accuracy accuracy) {
+    if (accuracy == Math::kFast) {
+        MapBlock(in, out, n, Log2Op_<Math::kFast> { SIMD::Set1(scale) });
+    } else {
+        MapBlock(in, out, n, Log2Op_<Math::kPrecise> { SIMD::Set1(scale) });
+    }
+}
+
+}  // inline namespace __SIMD_ISA_NS
+
+
+void Math::FastPow2Block(const float *in, float *out, unsigned int n,
+        Accuracy accuracy) {
+    Pow2Block(in, out, n, 1.f, accuracy);
+}
+
+
+void Math::FastLog2Block(const float *in, float *out, unsigned int n,
+        Accuracy accuracy) {
+    Log2Block(in, out, n, 1.f, accuracy);
+}
+
+
+void Math::FastExpBlock(const float *in, float *out, unsigned int n,
+        Accuracy accuracy) {
+    Pow2Block(in, out, n, kLog2OfE, accuracy);
+}
+
+
+void Math::FastLnBlock(const float *in, float *out, unsigned int n,
+        Accuracy accuracy) {
+    Log2Block(in, out, n, kOneOverLog2OfE, accuracy);
+}
+
+
+void Math::FastPow10Block(const float *in, float *out, unsigned int n,
+        Accuracy accuracy) {
+    Pow2Block(in, out, n, kLog2Of10, accuracy);
+}
+
+
+void Math::FastLog10Block(const float *in, float *out, unsigned int n,
+        Accuracy accuracy) {
+    Log2Block(in, out, n, kOneOverLog2Of10, accuracy);
+}
+
+
+void Math::LinTodBBlock(const float *in, float *out, unsigned int n,
+        Accuracy accuracy) {
+    Log2Block(in, out, n, 20.f * kOneOverLog2Of10, accuracy);
+}
+
+
+void Math::dBToLinBlock(const float *in, float *out, unsigned int n,
+        Accuracy accuracy) {
+    Pow2Block(in, out, n, kLog2Of10 / 20.f, accuracy);
+}
+
+}  // namespace DSP
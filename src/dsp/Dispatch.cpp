@@ -0,0 +1,137 @@
+#include "DispatchTable.hpp"
+
+
+namespace DSP {
+
+// Highest instruction set the build itself targets
+#if defined(__AVX512F__)
+static const Dispatch::ISA kBuildISA = Dispatch::kAVX512;
+#elif defined(__AVX2__)
+static const Dispatch::ISA kBuildISA = Dispatch::kAVX2;
+#else
+static const Dispatch::ISA kBuildISA = Dispatch::kBaseline;
+#endif
+
+
+inline namespace __SIMD_ISA_NS {
+
+const KernelTable &GetISAKernels() {
+    static const KernelTable t = MakeKernelTable(true);
+    return t;
+}
+
+}
+
+
+#if defined(__DISPATCH_AVX2) || defined(__DISPATCH_AVX512)
+// An instruction set's table, with the build's kernels where it has none
+static KernelTable CompleteTable(const KernelTable &isa) {
+    KernelTable t = isa;
+    for (unsigned int form = 0; form < 2; form++) {
+        for (unsigned int ch = 0; ch < KernelTable::kBiquadChannels; ch++) {
+            if (t.biquad[form][ch] == nullptr) {
+                t.biquad[form][ch] = GetISAKernels().biquad[form][ch];
+            }
+        }
+    }
+    return t;
+}
+#endif
+
+
+static Dispatch::CPU DetectCPU() {
+    Dispatch::CPU cpu = { false, false, false, false };
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    // Also checks the OS saves the wider registers
+    __builtin_cpu_init();
+    cpu.sse2 = __builtin_cpu_supports("sse2");
+    cpu.avx2 = __builtin_cpu_supports("avx2");
+    cpu.fma = __builtin_cpu_supports("fma");
+    cpu.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+    return cpu;
+}
+
+
+const Dispatch::CPU &Dispatch::GetCPU() {
+    static const CPU cpu = DetectCPU();
+    return cpu;
+}
+
+
+bool Dispatch::IsAvailable(ISA isa) {
+    if (isa <= kBuildISA) {
+        return true;
+    }
+    switch (isa) {
+#if defined(__DISPATCH_AVX2)
+    case kAVX2:
+        return GetCPU().avx2 && GetCPU().fma;
+#endif
+#if defined(__DISPATCH_AVX512)
+    case kAVX512:
+        return GetCPU().avx512f && GetCPU().avx2 && GetCPU().fma;
+#endif
+    default:
+        return false;
+    }
+}
+
+
+Dispatch::ISA &Dispatch::Current_() {
+    static ISA isa = [] {
+        ISA best = kBaseline;
+        for (int i = kBaseline; i < kNumISAs; i++) {
+            if (IsAvailable(static_cast<ISA>(i))) {
+                best = static_cast<ISA>(i);
+            }
+        }
+        return best;
+    }();
+    return isa;
+}
+
+
+Dispatch::ISA Dispatch::GetISA() {
+    return Current_();
+}
+
+
+bool Dispatch::SetISA(ISA isa) {
+    if (isa >= kNumISAs || !IsAvailable(isa)) {
+        return false;
+    }
+    Current_() = isa;
+    return true;
+}
+
+
+const char *Dispatch::GetISAName(ISA isa) {
+    static const char *const kNames[kNumISAs] = { "baseline", "AVX2",
+        "AVX-512" };
+    return (isa < kNumISAs) ? kNames[isa] : "unknown";
+}
+
+
+const KernelTable &Dispatch::GetKernels() {
+    // Instruction sets the build covers share its own kernels
+    switch (Current_()) {
+#if defined(__DISPATCH_AVX512)
+    case kAVX512: {
+        static const KernelTable t =
+            CompleteTable(SIMD_AVX512::GetISAKernels());
+        return t;
+    }
+#endif
+#if defined(__DISPATCH_AVX2)
+    case kAVX2: {
+        static const KernelTable t = CompleteTable(SIMD_AVX2::GetISAKernels());
+        return t;
+    }
+#endif
+    default:
+        return GetISAKernels();
+    }
+}
+
+}  // namespace DSP
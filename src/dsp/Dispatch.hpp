@@ -0,0 +1,142 @@
+#ifndef _DISPATCH_HPP_
+#define _DISPATCH_HPP_
+
+#include "SIMD.hpp"
+
+// Instruction sets built on top of the build's own, each in a translation
+// unit of its own (x86 with GCC only: see DispatchAVX2.cpp). Keep in step
+// with the conditions in Dispatch*.cpp.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    !defined(__clang__)
+#if !defined(__AVX2__)
+#define __DISPATCH_AVX2
+#endif
+#if !defined(__AVX512F__)
+#define __DISPATCH_AVX512
+#endif
+#endif
+
+
+namespace DSP {
+
+struct BiquadCoeffs;
+
+
+/**
+ * @brief Kernels for one instruction set, as function pointers. Lengths
+ * are in floats.
+ *
+ */
+struct KernelTable {
+    // Channel counts with a Biquad kernel in the table
+    static constexpr unsigned int kBiquadChannels = 8;
+    typedef void (*BiquadFn)(const BiquadCoeffs *c, void *s,
+        unsigned int n_sections, float *x, unsigned int n_samples);
+    typedef void (*MeshScatterFn)(float *junc, const float *const *wave,
+        const float *coef, const float *damp, float alpha, unsigned int n);
+    typedef void (*MeshPropagateFn)(float *const *wave_next,
+        const float *const *wave, const float *junc, const float *const *link,
+        const int *offset, unsigned int n);
+
+    void (*gain)(float *buffer, float gain, unsigned int n);
+    void (*accum)(float *buffer, const float *accum, unsigned int n);
+    void (*subtract)(float *buffer, const float *accum, unsigned int n);
+    void (*accum_gain)(float *buffer, const float *accum, float gain,
+        unsigned int n);
+    void (*mix)(float *buffer, const float *buffer2, float gain1, float gain2,
+        unsigned int n);
+    BiquadFn biquad[2][kBiquadChannels];  // [transposed][n_channels - 1]
+    MeshScatterFn mesh_scatter;  // See WaveguideKernels
+    MeshPropagateFn mesh_propagate;
+};
+
+
+/**
+ * @brief Picks kernels for the CPU we're running on, so that one binary
+ * (e.g. the LV2 plugin) runs AVX2 or AVX-512 code where it can and the
+ * build's own instruction set (SSE2, NEON...) elsewhere.
+ *
+ * CPU features are detected once, on first use. Classes bind the kernels
+ * they need when they're set up (see Biquad, Triangular2DMesh), so the
+ * audio thread never asks again.
+ */
+class Dispatch {
+
+ public:
+
+    /**
+     * @brief Widest vector of any instruction set, in floats, and its
+     * alignment (bytes): arrays padded and aligned to them suit kernels
+     * that need whole, aligned vectors whichever set runs them
+     *
+     */
+    static constexpr unsigned int kMaxWidth = 16;
+    static constexpr size_t kMaxAlignment = kMaxWidth * sizeof(float);
+
+    /**
+     * @brief Instruction sets with kernels of their own, in order
+     *
+     */
+    enum ISA {
+        kBaseline,  // What the build targets
+        kAVX2,  // AVX2 and FMA
+        kAVX512,  // AVX-512F (and AVX2, FMA)
+        kNumISAs
+    };
+
+    struct CPU {
+        bool sse2;
+        bool avx2;
+        bool fma;
+        bool avx512f;
+    };
+
+    static const CPU &GetCPU();
+    /**
+     * @brief Whether kernels for isa are built in and the CPU runs them
+     *
+     */
+    static bool IsAvailable(ISA isa);
+    /**
+     * @brief Instruction set in use: the best available, unless set
+     *
+     */
+    static ISA GetISA();
+    /**
+     * @brief Force an instruction set (e.g. to compare kernels). Only
+     * classes set up afterwards pick it up.
+     *
+     * @return false if not available (nothing changes)
+     */
+    static bool SetISA(ISA isa);
+    static const char *GetISAName(ISA isa);
+    /**
+     * @brief Kernels for the instruction set in use
+     *
+     */
+    static const KernelTable &GetKernels();
+
+ private:
+
+    static ISA &Current_();
+};
+
+
+// Each instruction set's table (see Dispatch*.cpp)
+inline namespace __SIMD_ISA_NS {
+const KernelTable &GetISAKernels();
+}
+#if defined(__DISPATCH_AVX2)
+namespace SIMD_AVX2 {
+const KernelTable &GetISAKernels();
+}
+#endif
+#if defined(__DISPATCH_AVX512)
+namespace SIMD_AVX512 {
+const KernelTable &GetISAKernels();
+}
+#endif
+
+}  // namespace DSP
+
+#endif  // _DISPATCH_HPP_
@@ -0,0 +1,27 @@
+// AVX2 kernels (see Dispatch). Everything in here is built for AVX2 and
+// FMA whatever the build flags say, so it must only run on CPUs that
+// have it: include nothing but kernels living in the SIMD namespaces.
+// Same condition as __DISPATCH_AVX2 (Dispatch.hpp), checked before any
+// include so that SIMD.hpp picks the AVX2 backend.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    !defined(__clang__) && !defined(__AVX2__)
+
+#pragma GCC target("avx2,fma")
+#define SIMD_TARGET_AVX2
+#include "DispatchTable.hpp"
+
+
+namespace DSP {
+
+namespace SIMD_AVX2 {
+
+const KernelTable &GetISAKernels() {
+    static const KernelTable t = MakeKernelTable(false);
+    return t;
+}
+
+}
+
+}  // namespace DSP
+
+#endif
@@ -0,0 +1,27 @@
+// AVX-512 kernels (see Dispatch). Everything in here is built for
+// AVX-512F whatever the build flags say, so it must only run on CPUs that
+// have it: include nothing but kernels living in the SIMD namespaces.
+// Same condition as __DISPATCH_AVX512 (Dispatch.hpp), checked before any
+// include so that SIMD.hpp picks the AVX512 backend.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    !defined(__clang__) && !defined(__AVX512F__)
+
+#pragma GCC target("avx512f,avx2,fma")
+#define SIMD_TARGET_AVX512
+#include "DispatchTable.hpp"
+
+
+namespace DSP {
+
+namespace SIMD_AVX512 {
+
+const KernelTable &GetISAKernels() {
+    static const KernelTable t = MakeKernelTable(false);
+    return t;
+}
+
+}
+
+}  // namespace DSP
+
+#endif
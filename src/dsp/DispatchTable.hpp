@@ -0,0 +1,63 @@
+#ifndef _DISPATCH_TABLE_HPP_
+#define _DISPATCH_TABLE_HPP_
+
+#include "BiquadKernel.hpp"
+#include "BlockKernels.hpp"
+#include "Dispatch.hpp"
+#include "WaveguideKernels.hpp"
+
+
+namespace DSP {
+
+inline namespace __SIMD_ISA_NS {
+
+// Biquad entries for 1 to n_channels channels. Each vector is one
+// latency-bound recursion, so wider vectors only pay with two of them or
+// more: unless narrow, fewer channels are left empty (mono is pipelined
+// across lanes instead, so it always has one).
+template <unsigned int n_channels>
+struct FillBiquadTable_ {
+    static void Fill(KernelTable &t, bool narrow) {
+        bool fits = n_channels == 1 || n_channels >= 2 * SIMD::kWidth;
+        t.biquad[0][n_channels - 1] = (narrow || fits) ?
+            &BiquadKernel<n_channels>::template RunUntyped<false> : nullptr;
+        t.biquad[1][n_channels - 1] = (narrow || fits) ?
+            &BiquadKernel<n_channels>::template RunUntyped<true> : nullptr;
+        FillBiquadTable_<n_channels - 1>::Fill(t, narrow);
+    }
+};
+
+template <>
+struct FillBiquadTable_<0> {
+    static void Fill(KernelTable &, bool) {}
+};
+
+
+/**
+ * @brief This instruction set's kernels. Only for the translation units
+ * that define GetISAKernels(), one per instruction set: anything they
+ * include is compiled for it.
+ *
+ * @param narrow Also fill in Biquad entries narrower than a vector (the
+ * build's own table must have every entry)
+ */
+inline KernelTable MakeKernelTable(bool narrow) {
+    static_assert(SIMD::kWidth <= Dispatch::kMaxWidth,
+        "Dispatch::kMaxWidth must cover every instruction set");
+    KernelTable t;
+    t.gain = &BlockKernels::Gain;
+    t.accum = &BlockKernels::Accum;
+    t.subtract = &BlockKernels::Subtract;
+    t.accum_gain = &BlockKernels::AccumGain;
+    t.mix = &BlockKernels::Mix;
+    FillBiquadTable_<KernelTable::kBiquadChannels>::Fill(t, narrow);
+    t.mesh_scatter = &WaveguideKernels::Scatter;
+    t.mesh_propagate = &WaveguideKernels::Propagate;
+    return t;
+}
+
+}  // inline namespace __SIMD_ISA_NS
+
+}  // namespace DSP
+
+#endif  // _DISPATCH_TABLE_HPP_
@@ -0,0 +1,168 @@
+/**
+ * @file FFT.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-21
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "FFT.hpp"
+#include <cassert>
+#include <cmath>
+
+
+namespace DSP {
+
+
+size_t FFT::GetMemSize(unsigned int n) {
+    // Twiddles (n/2 complex) plus bit-reversal table (n/2 indices)
+    return n * sizeof(float) + (n >> 1) * sizeof(uint32_t);
+}
+
+
+FFT::FFT(unsigned int n, void *mem) :
+        n_(n),
+        n_complex_(n >> 1) {
+
+    assert(n >= 4);
+    assert((n & (n - 1)) == 0);  // Power of 2 only
+
+    twiddle_ = reinterpret_cast<float *>(mem);
+    bitrev_ = reinterpret_cast<uint32_t *>(twiddle_ + n);
+
+    // Use double for the tables, they're computed only once
+    for (unsigned int k = 0; k < n_complex_; k++) {
+        double phase = -2. * M_PI * static_cast<double>(k) / n_;
+        twiddle_[2 * k] = static_cast<float>(std::cos(phase));
+        twiddle_[2 * k + 1] = static_cast<float>(std::sin(phase));
+    }
+
+    unsigned int n_bits = 0;
+    while ((1u << n_bits) < n_complex_) {
+        n_bits++;
+    }
+    for (unsigned int k = 0; k < n_complex_; k++) {
+        uint32_t r = 0;
+        for (unsigned int b = 0; b < n_bits; b++) {
+            r |= ((k >> b) & 0x1) << (n_bits - 1 - b);
+        }
+        bitrev_[k] = r;
+    }
+}
+
+
+void FFT::Complex_(float *z, int sign) {
+
+    // Bit-reversal permutation
+    for (unsigned int k = 0; k < n_complex_; k++) {
+        unsigned int r = bitrev_[k];
+        if (r > k) {
+            float tmp_re = z[2 * k];
+            float tmp_im = z[2 * k + 1];
+            z[2 * k] = z[2 * r];
+            z[2 * k + 1] = z[2 * r + 1];
+            z[2 * r] = tmp_re;
+            z[2 * r + 1] = tmp_im;
+        }
+    }
+
+    // Butterflies. Twiddle table is for n_ points, so a stage of length
+    // len (complex) steps through it by n_/len.
+    for (unsigned int len = 2; len <= n_complex_; len <<= 1) {
+        unsigned int half = len >> 1;
+        unsigned int tw_step = n_ / len;
+        for (unsigned int start = 0; start < n_complex_; start += len) {
+            for (unsigned int j = 0; j < half; j++) {
+                float w_re = twiddle_[2 * j * tw_step];
+                float w_im = (sign < 0) ? twiddle_[2 * j * tw_step + 1] :
+                    -twiddle_[2 * j * tw_step + 1];
+                float *a = z + 2 * (start + j);
+                float *b = z + 2 * (start + j + half);
+                float t_re = b[0] * w_re - b[1] * w_im;
+                float t_im = b[0] * w_im + b[1] * w_re;
+                b[0] = a[0] - t_re;
+                b[1] = a[1] - t_im;
+                a[0] += t_re;
+                a[1] += t_im;
+            }
+        }
+    }
+}
+
+
+void FFT::ForwardReal(const float *in, float *out) {
+
+    // Pack even/odd samples as a half-size complex signal
+    for (unsigned int k = 0; k < n_; k++) {
+        out[k] = in[k];
+    }
+    Complex_(out, -1);
+
+    // Split the two interleaved spectra:
+    // X[k] = Ze[k] + W^k * Zo[k], with
+    // Ze[k] = (Z[k] + Z*[N-k]) / 2, Zo[k] = (Z[k] - Z*[N-k]) / 2i
+    const unsigned int n_c = n_complex_;
+    float dc_re = out[0];
+    float dc_im = out[1];
+    out[0] = dc_re + dc_im;
+    out[1] = 0;
+    out[2 * n_c] = dc_re - dc_im;
+    out[2 * n_c + 1] = 0;
+    for (unsigned int k = 1; k <= (n_c >> 1); k++) {
+        unsigned int nk = n_c - k;
+        float zk_re = out[2 * k];
+        float zk_im = out[2 * k + 1];
+        float znk_re = out[2 * nk];
+        float znk_im = out[2 * nk + 1];
+        float e_re = 0.5f * (zk_re + znk_re);
+        float e_im = 0.5f * (zk_im - znk_im);
+        float o_re = 0.5f * (zk_im + znk_im);
+        float o_im = -0.5f * (zk_re - znk_re);
+        float w_re = twiddle_[2 * k];
+        float w_im = twiddle_[2 * k + 1];
+        float wo_re = w_re * o_re - w_im * o_im;
+        float wo_im = w_re * o_im + w_im * o_re;
+        out[2 * k] = e_re + wo_re;
+        out[2 * k + 1] = e_im + wo_im;
+        // Mirror bin: W^(N-k) = -conj(W^k)
+        out[2 * nk] = e_re - wo_re;
+        out[2 * nk + 1] = -(e_im - wo_im);
+    }
+}
+
+
+void FFT::InverseReal(const float *in, float *out) {
+
+    // Merge back into a half-size complex spectrum:
+    // Z[k] = Ze[k] + i * Zo[k], with
+    // Ze[k] = (X[k] + X*[N-k]) / 2, Zo[k] = (X[k] - X*[N-k]) * conj(W^k) / 2
+    const unsigned int n_c = n_complex_;
+    for (unsigned int k = 0; k < n_c; k++) {
+        unsigned int nk = n_c - k;
+        float xk_re = in[2 * k];
+        float xk_im = in[2 * k + 1];
+        float xnk_re = in[2 * nk];
+        float xnk_im = in[2 * nk + 1];
+        float e_re = 0.5f * (xk_re + xnk_re);
+        float e_im = 0.5f * (xk_im - xnk_im);
+        float d_re = 0.5f * (xk_re - xnk_re);
+        float d_im = 0.5f * (xk_im + xnk_im);
+        float w_re = twiddle_[2 * k];
+        float w_im = -twiddle_[2 * k + 1];
+        float o_re = d_re * w_re - d_im * w_im;
+        float o_im = d_re * w_im + d_im * w_re;
+        out[2 * k] = e_re - o_im;
+        out[2 * k + 1] = e_im + o_re;
+    }
+    Complex_(out, 1);
+
+    const float scale = 1.f / static_cast<float>(n_c);
+    for (unsigned int k = 0; k < n_; k++) {
+        out[k] *= scale;
+    }
+}
+
+}  // namespace DSP
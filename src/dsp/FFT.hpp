@@ -0,0 +1,77 @@
+#ifndef _FFT_HPP_
+#define _FFT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace DSP {
+
+/**
+ * @brief Radix-2 FFT of real signals, computed as a half-size complex FFT.
+ *
+ * Twiddles and bit-reversal tables live in externally allocated memory
+ * (see GetMemSize()), so the transform itself never allocates and is
+ * safe to run on the audio thread.
+ *
+ * Spectra are stored as interleaved (re, im) pairs, from DC up to and
+ * including Nyquist: a spectrum of an n-point signal is n + 2 floats long.
+ */
+class FFT {
+
+ public:
+
+    /**
+     * @brief Memory needed by an FFT of a given size
+     *
+     * @param n Number of real points (power of 2, at least 4)
+     * @return size_t Bytes
+     */
+    static size_t GetMemSize(unsigned int n);
+    /**
+     * @brief Construct a new FFT object
+     *
+     * @param n Number of real points (power of 2, at least 4)
+     * @param mem Memory of GetMemSize(n) bytes. Allocate externally.
+     */
+    FFT(unsigned int n, void *mem);
+    /**
+     * @brief Real to complex transform (out-of-place).
+     *
+     * @param in n real samples
+     * @param out n + 2 floats: n/2 + 1 complex bins
+     */
+    void ForwardReal(const float *in, float *out);
+    /**
+     * @brief Complex to real transform (out-of-place), scaled so that
+     * InverseReal(ForwardReal(x)) == x.
+     *
+     * @param in n + 2 floats: n/2 + 1 complex bins
+     * @param out n real samples
+     */
+    void InverseReal(const float *in, float *out);
+    /**
+     * @brief Number of real points
+     *
+     */
+    unsigned int GetSize() { return n_; }
+
+ protected:
+
+    /**
+     * @brief In-place complex FFT of n_/2 points, unscaled
+     *
+     * @param z Interleaved complex data
+     * @param sign -1 for forward, +1 for inverse
+     */
+    void Complex_(float *z, int sign);
+
+    unsigned int n_;
+    unsigned int n_complex_;
+    float *twiddle_;  // exp(-2*pi*i*k/n) for k in [0, n/2)
+    uint32_t *bitrev_;
+};
+
+}  // namespace DSP
+
+#endif  // _FFT_HPP_
@@ -10,6 +10,8 @@
  */
 
 #include "Filter.hpp"
+#include <cmath>
+#include "SIMD.hpp"
 
 namespace DSP {
 
@@ -26,11 +28,40 @@ void ARSmoother::Reset() {
 }
 
 
+void ARSmoother::SetAlphas(float alpha_attack, float alpha_release) {
+    alpha_a_ = alpha_attack;
+    alpha_r_ = alpha_release;
+}
+
+
+void ARSmoother::SetTimes(float attack_ms, float release_ms, float fs) {
+    SetAlphas(GetAlpha(attack_ms, fs), GetAlpha(release_ms, fs));
+}
+
+
+float ARSmoother::GetAlpha(float time_ms, float fs) {
+    if (time_ms <= 0) {
+        return 1.f;
+    }
+    // A step gets to 1 - 1/e in time_ms
+    return 1.f - std::exp(-1000.f / (time_ms * fs));
+}
+
+
 float ARSmoother::ProcessSample(float in) {
-    float alpha = (in > y_1_) ? alpha_a_ : alpha_r_;
+    using O = SIMDScalar;
+    float alpha = O::Select(O::CmpLe(in, y_1_), alpha_r_, alpha_a_);
     y_1_ = in * alpha + (1.f - alpha) * y_1_;
     return y_1_;
 }
 
 
+void ARSmoother::ProcessBuffer(const float *in, float *out,
+        unsigned int n_samples) {
+    for (unsigned int n = 0; n < n_samples; n++) {
+        out[n] = ProcessSample(in[n]);
+    }
+}
+
+
 }  // namespace DSP
@@ -2,26 +2,22 @@
 #define _FILTER_HPP_
 
 #include <cassert>
+#include "BiquadKernel.hpp"
+#include "Dispatch.hpp"
 
 
 namespace DSP {
-    
-/**
- * @brief Coefficients in a 5-number format (a0 ignored)
- * 
- */
-struct BiquadCoeffs {
-    float b0;
-    float b1;
-    float b2;
-    float a1;
-    float a2;
-};
 
 
 /**
  * @brief Biquad (or second-order section)
- * 
+ *
+ * Buffers can be interleaved (frames of n_channels samples) or planar
+ * (one buffer per channel). They run through the kernels for the CPU's
+ * best instruction set (see BiquadKernel, Dispatch), bound when the
+ * filter is constructed; single frames always run through the build's
+ * own.
+ *
  * @tparam n_channels Number of channels to be processed, assumed
  * to be immutable for the life of the instance.
  */
@@ -34,9 +30,16 @@ class Biquad {
      * @brief Memory of one section of the filter
      * 
      */
-    struct State {
-        float z1[n_channels];
-        float z2[n_channels];
+    typedef BiquadState<n_channels> State;
+
+    /**
+     * @brief Filter structure
+     *
+     */
+    enum Form {
+        kDF2,  // Direct form 2: one delay line per section
+        kTDF2,  // Transposed direct form 2: less roundoff noise and
+                // smaller state swings with poles near z = 1
     };
 
     /**
@@ -52,6 +55,12 @@ class Biquad {
      * 
      */
     void Reset();
+    /**
+     * @brief Switch filter structure (resets memory: the two forms keep
+     * different states). DF2 by default.
+     *
+     */
+    void SetForm(Form form);
     /**
      * @brief Process a single frame of data.
      * 
@@ -61,10 +70,17 @@ class Biquad {
     /**
      * @brief Process buffer of frames.
      * 
-     * @param buffer Audio buffer
+     * @param buffer Audio buffer, interleaved
      * @param n_samples Number of frames in audio buffer
      */
     void ProcessBuffer(float *buffer, unsigned int n_samples);
+    /**
+     * @brief Process one buffer per channel.
+     *
+     * @param buffers n_channels buffers of n_samples each
+     * @param n_samples Number of samples in each buffer
+     */
+    void ProcessBufferPlanar(float *const *buffers, unsigned int n_samples);
     /**
      * @brief Set the Coefficients object (deep copy)
      * 
@@ -74,24 +90,17 @@ class Biquad {
     void SetCoefficients(unsigned int sos_index, BiquadCoeffs &c);
 
  private:
-    
-    /**
-     * @brief DF2 kernel - perform filtering of all channels at once
-     * 
-     */
-    static __attribute__((always_inline)) void DF2_(
-            BiquadCoeffs *c, State *s, float *x) {
-        for (unsigned int ch = 0; ch < n_channels; ch++) {
-            float w = x[ch] - c->a1 * s->z1[ch] - c->a2 * s->z2[ch];
-            x[ch] = c->b0 * w + c->b1 * s->z1[ch] + c->b2 * s->z2[ch];
-            s->z2[ch] = s->z1[ch];
-            s->z1[ch] = w;
-        }
-    }
+
+    // Frames interleaved at a time from planar buffers (on the stack)
+    static constexpr unsigned int kPlanarChunk = 64;
+
+    void BindKernel_();
     
     const unsigned int n_sections_;
     BiquadCoeffs *c_;
     State *s_;
+    Form form_;
+    KernelTable::BiquadFn kernel_;  // For buffers
 
 };
 
@@ -99,7 +108,9 @@ template<unsigned int n_channels>
 Biquad<n_channels>::Biquad(unsigned int n_sections, BiquadCoeffs *c, State *s) :
         n_sections_(n_sections),
         c_(c),
-        s_(s) {
+        s_(s),
+        form_(kDF2) {
+    BindKernel_();
     Reset();
 }
 
@@ -115,32 +126,68 @@ void Biquad<n_channels>::Reset() {
     }
 }
 
+
+template<unsigned int n_channels>
+void Biquad<n_channels>::SetForm(Form form) {
+    form_ = form;
+    BindKernel_();
+    Reset();
+}
+
+
+template<unsigned int n_channels>
+void Biquad<n_channels>::BindKernel_() {
+    bool transposed = (form_ == kTDF2);
+    if (n_channels <= KernelTable::kBiquadChannels) {
+        kernel_ = Dispatch::GetKernels().biquad[transposed][n_channels - 1];
+    } else if (transposed) {
+        kernel_ = &BiquadKernel<n_channels>::template RunUntyped<true>;
+    } else {
+        kernel_ = &BiquadKernel<n_channels>::template RunUntyped<false>;
+    }
+}
+
+
 template<unsigned int n_channels>
 void Biquad<n_channels>::ProcessFrame(float *x) {
-    BiquadCoeffs *c = c_;
-    State *s = s_;
-    for (unsigned int n = 0; n < n_sections_; n++) {
-        // Direct form 2 kernel
-        DF2_(c, s, x);
-        c++;
-        s++;
+    // Inline: not worth a call through the kernel table
+    if (form_ == kDF2) {
+        BiquadKernel<n_channels>::template Run<false>(c_, s_, n_sections_,
+            x, 1);
+    } else {
+        BiquadKernel<n_channels>::template Run<true>(c_, s_, n_sections_,
+            x, 1);
     }
 }
 
+
 template<unsigned int n_channels>
 void Biquad<n_channels>::ProcessBuffer(float *buffer, unsigned int n_samples) {
-    BiquadCoeffs *c = c_;
-    State *s = s_;
-    // Loop through SOS first, then samples (cache coefficients)
-    for (unsigned int n = 0; n < n_sections_; n++) {
-        float *buffer_head = buffer;
-        for (unsigned int k = 0; k < n_samples; k++) {
-            // Direct form 2 kernel
-            DF2_(c, s, buffer_head);
-            buffer_head += n_channels;
+    kernel_(c_, s_, n_sections_, buffer, n_samples);
+}
+
+
+template<unsigned int n_channels>
+void Biquad<n_channels>::ProcessBufferPlanar(float *const *buffers,
+        unsigned int n_samples) {
+    // Interleave a chunk at a time, so channels still share vectors
+    float frames[kPlanarChunk * n_channels];
+    for (unsigned int start = 0; start < n_samples; start += kPlanarChunk) {
+        unsigned int n = (n_samples - start < kPlanarChunk) ?
+            n_samples - start : kPlanarChunk;
+        for (unsigned int ch = 0; ch < n_channels; ch++) {
+            const float *in = buffers[ch] + start;
+            for (unsigned int k = 0; k < n; k++) {
+                frames[k * n_channels + ch] = in[k];
+            }
+        }
+        kernel_(c_, s_, n_sections_, frames, n);
+        for (unsigned int ch = 0; ch < n_channels; ch++) {
+            float *out = buffers[ch] + start;
+            for (unsigned int k = 0; k < n; k++) {
+                out[k] = frames[k * n_channels + ch];
+            }
         }
-        c++;
-        s++;
     }
 }
 
@@ -153,11 +200,43 @@ void Biquad<n_channels>::SetCoefficients(
 }
 
 
+/**
+ * @brief Attack/release envelope smoother: a one-pole lowpass, with one
+ * coefficient while the input rises above the output and another while
+ * it falls. The choice is a select, not a branch.
+ *
+ * See ARSmootherBank for many channels at once.
+ */
 class ARSmoother {
  public:
     ARSmoother(float alpha_attack, float alpha_release);
     float ProcessSample(float in);
+    /**
+     * @brief Process buffer of samples (in-place allowed)
+     *
+     * @param in Input buffer
+     * @param out Output buffer
+     * @param n_samples Number of samples
+     */
+    void ProcessBuffer(const float *in, float *out, unsigned int n_samples);
     void Reset();
+    void SetAlphas(float alpha_attack, float alpha_release);
+    /**
+     * @brief Set attack and release from time constants (to 1 - 1/e of a
+     * step)
+     *
+     * @param attack_ms Attack time constant
+     * @param release_ms Release time constant
+     * @param fs Sample rate
+     */
+    void SetTimes(float attack_ms, float release_ms, float fs);
+    /**
+     * @brief Coefficient for a time constant (1 for 0 ms)
+     *
+     * @param time_ms Time constant
+     * @param fs Sample rate
+     */
+    static float GetAlpha(float time_ms, float fs);
 
  protected:
     float alpha_a_;
@@ -1,8 +1,123 @@
 #include "FilterDesigner.hpp"
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <complex>
+#include "DSPMath.hpp"
 
 namespace DSP {
 
+// Section of an analog prototype with cutoff 1 rad/s: s^2 + a s + b, or
+// s + a if first order
+struct AnalogSection_ {
+    double a;
+    double b;
+    bool first_order;
+};
+
+
+// Poles of a Bessel filter: roots of the reverse Bessel polynomial
+// (Durand-Kerner), scaled like SciPy's norm='phase'
+static void BesselPoles(unsigned int order, std::complex<double> *p) {
+    // Coefficients, lowest power first: (2N - k)! / (2^(N - k) k! (N - k)!)
+    double coeffs[FilterDesigner::kMaxOrder + 1];
+    coeffs[order] = 1.;
+    for (unsigned int k = order; k > 0; k--) {
+        // Ratio of coefficient k - 1 to coefficient k
+        coeffs[k - 1] = coeffs[k] * (2 * order - k + 1) * k /
+            (2. * (order - k + 1));
+    }
+    for (unsigned int k = 0; k < order; k++) {
+        p[k] = std::pow(std::complex<double>(0.4, 0.9), k);
+    }
+    for (unsigned int iter = 0; iter < 500; iter++) {
+        double change = 0;
+        for (unsigned int k = 0; k < order; k++) {
+            std::complex<double> num = coeffs[order];
+            for (unsigned int j = order; j > 0; j--) {
+                num = num * p[k] + coeffs[j - 1];
+            }
+            std::complex<double> den = 1.;
+            for (unsigned int j = 0; j < order; j++) {
+                if (j != k) {
+                    den *= p[k] - p[j];
+                }
+            }
+            std::complex<double> step = num / den;
+            p[k] -= step;
+            change = std::max(change, std::abs(step));
+        }
+        if (change < 1e-14) {
+            break;
+        }
+    }
+    // Product of the roots is coeffs[0]: scale them to a product of 1
+    double scale = std::pow(coeffs[0], -1. / order);
+    for (unsigned int k = 0; k < order; k++) {
+        p[k] *= scale;
+    }
+}
+
+
+// Sections of an analog lowpass prototype, in order of increasing Q
+static unsigned int AnalogPrototype(FilterDesigner::Prototype p,
+        unsigned int order, AnalogSection_ *s) {
+    unsigned int n = 0;
+    switch (p) {
+    case FilterDesigner::kButterworth:
+        if (order % 2) {
+            s[n++] = { 1., 0., true };
+        }
+        // Poles on the unit circle, furthest from the imaginary axis first
+        for (unsigned int k = order / 2; k > 0; k--) {
+            double a = 2. * std::sin(M_PI * (2 * k - 1) / (2. * order));
+            s[n++] = { a, 1., false };
+        }
+        break;
+    case FilterDesigner::kBessel: {
+        std::complex<double> poles[FilterDesigner::kMaxOrder];
+        BesselPoles(order, poles);
+        for (unsigned int k = 0; k < order; k++) {
+            if (std::abs(poles[k].imag()) < 1e-9) {
+                s[n++] = { -poles[k].real(), 0., true };
+            }
+        }
+        for (unsigned int k = 0; k < order; k++) {
+            if (poles[k].imag() >= 1e-9) {
+                s[n++] = { -2. * poles[k].real(), std::norm(poles[k]),
+                    false };
+            }
+        }
+        // Q = sqrt(b) / a, in increasing order (insertion sort)
+        for (unsigned int i = (order % 2); i < n; i++) {
+            for (unsigned int j = i; j > (order % 2) &&
+                    std::sqrt(s[j].b) / s[j].a <
+                    std::sqrt(s[j - 1].b) / s[j - 1].a; j--) {
+                std::swap(s[j], s[j - 1]);
+            }
+        }
+        break;
+    }
+    case FilterDesigner::kLinkwitzRiley: {
+        AnalogSection_ half[FilterDesigner::kMaxOrder / 2];
+        unsigned int n_half = AnalogPrototype(FilterDesigner::kButterworth,
+            order / 2, half);
+        for (unsigned int k = 0; k < n_half; k++) {
+            if (half[k].first_order) {
+                // (s + 1)^2
+                s[n++] = { 2., 1., false };
+            } else {
+                s[n++] = half[k];
+                s[n++] = half[k];
+            }
+        }
+        break;
+    }
+    }
+    return n;
+}
+
+
 void FilterDesigner::ResonantLowpass(BiquadCoeffs *c, float fs,
         float f_cut, float q_factor, float gain) {
     // Pre-calculate factors used more than once
@@ -65,4 +180,164 @@ void FilterDesigner::ScaleByA0(float *b, float *a, float gain,
     c->a2 = a[2];
 }
 
+
+void FilterDesigner::ScaleByA0(double *b, double *a, double gain,
+        BiquadCoeffs *c) {
+    // As the float version, rounding once at the end
+    double coeff = 1. / a[0];
+    c->b0 = b[0] * coeff * gain;
+    c->b1 = b[1] * coeff * gain;
+    c->b2 = b[2] * coeff * gain;
+    c->a1 = a[1] * coeff;
+    c->a2 = a[2] * coeff;
+}
+
+
+unsigned int FilterDesigner::GetNumSections(Prototype p, unsigned int order) {
+    if (p == kLinkwitzRiley) {
+        // Pairs of sections, the first-order ones merged
+        unsigned int half = order / 2;
+        return 2 * (half / 2) + (half % 2);
+    }
+    return (order + 1) / 2;
+}
+
+
+unsigned int FilterDesigner::Lowpass(BiquadCoeffs *c, Prototype p,
+        unsigned int order, float fs, float f_cut, float gain) {
+    return Design_(c, p, order, fs, f_cut, gain, false);
+}
+
+
+unsigned int FilterDesigner::Highpass(BiquadCoeffs *c, Prototype p,
+        unsigned int order, float fs, float f_cut, float gain) {
+    return Design_(c, p, order, fs, f_cut, gain, true);
+}
+
+
+unsigned int FilterDesigner::Crossover(BiquadCoeffs *lpf, BiquadCoeffs *hpf,
+        Prototype p, unsigned int order, float fs, float f_cut) {
+    float hpf_gain = (p == kLinkwitzRiley && order % 4 == 2) ? -1.f : 1.f;
+    Lowpass(lpf, p, order, fs, f_cut, 1.f);
+    return Highpass(hpf, p, order, fs, f_cut, hpf_gain);
+}
+
+
+unsigned int FilterDesigner::Design_(BiquadCoeffs *c, Prototype p,
+        unsigned int order, float fs, float f_cut, float gain,
+        bool highpass) {
+    assert(order > 0 && order <= kMaxOrder);
+    assert(p != kLinkwitzRiley || order % 2 == 0);
+    AnalogSection_ s[kMaxOrder];
+    unsigned int n_sections = AnalogPrototype(p, order, s);
+
+    // Bilinear transform, s = (1 - z^-1) / (k (1 + z^-1)): the analog
+    // cutoff lands on f_cut
+    double k = std::tan(M_PI * f_cut / fs);
+    for (unsigned int n = 0; n < n_sections; n++) {
+        double a_s = s[n].a;
+        double b_s = s[n].b;
+        double b[3];
+        double a[3];
+        if (s[n].first_order) {
+            // Lowpass a / (s + a); highpass s / (s + 1 / a)
+            if (highpass) {
+                a_s = 1. / a_s;
+            }
+            double ak = a_s * k;
+            b[0] = highpass ? 1. : ak;
+            b[1] = highpass ? -1. : ak;
+            b[2] = 0.;
+            a[0] = 1. + ak;
+            a[1] = ak - 1.;
+            a[2] = 0.;
+        } else {
+            // Lowpass b / (s^2 + a s + b); highpass s^2 / (s^2 + a / b s
+            // + 1 / b) (poles at 1 / p)
+            if (highpass) {
+                a_s = a_s / b_s;
+                b_s = 1. / b_s;
+            }
+            double ak = a_s * k;
+            double bk2 = b_s * k * k;
+            b[0] = highpass ? 1. : bk2;
+            b[1] = highpass ? -2. : 2. * bk2;
+            b[2] = b[0];
+            a[0] = 1. + ak + bk2;
+            a[1] = 2. * (bk2 - 1.);
+            a[2] = 1. - ak + bk2;
+        }
+        ScaleByA0(b, a, (n == 0) ? gain : 1., &c[n]);
+    }
+    return n_sections;
+}
+
+
+size_t BiquadTable::GetMemSize(unsigned int n_sections,
+        unsigned int n_points) {
+    return n_sections * n_points * sizeof(BiquadCoeffs);
+}
+
+
+BiquadTable::BiquadTable(unsigned int n_sections, unsigned int n_points,
+        float f_min, float f_max, void *mem) :
+        n_sections_(n_sections),
+        n_points_(n_points),
+        f_min_(f_min),
+        log2_f_min_(Math::FastLog2(f_min, Math::kPrecise)),
+        c_(static_cast<BiquadCoeffs *>(mem)) {
+    assert(n_points >= 2);
+    assert(f_min > 0 && f_max > f_min);
+    points_per_octave_ = (n_points - 1) / std::log2(f_max / f_min);
+    // Pass-through until filled
+    for (unsigned int n = 0; n < n_sections * n_points; n++) {
+        c_[n] = { 1.f, 0.f, 0.f, 0.f, 0.f };
+    }
+}
+
+
+bool BiquadTable::Fill(FilterDesigner::Prototype p, bool highpass,
+        unsigned int order, float fs, float gain) {
+    if (FilterDesigner::GetNumSections(p, order) != n_sections_) {
+        return false;
+    }
+    for (unsigned int n = 0; n < n_points_; n++) {
+        if (highpass) {
+            FilterDesigner::Highpass(c_ + n * n_sections_, p, order, fs,
+                GetCutoff(n), gain);
+        } else {
+            FilterDesigner::Lowpass(c_ + n * n_sections_, p, order, fs,
+                GetCutoff(n), gain);
+        }
+    }
+    return true;
+}
+
+
+void BiquadTable::Lookup(float f_cut, BiquadCoeffs *c) const {
+    // No libm on the audio thread
+    float x = (f_cut > f_min_) ? (Math::FastLog2(f_cut, Math::kPrecise) -
+        log2_f_min_) * points_per_octave_ : 0.f;
+    unsigned int n = static_cast<unsigned int>(x);
+    if (n >= n_points_ - 1) {
+        n = n_points_ - 2;
+        x = n_points_ - 1;
+    }
+    float frac = x - n;
+    const BiquadCoeffs *c0 = c_ + n * n_sections_;
+    const BiquadCoeffs *c1 = c0 + n_sections_;
+    for (unsigned int k = 0; k < n_sections_; k++) {
+        c[k].b0 = c0[k].b0 + frac * (c1[k].b0 - c0[k].b0);
+        c[k].b1 = c0[k].b1 + frac * (c1[k].b1 - c0[k].b1);
+        c[k].b2 = c0[k].b2 + frac * (c1[k].b2 - c0[k].b2);
+        c[k].a1 = c0[k].a1 + frac * (c1[k].a1 - c0[k].a1);
+        c[k].a2 = c0[k].a2 + frac * (c1[k].a2 - c0[k].a2);
+    }
+}
+
+
+float BiquadTable::GetCutoff(unsigned int n) const {
+    return f_min_ * std::exp2(n / points_per_octave_);
+}
+
 }
@@ -1,6 +1,7 @@
 #ifndef _FILTER_DESIGNER_HPP_
 #define _FILTER_DESIGNER_HPP_
 
+#include <cstddef>
 #include "Filter.hpp"
 
 namespace DSP {
@@ -12,6 +13,25 @@ namespace DSP {
 class FilterDesigner {
 
  public:
+
+    /**
+     * @brief Analog prototypes for higher-order designs
+     *
+     */
+    enum Prototype {
+        kButterworth,  // Maximally flat magnitude, -3 dB at cutoff
+        kBessel,  // Maximally flat group delay; phase-matched to
+                  // Butterworth at high frequencies (SciPy's norm='phase')
+        kLinkwitzRiley,  // Butterworth of half the order, squared: -6 dB
+                         // at cutoff (even orders only)
+    };
+
+    /**
+     * @brief Highest order Lowpass() and Highpass() design
+     *
+     */
+    static constexpr unsigned int kMaxOrder = 8;
+
     /**
      * @brief Resonant second-order lowpass filter
      * 
@@ -36,6 +56,53 @@ class FilterDesigner {
     static void ResonantHighpass(BiquadCoeffs *c, float fs,
             float f_cut, float q_factor, float gain);
 
+    /**
+     * @brief Number of second-order sections for a design
+     *
+     * @param p Prototype
+     * @param order Filter order (1 to kMaxOrder; even for Linkwitz-Riley)
+     */
+    static unsigned int GetNumSections(Prototype p, unsigned int order);
+
+    /**
+     * @brief N-order lowpass filter, as second-order sections (bilinear
+     * transform, prewarped at the cutoff). Sections come in order of
+     * increasing Q; odd orders start with a first-order one.
+     *
+     * Not for the audio thread (trig calls): see BiquadTable to sweep
+     * cutoffs at run time.
+     *
+     * @param c Array of GetNumSections(p, order) sections (in-place
+     * creation)
+     * @param p Prototype
+     * @param order Filter order (1 to kMaxOrder; even for Linkwitz-Riley)
+     * @param fs Sample rate
+     * @param f_cut Cutoff frequency
+     * @param gain Gain of filter (applied to the first section)
+     * @return unsigned int Number of sections written
+     */
+    static unsigned int Lowpass(BiquadCoeffs *c, Prototype p,
+            unsigned int order, float fs, float f_cut, float gain = 1.f);
+
+    /**
+     * @brief N-order highpass filter, as Lowpass()
+     *
+     */
+    static unsigned int Highpass(BiquadCoeffs *c, Prototype p,
+            unsigned int order, float fs, float f_cut, float gain = 1.f);
+
+    /**
+     * @brief Lowpass and highpass pair splitting at f_cut. With
+     * Linkwitz-Riley, the bands sum to an allpass: for orders 2 and 6 the
+     * highpass comes out inverted to make that so.
+     *
+     * @param lpf Array of GetNumSections(p, order) sections
+     * @param hpf Array of GetNumSections(p, order) sections
+     * @return unsigned int Number of sections in each band
+     */
+    static unsigned int Crossover(BiquadCoeffs *lpf, BiquadCoeffs *hpf,
+            Prototype p, unsigned int order, float fs, float f_cut);
+
  private:
     /**
      * @brief Scale B and A array by A[0] and format into a Biquad
@@ -48,6 +115,93 @@ class FilterDesigner {
      */
     static void ScaleByA0(float *b, float *a, float gain,
             BiquadCoeffs *c);
+    static void ScaleByA0(double *b, double *a, double gain,
+            BiquadCoeffs *c);
+    static unsigned int Design_(BiquadCoeffs *c, Prototype p,
+            unsigned int order, float fs, float f_cut, float gain,
+            bool highpass);
+};
+
+
+/**
+ * @brief Precomputed filter designs over a range of cutoffs, for sweeps
+ * from control ports: Lookup() interpolates between the two nearest
+ * designs with no trig or pow calls, so it can run on the audio thread.
+ *
+ * Cutoffs are spaced evenly in octaves. Interpolating coefficients
+ * linearly keeps every section stable (stable (a1, a2) pairs make a
+ * triangle), and with a few points per octave the response stays close
+ * to a design at the exact cutoff.
+ *
+ * Memory is allocated externally (see GetMemSize()).
+ */
+class BiquadTable {
+
+ public:
+
+    /**
+     * @brief Memory needed for a table
+     *
+     * @param n_sections Sections per design
+     * @param n_points Number of cutoffs (at least 2)
+     * @return size_t Bytes
+     */
+    static size_t GetMemSize(unsigned int n_sections, unsigned int n_points);
+    /**
+     * @brief Construct a new, empty BiquadTable (see Fill())
+     *
+     * @param n_sections Sections per design
+     * @param n_points Number of cutoffs (at least 2)
+     * @param f_min Lowest cutoff
+     * @param f_max Highest cutoff
+     * @param mem Memory of GetMemSize(n_sections, n_points) bytes. Allocate
+     * externally.
+     */
+    BiquadTable(unsigned int n_sections, unsigned int n_points, float f_min,
+        float f_max, void *mem);
+    /**
+     * @brief Design every point with FilterDesigner::Lowpass() or
+     * Highpass() (not for the audio thread)
+     *
+     * @return false if the design doesn't take n_sections sections
+     */
+    bool Fill(FilterDesigner::Prototype p, bool highpass, unsigned int order,
+        float fs, float gain = 1.f);
+    /**
+     * @brief Design every point with design(c, f_cut), which writes
+     * n_sections sections to c (not for the audio thread)
+     *
+     */
+    template <typename FN_T>
+    void Fill(FN_T design) {
+        for (unsigned int n = 0; n < n_points_; n++) {
+            design(c_ + n * n_sections_, GetCutoff(n));
+        }
+    }
+    /**
+     * @brief Sections for cutoff f_cut (clamped to the table's range),
+     * interpolated
+     *
+     * @param f_cut Cutoff frequency
+     * @param c Array of n_sections sections, e.g. a Biquad's (see
+     * Biquad::SetCoefficients())
+     */
+    void Lookup(float f_cut, BiquadCoeffs *c) const;
+    /**
+     * @brief Cutoff of point n
+     *
+     */
+    float GetCutoff(unsigned int n) const;
+    unsigned int GetNumSections() const { return n_sections_; }
+
+ private:
+
+    const unsigned int n_sections_;
+    const unsigned int n_points_;
+    const float f_min_;
+    const float log2_f_min_;
+    float points_per_octave_;
+    BiquadCoeffs *c_;  // [point][section]
 };
 
 }
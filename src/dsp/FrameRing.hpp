@@ -0,0 +1,138 @@
+#ifndef _FRAME_RING_HPP_
+#define _FRAME_RING_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+
+namespace DSP {
+
+/**
+ * @brief Lock-free single-producer, single-consumer ring of fixed-size
+ * float frames (e.g. snapshots of a mesh for a UI).
+ *
+ * Like SPSCQueue, but frames are written and read in place rather than
+ * copied in and out. The producer (the audio thread) never blocks: if the
+ * consumer falls behind and the ring is full, new frames are dropped and
+ * counted.
+ *
+ * Number of frames must be a power of 2. Memory is allocated externally
+ * (see GetMemSize()).
+ */
+class FrameRing {
+
+ public:
+
+    /**
+     * @brief Memory needed for n_frames frames of frame_size floats
+     *
+     */
+    static size_t GetMemSize(unsigned int frame_size, unsigned int n_frames) {
+        return static_cast<size_t>(frame_size) * n_frames * sizeof(float);
+    }
+    /**
+     * @brief Construct a new, empty FrameRing
+     *
+     * @param frame_size Floats per frame
+     * @param n_frames Frames in the ring (power of 2)
+     * @param mem Memory of GetMemSize(frame_size, n_frames) bytes. Allocate
+     * externally.
+     */
+    FrameRing(unsigned int frame_size, unsigned int n_frames, void *mem) :
+            frame_size_(frame_size),
+            n_frames_(n_frames),
+            frames_(static_cast<float *>(mem)),
+            dropped_(0),
+            head_(0),
+            tail_(0) {
+        assert(n_frames > 0);
+        assert((n_frames & (n_frames - 1)) == 0);  // Power of 2 only
+    }
+    /**
+     * @brief Frame to fill in, at the back (producer only). Nothing is
+     * visible to the consumer until CommitWrite().
+     *
+     * @return float* Frame, or nullptr if the ring is full (counted as a
+     * dropped frame)
+     */
+    float *BeginWrite() {
+        unsigned int tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == n_frames_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return Frame_(tail);
+    }
+    /**
+     * @brief Publish the frame from BeginWrite() (producer only)
+     *
+     */
+    void CommitWrite() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+    }
+    /**
+     * @brief Oldest frame, left in the ring (consumer only)
+     *
+     * @return const float* Frame, or nullptr if the ring is empty
+     */
+    const float *Front() {
+        unsigned int head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return Frame_(head);
+    }
+    /**
+     * @brief Drop the oldest frame (consumer only, ring not empty)
+     *
+     */
+    void Pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+    }
+    /**
+     * @brief Skip to the newest frame, dropping all older ones (consumer
+     * only): for a display that only wants to keep up
+     *
+     * @return const float* Frame, or nullptr if the ring is empty
+     */
+    const float *Latest() {
+        unsigned int tail = tail_.load(std::memory_order_acquire);
+        if (head_.load(std::memory_order_relaxed) == tail) {
+            return nullptr;
+        }
+        head_.store(tail - 1, std::memory_order_release);
+        return Frame_(tail - 1);
+    }
+    unsigned int GetFrameSize() { return frame_size_; }
+    unsigned int GetNumFrames() { return n_frames_; }
+    /**
+     * @brief Frames the producer found no room for, so far
+     *
+     */
+    unsigned int GetDropped() {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+ protected:
+
+    // Counters run freely and wrap around: only their difference matters
+    unsigned int frame_size_;
+    unsigned int n_frames_;
+    float *frames_;
+    std::atomic<unsigned int> dropped_;
+    std::atomic<unsigned int> head_;  // Written by the consumer
+    char pad_[64];  // Keep the two counters on separate cache lines
+    std::atomic<unsigned int> tail_;  // Written by the producer
+
+    float *Frame_(unsigned int counter) {
+        return frames_ + static_cast<size_t>(counter & (n_frames_ - 1)) *
+            frame_size_;
+    }
+};
+
+}  // namespace DSP
+
+#endif  // _FRAME_RING_HPP_
@@ -0,0 +1,83 @@
+/**
+ * @file LargeAlloc.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-29
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "LargeAlloc.hpp"
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+
+namespace DSP {
+
+
+#if defined(__linux__)
+
+static size_t RoundToHugePages(size_t n_bytes) {
+    return (n_bytes + LargeAlloc::kHugePageSize - 1) &
+        ~(LargeAlloc::kHugePageSize - 1);
+}
+
+
+void *LargeAlloc::Allocate(size_t n_bytes, PageMode mode) {
+
+    void *mem = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    if (mode == kExplicitHugePages) {
+        mem = mmap(nullptr, RoundToHugePages(n_bytes),
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            return mem;
+        }
+        // Pool empty or not configured: fall back to transparent ones
+        mode = kTransparentHugePages;
+    }
+#endif
+    mem = mmap(nullptr, RoundToHugePages(n_bytes), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+#if defined(MADV_HUGEPAGE)
+    if (mode == kTransparentHugePages) {
+        // Only advice: fine if it's ignored
+        madvise(mem, RoundToHugePages(n_bytes), MADV_HUGEPAGE);
+    }
+#endif
+    return mem;
+}
+
+
+void LargeAlloc::Free(void *mem, size_t n_bytes) {
+    if (mem != nullptr) {
+        munmap(mem, RoundToHugePages(n_bytes));
+    }
+}
+
+#else  // No mmap: plain zeroed heap memory, no huge pages
+
+void *LargeAlloc::Allocate(size_t n_bytes, PageMode mode) {
+    (void) mode;
+    return std::calloc(n_bytes, 1);
+}
+
+
+void LargeAlloc::Free(void *mem, size_t n_bytes) {
+    (void) n_bytes;
+    std::free(mem);
+}
+
+#endif
+
+
+}  // namespace DSP
@@ -0,0 +1,46 @@
+#ifndef _LARGE_ALLOC_HPP_
+#define _LARGE_ALLOC_HPP_
+
+#include <cstddef>
+
+
+namespace DSP {
+
+/**
+ * @brief Memory for very large meshes (offline, high-resolution runs),
+ * to hand to their constructors instead of new[].
+ *
+ * Planes of hundreds of MB thrash the TLB on 4 kB pages: this maps them on
+ * huge pages where the OS allows. Pages are only reserved, not touched,
+ * so on a multi-socket machine each one lands on the NUMA node of the
+ * thread that writes it first (see Rectilinear3DMesh::StartThreads()).
+ * Not for the audio thread.
+ */
+class LargeAlloc {
+
+ public:
+
+    enum PageMode {
+        kNormalPages,
+        kTransparentHugePages,  // Ask the kernel to back with huge pages
+        kExplicitHugePages,  // From the reserved pool, else transparent
+    };
+
+    /**
+     * @brief Map n_bytes of zeroed, page-aligned memory
+     *
+     * @return void* Memory, or nullptr if it couldn't be mapped
+     */
+    static void *Allocate(size_t n_bytes, PageMode mode);
+    /**
+     * @brief Release memory from Allocate(), with the same size
+     *
+     */
+    static void Free(void *mem, size_t n_bytes);
+
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+};
+
+}  // namespace DSP
+
+#endif  // _LARGE_ALLOC_HPP_
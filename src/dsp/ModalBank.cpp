@@ -0,0 +1,175 @@
+/**
+ * @file ModalBank.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-21
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "ModalBank.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+
+namespace DSP {
+
+
+size_t ModalBank::GetMemSize(unsigned int max_modes) {
+    // Planes are padded to whole vectors, plus slack to align the first one
+    return kNPlanes * SIMD::PadToWidth(max_modes) * sizeof(float)
+        + SIMD::kAlignment;
+}
+
+
+ModalBank::ModalBank(unsigned int max_modes, void *mem) :
+        max_modes_(max_modes),
+        n_modes_(0),
+        n_padded_(0) {
+
+    unsigned int plane_size = SIMD::PadToWidth(max_modes);
+    float *base = SIMD::Align<float>(mem);
+    for (unsigned int n = 0; n < kNPlanes; n++) {
+        plane_[n] = base + n * plane_size;
+        for (unsigned int m = 0; m < plane_size; m++) {
+            plane_[n][m] = 0;
+        }
+    }
+    Reset();
+}
+
+
+void ModalBank::Reset() {
+    for (unsigned int m = 0; m < SIMD::PadToWidth(max_modes_); m++) {
+        plane_[kY1][m] = 0;
+        plane_[kY2][m] = 0;
+    }
+    x_1_ = 0;
+}
+
+
+void ModalBank::SetModes(const Mode *modes, unsigned int n_modes) {
+
+    assert(n_modes <= max_modes_);
+
+    // Impulse response A r^n cos(wn) + B r^n sin(wn) of
+    // (b0 + b1 z^-1) / (1 - 2r cos(w) z^-1 + r^2 z^-2)
+    for (unsigned int m = 0; m < n_modes; m++) {
+        const Mode &md = modes[m];
+        float amp = md.gain_source * md.gain_pickup;
+        float a = amp * std::cos(md.phase);
+        float b = -amp * std::sin(md.phase);
+        float cos_w = std::cos(md.omega);
+        float sin_w = std::sin(md.omega);
+        plane_[kB0][m] = a;
+        plane_[kB1][m] = md.radius * (b * sin_w - a * cos_w);
+        plane_[kA1][m] = 2.f * md.radius * cos_w;
+        plane_[kA2][m] = -md.radius * md.radius;
+    }
+    // Padding modes are silent
+    n_padded_ = SIMD::PadToWidth(n_modes);
+    for (unsigned int m = n_modes; m < n_padded_; m++) {
+        plane_[kB0][m] = 0;
+        plane_[kB1][m] = 0;
+        plane_[kA1][m] = 0;
+        plane_[kA2][m] = 0;
+    }
+    n_modes_ = n_modes;
+}
+
+
+float ModalBank::ProcessSample(float in) {
+    float out;
+    ProcessBuffer(&in, &out, 1);
+    return out;
+}
+
+
+void ModalBank::ProcessBuffer(const float *in, float *out,
+        unsigned int n_samples) {
+
+    using V = SIMD;
+
+    for (unsigned int n = 0; n < n_samples; n++) {
+        // Read input first, in case in == out
+        float x = in[n];
+        V::Vec x_v = V::Set1(x);
+        V::Vec x_1_v = V::Set1(x_1_);
+        V::Vec acc = V::Zero();
+        for (unsigned int m = 0; m < n_padded_; m += V::kWidth) {
+            V::Vec y_1 = V::Load(plane_[kY1] + m);
+            V::Vec y_2 = V::Load(plane_[kY2] + m);
+            V::Vec y = V::Mul(V::Load(plane_[kB0] + m), x_v);
+            y = V::MulAdd(V::Load(plane_[kB1] + m), x_1_v, y);
+            y = V::MulAdd(V::Load(plane_[kA1] + m), y_1, y);
+            y = V::MulAdd(V::Load(plane_[kA2] + m), y_2, y);
+            V::Store(plane_[kY2] + m, y_1);
+            V::Store(plane_[kY1] + m, y);
+            acc = V::Add(acc, y);
+        }
+        out[n] = V::HorizontalSum(acc);
+        x_1_ = x;
+    }
+}
+
+
+bool ModalBank::SaveModes(const char *path, const Mode *modes,
+        unsigned int n_modes) {
+
+    FILE *f = std::fopen(path, "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    uint32_t header[3] = { kFileMagic, kFileVersion, n_modes };
+    bool ok = std::fwrite(header, sizeof(header), 1, f) == 1;
+    for (unsigned int m = 0; ok && m < n_modes; m++) {
+        float fields[5] = {
+            modes[m].omega,
+            modes[m].radius,
+            modes[m].gain_source,
+            modes[m].gain_pickup,
+            modes[m].phase,
+        };
+        ok = std::fwrite(fields, sizeof(fields), 1, f) == 1;
+    }
+    ok = (std::fclose(f) == 0) && ok;
+    return ok;
+}
+
+
+unsigned int ModalBank::LoadModes(const char *path, Mode *modes,
+        unsigned int max_modes) {
+
+    FILE *f = std::fopen(path, "rb");
+    if (f == nullptr) {
+        return 0;
+    }
+    uint32_t header[3];
+    if (std::fread(header, sizeof(header), 1, f) != 1
+            || header[0] != kFileMagic
+            || header[1] != kFileVersion
+            || header[2] > max_modes) {
+        std::fclose(f);
+        return 0;
+    }
+    unsigned int n_modes = header[2];
+    for (unsigned int m = 0; m < n_modes; m++) {
+        float fields[5];
+        if (std::fread(fields, sizeof(fields), 1, f) != 1) {
+            std::fclose(f);
+            return 0;
+        }
+        modes[m].omega = fields[0];
+        modes[m].radius = fields[1];
+        modes[m].gain_source = fields[2];
+        modes[m].gain_pickup = fields[3];
+        modes[m].phase = fields[4];
+    }
+    std::fclose(f);
+    return n_modes;
+}
+
+}  // namespace DSP
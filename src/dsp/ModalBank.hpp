@@ -0,0 +1,130 @@
+#ifndef _MODAL_BANK_HPP_
+#define _MODAL_BANK_HPP_
+
+#include <cstddef>
+#include "SIMD.hpp"
+
+
+namespace DSP {
+
+/**
+ * @brief Bank of damped two-pole resonators, summed into one output.
+ *
+ * Each resonator reproduces one mode of a linear system: its impulse
+ * response is
+ *
+ *     gain_source * gain_pickup * radius^n * cos(omega * n + phase)
+ *
+ * Modes are stored structure-of-arrays and processed kWidth at a time
+ * with the SIMD wrapper. Memory is allocated externally (see
+ * GetMemSize()), like the mesh.
+ */
+class ModalBank {
+
+ public:
+
+    /**
+     * @brief One mode, normalised to the sampling rate
+     *
+     */
+    struct Mode {
+        float omega;  // Frequency (rad/sample)
+        float radius;  // Pole radius (decay per sample, < 1)
+        float gain_source;  // Mode shape at the excitation point
+        float gain_pickup;  // Mode shape at the listening point
+        float phase;  // Phase of the impulse response (rad)
+    };
+
+    /**
+     * @brief Memory needed for a bank of up to max_modes modes
+     *
+     * @param max_modes Maximum number of modes
+     * @return size_t Bytes
+     */
+    static size_t GetMemSize(unsigned int max_modes);
+    /**
+     * @brief Construct a new, silent ModalBank
+     *
+     * @param max_modes Maximum number of modes
+     * @param mem Memory of GetMemSize(max_modes) bytes. Allocate externally.
+     */
+    ModalBank(unsigned int max_modes, void *mem);
+    /**
+     * @brief Reset memory of all resonators
+     *
+     */
+    void Reset();
+    /**
+     * @brief Load a set of modes. Resonator memory is left alone, so
+     * modes can be swapped while the bank is still ringing.
+     *
+     * @param modes Array of modes
+     * @param n_modes Number of modes, at most max_modes
+     */
+    void SetModes(const Mode *modes, unsigned int n_modes);
+    /**
+     * @brief Process a single sample
+     *
+     * @param in Excitation
+     * @return float Sum of all modes
+     */
+    float ProcessSample(float in);
+    /**
+     * @brief Process buffer of samples (in-place allowed)
+     *
+     * @param in Excitation buffer
+     * @param out Output buffer
+     * @param n_samples Number of samples
+     */
+    void ProcessBuffer(const float *in, float *out, unsigned int n_samples);
+    /**
+     * @brief Number of modes currently loaded
+     *
+     */
+    unsigned int GetNModes() { return n_modes_; }
+
+    /**
+     * @brief Write modes to a binary file (native endianness)
+     *
+     * @param path File path
+     * @param modes Array of modes
+     * @param n_modes Number of modes
+     * @return true on success
+     */
+    static bool SaveModes(const char *path, const Mode *modes,
+        unsigned int n_modes);
+    /**
+     * @brief Read modes written by SaveModes()
+     *
+     * @param path File path
+     * @param modes Array of modes to be filled
+     * @param max_modes Size of the array
+     * @return unsigned int Number of modes read (0 on error)
+     */
+    static unsigned int LoadModes(const char *path, Mode *modes,
+        unsigned int max_modes);
+
+ protected:
+
+    enum Planes_ {
+        kB0,
+        kB1,
+        kA1,
+        kA2,
+        kY1,
+        kY2,
+        kNPlanes,
+    };
+    static constexpr uint32_t kFileMagic = 0x534d4d56;  // "VMMS"
+    static constexpr uint32_t kFileVersion = 1;
+
+    unsigned int max_modes_;
+    unsigned int n_modes_;
+    unsigned int n_padded_;
+    float *plane_[kNPlanes];
+    float x_1_;
+};
+
+}  // namespace DSP
+
+#endif  // _MODAL_BANK_HPP_
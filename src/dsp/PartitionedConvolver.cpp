@@ -0,0 +1,112 @@
+/**
+ * @file PartitionedConvolver.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-28
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "PartitionedConvolver.hpp"
+#include <cassert>
+#include <cstring>
+
+
+namespace DSP {
+
+
+size_t PartitionedConvolver::GetMemSize(unsigned int block_size,
+        unsigned int max_ir_length) {
+    unsigned int fft_size = 2 * block_size;
+    unsigned int spectrum_size = fft_size + 2;
+    unsigned int n_partitions = (max_ir_length + block_size - 1) / block_size;
+    size_t n_floats = 2 * n_partitions * spectrum_size  // IR and input FDL
+        + fft_size  // Input (previous and current block)
+        + spectrum_size  // Accumulator
+        + fft_size;  // Time-domain output
+    return FFT::GetMemSize(fft_size) + n_floats * sizeof(float);
+}
+
+
+PartitionedConvolver::PartitionedConvolver(unsigned int block_size,
+        unsigned int max_ir_length, void *mem) :
+        block_size_(block_size),
+        spectrum_size_(2 * block_size + 2),
+        max_partitions_((max_ir_length + block_size - 1) / block_size),
+        n_partitions_(0),
+        ir_length_(0),
+        fdl_head_(0),
+        fft_(2 * block_size, mem) {
+
+    assert(block_size >= 2);
+    assert((block_size & (block_size - 1)) == 0);  // Power of 2 only
+
+    float *base = reinterpret_cast<float *>(
+        reinterpret_cast<char *>(mem) + FFT::GetMemSize(2 * block_size));
+    ir_spectra_ = base;
+    fdl_ = ir_spectra_ + max_partitions_ * spectrum_size_;
+    input_ = fdl_ + max_partitions_ * spectrum_size_;
+    accum_ = input_ + 2 * block_size_;
+    time_ = accum_ + spectrum_size_;
+
+    Reset();
+}
+
+
+void PartitionedConvolver::Reset() {
+    memset(fdl_, 0, sizeof(float) * max_partitions_ * spectrum_size_);
+    memset(input_, 0, sizeof(float) * 2 * block_size_);
+    fdl_head_ = 0;
+}
+
+
+void PartitionedConvolver::SetImpulseResponse(const float *ir,
+        unsigned int length) {
+
+    assert(length <= max_partitions_ * block_size_);
+
+    n_partitions_ = (length + block_size_ - 1) / block_size_;
+    ir_length_ = length;
+    // Each partition zero-padded to the FFT size (time_ as scratch)
+    for (unsigned int p = 0; p < n_partitions_; p++) {
+        unsigned int start = p * block_size_;
+        unsigned int n = (length - start < block_size_) ?
+            length - start : block_size_;
+        memset(time_, 0, sizeof(float) * 2 * block_size_);
+        memcpy(time_, ir + start, sizeof(float) * n);
+        fft_.ForwardReal(time_, ir_spectra_ + p * spectrum_size_);
+    }
+}
+
+
+void PartitionedConvolver::ProcessBlock(const float *in, float *out) {
+
+    // Slide input window: [previous block | current block]
+    memcpy(input_, input_ + block_size_, sizeof(float) * block_size_);
+    memcpy(input_ + block_size_, in, sizeof(float) * block_size_);
+
+    // Newest input spectrum goes at the head of the delay line
+    fdl_head_ = (fdl_head_ == 0) ? max_partitions_ - 1 : fdl_head_ - 1;
+    fft_.ForwardReal(input_, fdl_ + fdl_head_ * spectrum_size_);
+
+    // Multiply-accumulate: partition p meets the input from p blocks ago
+    memset(accum_, 0, sizeof(float) * spectrum_size_);
+    unsigned int slot = fdl_head_;
+    for (unsigned int p = 0; p < n_partitions_; p++) {
+        const float *x = fdl_ + slot * spectrum_size_;
+        const float *h = ir_spectra_ + p * spectrum_size_;
+        for (unsigned int k = 0; k < spectrum_size_; k += 2) {
+            accum_[k] += x[k] * h[k] - x[k + 1] * h[k + 1];
+            accum_[k + 1] += x[k] * h[k + 1] + x[k + 1] * h[k];
+        }
+        slot = (slot + 1 == max_partitions_) ? 0 : slot + 1;
+    }
+
+    // Overlap-save: only the second half is free of circular wrap-around
+    fft_.InverseReal(accum_, time_);
+    memcpy(out, time_ + block_size_, sizeof(float) * block_size_);
+}
+
+}  // namespace DSP
@@ -0,0 +1,87 @@
+#ifndef _PARTITIONED_CONVOLVER_HPP_
+#define _PARTITIONED_CONVOLVER_HPP_
+
+#include <cstddef>
+#include "FFT.hpp"
+
+
+namespace DSP {
+
+/**
+ * @brief Uniformly partitioned overlap-save FFT convolution.
+ *
+ * The impulse response is split into partitions of block_size samples,
+ * each transformed once with a 2 * block_size FFT. Every block of input is
+ * transformed once, kept in a frequency-domain delay line, and multiplied
+ * against all partitions. Output for a block is available as soon as that
+ * block of input is: no latency on top of the host's block.
+ *
+ * Memory is allocated externally (see GetMemSize()).
+ */
+class PartitionedConvolver {
+
+ public:
+
+    /**
+     * @brief Memory needed by the convolver
+     *
+     * @param block_size Samples per block (power of 2, at least 2)
+     * @param max_ir_length Longest impulse response to be loaded
+     * @return size_t Bytes
+     */
+    static size_t GetMemSize(unsigned int block_size,
+        unsigned int max_ir_length);
+    /**
+     * @brief Construct a new PartitionedConvolver, with an empty response
+     *
+     * @param block_size Samples per block (power of 2, at least 2)
+     * @param max_ir_length Longest impulse response to be loaded
+     * @param mem Memory of GetMemSize() bytes. Allocate externally.
+     */
+    PartitionedConvolver(unsigned int block_size,
+        unsigned int max_ir_length, void *mem);
+    /**
+     * @brief Clear input history
+     *
+     */
+    void Reset();
+    /**
+     * @brief Load an impulse response. Doesn't allocate, but runs one FFT
+     * per partition: keep it off the audio thread for long responses.
+     *
+     * @param ir Impulse response
+     * @param length Length, at most max_ir_length
+     */
+    void SetImpulseResponse(const float *ir, unsigned int length);
+    /**
+     * @brief Convolve one block (in-place allowed)
+     *
+     * @param in block_size input samples
+     * @param out block_size output samples
+     */
+    void ProcessBlock(const float *in, float *out);
+    /**
+     * @brief Length of the loaded impulse response
+     *
+     */
+    unsigned int GetLength() { return ir_length_; }
+
+ protected:
+
+    unsigned int block_size_;
+    unsigned int spectrum_size_;  // Floats per spectrum
+    unsigned int max_partitions_;
+    unsigned int n_partitions_;
+    unsigned int ir_length_;
+    unsigned int fdl_head_;
+    FFT fft_;
+    float *ir_spectra_;
+    float *fdl_;
+    float *input_;
+    float *accum_;
+    float *time_;
+};
+
+}  // namespace DSP
+
+#endif  // _PARTITIONED_CONVOLVER_HPP_
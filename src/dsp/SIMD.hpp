@@ -0,0 +1,488 @@
+#ifndef _SIMD_HPP_
+#define _SIMD_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// A translation unit can also ask for a backend the build doesn't target
+// by defining SIMD_TARGET_AVX2 or SIMD_TARGET_AVX512 (along with a
+// matching #pragma GCC target) before any include: see Dispatch
+#if defined(__AVX512F__) || defined(SIMD_TARGET_AVX512)
+// GCC 12's AVX-512 intrinsics trip its own uninitialised warnings
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#define __SIMD_AVX512
+#define __SIMD_ISA_NS    SIMD_AVX512
+#elif defined(__AVX2__) || defined(SIMD_TARGET_AVX2)
+#include <immintrin.h>
+#define __SIMD_AVX2
+#define __SIMD_ISA_NS    SIMD_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define __SIMD_ISA_NS    SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define __SIMD_ISA_NS    SIMD_NEON
+#else
+#define __SIMD_ISA_NS    SIMD_Scalar
+#endif
+
+
+namespace DSP {
+
+// Every backend lives in its own (inline) namespace, so translation units
+// built for different instruction sets never share a symbol.
+inline namespace __SIMD_ISA_NS {
+
+/**
+ * @brief Thin wrapper around the platform's float vector type, so that
+ * kernels are written once and compiled for AVX-512, AVX2, SSE2, NEON or
+ * plain scalar (whichever the translation unit is built for).
+ *
+ * Kernels should loop in steps of kWidth and never assume a given width:
+ * the scalar fallback has kWidth == 1.
+ *
+ * For math kernels, numbers can also be taken apart: BitsToFloat() is the
+ * float whose bits are the (truncated, signed) integer value of bits,
+ * FloatToBits() the other way around; Exponent() and Mantissa() split a
+ * normal number into 2^e * m, with m in [1, 2).
+ */
+class SIMD {
+
+ public:
+
+#if defined(__SIMD_AVX512)
+    typedef __m512 Vec;
+    static constexpr unsigned int kWidth = 16;
+#elif defined(__SIMD_AVX2)
+    typedef __m256 Vec;
+    static constexpr unsigned int kWidth = 8;
+#elif defined(__SSE2__)
+    typedef __m128 Vec;
+    static constexpr unsigned int kWidth = 4;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    typedef float32x4_t Vec;
+    static constexpr unsigned int kWidth = 4;
+#else
+    typedef float Vec;
+    static constexpr unsigned int kWidth = 1;
+#endif
+
+    /**
+     * @brief Alignment (bytes) that Load() and Store() expect
+     *
+     */
+#if defined(__SIMD_AVX512)
+    static constexpr size_t kAlignment = 64;
+#elif defined(__SIMD_AVX2)
+    static constexpr size_t kAlignment = 32;
+#else
+    static constexpr size_t kAlignment = 16;
+#endif
+
+    /**
+     * @brief Whether p is aligned for Load() and Store()
+     *
+     */
+    static inline bool IsAligned(const void *p) {
+        return (reinterpret_cast<uintptr_t>(p) & (kAlignment - 1)) == 0;
+    }
+
+    /**
+     * @brief Round a number of floats up to a whole number of vectors
+     *
+     */
+    static inline unsigned int PadToWidth(unsigned int n) {
+        return (n + kWidth - 1) & ~(kWidth - 1);
+    }
+
+    /**
+     * @brief Round a pointer up to the next kAlignment boundary
+     *
+     */
+    template <typename T_>
+    static inline T_ *Align(void *ptr) {
+        uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
+        p = (p + kAlignment - 1) & ~(static_cast<uintptr_t>(kAlignment) - 1);
+        return reinterpret_cast<T_ *>(p);
+    }
+
+#if defined(__SIMD_AVX512)
+
+    static inline Vec Load(const float *p) { return _mm512_load_ps(p); }
+    static inline Vec LoadU(const float *p) { return _mm512_loadu_ps(p); }
+    static inline void Store(float *p, Vec v) { _mm512_store_ps(p, v); }
+    static inline void StoreU(float *p, Vec v) { _mm512_storeu_ps(p, v); }
+    static inline Vec Set1(float x) { return _mm512_set1_ps(x); }
+    static inline Vec Zero() { return _mm512_setzero_ps(); }
+    static inline Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+    static inline Vec MulAdd(Vec a, Vec b, Vec c) {
+        return _mm512_fmadd_ps(a, b, c);
+    }
+    static inline Vec Div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+    static inline Vec Max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+    static inline Vec Abs(Vec v) { return _mm512_abs_ps(v); }
+    static inline Vec Floor(Vec v) {
+        return _mm512_roundscale_ps(v, _MM_FROUND_TO_NEG_INF |
+            _MM_FROUND_NO_EXC);
+    }
+    static inline Vec BitsToFloat(Vec bits) {
+        return _mm512_castsi512_ps(_mm512_cvttps_epi32(bits));
+    }
+    static inline Vec FloatToBits(Vec v) {
+        return _mm512_cvtepi32_ps(_mm512_castps_si512(v));
+    }
+    static inline Vec Exponent(Vec v) { return _mm512_getexp_ps(v); }
+    static inline Vec Mantissa(Vec v) {
+        return _mm512_getmant_ps(v, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero);
+    }
+    static inline Vec Gather(const float *base, const uint32_t *index) {
+        __m512i i = _mm512_loadu_si512(index);
+        return _mm512_i32gather_ps(i, base, 4);
+    }
+    static inline float HorizontalSum(Vec v) {
+        __m256 s = _mm256_add_ps(_mm512_castps512_ps256(v),
+            _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+        __m128 t = _mm_add_ps(_mm256_castps256_ps128(s),
+            _mm256_extractf128_ps(s, 1));
+        t = _mm_add_ps(t, _mm_movehl_ps(t, t));
+        return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+    }
+    // [x, v[0], ..., v[14]]
+    static inline Vec ShiftIn(Vec v, float x) {
+        return _mm512_mask_permutexvar_ps(_mm512_set1_ps(x), 0xfffe,
+            _mm512_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+            14), v);
+    }
+    static inline float Last(Vec v) {
+        return _mm_cvtss_f32(_mm512_castps512_ps128(
+            _mm512_maskz_compress_ps(0x8000, v)));
+    }
+    // Masks are kept as vectors (all bits set in true lanes), as on the
+    // other backends
+    static inline Vec CmpLe(Vec a, Vec b) {
+        __mmask16 m = _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);
+        return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(m, -1));
+    }
+    static inline Vec Select(Vec mask, Vec a, Vec b) {
+        __m512i m = _mm512_castps_si512(mask);
+        return _mm512_mask_blend_ps(_mm512_test_epi32_mask(m, m), b, a);
+    }
+
+#elif defined(__SIMD_AVX2)
+
+    static inline Vec Load(const float *p) { return _mm256_load_ps(p); }
+    static inline Vec LoadU(const float *p) { return _mm256_loadu_ps(p); }
+    static inline void Store(float *p, Vec v) { _mm256_store_ps(p, v); }
+    static inline void StoreU(float *p, Vec v) { _mm256_storeu_ps(p, v); }
+    static inline Vec Set1(float x) { return _mm256_set1_ps(x); }
+    static inline Vec Zero() { return _mm256_setzero_ps(); }
+    static inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static inline Vec MulAdd(Vec a, Vec b, Vec c) {
+#if defined(__FMA__) || defined(SIMD_TARGET_AVX2)
+        return _mm256_fmadd_ps(a, b, c);
+#else
+        return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+    }
+    static inline Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    static inline Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    static inline Vec Abs(Vec v) {
+        return _mm256_andnot_ps(_mm256_set1_ps(-0.f), v);
+    }
+    static inline Vec Floor(Vec v) { return _mm256_floor_ps(v); }
+    static inline Vec BitsToFloat(Vec bits) {
+        return _mm256_castsi256_ps(_mm256_cvttps_epi32(bits));
+    }
+    static inline Vec FloatToBits(Vec v) {
+        return _mm256_cvtepi32_ps(_mm256_castps_si256(v));
+    }
+    static inline Vec Exponent(Vec v) {
+        __m256i e = _mm256_and_si256(_mm256_srli_epi32(
+            _mm256_castps_si256(v), 23), _mm256_set1_epi32(0xff));
+        return _mm256_sub_ps(_mm256_cvtepi32_ps(e), _mm256_set1_ps(127.f));
+    }
+    static inline Vec Mantissa(Vec v) {
+        __m256i m = _mm256_and_si256(_mm256_castps_si256(v),
+            _mm256_set1_epi32(0x007fffff));
+        return _mm256_castsi256_ps(_mm256_or_si256(m,
+            _mm256_set1_epi32(0x3f800000)));
+    }
+    static inline Vec Gather(const float *base, const uint32_t *index) {
+        __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+            index));
+        return _mm256_i32gather_ps(base, i, 4);
+    }
+    static inline float HorizontalSum(Vec v) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v),
+            _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+    // [x, v[0], ..., v[6]]
+    static inline Vec ShiftIn(Vec v, float x) {
+        Vec up = _mm256_permutevar8x32_ps(v,
+            _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6));
+        return _mm256_blend_ps(up, _mm256_set1_ps(x), 1);
+    }
+    static inline float Last(Vec v) {
+        __m128 hi = _mm256_extractf128_ps(v, 1);
+        return _mm_cvtss_f32(_mm_shuffle_ps(hi, hi, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    static inline Vec CmpLe(Vec a, Vec b) {
+        return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+    }
+    static inline Vec Select(Vec mask, Vec a, Vec b) {
+        return _mm256_blendv_ps(b, a, mask);
+    }
+
+#elif defined(__SSE2__)
+
+    static inline Vec Load(const float *p) { return _mm_load_ps(p); }
+    static inline Vec LoadU(const float *p) { return _mm_loadu_ps(p); }
+    static inline void Store(float *p, Vec v) { _mm_store_ps(p, v); }
+    static inline void StoreU(float *p, Vec v) { _mm_storeu_ps(p, v); }
+    static inline Vec Set1(float x) { return _mm_set1_ps(x); }
+    static inline Vec Zero() { return _mm_setzero_ps(); }
+    static inline Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static inline Vec MulAdd(Vec a, Vec b, Vec c) {
+        return _mm_add_ps(_mm_mul_ps(a, b), c);
+    }
+    static inline Vec Div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+    static inline Vec Max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+    static inline Vec Abs(Vec v) { return _mm_andnot_ps(_mm_set1_ps(-0.f), v); }
+    // Truncate, then step down where that went up (no roundps before
+    // SSE4.1)
+    static inline Vec Floor(Vec v) {
+        __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.f)));
+    }
+    static inline Vec BitsToFloat(Vec bits) {
+        return _mm_castsi128_ps(_mm_cvttps_epi32(bits));
+    }
+    static inline Vec FloatToBits(Vec v) {
+        return _mm_cvtepi32_ps(_mm_castps_si128(v));
+    }
+    static inline Vec Exponent(Vec v) {
+        __m128i e = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(v), 23),
+            _mm_set1_epi32(0xff));
+        return _mm_sub_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(127.f));
+    }
+    static inline Vec Mantissa(Vec v) {
+        __m128i m = _mm_and_si128(_mm_castps_si128(v),
+            _mm_set1_epi32(0x007fffff));
+        return _mm_castsi128_ps(_mm_or_si128(m, _mm_set1_epi32(0x3f800000)));
+    }
+    // base[index[0..3]]: no gather instruction before AVX2, so lane by lane
+    static inline Vec Gather(const float *base, const uint32_t *index) {
+        return _mm_setr_ps(base[index[0]], base[index[1]], base[index[2]],
+            base[index[3]]);
+    }
+    static inline float HorizontalSum(Vec v) {
+        __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 sums = _mm_add_ps(v, shuf);
+        shuf = _mm_movehl_ps(shuf, sums);
+        return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+    }
+    // [x, v[0], v[1], v[2]]
+    static inline Vec ShiftIn(Vec v, float x) {
+        __m128 up = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4));
+        return _mm_move_ss(up, _mm_set_ss(x));
+    }
+    static inline float Last(Vec v) {
+        return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    // Masks have all bits set in true lanes, to be used by Select()
+    static inline Vec CmpLe(Vec a, Vec b) { return _mm_cmple_ps(a, b); }
+    static inline Vec Select(Vec mask, Vec a, Vec b) {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+    static inline Vec Load(const float *p) { return vld1q_f32(p); }
+    static inline Vec LoadU(const float *p) { return vld1q_f32(p); }
+    static inline void Store(float *p, Vec v) { vst1q_f32(p, v); }
+    static inline void StoreU(float *p, Vec v) { vst1q_f32(p, v); }
+    static inline Vec Set1(float x) { return vdupq_n_f32(x); }
+    static inline Vec Zero() { return vdupq_n_f32(0.f); }
+    static inline Vec Add(Vec a, Vec b) { return vaddq_f32(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+    static inline Vec MulAdd(Vec a, Vec b, Vec c) { return vmlaq_f32(c, a, b); }
+#if defined(__aarch64__)
+    static inline Vec Div(Vec a, Vec b) { return vdivq_f32(a, b); }
+#else
+    // No divide on 32-bit NEON: reciprocal estimate, refined twice
+    static inline Vec Div(Vec a, Vec b) {
+        float32x4_t r = vrecpeq_f32(b);
+        r = vmulq_f32(r, vrecpsq_f32(b, r));
+        r = vmulq_f32(r, vrecpsq_f32(b, r));
+        return vmulq_f32(a, r);
+    }
+#endif
+    static inline Vec Min(Vec a, Vec b) { return vminq_f32(a, b); }
+    static inline Vec Max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+    static inline Vec Abs(Vec v) { return vabsq_f32(v); }
+#if defined(__aarch64__)
+    static inline Vec Floor(Vec v) { return vrndmq_f32(v); }
+#else
+    static inline Vec Floor(Vec v) {
+        float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(v));
+        uint32x4_t one = vreinterpretq_u32_f32(vdupq_n_f32(1.f));
+        return vsubq_f32(t, vreinterpretq_f32_u32(
+            vandq_u32(vcgtq_f32(t, v), one)));
+    }
+#endif
+    static inline Vec BitsToFloat(Vec bits) {
+        return vreinterpretq_f32_s32(vcvtq_s32_f32(bits));
+    }
+    static inline Vec FloatToBits(Vec v) {
+        return vcvtq_f32_s32(vreinterpretq_s32_f32(v));
+    }
+    static inline Vec Exponent(Vec v) {
+        uint32x4_t e = vandq_u32(vshrq_n_u32(vreinterpretq_u32_f32(v), 23),
+            vdupq_n_u32(0xff));
+        return vsubq_f32(vcvtq_f32_u32(e), vdupq_n_f32(127.f));
+    }
+    static inline Vec Mantissa(Vec v) {
+        uint32x4_t m = vandq_u32(vreinterpretq_u32_f32(v),
+            vdupq_n_u32(0x007fffff));
+        return vreinterpretq_f32_u32(vorrq_u32(m, vdupq_n_u32(0x3f800000)));
+    }
+    static inline Vec Gather(const float *base, const uint32_t *index) {
+        Vec v = vdupq_n_f32(base[index[0]]);
+        v = vsetq_lane_f32(base[index[1]], v, 1);
+        v = vsetq_lane_f32(base[index[2]], v, 2);
+        return vsetq_lane_f32(base[index[3]], v, 3);
+    }
+    static inline float HorizontalSum(Vec v) {
+        float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+        return vget_lane_f32(vpadd_f32(s, s), 0);
+    }
+    static inline Vec ShiftIn(Vec v, float x) {
+        return vextq_f32(vdupq_n_f32(x), v, 3);
+    }
+    static inline float Last(Vec v) { return vgetq_lane_f32(v, 3); }
+    static inline Vec CmpLe(Vec a, Vec b) {
+        return vreinterpretq_f32_u32(vcleq_f32(a, b));
+    }
+    static inline Vec Select(Vec mask, Vec a, Vec b) {
+        return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+    }
+
+#else
+
+    static inline Vec Load(const float *p) { return *p; }
+    static inline Vec LoadU(const float *p) { return *p; }
+    static inline void Store(float *p, Vec v) { *p = v; }
+    static inline void StoreU(float *p, Vec v) { *p = v; }
+    static inline Vec Set1(float x) { return x; }
+    static inline Vec Zero() { return 0.f; }
+    static inline Vec Add(Vec a, Vec b) { return a + b; }
+    static inline Vec Sub(Vec a, Vec b) { return a - b; }
+    static inline Vec Mul(Vec a, Vec b) { return a * b; }
+    static inline Vec MulAdd(Vec a, Vec b, Vec c) { return a * b + c; }
+    static inline Vec Div(Vec a, Vec b) { return a / b; }
+    static inline Vec Min(Vec a, Vec b) { return (a < b) ? a : b; }
+    static inline Vec Max(Vec a, Vec b) { return (a > b) ? a : b; }
+    static inline Vec Abs(Vec v) { return std::fabs(v); }
+    static inline Vec Floor(Vec v) { return std::floor(v); }
+    static inline Vec BitsToFloat(Vec bits) {
+        union { int32_t i; float f; } u = { static_cast<int32_t>(bits) };
+        return u.f;
+    }
+    static inline Vec FloatToBits(Vec v) {
+        union { float f; int32_t i; } u = { v };
+        return static_cast<float>(u.i);
+    }
+    static inline Vec Exponent(Vec v) {
+        union { float f; int32_t i; } u = { v };
+        return static_cast<float>((u.i >> 23) & 0xff) - 127.f;
+    }
+    static inline Vec Mantissa(Vec v) {
+        union { float f; int32_t i; } u = { v };
+        u.i = (u.i & 0x007fffff) | 0x3f800000;
+        return u.f;
+    }
+    static inline Vec Gather(const float *base, const uint32_t *index) {
+        return base[*index];
+    }
+    static inline float HorizontalSum(Vec v) { return v; }
+    static inline Vec ShiftIn(Vec v, float x) { return x; }
+    static inline float Last(Vec v) { return v; }
+    static inline Vec CmpLe(Vec a, Vec b) { return (a <= b) ? 1.f : 0.f; }
+    static inline Vec Select(Vec mask, Vec a, Vec b) {
+        return (mask != 0.f) ? a : b;
+    }
+
+#endif
+};
+
+
+/**
+ * @brief SIMD's interface on single floats, whatever the build targets:
+ * kernels templated on it run channels left over from whole vectors, or
+ * scalar versions of vector code.
+ *
+ */
+struct SIMDScalar {
+    typedef float Vec;
+    static constexpr unsigned int kWidth = 1;
+
+    static inline float LoadU(const float *p) { return *p; }
+    static inline void StoreU(float *p, float x) { *p = x; }
+    static inline float Set1(float x) { return x; }
+    static inline float Zero() { return 0.f; }
+    static inline float Add(float a, float b) { return a + b; }
+    static inline float Sub(float a, float b) { return a - b; }
+    static inline float Mul(float a, float b) { return a * b; }
+    static inline float MulAdd(float a, float b, float c) { return a * b + c; }
+    static inline float Div(float a, float b) { return a / b; }
+    static inline float Min(float a, float b) { return (a < b) ? a : b; }
+    static inline float Max(float a, float b) { return (a > b) ? a : b; }
+    static inline float Floor(float x) { return std::floor(x); }
+    static inline float BitsToFloat(float bits) {
+        union { int32_t i; float f; } u = { static_cast<int32_t>(bits) };
+        return u.f;
+    }
+    static inline float FloatToBits(float x) {
+        union { float f; int32_t i; } u = { x };
+        return static_cast<float>(u.i);
+    }
+    static inline float Exponent(float x) {
+        union { float f; int32_t i; } u = { x };
+        return static_cast<float>((u.i >> 23) & 0xff) - 127.f;
+    }
+    static inline float Mantissa(float x) {
+        union { float f; int32_t i; } u = { x };
+        u.i = (u.i & 0x007fffff) | 0x3f800000;
+        return u.f;
+    }
+    static inline float Gather(const float *base, const uint32_t *index) {
+        return base[*index];
+    }
+    static inline float CmpLe(float a, float b) { return (a <= b) ? 1.f : 0.f; }
+    static inline float Select(float mask, float a, float b) {
+        return (mask != 0.f) ? a : b;
+    }
+};
+
+}  // inline namespace __SIMD_ISA_NS
+
+}  // namespace DSP
+
+#endif  // _SIMD_HPP_
@@ -0,0 +1,109 @@
+#ifndef _SPSC_QUEUE_HPP_
+#define _SPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+
+namespace DSP {
+
+/**
+ * @brief Lock-free single-producer, single-consumer FIFO.
+ *
+ * One thread may push (e.g. a control or UI thread), one other thread may
+ * pop (e.g. the audio thread); neither ever blocks or allocates. Items are
+ * copied in and out, so keep them small and trivially copyable.
+ *
+ * Capacity must be a power of 2. Memory is allocated externally (see
+ * GetMemSize()).
+ */
+template <typename T_>
+class SPSCQueue {
+
+ public:
+
+    /**
+     * @brief Memory needed for capacity items
+     *
+     */
+    static size_t GetMemSize(unsigned int capacity) {
+        return capacity * sizeof(T_);
+    }
+    /**
+     * @brief Construct a new, empty SPSCQueue
+     *
+     * @param capacity Maximum number of items queued (power of 2)
+     * @param mem Memory of GetMemSize(capacity) bytes. Allocate externally.
+     */
+    SPSCQueue(unsigned int capacity, void *mem) :
+            capacity_(capacity),
+            items_(static_cast<T_ *>(mem)),
+            head_(0),
+            tail_(0) {
+        assert(capacity > 0);
+        assert((capacity & (capacity - 1)) == 0);  // Power of 2 only
+    }
+    /**
+     * @brief Add an item at the back (producer only)
+     *
+     * @return false if the queue is full
+     */
+    bool Push(const T_ &item) {
+        unsigned int tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == capacity_) {
+            return false;
+        }
+        items_[tail & (capacity_ - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    /**
+     * @brief Oldest item, left in the queue (consumer only)
+     *
+     * @return const T_* Item, or nullptr if the queue is empty
+     */
+    const T_ *Front() {
+        unsigned int head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &items_[head & (capacity_ - 1)];
+    }
+    /**
+     * @brief Drop the oldest item (consumer only, queue not empty)
+     *
+     */
+    void Pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+    }
+    /**
+     * @brief Take the oldest item out (consumer only)
+     *
+     * @return false if the queue is empty
+     */
+    bool Pop(T_ &item) {
+        const T_ *front = Front();
+        if (front == nullptr) {
+            return false;
+        }
+        item = *front;
+        Pop();
+        return true;
+    }
+    unsigned int GetCapacity() { return capacity_; }
+
+ protected:
+
+    // Counters run freely and wrap around: only their difference matters
+    unsigned int capacity_;
+    T_ *items_;
+    std::atomic<unsigned int> head_;  // Written by the consumer
+    char pad_[64];  // Keep the two counters on separate cache lines
+    std::atomic<unsigned int> tail_;  // Written by the producer
+};
+
+}  // namespace DSP
+
+#endif  // _SPSC_QUEUE_HPP_
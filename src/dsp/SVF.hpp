@@ -0,0 +1,358 @@
+#ifndef _SVF_HPP_
+#define _SVF_HPP_
+
+#include <cassert>
+#include <cmath>
+#include "SIMD.hpp"
+
+
+namespace DSP {
+
+/**
+ * @brief Memory of a state-variable filter, all channels
+ *
+ */
+template <unsigned int n_channels>
+struct SVFState {
+    float ic1eq[n_channels];
+    float ic2eq[n_channels];
+};
+
+
+inline namespace __SIMD_ISA_NS {
+
+/**
+ * @brief State-variable filter (topology-preserving transform, after
+ * Zavalishin and Simper), with lowpass, bandpass and highpass out of the
+ * same state.
+ *
+ * The integrators keep their state through any change of cutoff or
+ * resonance, so unlike a Biquad it stays well-behaved when modulated a
+ * sample at a time; and a new cutoff only costs a tan (see FastTan()) and
+ * a divide. Each channel has its own cutoff and resonance: the channels
+ * make a bank, processed SIMD::kWidth at a time (the ones left over, one
+ * at a time), with the state in registers for the whole buffer.
+ *
+ * Compiled for the build's instruction set (not picked at run time, see
+ * Dispatch).
+ *
+ * @tparam n_channels Number of interleaved channels
+ */
+template <unsigned int n_channels>
+class SVF {
+
+ public:
+
+    /**
+     * @brief Memory of the filter
+     *
+     */
+    typedef SVFState<n_channels> State;
+
+    /**
+     * @brief Construct a new SVF object, with every channel at fs / 4 and
+     * a Q of 1 / sqrt(2) (Butterworth lowpass and highpass)
+     *
+     * @param fs Sample rate
+     * @param s State (filter memory). Allocate externally.
+     */
+    SVF(float fs, State *s);
+    /**
+     * @brief Reset memory of filter.
+     *
+     */
+    void Reset();
+    /**
+     * @brief Set cutoff and resonance of every channel
+     *
+     * @param f_cut Cutoff frequency (up to just under fs / 2)
+     * @param q_factor Quality factor
+     */
+    void SetParameters(float f_cut, float q_factor);
+    /**
+     * @brief Set cutoff and resonance of one channel
+     *
+     */
+    void SetParameters(unsigned int channel, float f_cut, float q_factor);
+    /**
+     * @brief Process buffer of frames, with the cutoffs and resonances
+     * set. Any output can be nullptr (not needed) or in (in place).
+     *
+     * @param in Audio buffer, interleaved
+     * @param lp Lowpass output, interleaved
+     * @param bp Bandpass output (peak gain Q), interleaved
+     * @param hp Highpass output, interleaved
+     * @param n_samples Number of frames in the buffers
+     */
+    void ProcessBuffer(const float *in, float *lp, float *bp, float *hp,
+        unsigned int n_samples);
+    /**
+     * @brief Process buffer of frames, with a cutoff (and optionally a
+     * Q) per frame and channel. The last ones are kept, as if set with
+     * SetParameters(), but with FastTan().
+     *
+     * @param f_cut Cutoff frequencies, interleaved like in
+     * @param q_factor Quality factors, interleaved like in; nullptr to
+     * keep the ones set
+     */
+    void ProcessBufferModulated(const float *in, const float *f_cut,
+        const float *q_factor, float *lp, float *bp, float *hp,
+        unsigned int n_samples);
+
+    /**
+     * @brief tan(x) for 0 <= x < pi / 2, to float precision: a Pade
+     * approximant up to pi / 4, reflected above it (tan(x) =
+     * 1 / tan(pi / 2 - x))
+     *
+     */
+    static inline SIMD::Vec FastTan(SIMD::Vec x);
+
+ private:
+
+    using V = SIMD;
+    // Channels in whole vectors, then one at a time
+    static constexpr unsigned int kVectors = n_channels / SIMD::kWidth;
+    static constexpr unsigned int kVectorChannels = kVectors * SIMD::kWidth;
+    static constexpr unsigned int kLeftover = n_channels - kVectorChannels;
+    // Highest pi * f_cut / fs (0.49 fs: tan stays finite)
+    static constexpr float kMaxOmega = 1.54f;
+
+    /**
+     * @brief Coefficients of one vector of channels (or one channel)
+     *
+     */
+    template <class OPS_T>
+    struct Coeffs_ {
+        typename OPS_T::Vec a1, a2, a3, k;
+    };
+
+    template <class OPS_T>
+    static inline typename OPS_T::Vec Tan_(typename OPS_T::Vec x);
+    template <class OPS_T>
+    static inline Coeffs_<OPS_T> MakeCoeffs_(typename OPS_T::Vec g,
+        typename OPS_T::Vec k);
+    /**
+     * @brief Parameters, coefficients and state of one vector of channels
+     * (or one channel)
+     *
+     */
+    template <class OPS_T>
+    struct Channels_ {
+        typename OPS_T::Vec g, k, z1, z2;
+        Coeffs_<OPS_T> c;
+    };
+
+    template <class OPS_T>
+    inline void Load_(Channels_<OPS_T> &ch, unsigned int first) const;
+    template <class OPS_T>
+    inline void Save_(const Channels_<OPS_T> &ch, unsigned int first);
+    /**
+     * @brief One frame through channels [first, first + OPS_T's width),
+     * modulated if f_cut isn't nullptr
+     *
+     * @param i Index of the first channel in the buffers
+     */
+    template <class OPS_T>
+    inline void Step_(Channels_<OPS_T> &ch, unsigned int i,
+        const float *in, const float *f_cut, const float *q_factor,
+        float *lp, float *bp, float *hp) const;
+    void Run_(const float *in, const float *f_cut, const float *q_factor,
+        float *lp, float *bp, float *hp, unsigned int n_samples);
+
+    const float omega_scale_;  // pi / fs
+    State *s_;
+    float g_[n_channels];  // tan(pi * f_cut / fs)
+    float k_[n_channels];  // 1 / Q
+};
+
+
+template<unsigned int n_channels>
+SVF<n_channels>::SVF(float fs, State *s) :
+        omega_scale_(M_PI / fs),
+        s_(s) {
+    SetParameters(0.25f * fs, M_SQRT1_2);
+    Reset();
+}
+
+
+template<unsigned int n_channels>
+void SVF<n_channels>::Reset() {
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        s_->ic1eq[ch] = 0;
+        s_->ic2eq[ch] = 0;
+    }
+}
+
+
+template<unsigned int n_channels>
+void SVF<n_channels>::SetParameters(float f_cut, float q_factor) {
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        SetParameters(ch, f_cut, q_factor);
+    }
+}
+
+
+template<unsigned int n_channels>
+void SVF<n_channels>::SetParameters(unsigned int channel, float f_cut,
+        float q_factor) {
+    assert(channel < n_channels);
+    float omega = std::fmin(std::fmax(f_cut * omega_scale_, 0.f), kMaxOmega);
+    g_[channel] = std::tan(omega);
+    k_[channel] = 1.f / q_factor;
+}
+
+
+template<unsigned int n_channels>
+inline SIMD::Vec SVF<n_channels>::FastTan(SIMD::Vec x) {
+    return Tan_<SIMD>(x);
+}
+
+
+template<unsigned int n_channels>
+void SVF<n_channels>::ProcessBuffer(const float *in, float *lp, float *bp,
+        float *hp, unsigned int n_samples) {
+    Run_(in, nullptr, nullptr, lp, bp, hp, n_samples);
+}
+
+
+template<unsigned int n_channels>
+void SVF<n_channels>::ProcessBufferModulated(const float *in,
+        const float *f_cut, const float *q_factor, float *lp, float *bp,
+        float *hp, unsigned int n_samples) {
+    Run_(in, f_cut, q_factor, lp, bp, hp, n_samples);
+}
+
+
+template<unsigned int n_channels>
+template<class OPS_T>
+inline typename OPS_T::Vec SVF<n_channels>::Tan_(typename OPS_T::Vec x) {
+    using O = OPS_T;
+    const typename O::Vec kQuarterPi = O::Set1(M_PI / 4);
+    const typename O::Vec kHalfPi = O::Set1(M_PI / 2);
+    typename O::Vec reflect = O::CmpLe(kQuarterPi, x);
+    typename O::Vec t = O::Select(reflect, O::Sub(kHalfPi, x), x);
+    typename O::Vec t2 = O::Mul(t, t);
+    // t (945 - 105 t^2 + t^4) / (945 - 420 t^2 + 15 t^4)
+    typename O::Vec p = O::Mul(t, O::MulAdd(t2, O::Sub(t2, O::Set1(105.f)),
+        O::Set1(945.f)));
+    typename O::Vec q = O::MulAdd(t2, O::MulAdd(t2, O::Set1(15.f),
+        O::Set1(-420.f)), O::Set1(945.f));
+    return O::Div(O::Select(reflect, q, p), O::Select(reflect, p, q));
+}
+
+
+template<unsigned int n_channels>
+template<class OPS_T>
+inline typename SVF<n_channels>::template Coeffs_<OPS_T>
+SVF<n_channels>::MakeCoeffs_(typename OPS_T::Vec g, typename OPS_T::Vec k) {
+    using O = OPS_T;
+    Coeffs_<OPS_T> c;
+    c.a1 = O::Div(O::Set1(1.f), O::MulAdd(g, O::Add(g, k), O::Set1(1.f)));
+    c.a2 = O::Mul(g, c.a1);
+    c.a3 = O::Mul(g, c.a2);
+    c.k = k;
+    return c;
+}
+
+
+template<unsigned int n_channels>
+template<class OPS_T>
+inline void SVF<n_channels>::Load_(Channels_<OPS_T> &ch,
+        unsigned int first) const {
+    ch.g = OPS_T::LoadU(g_ + first);
+    ch.k = OPS_T::LoadU(k_ + first);
+    ch.c = MakeCoeffs_<OPS_T>(ch.g, ch.k);
+    ch.z1 = OPS_T::LoadU(s_->ic1eq + first);
+    ch.z2 = OPS_T::LoadU(s_->ic2eq + first);
+}
+
+
+template<unsigned int n_channels>
+template<class OPS_T>
+inline void SVF<n_channels>::Save_(const Channels_<OPS_T> &ch,
+        unsigned int first) {
+    OPS_T::StoreU(g_ + first, ch.g);
+    OPS_T::StoreU(k_ + first, ch.k);
+    OPS_T::StoreU(s_->ic1eq + first, ch.z1);
+    OPS_T::StoreU(s_->ic2eq + first, ch.z2);
+}
+
+
+template<unsigned int n_channels>
+template<class OPS_T>
+inline void SVF<n_channels>::Step_(Channels_<OPS_T> &ch, unsigned int i,
+        const float *in, const float *f_cut, const float *q_factor,
+        float *lp, float *bp, float *hp) const {
+
+    using O = OPS_T;
+    typedef typename O::Vec Vec;
+    if (f_cut) {
+        // Off the recursion: overlaps with the other channels' steps
+        Vec omega = O::Min(O::Max(O::Mul(O::LoadU(f_cut + i),
+            O::Set1(omega_scale_)), O::Zero()), O::Set1(kMaxOmega));
+        ch.g = Tan_<OPS_T>(omega);
+        if (q_factor) {
+            ch.k = O::Div(O::Set1(1.f), O::LoadU(q_factor + i));
+        }
+        ch.c = MakeCoeffs_<OPS_T>(ch.g, ch.k);
+    }
+    const Coeffs_<OPS_T> &c = ch.c;
+    Vec x = O::LoadU(in + i);
+    Vec v3 = O::Sub(x, ch.z2);
+    Vec v1 = O::MulAdd(c.a2, v3, O::Mul(c.a1, ch.z1));
+    Vec v2 = O::Add(ch.z2, O::MulAdd(c.a3, v3, O::Mul(c.a2, ch.z1)));
+    ch.z1 = O::Sub(O::Add(v1, v1), ch.z1);
+    ch.z2 = O::Sub(O::Add(v2, v2), ch.z2);
+    if (lp) {
+        O::StoreU(lp + i, v2);
+    }
+    if (bp) {
+        O::StoreU(bp + i, v1);
+    }
+    if (hp) {
+        O::StoreU(hp + i, O::Sub(O::Sub(x, O::Mul(c.k, v1)), v2));
+    }
+}
+
+
+template<unsigned int n_channels>
+void SVF<n_channels>::Run_(const float *in, const float *f_cut,
+        const float *q_factor, float *lp, float *bp, float *hp,
+        unsigned int n_samples) {
+
+    // (+ 1: no empty arrays)
+    Channels_<SIMD> vec[kVectors + 1];
+    Channels_<SIMDScalar> one[kLeftover + 1];
+    for (unsigned int v = 0; v < kVectors; v++) {
+        Load_(vec[v], v * V::kWidth);
+    }
+    for (unsigned int ch = 0; ch < kLeftover; ch++) {
+        Load_(one[ch], kVectorChannels + ch);
+    }
+
+    // All channels advance together, so their recursions overlap
+    for (unsigned int n = 0; n < n_samples; n++) {
+        unsigned int frame = n * n_channels;
+        for (unsigned int v = 0; v < kVectors; v++) {
+            Step_(vec[v], frame + v * V::kWidth, in, f_cut, q_factor, lp, bp,
+                hp);
+        }
+        for (unsigned int ch = 0; ch < kLeftover; ch++) {
+            Step_(one[ch], frame + kVectorChannels + ch, in, f_cut, q_factor,
+                lp, bp, hp);
+        }
+    }
+
+    for (unsigned int v = 0; v < kVectors; v++) {
+        Save_(vec[v], v * V::kWidth);
+    }
+    for (unsigned int ch = 0; ch < kLeftover; ch++) {
+        Save_(one[ch], kVectorChannels + ch);
+    }
+}
+
+}  // inline namespace __SIMD_ISA_NS
+
+}  // namespace DSP
+
+#endif  // _SVF_HPP_
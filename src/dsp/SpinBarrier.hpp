@@ -0,0 +1,151 @@
+#ifndef _SPIN_BARRIER_HPP_
+#define _SPIN_BARRIER_HPP_
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+namespace DSP {
+
+/**
+ * @brief Barrier for a fixed group of threads that meet very often (e.g.
+ * once per sample), too often to go through the OS.
+ *
+ * Waiting threads spin, then start yielding their core if the others are
+ * late (e.g. when there are more threads than cores). Reusable straight
+ * away: the last thread in resets it.
+ */
+class SpinBarrier {
+
+ public:
+
+    explicit SpinBarrier(unsigned int n_threads) :
+            n_threads_(n_threads),
+            arrived_(0),
+            generation_(0) {}
+    /**
+     * @brief Change the size of the group (no thread waiting)
+     *
+     */
+    void SetThreadCount(unsigned int n_threads) { n_threads_ = n_threads; }
+    /**
+     * @brief Return once all n_threads threads have called Wait(). Memory
+     * written by any of them before is visible to all of them after.
+     *
+     */
+    void Wait() {
+        unsigned int generation = generation_.load(std::memory_order_acquire);
+        if (arrived_.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+                n_threads_) {
+            // Last one in lets everyone go
+            arrived_.store(0, std::memory_order_relaxed);
+            generation_.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        unsigned int spins = 0;
+        while (generation_.load(std::memory_order_acquire) == generation) {
+            if (++spins > kSpinsBeforeYield) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    static constexpr unsigned int kSpinsBeforeYield = 256;
+
+ protected:
+
+    unsigned int n_threads_;
+    std::atomic<unsigned int> arrived_;
+    std::atomic<unsigned int> generation_;
+};
+
+
+/**
+ * @brief Worker threads that wait for blocks by spinning (then yielding,
+ * as SpinBarrier does), for an owner that splits each block between
+ * itself and them.
+ *
+ * Worker w (1 to n_workers) runs owner->*run(w) once per Post(), so the
+ * owner runs its own share (0) on the caller's thread straight after
+ * posting. Synchronising within a block is up to the owner, e.g. with a
+ * SpinBarrier.
+ */
+class SpinWorkers {
+
+ public:
+
+    SpinWorkers() :
+            block_count_(0),
+            stop_(false) {}
+    ~SpinWorkers() { Stop(); }
+    /**
+     * @brief Start n_workers threads. Each runs owner->*start(w) first,
+     * if given. Not real-time safe.
+     *
+     */
+    template <class T>
+    void Start(unsigned int n_workers, T *owner, void (T::*run)(unsigned int),
+            void (T::*start)(unsigned int) = nullptr) {
+        stop_.store(false, std::memory_order_relaxed);
+        for (unsigned int w = 1; w <= n_workers; w++) {
+            // Count taken here: the thread may only get going after the
+            // first block has been posted
+            workers_.emplace_back(&SpinWorkers::Worker_<T>, this, w,
+                block_count_.load(std::memory_order_relaxed), owner, run,
+                start);
+        }
+    }
+    /**
+     * @brief Stop and join all threads (none may be running a block).
+     * Not real-time safe.
+     *
+     */
+    void Stop() {
+        stop_.store(true, std::memory_order_release);
+        for (std::thread &worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+    }
+    bool IsRunning() const { return !workers_.empty(); }
+    /**
+     * @brief Have every worker run a block. Whatever the owner wrote
+     * before is visible to them.
+     *
+     */
+    void Post() { block_count_.fetch_add(1, std::memory_order_release); }
+
+ protected:
+
+    std::vector<std::thread> workers_;
+    std::atomic<unsigned int> block_count_;
+    std::atomic<bool> stop_;
+
+    template <class T>
+    void Worker_(unsigned int w, unsigned int seen, T *owner,
+            void (T::*run)(unsigned int), void (T::*start)(unsigned int)) {
+        if (start != nullptr) {
+            (owner->*start)(w);
+        }
+        for (;;) {
+            unsigned int spins = 0;
+            unsigned int count;
+            while ((count = block_count_.load(std::memory_order_acquire)) ==
+                    seen) {
+                if (stop_.load(std::memory_order_acquire)) {
+                    return;
+                }
+                if (++spins > SpinBarrier::kSpinsBeforeYield) {
+                    std::this_thread::yield();
+                }
+            }
+            seen = count;
+            (owner->*run)(w);
+        }
+    }
+};
+
+}  // namespace DSP
+
+#endif  // _SPIN_BARRIER_HPP_
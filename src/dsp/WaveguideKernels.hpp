@@ -0,0 +1,73 @@
+#ifndef _WAVEGUIDE_KERNELS_HPP_
+#define _WAVEGUIDE_KERNELS_HPP_
+
+#include "SIMD.hpp"
+
+
+namespace DSP {
+
+inline namespace __SIMD_ISA_NS {
+
+/**
+ * @brief Waveguide mesh kernels for one instruction set (see
+ * Triangular2DMesh's stencil kernel, and Dispatch for how the instruction
+ * set gets picked). Every junction has kNPorts waveguides, numbered round
+ * it so that the opposite of port d is (d + kNPorts / 2) % kNPorts; the
+ * missing ones carry zeros.
+ *
+ * Arrays hold n junctions each, aligned and padded to
+ * Dispatch::kMaxAlignment, so that any instruction set's kernels run them
+ * with aligned loads and no tail.
+ */
+class WaveguideKernels {
+
+ public:
+
+    static constexpr unsigned int kNPorts = 6;
+
+    /**
+     * @brief Junction waves: junc = (sum of wave[d]) * coef * alpha * damp
+     *
+     */
+    static void Scatter(float *junc, const float *const *wave,
+            const float *coef, const float *damp, float alpha,
+            unsigned int n) {
+        const SIMD::Vec a = SIMD::Set1(alpha);
+        for (unsigned int j = 0; j < n; j += SIMD::kWidth) {
+            SIMD::Vec sum = SIMD::Load(wave[0] + j);
+            for (unsigned int d = 1; d < kNPorts; d++) {
+                sum = SIMD::Add(sum, SIMD::Load(wave[d] + j));
+            }
+            SIMD::Store(junc + j, SIMD::Mul(SIMD::Mul(SIMD::Mul(sum,
+                SIMD::Load(coef + j)), a), SIMD::Load(damp + j)));
+        }
+    }
+
+    /**
+     * @brief Waves arriving next sample: what the neighbour at offset[d]
+     * scattered, minus what it received along the opposite port, times
+     * link[d] (0 where the waveguide is missing). Neighbours may sit up to
+     * the largest offset outside the arrays, where they must read zero.
+     *
+     */
+    static void Propagate(float *const *wave_next, const float *const *wave,
+            const float *junc, const float *const *link, const int *offset,
+            unsigned int n) {
+        for (unsigned int j = 0; j < n; j += SIMD::kWidth) {
+            for (unsigned int d = 0; d < kNPorts; d++) {
+                const float *from = junc + j + offset[d];
+                const float *back = wave[(d + kNPorts / 2) % kNPorts] + j +
+                    offset[d];
+                SIMD::Store(wave_next[d] + j, SIMD::Mul(
+                    SIMD::Load(link[d] + j),
+                    SIMD::Sub(SIMD::LoadU(from), SIMD::LoadU(back))));
+            }
+        }
+    }
+};
+
+}  // inline namespace __SIMD_ISA_NS
+
+}  // namespace DSP
+
+#endif  // _WAVEGUIDE_KERNELS_HPP_
@@ -0,0 +1,350 @@
+#include "Waveshaper.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include "SIMD.hpp"
+
+
+namespace DSP {
+
+static constexpr unsigned int kH = 2 * Waveshaper::kHalfbandTaps;  // History
+
+
+// Zeroth-order modified Bessel function of the first kind (for Kaiser)
+static double BesselI0(double x) {
+    double sum = 1., term = 1.;
+    for (unsigned int k = 1; term > 1e-12 * sum; k++) {
+        term *= (0.5 * x / k) * (0.5 * x / k);
+        sum += term;
+    }
+    return sum;
+}
+
+
+// Halfband taps at odd distances from the centre (whose tap is 0.5): a
+// Kaiser-windowed sinc, at a quarter of the oversampled rate
+static void DesignHalfband(float *g, unsigned int n_taps) {
+    const double beta = 8.;
+    double h[Waveshaper::kHalfbandTaps];
+    double sum = 0;
+    for (unsigned int j = 0; j < n_taps; j++) {
+        double d = 2. * j + 1.;
+        double r = d / (2. * n_taps);
+        h[j] = std::sin(0.5 * M_PI * d) / (M_PI * d) *
+            BesselI0(beta * std::sqrt(1. - r * r)) / BesselI0(beta);
+        sum += h[j];
+    }
+    // Unity gain at DC
+    for (unsigned int j = 0; j < n_taps; j++) {
+        g[j] = static_cast<float>(h[j] * 0.25 / sum);
+    }
+}
+
+
+// Keeps the last kH samples of a buffer of kH + n in front, for the
+// next block
+static void KeepHistory(float *b, unsigned int n) {
+    for (unsigned int k = 0; k < kH; k++) {
+        b[k] = b[k + n];
+    }
+}
+
+
+inline namespace __SIMD_ISA_NS {
+
+// Halfband filter at p (current sample), without its centre tap: taps
+// alternate with zeros, so only every other sample counts
+template <unsigned int kK, class O>
+static inline typename O::Vec Halfband(const float *p, const float *g) {
+    typename O::Vec acc = O::Zero();
+    for (unsigned int j = 0; j < kK; j++) {
+        acc = O::MulAdd(O::Set1(g[j]), O::Add(O::LoadU(p - kK + 1 + j),
+            O::LoadU(p - kK - j)), acc);
+    }
+    return acc;
+}
+
+
+// x (after kH of history) to y at twice the rate: even samples are the
+// filtered branch (doubled, for the zeros stuffed in), odd ones the
+// centre tap's
+template <unsigned int kK>
+static void Upsample(const float *x, float *y, unsigned int n,
+        const float *g) {
+    using V = SIMD;
+    const float *centre = x - (kK - 1);
+    unsigned int i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+        float even[V::kWidth];
+        V::StoreU(even, V::Mul(V::Set1(2.f), Halfband<kK, V>(x + i, g)));
+        for (unsigned int l = 0; l < V::kWidth; l++) {
+            y[2 * (i + l)] = even[l];
+            y[2 * (i + l) + 1] = centre[i + l];
+        }
+    }
+    for (; i < n; i++) {
+        y[2 * i] = 2.f * Halfband<kK, SIMDScalar>(x + i, g);
+        y[2 * i + 1] = centre[i];
+    }
+}
+
+
+// y at twice the rate to z, through the even and odd branches (each after
+// kH of history)
+template <unsigned int kK>
+static void Downsample(const float *y, float *even, float *odd, float *z,
+        unsigned int n, const float *g) {
+    using V = SIMD;
+    for (unsigned int i = 0; i < n; i++) {
+        even[i] = y[2 * i];
+        odd[i] = y[2 * i + 1];
+    }
+    const float *centre = odd - kK;
+    unsigned int i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+        V::StoreU(z + i, V::MulAdd(V::Set1(0.5f), V::LoadU(centre + i),
+            Halfband<kK, V>(even + i, g)));
+    }
+    for (; i < n; i++) {
+        z[i] = 0.5f * centre[i] + Halfband<kK, SIMDScalar>(even + i, g);
+    }
+}
+
+
+// Shapes, on whole vectors or (with SIMDScalar) single samples
+struct SigmoidShape {
+    float drive;
+    template <class O>
+    typename O::Vec Apply(typename O::Vec x) const {
+        // tanh() Pade approximant, which meets +/-1 at +/-3
+        x = O::Mul(x, O::Set1(drive));
+        x = O::Min(O::Max(x, O::Set1(-3.f)), O::Set1(3.f));
+        typename O::Vec x2 = O::Mul(x, x);
+        return O::Div(O::Mul(x, O::Add(x2, O::Set1(27.f))),
+            O::MulAdd(x2, O::Set1(9.f), O::Set1(27.f)));
+    }
+};
+
+struct Chebyshev5Shape {
+    float drive;
+    template <class O>
+    typename O::Vec Apply(typename O::Vec x) const {
+        x = O::Mul(x, O::Set1(drive));
+        x = O::Min(O::Max(x, O::Set1(-1.f)), O::Set1(1.f));
+        typename O::Vec x2 = O::Mul(x, x);
+        typename O::Vec y = O::MulAdd(x2, O::Set1(16.f), O::Set1(-20.f));
+        y = O::MulAdd(y, x2, O::Set1(5.f));
+        return O::Mul(y, x);
+    }
+};
+
+struct RemainderShape {
+    float drive;
+    float step;
+    float remainder_gain;
+    template <class O>
+    typename O::Vec Apply(typename O::Vec x) const {
+        x = O::Mul(x, O::Set1(drive));
+        typename O::Vec crushed = O::Mul(O::Floor(O::MulAdd(x,
+            O::Set1(1.f / step), O::Set1(0.5f))), O::Set1(step));
+        return O::MulAdd(O::Sub(x, crushed), O::Set1(remainder_gain),
+            crushed);
+    }
+};
+
+struct TableShape {
+    float drive;
+    const float *table;
+    template <class O>
+    typename O::Vec Apply(typename O::Vec x) const {
+        static constexpr float kScale = 0.5f * (Waveshaper::kTableSize - 1);
+        x = O::Mul(x, O::Set1(drive));
+        x = O::Min(O::Max(x, O::Set1(-1.f)), O::Set1(1.f));
+        typename O::Vec pos = O::MulAdd(x, O::Set1(kScale), O::Set1(kScale));
+        typename O::Vec i = O::Floor(pos);
+        float i_f[O::kWidth];
+        uint32_t index[O::kWidth];
+        O::StoreU(i_f, i);
+        for (unsigned int l = 0; l < O::kWidth; l++) {
+            // Also keeps NaNs in the table
+            index[l] = (i_f[l] >= 0.f && i_f[l] < Waveshaper::kTableSize) ?
+                static_cast<uint32_t>(i_f[l]) : 0;
+        }
+        typename O::Vec y0 = O::Gather(table, index);
+        typename O::Vec y1 = O::Gather(table + 1, index);
+        return O::MulAdd(O::Sub(y1, y0), O::Sub(pos, i), y0);
+    }
+};
+
+
+template <class SHAPE_T>
+static void ShapeBlock(float *x, unsigned int n, const SHAPE_T &shape) {
+    using V = SIMD;
+    unsigned int k = 0;
+    for (; k + V::kWidth <= n; k += V::kWidth) {
+        V::StoreU(x + k, shape.template Apply<V>(V::LoadU(x + k)));
+    }
+    for (; k < n; k++) {
+        x[k] = shape.template Apply<SIMDScalar>(x[k]);
+    }
+}
+
+}  // inline namespace __SIMD_ISA_NS
+
+
+size_t Waveshaper::GetMemSize(unsigned int oversampling,
+        unsigned int max_block) {
+    size_t n_floats = kTableSize + 1;
+    for (unsigned int s = 0; (2u << s) <= oversampling; s++) {
+        size_t len = max_block << s;
+        n_floats += 3 * (kHistory + len) + 2 * len;
+    }
+    return n_floats * sizeof(float);
+}
+
+
+Waveshaper::Waveshaper(unsigned int oversampling, unsigned int max_block,
+        void *mem) :
+        n_stages_((oversampling >= 2) + (oversampling >= 4)),
+        max_block_(max_block),
+        shape_(kSigmoid),
+        drive_(1.f) {
+
+    assert(oversampling == 1 || oversampling == 2 || oversampling == 4);
+
+    float *p = static_cast<float *>(mem);
+    table_ = p;
+    p += kTableSize + 1;
+    for (unsigned int s = 0; s < n_stages_; s++) {
+        unsigned int len = max_block << s;
+        stage_[s].up = p;
+        p += kHistory + len;
+        stage_[s].even = p;
+        p += kHistory + len;
+        stage_[s].odd = p;
+        p += kHistory + len;
+        stage_[s].oversampled = p;
+        p += 2 * len;
+    }
+    DesignHalfband(g_[0], kHalfbandTaps);
+    DesignHalfband(g_[1], kHalfbandTaps / 2);
+
+    SetRemainder(12, 10.f);
+    SetTable([](float x) { return x; });
+    Reset();
+}
+
+
+void Waveshaper::Reset() {
+    for (unsigned int s = 0; s < n_stages_; s++) {
+        for (unsigned int k = 0; k < kHistory; k++) {
+            stage_[s].up[k] = 0;
+            stage_[s].even[k] = 0;
+            stage_[s].odd[k] = 0;
+        }
+    }
+}
+
+
+void Waveshaper::SetRemainder(unsigned int bits, float remainder_gain) {
+    assert(bits >= 1 && bits < 32);
+    step_ = std::ldexp(1.f, -static_cast<int>(bits - 1));
+    remainder_gain_ = remainder_gain;
+}
+
+
+void Waveshaper::SetTable(const float *points) {
+    for (unsigned int n = 0; n < kTableSize; n++) {
+        table_[n] = points[n];
+    }
+    table_[kTableSize] = table_[kTableSize - 1];
+}
+
+
+void Waveshaper::Shape_(float *x, unsigned int n) {
+    switch (shape_) {
+    case kSigmoid:
+        ShapeBlock(x, n, SigmoidShape { drive_ });
+        break;
+    case kChebyshev5:
+        ShapeBlock(x, n, Chebyshev5Shape { drive_ });
+        break;
+    case kRemainder:
+        ShapeBlock(x, n, RemainderShape { drive_, step_, remainder_gain_ });
+        break;
+    case kTable:
+        ShapeBlock(x, n, TableShape { drive_, table_ });
+        break;
+    }
+}
+
+
+void Waveshaper::Process(const float *in, float *out,
+        unsigned int n_samples) {
+
+    assert(n_samples <= max_block_);
+
+    if (n_stages_ == 0) {
+        if (in != out) {
+            for (unsigned int k = 0; k < n_samples; k++) {
+                out[k] = in[k];
+            }
+        }
+        Shape_(out, n_samples);
+        return;
+    }
+
+    // Up, a stage at a time (in is copied first, so it can be out)
+    const float *x = in;
+    unsigned int n = n_samples;
+    for (unsigned int s = 0; s < n_stages_; s++) {
+        Stage_ &st = stage_[s];
+        for (unsigned int k = 0; k < n; k++) {
+            st.up[kHistory + k] = x[k];
+        }
+        if (s == 0) {
+            Upsample<kHalfbandTaps>(st.up + kHistory, st.oversampled, n,
+                g_[0]);
+        } else {
+            Upsample<kHalfbandTaps / 2>(st.up + kHistory, st.oversampled, n,
+                g_[1]);
+        }
+        KeepHistory(st.up, n);
+        x = st.oversampled;
+        n *= 2;
+    }
+
+    Shape_(stage_[n_stages_ - 1].oversampled, n);
+
+    // And back down
+    for (unsigned int s = n_stages_; s > 0; s--) {
+        Stage_ &st = stage_[s - 1];
+        n /= 2;
+        float *z = (s == 1) ? out : stage_[s - 2].oversampled;
+        if (s == 1) {
+            Downsample<kHalfbandTaps>(st.oversampled, st.even + kHistory,
+                st.odd + kHistory, z, n, g_[0]);
+        } else {
+            Downsample<kHalfbandTaps / 2>(st.oversampled, st.even + kHistory,
+                st.odd + kHistory, z, n, g_[1]);
+        }
+        KeepHistory(st.even, n);
+        KeepHistory(st.odd, n);
+    }
+}
+
+
+float Waveshaper::GetLatency() const {
+    // Each stage delays by its filter's centre, twice, at twice its input
+    // rate: 2K - 1 samples at its input rate (K taps a side)
+    float latency = 0;
+    if (n_stages_ >= 1) {
+        latency += 2.f * kHalfbandTaps - 1.f;
+    }
+    if (n_stages_ >= 2) {
+        latency += 0.5f * (kHalfbandTaps - 1.f);
+    }
+    return latency;
+}
+
+}  // namespace DSP
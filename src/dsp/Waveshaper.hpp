@@ -0,0 +1,158 @@
+#ifndef _WAVESHAPER_HPP_
+#define _WAVESHAPER_HPP_
+
+#include <cstddef>
+
+
+namespace DSP {
+
+/**
+ * @brief Memoryless nonlinearity, oversampled 1x, 2x or 4x to keep its
+ * harmonics from aliasing, processed a block at a time (e.g. after the
+ * mesh).
+ *
+ * Oversampling cascades 2x stages of halfband FIR filters, split into
+ * polyphase branches so no multiplies are wasted on zero-stuffed or
+ * dropped samples. Filters (kHalfbandTaps taps a side, Kaiser window) keep
+ * 0 to 0.39 of the base rate flat and reject images by about 80 dB, at the
+ * cost of GetLatency() samples of delay. At 4x, the second stage only has
+ * to reject what lands above that band, so it gets by with half the taps.
+ *
+ * Shapes, on drive * x:
+ *  - kSigmoid: rational tanh() approximation, saturating at +/-1
+ *  - kChebyshev5: T5(x) = 16x^5 - 20x^3 + 5x (input clamped to +/-1): a
+ *    full-scale sine comes out as its 5th harmonic
+ *  - kRemainder: bit-crush "grunge", the quantisation error of a crushed
+ *    signal amplified back in (the notebook smooths the result with a
+ *    4 kHz lowpass: see FilterDesigner)
+ *  - kTable: any curve, sampled over [-1, 1] (see SetTable()) and
+ *    interpolated linearly, input clamped
+ *
+ * Memory is allocated externally (see GetMemSize()). Process() is real-time
+ * safe; the setters are too, except SetTable() with a function to sample.
+ */
+class Waveshaper {
+
+ public:
+
+    enum Shape {
+        kSigmoid,
+        kChebyshev5,
+        kRemainder,
+        kTable,
+    };
+
+    /**
+     * @brief Nonzero halfband taps on each side of the centre (first
+     * stage)
+     *
+     */
+    static constexpr unsigned int kHalfbandTaps = 12;
+    /**
+     * @brief Number of points of the kTable curve
+     *
+     */
+    static constexpr unsigned int kTableSize = 257;
+
+    /**
+     * @brief Memory needed for a waveshaper
+     *
+     * @param oversampling 1, 2 or 4
+     * @param max_block Largest block Process() gets
+     * @return size_t Bytes
+     */
+    static size_t GetMemSize(unsigned int oversampling,
+        unsigned int max_block);
+    /**
+     * @brief Construct a new Waveshaper (kSigmoid, drive 1, silent
+     * filters, identity table)
+     *
+     * @param oversampling 1, 2 or 4
+     * @param max_block Largest block Process() gets
+     * @param mem Memory of GetMemSize(oversampling, max_block) bytes.
+     * Allocate externally.
+     */
+    Waveshaper(unsigned int oversampling, unsigned int max_block, void *mem);
+    /**
+     * @brief Reset memory of the oversampling filters
+     *
+     */
+    void Reset();
+    void SetShape(Shape shape) { shape_ = shape; }
+    /**
+     * @brief Gain into the shape
+     *
+     */
+    void SetDrive(float drive) { drive_ = drive; }
+    /**
+     * @brief kRemainder parameters
+     *
+     * @param bits Resolution of the crushed signal over [-1, 1]
+     * @param remainder_gain Gain of the quantisation error (1 is clean)
+     */
+    void SetRemainder(unsigned int bits, float remainder_gain);
+    /**
+     * @brief kTable curve, from its kTableSize points over [-1, 1]
+     *
+     */
+    void SetTable(const float *points);
+    /**
+     * @brief kTable curve, sampling fn(x) over [-1, 1] (not for the audio
+     * thread if fn is expensive)
+     *
+     */
+    template <typename FN_T>
+    void SetTable(FN_T fn) {
+        for (unsigned int n = 0; n < kTableSize; n++) {
+            table_[n] = fn(-1.f + 2.f * n / (kTableSize - 1));
+        }
+        table_[kTableSize] = table_[kTableSize - 1];
+    }
+    /**
+     * @brief Process buffer of samples (in-place allowed)
+     *
+     * @param in Input buffer
+     * @param out Output buffer
+     * @param n_samples Number of samples, at most max_block
+     */
+    void Process(const float *in, float *out, unsigned int n_samples);
+    /**
+     * @brief Delay of the oversampling filters, in samples (half a sample
+     * more at 4x)
+     *
+     */
+    float GetLatency() const;
+    unsigned int GetOversampling() const { return 1 << n_stages_; }
+
+ protected:
+
+    static constexpr unsigned int kMaxStages = 2;
+    // History kept in front of each filter buffer
+    static constexpr unsigned int kHistory = 2 * kHalfbandTaps;
+
+    // One 2x stage: upsampling takes blocks at its input rate, and
+    // downsampling gives them back from the even and odd samples
+    struct Stage_ {
+        float *up;  // History + input
+        float *even;  // History + even samples
+        float *odd;  // History + odd samples
+        float *oversampled;  // Block at twice the input rate
+    };
+
+    void Shape_(float *x, unsigned int n);
+
+    unsigned int n_stages_;
+    unsigned int max_block_;
+    Stage_ stage_[kMaxStages];
+    float g_[kMaxStages][kHalfbandTaps];  // Halfband taps next to the
+                                          // centre, outwards
+    Shape shape_;
+    float drive_;
+    float step_;
+    float remainder_gain_;
+    float *table_;  // kTableSize + 1 points (the last repeated)
+};
+
+}  // namespace DSP
+
+#endif  // _WAVESHAPER_HPP_
@@ -76,8 +76,10 @@ lv2_descriptor(uint32_t index);
 }  // extern "C"
 
 #include "mesh/Triangular2DMesh.hpp"
+#include "mesh/MeshEventQueue.hpp"
 #include "dsp/Filter.hpp"
 #include "dsp/FilterDesigner.hpp"
+#include "dsp/DSPMath.hpp"
 
 
 /**
@@ -102,6 +104,8 @@ typedef struct {
    // Audio plugin structure
    char *meshmem_ptr;
    Triangular2DMesh *mesh_ptr;
+   char *eventsmem_ptr;
+   MeshEventQueue<Triangular2DMesh> *events;
    DSP::BiquadCoeffs crossover_lpf_c;
    DSP::BiquadCoeffs crossover_hpf_c;
    DSP::Biquad<1>::State *crossover_lpf_s;
@@ -144,6 +148,11 @@ instantiate(const LV2_Descriptor*     descriptor,
    // Allocate and instantiate mesh
    amp->meshmem_ptr = new char[Triangular2DMesh::GetMemSize(mesh_properties)];
    amp->mesh_ptr = new Triangular2DMesh(mesh_properties, amp->meshmem_ptr);
+   const unsigned int n_events = 64;
+   amp->eventsmem_ptr = new char[
+      MeshEventQueue<Triangular2DMesh>::GetMemSize(n_events)];
+   amp->events = new MeshEventQueue<Triangular2DMesh>(*amp->mesh_ptr,
+      n_events, amp->eventsmem_ptr);
 
    // Filter design/allocation
    const float fcut = 100.f;
@@ -157,10 +166,12 @@ instantiate(const LV2_Descriptor*     descriptor,
    amp->crossover_hpf = new DSP::Biquad<1>(1, &amp->crossover_hpf_c,
          amp->crossover_hpf_s);
 
-   // Smoother design/allocation
-   const float alpha_a = 0.01;
-   const float alpha_r = 0.001;
-   amp->ar_smoother = new DSP::ARSmoother(alpha_a, alpha_r);
+   // Smoother design/allocation (the alphas used to be fixed at 0.01 and
+   // 0.001: approximately the same times at 48 kHz)
+   const float attack_ms = 2.f;
+   const float release_ms = 20.f;
+   amp->ar_smoother = new DSP::ARSmoother(1.f, 1.f);
+   amp->ar_smoother->SetTimes(attack_ms, release_ms, rate);
 
 	return (LV2_Handle)amp;
 }
@@ -213,13 +224,15 @@ activate(LV2_Handle instance)
 {
 	const Amp* amp = (const Amp*)instance;
    amp->mesh_ptr->Reset();
+   amp->events->Reset();
    amp->crossover_lpf->Reset();
    amp->crossover_hpf->Reset();
    amp->ar_smoother->Reset();
 }
 
 /** Define a macro for converting a gain in dB to a coefficient. */
-#define DB_CO(g) ((g) > -90.0f ? powf(10.0f, (g) * 0.05f) : 0.0f)
+#define DB_CO(g) ((g) > -90.0f ? \
+   DSP::Math::dBToLin((g), DSP::Math::kPrecise) : 0.0f)
 
 /**
    The `run()` method is the main process function of the plugin.  It processes
@@ -239,9 +252,10 @@ run(LV2_Handle instance, uint32_t n_samples)
 	const float* const input  = amp->input;
 	float* const       output = amp->output;
 
-   // Pass parameters
+   // Pass parameters (control ports are per block: the change lands on
+   // the first sample; out-of-range values are refused, not asserted)
 	const float coef = DB_CO(gain);
-   amp->mesh_ptr->SetAttenuation(attenuation);
+   amp->events->PushAttenuation(amp->events->GetTime(), attenuation);
    const float thresh = DB_CO(input_threshold);
 
    // Per sample execution
@@ -265,7 +279,7 @@ run(LV2_Handle instance, uint32_t n_samples)
       r -= 1.f;
       x = r * x;
       // Mesh execution
-		x = coef * amp->mesh_ptr->ProcessSample(true, x);
+		x = coef * amp->events->ProcessSample(true, x);
       // Mix back
       //output[pos] = x + y;
       output[pos] = x;
@@ -298,6 +312,8 @@ static void
 cleanup(LV2_Handle instance)
 {
    const Amp* amp = (const Amp*)instance;
+   delete amp->events;
+   delete[] amp->eventsmem_ptr;
    delete amp->mesh_ptr;
    delete amp->meshmem_ptr;
    delete amp->crossover_hpf;
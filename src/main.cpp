@@ -17,8 +17,91 @@
 #include "mesh/Triangular2DMesh.hpp"
 using mesh = Triangular2DMesh;
 
+#include "mesh/MeshCalibration.hpp"
+using calibration = MeshCalibration;
+
+#include "mesh/ModalAnalysis.hpp"
+using modal = ModalAnalysis;
+
+#include "mesh/ConvolutionMesh.hpp"
+using convmesh = ConvolutionMesh;
+
+#include "mesh/InterpolatedTriangularMesh.hpp"
+using imesh = InterpolatedTriangularMesh;
+
+#include "mesh/MeshEventQueue.hpp"
+using meshevents = MeshEventQueue<Triangular2DMesh>;
+
+#include "mesh/CoupledMeshSystem.hpp"
+using coupledmeshes = CoupledMeshSystem;
+
+#include "mesh/Rectilinear3DMesh.hpp"
+using mesh3d = Rectilinear3DMesh;
+
+#include "mesh/Geometries.hpp"
+
+#include "mesh/KirchhoffPlate.hpp"
+using plate = KirchhoffPlate;
+
+#include "mesh/MeshAutotuner.hpp"
+using autotuner = MeshAutotuner;
+
+#include "mesh/GraphMesh.hpp"
+using graphmesh = GraphMesh;
+
 #include "dsp/Filter.hpp"
 using arsmoother = DSP::ARSmoother;
+using biquadcoeffs = DSP::BiquadCoeffs;
+
+#include "dsp/ARSmootherBank.hpp"
+
+#include "dsp/FilterDesigner.hpp"
+using filterdesigner = DSP::FilterDesigner;
+using biquadtable = DSP::BiquadTable;
+
+#include "dsp/SVF.hpp"
+
+#include "dsp/Waveshaper.hpp"
+using waveshaper = DSP::Waveshaper;
+
+#include "dsp/FFT.hpp"
+using fft = DSP::FFT;
+
+#include "dsp/Block.hpp"
+using block = DSP::Block;
+
+#include "dsp/BlockExpr.hpp"
+using blockin = DSP::BlockIn;
+using blockout = DSP::BlockOut;
+
+#include "dsp/DSPMath.hpp"
+using dspmath = DSP::Math;
+
+#include "dsp/Dispatch.hpp"
+using dispatch = DSP::Dispatch;
+
+#include "dsp/ModalBank.hpp"
+using modalbank = DSP::ModalBank;
+
+#include "dsp/PartitionedConvolver.hpp"
+using convolver = DSP::PartitionedConvolver;
+
+#include "dsp/SPSCQueue.hpp"
+using spscqueue = DSP::SPSCQueue<unsigned int>;
+
+#include "dsp/LargeAlloc.hpp"
+using largealloc = DSP::LargeAlloc;
+
+#include "dsp/FrameRing.hpp"
+using framering = DSP::FrameRing;
+
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
 
 
 TEST_CASE( "Check dimensions", "[Triangular2DMesh]" ) {
@@ -31,12 +114,16 @@ TEST_CASE( "Check dimensions", "[Triangular2DMesh]" ) {
     // Expected properties
     unsigned int meshsize_x = 23;
     unsigned int meshsize_y = 8;
-    unsigned int meshsize = meshsize_x * meshsize_y;
     unsigned int c_size = 8;
     unsigned int k_size_even = 12;
     unsigned int k_size_odd = 11;
     unsigned int meshsize_ck = c_size * k_size_even - (c_size >> 1);
-    size_t expected_memsize = sizeof(float) * meshsize * mesh::kNMeshes;
+    // Packed nodes (92) between halos (12), each padded to whole vectors
+    // of any instruction set (16 floats)
+    unsigned int halo = 16;
+    size_t plane_size = 2 * halo + 96;
+    size_t expected_memsize = sizeof(float) * plane_size * mesh::kNMeshes +
+        DSP::Dispatch::kMaxAlignment;
     
     // Test important static properties
     size_t memsize = mesh::GetMemSize(p);
@@ -47,7 +134,8 @@ TEST_CASE( "Check dimensions", "[Triangular2DMesh]" ) {
     mesh m(p, mem);
     CHECK(m.pi_.x_size == meshsize_x);
     CHECK(m.pi_.y_size == meshsize_y);
-    CHECK(m.pi_.total_size == meshsize);
+    CHECK(m.pi_.halo == halo);
+    CHECK(m.pi_.plane_size == plane_size);
     CHECK(m.pi_.c_size == c_size);
     CHECK(m.pi_.k_size_even == k_size_even);
     CHECK(m.pi_.k_size_odd == k_size_odd);
@@ -170,6 +258,2528 @@ TEST_CASE( "Process 1D impulse (transversal)", "[Triangular2DMesh]" ) {
 }
 
 
+TEST_CASE( "Select resolution from CPU budget", "[MeshCalibration]" ) {
+
+    calibration::Budget b {
+        100.f,  // mm width
+        100.f,  // mm height
+        44100.f,  // sample rate
+        64,  // block size
+        0.5f,  // CPU fraction
+        5.f,  // finest resolution
+        25.f };  // coarsest resolution
+
+    // Budget verdict, on fixed costs (20 and 5 us a sample, at 44.1 kHz)
+    calibration::Selection s = calibration::Evaluate(b, 10.f, 20e-6f);
+    CHECK(s.p.x__mm == b.x__mm);
+    CHECK(s.p.y__mm == b.y__mm);
+    CHECK(s.p.spatial_res__mm == 10.f);
+    CHECK(s.block_cost__s == Approx(64 * 20e-6f));
+    CHECK(s.cpu_fraction == Approx(44100.f * 20e-6f));
+    CHECK(!s.within_budget);
+    s = calibration::Evaluate(b, 10.f, 5e-6f);
+    CHECK(s.cpu_fraction == Approx(44100.f * 5e-6f));
+    CHECK(s.within_budget);
+
+    // Whatever the machine, the choice is in range and consistent with
+    // its own verdict
+    s = calibration::SelectResolution(b);
+    CHECK(s.p.x__mm == b.x__mm);
+    CHECK(s.p.y__mm == b.y__mm);
+    CHECK(s.p.spatial_res__mm >= b.min_res__mm);
+    CHECK(s.p.spatial_res__mm <= b.max_res__mm);
+    CHECK(s.block_cost__s > 0);
+    CHECK(s.within_budget == (s.cpu_fraction <= b.cpu_fraction));
+    if (!s.within_budget) {
+        CHECK(s.p.spatial_res__mm == b.max_res__mm);
+    }
+
+    // Out of budget: fall back to the coarsest mesh
+    b.cpu_fraction = 1e-9f;
+    s = calibration::SelectResolution(b);
+    CHECK(s.within_budget == (s.cpu_fraction <= b.cpu_fraction));
+    if (!s.within_budget) {
+        CHECK(s.p.spatial_res__mm == b.max_res__mm);
+    }
+
+}
+
+
+TEST_CASE( "Extract modes and resynthesise", "[ModalAnalysis]" ) {
+
+    mesh::Properties p {
+        40.f,  // mm width
+        40.f,  // mm height
+        5.f };  // mm resolution
+    std::vector<char> mem(mesh::GetMemSize(p));
+    mesh m(p, mem.data());
+    m.SetAttenuation(0.005f);
+
+    modal::Settings s {
+        16.f, 24.f,  // Source
+        8.f, 12.f,  // Pickup
+        32,  // Modes
+        4096 };  // IR length
+    std::vector<modalbank::Mode> modes(s.n_modes);
+    unsigned int n_modes = modal::ExtractModes(m, s, modes.data());
+    REQUIRE(n_modes > 0);
+    REQUIRE(n_modes <= s.n_modes);
+    for (unsigned int n = 0; n < n_modes; n++) {
+        CHECK(modes[n].omega > 0);
+        CHECK(modes[n].omega < M_PI);
+        CHECK(modes[n].radius < 1.f);
+        CHECK(modes[n].gain_source > 0);
+    }
+
+    // Resynthesised impulse response should account for most of the energy
+    std::vector<float> ir(s.ir_length);
+    m.RenderImpulseResponse(ir.data(), s.ir_length);
+    std::vector<char> bank_mem(modalbank::GetMemSize(n_modes));
+    modalbank bank(n_modes, bank_mem.data());
+    bank.SetModes(modes.data(), n_modes);
+    double energy = 0;
+    double error = 0;
+    for (unsigned int n = 0; n < s.ir_length; n++) {
+        float y = bank.ProcessSample((n == 0) ? 1.f : 0.f);
+        energy += ir[n] * ir[n];
+        error += (ir[n] - y) * (ir[n] - y);
+    }
+    CHECK(error < 0.5 * energy);
+}
+
+
+TEST_CASE( "Single mode impulse response", "[ModalBank]" ) {
+
+    modalbank::Mode mode { 0.3f, 0.99f, 0.5f, 2.f, 0.7f };
+    std::vector<char> mem(modalbank::GetMemSize(5));
+    modalbank bank(5, mem.data());
+    bank.SetModes(&mode, 1);
+
+    float impulse[64] = { 1.f };
+    float out[64];
+    bank.ProcessBuffer(impulse, out, 64);
+    for (unsigned int n = 0; n < 64; n++) {
+        float expected = std::pow(mode.radius, n) *
+            std::cos(mode.omega * n + mode.phase);
+        CHECK(out[n] == Approx(expected).margin(1e-5));
+    }
+
+    // Save and load back
+    const char *path = "test_modes.bin";
+    REQUIRE(modalbank::SaveModes(path, &mode, 1));
+    modalbank::Mode loaded[2];
+    CHECK(modalbank::LoadModes(path, loaded, 0) == 0);  // Too many modes
+    REQUIRE(modalbank::LoadModes(path, loaded, 2) == 1);
+    CHECK(loaded[0].omega == mode.omega);
+    CHECK(loaded[0].radius == mode.radius);
+    CHECK(loaded[0].gain_source == mode.gain_source);
+    CHECK(loaded[0].gain_pickup == mode.gain_pickup);
+    CHECK(loaded[0].phase == mode.phase);
+    std::remove(path);
+}
+
+
+TEST_CASE( "Real FFT against DFT", "[FFT]" ) {
+
+    const unsigned int n = 64;
+    std::vector<char> mem(fft::GetMemSize(n));
+    fft f(n, mem.data());
+
+    float x[n];
+    float spectrum[n + 2];
+    float y[n];
+    for (unsigned int k = 0; k < n; k++) {
+        x[k] = std::sin(0.37f * k * k) + 0.1f * k;
+    }
+    f.ForwardReal(x, spectrum);
+    for (unsigned int bin = 0; bin <= n / 2; bin++) {
+        double re = 0;
+        double im = 0;
+        for (unsigned int k = 0; k < n; k++) {
+            re += x[k] * std::cos(2. * M_PI * bin * k / n);
+            im -= x[k] * std::sin(2. * M_PI * bin * k / n);
+        }
+        CHECK(spectrum[2 * bin] == Approx(re).margin(1e-4));
+        CHECK(spectrum[2 * bin + 1] == Approx(im).margin(1e-4));
+    }
+    f.InverseReal(spectrum, y);
+    for (unsigned int k = 0; k < n; k++) {
+        CHECK(y[k] == Approx(x[k]).margin(1e-5));
+    }
+}
+
+
+TEST_CASE( "Partitioned convolution against direct convolution",
+        "[PartitionedConvolver]" ) {
+
+    const unsigned int block_size = 16;
+    const unsigned int ir_length = 100;
+    const unsigned int n_blocks = 12;
+    std::vector<char> mem(convolver::GetMemSize(block_size, 128));
+    convolver conv(block_size, 128, mem.data());
+
+    float ir[ir_length];
+    for (unsigned int n = 0; n < ir_length; n++) {
+        ir[n] = std::cos(0.3f * n) * std::pow(0.97f, n);
+    }
+    conv.SetImpulseResponse(ir, ir_length);
+
+    float x[block_size * n_blocks];
+    float y[block_size * n_blocks];
+    for (unsigned int n = 0; n < block_size * n_blocks; n++) {
+        x[n] = std::sin(0.11f * n * n);
+    }
+    for (unsigned int b = 0; b < n_blocks; b++) {
+        conv.ProcessBlock(x + b * block_size, y + b * block_size);
+    }
+    for (unsigned int n = 0; n < block_size * n_blocks; n++) {
+        double expected = 0;
+        for (unsigned int k = 0; k < ir_length && k <= n; k++) {
+            expected += ir[k] * x[n - k];
+        }
+        CHECK(y[n] == Approx(expected).margin(1e-4));
+    }
+
+    // Dropping most of the energy is never allowed
+    CHECK(convmesh::TruncateByEnergy(ir, ir_length, 1e-3f) > 50);
+    CHECK(convmesh::TruncateByEnergy(ir, ir_length, 0.f) == ir_length);
+}
+
+
+TEST_CASE( "Convolution mode matches live mesh", "[ConvolutionMesh]" ) {
+
+    mesh::Properties p {
+        40.f,  // mm width
+        30.f,  // mm height
+        5.f };  // mm resolution
+    convmesh::Settings s {
+        32,  // Block size
+        4096,  // Max IR length
+        1e-9f,  // Energy threshold
+        2 };  // Settle blocks
+    std::vector<char> mem_live(mesh::GetMemSize(p));
+    std::vector<char> mem_ref(mesh::GetMemSize(p));
+    std::vector<char> mem_conv(convmesh::GetMemSize(p, s));
+    mesh live(p, mem_live.data());
+    mesh reference(p, mem_ref.data());
+    MeshIRCache cache;
+    convmesh engine(live, cache, s, mem_conv.data());
+
+    engine.SetAttenuation(0.01f);
+    reference.SetAttenuation(0.01f);
+    engine.SetSource(10.f, 10.f);
+    reference.SetSource(10.f, 10.f);
+
+    // Not settled yet
+    CHECK(!engine.Update());
+    CHECK(engine.GetMode() == convmesh::kLive);
+
+    float in[32];
+    float out[32];
+    for (unsigned int b = 0; b < 40; b++) {
+        for (unsigned int n = 0; n < 32; n++) {
+            in[n] = std::sin(0.05f * (b * 32 + n)) * ((b < 20) ? 1.f : 0.f);
+        }
+        engine.ProcessBlock(in, out);
+        for (unsigned int n = 0; n < 32; n++) {
+            CHECK(out[n] == Approx(reference.ProcessSample(true, in[n]))
+                .margin(1e-4));
+        }
+        if (b == 5) {
+            // Mesh keeps ringing while the convolver takes over
+            CHECK(engine.Update());
+            CHECK(engine.GetMode() == convmesh::kConvolving);
+            CHECK(cache.GetSize() == 1);
+        }
+    }
+
+    // Change of parameters: back to the live mesh, new cache entry later
+    engine.SetAttenuation(0.02f);
+    CHECK(engine.GetMode() == convmesh::kLive);
+    for (unsigned int b = 0; b < 200; b++) {
+        engine.ProcessBlock(in, out);
+    }
+    CHECK(engine.Update());
+    CHECK(cache.GetSize() == 2);
+    // Same parameters as before: served from the cache
+    engine.SetAttenuation(0.01f);
+    for (unsigned int b = 0; b < 200; b++) {
+        engine.ProcessBlock(in, out);
+    }
+    CHECK(engine.Update());
+    CHECK(cache.GetSize() == 2);
+}
+
+
+TEST_CASE( "Convolution mode cost", "[.][benchmark][ConvolutionMesh]" ) {
+
+    // LV2 plugin mesh, lightly damped
+    mesh::Properties p { 300.f, 300.f, 10.f };
+    convmesh::Settings s { 256, 1 << 16, 1e-6f, 0 };
+    std::vector<char> mem_live(mesh::GetMemSize(p));
+    std::vector<char> mem_conv(convmesh::GetMemSize(p, s));
+    mesh live(p, mem_live.data());
+    MeshIRCache cache;
+    convmesh engine(live, cache, s, mem_conv.data());
+    engine.SetAttenuation(0.0005f);
+
+    const unsigned int n_blocks = 200;
+    std::vector<float> buffer(s.block_size, 0.f);
+    auto time_blocks = [&]() {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int b = 0; b < n_blocks; b++) {
+            buffer[0] = 1.f;
+            engine.ProcessBlock(buffer.data(), buffer.data());
+        }
+        std::chrono::duration<double> t =
+            std::chrono::steady_clock::now() - start;
+        return t.count() / n_blocks;
+    };
+    double t_live = time_blocks();
+    REQUIRE(engine.Update());
+    // Let the live mesh ring out first
+    for (unsigned int b = 0; b < (s.max_ir_length / s.block_size); b++) {
+        engine.ProcessBlock(buffer.data(), buffer.data());
+    }
+    double t_conv = time_blocks();
+    std::printf("ConvolutionMesh: live %g s/block, convolution %g s/block "
+        "(IR %u samples), ratio %.1f\n", t_live, t_conv,
+        static_cast<unsigned int>(cache.Find(live.GetConfigurationHash())
+            ->size()), t_live / t_conv);
+}
+
+
+TEST_CASE( "Interpolated mesh fundamental", "[InterpolatedTriangularMesh]" ) {
+
+    // Square membrane with fixed edges: the (1, 1) mode sits at
+    // c / sqrt(2) / L Hz, and c = Courant number * res * fs
+    const float res = imesh::EquivalentResolution(5.f);
+    const float courant = (1.f / std::sqrt(2.f)) /
+        imesh::EquivalentResolution(1.f);
+    imesh::Properties p { 200.f, 200.f, res };
+    std::vector<char> mem(imesh::GetMemSize(p));
+    imesh m(p, mem.data());
+    CHECK(imesh::GetNodeCount(p) * 3 < mesh::GetNodeCount({ 200.f, 200.f,
+        5.f }));
+    m.SetSource(97.f, 103.f);
+    m.SetPickup(101.f, 99.f);
+
+    const unsigned int n_samples = 16384;
+    std::vector<float> ir(n_samples);
+    float peak = 0;
+    for (unsigned int n = 0; n < n_samples; n++) {
+        ir[n] = m.ProcessSample(true, (n == 0) ? 1.f : 0.f);
+        REQUIRE(std::isfinite(ir[n]));
+        peak = std::max(peak, std::fabs(ir[n]));
+    }
+    CHECK(peak < 10.f);
+
+    // Fixed edges sit on the first row/column of zeros past the mask
+    const float pi = 3.14159265f;
+    float length = 200.f + res;
+    float omega_11 = pi * courant * res * std::sqrt(2.f) / length;
+    float best_omega = 0;
+    float best_mag = 0;
+    for (float omega = 0.8f * omega_11; omega < 1.2f * omega_11;
+        omega += 1e-4f * omega_11) {
+        double re = 0, im = 0;
+        for (unsigned int n = 0; n < n_samples; n++) {
+            double w = 0.5 - 0.5 * std::cos(2 * pi * n / n_samples);
+            re += w * ir[n] * std::cos(omega * n);
+            im -= w * ir[n] * std::sin(omega * n);
+        }
+        float mag = re * re + im * im;
+        if (mag > best_mag) {
+            best_mag = mag;
+            best_omega = omega;
+        }
+    }
+    CHECK(best_omega == Approx(omega_11).epsilon(0.03));
+}
+
+
+TEST_CASE( "Interpolated mesh dispersion compensation",
+    "[InterpolatedTriangularMesh]" ) {
+
+    const float courant = (1.f / std::sqrt(2.f)) /
+        imesh::EquivalentResolution(1.f);
+    const float sector = 3.14159265f / 6.f;
+
+    // Inverse of the direction-averaged curve
+    for (float kappa = 0.1f; kappa < 2.5f; kappa += 0.2f) {
+        float mean = 0;
+        for (unsigned int n = 0; n < 7; n++) {
+            mean += imesh::GetMeshFrequency(kappa, sector * n / 6.f);
+        }
+        mean /= 7.f;
+        CHECK(imesh::CompensateFrequency(mean) ==
+            Approx(courant * kappa).epsilon(1e-4));
+    }
+
+    // The worst direction ends up closer to the ideal membrane, within
+    // 0.5% up to 0.678 rad/sample
+    float prev = 0;
+    for (float omega = 0.05f; omega < 0.95f; omega += 0.05f) {
+        float kappa = omega / courant;
+        float worst = 0;
+        float worst_compensated = 0;
+        for (unsigned int n = 0; n < 7; n++) {
+            float mesh_omega = imesh::GetMeshFrequency(kappa,
+                sector * n / 6.f);
+            float compensated = imesh::CompensateFrequency(mesh_omega);
+            worst = std::max(worst, std::fabs(mesh_omega / omega - 1.f));
+            worst_compensated = std::max(worst_compensated,
+                std::fabs(compensated / omega - 1.f));
+        }
+        CHECK(worst_compensated <= worst + 1e-4f);
+        if (omega < 0.678f) {
+            CHECK(worst_compensated < 0.005f);
+        }
+        float compensated = imesh::CompensateFrequency(omega);
+        CHECK(compensated > prev);
+        prev = compensated;
+    }
+    CHECK(imesh::CompensateFrequency(1.1f) == 1.1f);
+}
+
+
+// Seconds per ProcessSample() call, impulse then silence
+template <typename MeshT_>
+static double TimeProcessSample(MeshT_ &m, unsigned int n_samples) {
+    auto start = std::chrono::steady_clock::now();
+    float acc = 0;
+    for (unsigned int n = 0; n < n_samples; n++) {
+        acc += m.ProcessSample(true, (n == 0) ? 1.f : 0.f);
+    }
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+    REQUIRE(std::isfinite(acc));
+    return t.count() / n_samples;
+}
+
+
+TEST_CASE( "Interpolated mesh cost at matched error",
+    "[.][benchmark][InterpolatedTriangularMesh]" ) {
+
+    // Same membrane and pitch: the waveguide mesh at 10 mm, the
+    // interpolated one at the resolution with the same wave speed
+    const float dwm_res = 10.f;
+    mesh::Properties p_dwm { 300.f, 300.f, dwm_res };
+    imesh::Properties p_int { 300.f, 300.f,
+        imesh::EquivalentResolution(dwm_res) };
+    std::vector<char> mem_dwm(mesh::GetMemSize(p_dwm));
+    std::vector<char> mem_int(imesh::GetMemSize(p_int));
+    mesh dwm(p_dwm, mem_dwm.data());
+    imesh interp(p_int, mem_int.data());
+
+    // Worst pitch error over all directions, up to omega_max
+    const float omega_max = 0.678f;
+    const float sector = 3.14159265f / 6.f;
+    const float courant_dwm = 1.f / std::sqrt(2.f);
+    const float courant_int = courant_dwm / imesh::EquivalentResolution(1.f);
+    float error_dwm = 0, error_int = 0, error_comp = 0;
+    for (float omega = 0.01f; omega <= omega_max; omega += 0.01f) {
+        for (unsigned int n = 0; n < 7; n++) {
+            float theta = sector * n / 6.f;
+            // Waveguide mesh: cos(omega) = 1/3 sum(cos(k . d)) over the
+            // three lattice directions
+            float kappa = omega / courant_dwm;
+            float sum = 0;
+            for (unsigned int j = 0; j < 3; j++) {
+                sum += std::cos(kappa * std::cos(theta - j * 2.f * sector));
+            }
+            error_dwm = std::max(error_dwm,
+                std::fabs(std::acos(sum / 3.f) / omega - 1.f));
+            float mesh_omega = imesh::GetMeshFrequency(
+                omega / courant_int, theta);
+            error_int = std::max(error_int,
+                std::fabs(mesh_omega / omega - 1.f));
+            error_comp = std::max(error_comp, std::fabs(
+                imesh::CompensateFrequency(mesh_omega) / omega - 1.f));
+        }
+    }
+
+    double t_dwm = TimeProcessSample(dwm, 20000);
+    double t_int = TimeProcessSample(interp, 20000);
+    std::printf("Waveguide mesh: %.2f mm, %u nodes, max pitch error %.2f%%, "
+        "%.4f s per second of audio at 44.1 kHz\n", dwm_res,
+        mesh::GetNodeCount(p_dwm), 100 * error_dwm, t_dwm * 44100);
+    std::printf("Interpolated mesh: %.2f mm, %u nodes, max pitch error %.2f%% "
+        "(%.2f%% compensated), %.4f s per second of audio at 44.1 kHz, "
+        "%.1fx cheaper\n", p_int.spatial_res__mm, imesh::GetNodeCount(p_int),
+        100 * error_int, 100 * error_comp, t_int * 44100, t_dwm / t_int);
+}
+
+
+TEST_CASE( "SPSC queue across threads", "[SPSCQueue]" ) {
+
+    const unsigned int capacity = 16;
+    std::vector<char> mem(spscqueue::GetMemSize(capacity));
+    spscqueue queue(capacity, mem.data());
+
+    unsigned int item = 0;
+    CHECK(queue.Front() == nullptr);
+    CHECK_FALSE(queue.Pop(item));
+    for (unsigned int n = 0; n < capacity; n++) {
+        CHECK(queue.Push(n));
+    }
+    CHECK_FALSE(queue.Push(capacity));
+    for (unsigned int n = 0; n < capacity; n++) {
+        REQUIRE(queue.Pop(item));
+        CHECK(item == n);
+    }
+
+    // Everything comes out once and in order, however the two threads
+    // interleave
+    const unsigned int n_items = 200000;
+    std::thread producer([&]() {
+        for (unsigned int n = 0; n < n_items; n++) {
+            while (!queue.Push(n)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    unsigned int expected = 0;
+    bool in_order = true;
+    while (expected < n_items) {
+        if (queue.Pop(item)) {
+            in_order &= (item == expected);
+            expected++;
+        }
+    }
+    producer.join();
+    CHECK(in_order);
+    CHECK(queue.Front() == nullptr);
+}
+
+
+TEST_CASE( "Sample-accurate mesh events", "[MeshEventQueue]" ) {
+
+    mesh::Properties p { 200.f, 200.f, 10.f };
+    std::vector<char> mem_a(mesh::GetMemSize(p));
+    std::vector<char> mem_b(mesh::GetMemSize(p));
+    std::vector<char> mem_events(meshevents::GetMemSize(8));
+    mesh a(p, mem_a.data());
+    mesh b(p, mem_b.data());
+    meshevents events(a, 8, mem_events.data());
+
+    SECTION( "Out-of-range events are refused" ) {
+        CHECK_FALSE(events.PushSource(0, -1.f, 50.f));
+        CHECK_FALSE(events.PushSource(0, 50.f, 1000.f));
+        CHECK_FALSE(events.PushPickup(0, NAN, 50.f));
+        CHECK_FALSE(events.PushAttenuation(0, 1.f));
+        CHECK_FALSE(events.PushAttenuation(0, -0.1f));
+        CHECK(events.PushAttenuation(10, 0.1f));
+        CHECK_FALSE(events.PushAttenuation(9, 0.1f));  // Back in time
+        for (unsigned int n = 0; n < 7; n++) {
+            CHECK(events.PushAttenuation(10 + n, 0.1f));
+        }
+        CHECK_FALSE(events.PushAttenuation(20, 0.1f));  // Full
+    }
+
+    SECTION( "Changes land on their sample across blocks" ) {
+        const unsigned int n_samples = 512;
+        const unsigned int block = 64;
+        REQUIRE(events.PushPickup(100, 120.f, 80.f));
+        REQUIRE(events.PushAttenuation(150, 0.01f));
+        REQUIRE(events.PushSource(300, 60.f, 140.f));
+        REQUIRE(events.PushPickup(300, 30.f, 30.f));
+
+        std::vector<float> in(n_samples), out_a(n_samples), out_b(n_samples);
+        for (unsigned int n = 0; n < n_samples; n++) {
+            in[n] = (n % 37 == 0) ? 1.f : 0.f;
+        }
+        for (unsigned int n = 0; n < n_samples; n += block) {
+            events.ProcessBuffer(&in[n], &out_a[n], block);
+        }
+        CHECK(events.GetTime() == n_samples);
+
+        for (unsigned int n = 0; n < n_samples; n++) {
+            if (n == 100) {
+                b.SetPickup(120.f, 80.f);
+            } else if (n == 150) {
+                b.SetAttenuation(0.01f);
+            } else if (n == 300) {
+                b.SetSource(60.f, 140.f);
+                b.SetPickup(30.f, 30.f);
+            }
+            out_b[n] = b.ProcessSample(true, in[n]);
+        }
+        for (unsigned int n = 0; n < n_samples; n++) {
+            REQUIRE(out_a[n] == out_b[n]);
+        }
+    }
+
+    SECTION( "Positions off the mask are dropped when due" ) {
+        const unsigned int n_samples = 256;
+        for (mesh *m : { &a, &b }) {
+            m->ApplyMask(Geometries::CircularMembrane(100.f));
+            m->SetSource(100.f, 100.f);
+            m->SetPickup(120.f, 80.f);
+        }
+        // On the mesh's extent but not on its mask: only the audio
+        // thread may look at that
+        CHECK(events.PushPickup(10, 5.f, 5.f));
+        REQUIRE(events.PushPickup(20, 120.f, 120.f));
+
+        std::vector<float> in(n_samples), out_a(n_samples), out_b(n_samples);
+        in[0] = 1.f;
+        events.ProcessBuffer(in.data(), out_a.data(), n_samples);
+        for (unsigned int n = 0; n < n_samples; n++) {
+            if (n == 20) {
+                b.SetPickup(120.f, 120.f);
+            }
+            out_b[n] = b.ProcessSample(true, in[n]);
+        }
+        for (unsigned int n = 0; n < n_samples; n++) {
+            REQUIRE(out_a[n] == out_b[n]);
+        }
+        // The producer gets to know
+        CHECK(events.GetRejected() == 1);
+
+        // Same for a position clamped since it was pushed
+        REQUIRE(events.PushSource(n_samples + 10, 60.f, 100.f));
+        a.ClampRegion(60.f, 100.f, 8.f);
+        events.ProcessBuffer(in.data(), out_a.data(), n_samples);
+        CHECK(events.GetRejected() == 2);
+    }
+}
+
+
+TEST_CASE( "Fractional pickup interpolates between nodes",
+    "[Triangular2DMesh]" ) {
+
+    mesh::Properties p { 100.f, 100.f, 10.f };
+    std::vector<char> mem(mesh::GetMemSize(p));
+    mesh m(p, mem.data());
+    m.SetSource(31.f, 62.f);
+    const unsigned int n_samples = 300;
+    auto render = [&](float x, float y, std::vector<float> &ir) {
+        m.SetPickup(x, y);
+        ir.resize(n_samples);
+        m.RenderImpulseResponse(ir.data(), n_samples);
+    };
+
+    // Enclosing triangle found the slow way: three mutually adjacent
+    // nodes around the point, with Cartesian barycentric weights >= 0
+    const float px = 43.7f, py = 51.2f;
+    const float h = p.spatial_res__mm;
+    std::vector<std::pair<float, float>> near;
+    for (unsigned int c = 0; c < m.pi_.c_size; c++) {
+        for (unsigned int k = 0; k < m.pi_.k_size_odd + !(c & 0x1); k++) {
+            float x, y;
+            m.CKtoXY_(c, k, x, y);
+            if (std::hypot(x - px, y - py) < h) {
+                near.push_back({ x, y });
+            }
+        }
+    }
+    float node_x[3] = { 0 }, node_y[3] = { 0 }, w[3] = { 0 };
+    bool found = false;
+    for (unsigned int a = 0; a < near.size() && !found; a++) {
+        for (unsigned int b = a + 1; b < near.size() && !found; b++) {
+            for (unsigned int c = b + 1; c < near.size() && !found; c++) {
+                float x1 = near[a].first, y1 = near[a].second;
+                float x2 = near[b].first, y2 = near[b].second;
+                float x3 = near[c].first, y3 = near[c].second;
+                float det = (y2 - y3) * (x1 - x3) + (x3 - x2) * (y1 - y3);
+                w[0] = ((y2 - y3) * (px - x3) + (x3 - x2) * (py - y3)) / det;
+                w[1] = ((y3 - y1) * (px - x3) + (x1 - x3) * (py - y3)) / det;
+                w[2] = 1.f - w[0] - w[1];
+                if (std::fabs(std::hypot(x1 - x2, y1 - y2) - h) < 0.01f &&
+                    std::fabs(std::hypot(x2 - x3, y2 - y3) - h) < 0.01f &&
+                    w[0] >= 0 && w[1] >= 0 && w[2] >= 0) {
+                    node_x[0] = x1; node_y[0] = y1;
+                    node_x[1] = x2; node_y[1] = y2;
+                    node_x[2] = x3; node_y[2] = y3;
+                    found = true;
+                }
+            }
+        }
+    }
+    REQUIRE(found);
+
+    // Readout is linear in the weights
+    std::vector<float> ir, ir_node[3];
+    render(px, py, ir);
+    for (unsigned int n = 0; n < 3; n++) {
+        render(node_x[n], node_y[n], ir_node[n]);
+    }
+    float peak = 0;
+    for (unsigned int n = 0; n < n_samples; n++) {
+        peak = std::max(peak, std::fabs(ir[n]));
+    }
+    REQUIRE(peak > 0);
+    for (unsigned int n = 0; n < n_samples; n++) {
+        float expected = w[0] * ir_node[0][n] + w[1] * ir_node[1][n] +
+            w[2] * ir_node[2][n];
+        REQUIRE(ir[n] == Approx(expected).margin(1e-4f * peak));
+    }
+}
+
+
+TEST_CASE( "Gliding pickup and source", "[Triangular2DMesh]" ) {
+
+    mesh::Properties p { 100.f, 100.f, 10.f };
+    std::vector<char> mem_a(mesh::GetMemSize(p));
+    std::vector<char> mem_b(mesh::GetMemSize(p));
+    mesh a(p, mem_a.data());
+    mesh b(p, mem_b.data());
+
+    // Incremental glide against jumping to the same position every sample
+    const unsigned int n_glide = 1000;
+    const float x0 = 20.f, y0 = 15.f, x1 = 80.f, y1 = 70.f;
+    const float sx0 = 50.f, sy0 = 50.f, sx1 = 35.f, sy1 = 60.f;
+    a.SetPickup(x0, y0);
+    a.SetSource(sx0, sy0);
+    a.GlidePickup(x1, y1, n_glide);
+    a.GlideSource(sx1, sy1, n_glide);
+    float max_step = 0;
+    float prev_out = 0;
+    float rms = 0;
+    std::vector<float> out_a(n_glide + 10), out_b(n_glide + 10);
+    for (unsigned int n = 0; n < n_glide + 10; n++) {
+        float in = std::sin(0.05f * n);
+        float f = std::min(1.f, static_cast<float>(n) / n_glide);
+        b.SetPickup(x0 + f * (x1 - x0), y0 + f * (y1 - y0));
+        b.SetSource(sx0 + f * (sx1 - sx0), sy0 + f * (sy1 - sy0));
+        out_a[n] = a.ProcessSample(true, in);
+        out_b[n] = b.ProcessSample(true, in);
+        rms += out_b[n] * out_b[n];
+        if (n > 0) {
+            max_step = std::max(max_step, std::fabs(out_a[n] - prev_out));
+        }
+        prev_out = out_a[n];
+    }
+    rms = std::sqrt(rms / (n_glide + 10));
+    REQUIRE(rms > 0);
+    for (unsigned int n = 0; n < n_glide + 10; n++) {
+        REQUIRE(out_a[n] == Approx(out_b[n]).margin(1e-3f * rms));
+    }
+    // Lands exactly on the target
+    CHECK(a.GetConfigurationHash() == b.GetConfigurationHash());
+    // A slow sine in, no clicks out
+    CHECK(max_step < rms);
+}
+
+
+TEST_CASE( "Visualisation stream", "[Triangular2DMesh]" ) {
+
+    mesh::Properties p { 100.f, 80.f, 5.f };
+    std::vector<char> mem(mesh::GetMemSize(p));
+    mesh m(p, mem.data());
+    m.SetSource(42.f, 37.f);
+
+    const unsigned int decimation = 2;
+    const unsigned int frame_size = m.GetVisualisationFrameSize(decimation);
+    CHECK(frame_size > 0);
+    CHECK(frame_size < mesh::GetNodeCount(p) / 2);
+    std::vector<float> xy(2 * frame_size);
+    m.GetVisualisationCoordinates(decimation, xy.data());
+    CHECK(xy[0] == 0.f);
+    CHECK(xy[1] == 0.f);
+    CHECK(xy[2] == Approx(decimation * p.spatial_res__mm));
+
+    std::vector<char> ring_mem(framering::GetMemSize(frame_size, 4));
+    framering ring(frame_size, 4, ring_mem.data());
+    m.SetVisualisation(&ring, 16, decimation);
+
+    // A frame every 16 samples, showing the mesh as it is
+    for (unsigned int n = 0; n < 32; n++) {
+        m.ProcessSample(n == 0, 1.f);
+    }
+    REQUIRE(ring.Front() != nullptr);
+    ring.Pop();
+    const float *frame = ring.Front();
+    REQUIRE(frame != nullptr);
+    unsigned int i = 0;
+    float energy = 0;
+    for (unsigned int c = 0; c < m.pi_.c_size; c += decimation) {
+        for (unsigned int k = 0; k < m.pi_.k_size_odd + !(c & 0x1);
+                k += decimation) {
+            CHECK(frame[i++] == m.GetM_(m.junc_v_, c, k));
+            energy += frame[i - 1] * frame[i - 1];
+        }
+    }
+    CHECK(i == frame_size);
+    CHECK(energy > 0.f);
+    ring.Pop();
+    CHECK(ring.Front() == nullptr);
+
+    // Nobody reading: frames are dropped, the mesh carries on
+    for (unsigned int n = 0; n < 16 * 10; n++) {
+        m.ProcessSample(false, 0.f);
+    }
+    CHECK(ring.GetDropped() == 10 - 4);
+    CHECK(ring.Latest() != nullptr);
+    CHECK(ring.Front() != nullptr);
+    ring.Pop();
+    CHECK(ring.Front() == nullptr);
+
+    // Reader on another thread: every frame is either read or dropped
+    m.SetVisualisation(nullptr, 1, 1);
+    std::vector<char> ring2_mem(framering::GetMemSize(frame_size, 8));
+    framering ring2(frame_size, 8, ring2_mem.data());
+    m.SetVisualisation(&ring2, 4, decimation);
+    std::atomic<bool> done(false);
+    unsigned int read = 0;
+    std::thread reader([&]() {
+        for (;;) {
+            bool finished = done.load(std::memory_order_acquire);
+            while (ring2.Front() != nullptr) {
+                ring2.Pop();
+                read++;
+            }
+            if (finished) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    });
+    for (unsigned int n = 0; n < 4 * 1000; n++) {
+        m.ProcessSample(false, 0.f);
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+    CHECK(read + ring2.GetDropped() == 1000);
+}
+
+
+TEST_CASE( "Clamp, damp and release regions", "[Triangular2DMesh]" ) {
+
+    mesh::Properties p { 100.f, 100.f, 4.f };
+    std::vector<char> mem_a(mesh::GetMemSize(p)), mem_b(mesh::GetMemSize(p));
+    mesh a(p, mem_a.data()), b(p, mem_b.data());
+    auto disc = [](float x, float y, float r) {
+        return [=](float x_, float y_) {
+            return (x_ - x) * (x_ - x) + (y_ - y) * (y_ - y) <= r * r;
+        };
+    };
+    auto circle = disc(50.f, 50.f, 48.f);
+    auto finger = disc(62.f, 40.f, 9.f);
+    for (mesh *m : { &a, &b }) {
+        m->SetSource(30.f, 55.f);
+        m->SetPickup(70.f, 65.f);
+    }
+
+    // Clamped disc: same mesh as one masked out from the start
+    a.ApplyMask([&](float x, float y) { return circle(x, y) &&
+        !finger(x, y); });
+    b.ApplyMask(circle);
+    const uint64_t hash_b = b.GetConfigurationHash();
+    b.ClampRegion(62.f, 40.f, 9.f);
+    CHECK(b.GetConfigurationHash() != hash_b);
+    bool same_links = true;
+    for (unsigned int c = 0; c < a.pi_.c_size; c++) {
+        for (unsigned int k = 0; k < a.pi_.k_size_odd + !(c & 0x1); k++) {
+            same_links &= (a.GetM_(a.mesh_mask_, c, k) & mesh::kLinkBits) ==
+                (b.GetM_(b.mesh_mask_, c, k) & mesh::kLinkBits);
+        }
+    }
+    CHECK(same_links);
+    // Clamped nodes are off the mesh for whatever reads or feeds it
+    CHECK_FALSE(b.IsInside(62.f, 40.f));
+    CHECK(b.IsInside(30.f, 55.f));
+    float max_diff = 0;
+    for (unsigned int n = 0; n < 500; n++) {
+        float in = (n == 0) ? 1.f : 0.f;
+        max_diff = std::max(max_diff, std::abs(a.ProcessSample(true, in) -
+            b.ProcessSample(true, in)));
+    }
+    CHECK(max_diff == 0.f);
+
+    // Released while ringing: back to the plain circle, nothing stale
+    b.ReleaseRegion(62.f, 40.f, 9.f);
+    CHECK(b.GetConfigurationHash() == hash_b);
+    CHECK(b.IsInside(62.f, 40.f));
+    float max_out = 0;
+    for (unsigned int n = 0; n < 2000; n++) {
+        max_out = std::max(max_out, std::abs(b.ProcessSample(true, 0.f)));
+    }
+    CHECK(max_out > 0.f);
+    CHECK(max_out < 1.f);
+
+    // Damping: decays faster, more so with more damping
+    auto tail_energy = [&](float amount) {
+        b.Reset();
+        b.ReleaseRegion(50.f, 50.f, 100.f);
+        if (amount > 0) {
+            b.DampRegion(62.f, 40.f, 9.f, amount);
+        }
+        float energy = 0;
+        for (unsigned int n = 0; n < 4000; n++) {
+            float out = b.ProcessSample(true, (n == 0) ? 1.f : 0.f);
+            energy += (n >= 2000) ? out * out : 0.f;
+        }
+        return energy;
+    };
+    float undamped = tail_energy(0.f);
+    float light = tail_energy(0.05f);
+    float heavy = tail_energy(0.3f);
+    CHECK(light < 0.5f * undamped);
+    CHECK(heavy < light);
+    b.ReleaseRegion(62.f, 40.f, 9.f);
+    CHECK(b.GetConfigurationHash() == hash_b);
+
+    // A pickup whose triangle gets clamped lets go of those nodes, and
+    // picks them back up on release
+    b.SetPickup(62.f, 40.f);
+    auto n_pickup_nodes = [&]() {
+        unsigned int n = 0;
+        for (unsigned int i = 0; i < 3; i++) {
+            n += b.pickup_interp_.c[i] != mesh::kNoNode;
+        }
+        return n;
+    };
+    CHECK(n_pickup_nodes() == 3);
+    b.ClampRegion(62.f, 40.f, 9.f);
+    CHECK(n_pickup_nodes() == 0);
+    b.ReleaseRegion(62.f, 40.f, 9.f);
+    CHECK(n_pickup_nodes() == 3);
+}
+
+
+TEST_CASE( "Tension modulation", "[Triangular2DMesh]" ) {
+
+    mesh::Properties p { 100.f, 100.f, 5.f };
+    std::vector<char> mem_nl(mesh::GetMemSize(p));
+    std::vector<char> mem_rest(mesh::GetMemSize(p));
+    std::vector<char> mem_lin(mesh::GetMemSize(p));
+    std::vector<char> mem_ref(mesh::GetMemSize(p));
+    mesh nl(p, mem_nl.data());
+    mesh rest(p, mem_rest.data());
+    mesh lin(p, mem_lin.data());
+    mesh ref(p, mem_ref.data());
+    for (mesh *m : { &nl, &rest, &lin, &ref }) {
+        m->SetSource(40.f, 45.f);
+        m->SetPickup(61.f, 52.f);
+        m->SetAttenuation(0.0005f);
+    }
+    // Same speed at rest; "rest" never gets loud enough to move
+    nl.SetTensionModulation(20.f, 1.25f);
+    rest.SetTensionModulation(1e-9f, 1.25f);
+    lin.SetTensionModulation(0.f, 1.25f);  // Off: headroom ignored
+    CHECK_FALSE(nl.IsLinear());
+    CHECK(lin.IsLinear());
+    CHECK(nl.GetConfigurationHash() != rest.GetConfigurationHash());
+
+    const unsigned int n_samples = 16384;
+    const unsigned int window = 2048;
+    std::vector<float> out_nl(n_samples), out_rest(n_samples);
+    float max_nl = 0;
+    for (unsigned int n = 0; n < n_samples; n++) {
+        float in = (n == 0) ? 4.f : 0.f;
+        out_nl[n] = nl.ProcessSample(true, in);
+        out_rest[n] = rest.ProcessSample(true, in);
+        REQUIRE(std::isfinite(out_nl[n]));
+        max_nl = std::max(max_nl, std::fabs(out_nl[n]));
+        // Turned off, it's the plain mesh
+        REQUIRE(lin.ProcessSample(true, in) == ref.ProcessSample(true, in));
+    }
+    CHECK(max_nl < 10.f);
+
+    // Higher pitch while loud, converging to the resting pitch
+    auto crossings = [&](const std::vector<float> &x, unsigned int start) {
+        unsigned int count = 0;
+        for (unsigned int n = start + 1; n < start + window; n++) {
+            count += (x[n - 1] < 0) != (x[n] < 0);
+        }
+        return count;
+    };
+    unsigned int early_nl = crossings(out_nl, 0);
+    unsigned int early_rest = crossings(out_rest, 0);
+    unsigned int late_nl = crossings(out_nl, n_samples - window);
+    unsigned int late_rest = crossings(out_rest, n_samples - window);
+    CHECK(early_nl > early_rest * 1.05f);
+    CHECK(std::abs(static_cast<int>(late_nl) - static_cast<int>(late_rest))
+        < static_cast<int>(early_nl - early_rest));
+}
+
+
+TEST_CASE( "Stencil kernel runs as the nodes kernel", "[Triangular2DMesh]" ) {
+
+    mesh::Properties p { 100.f, 100.f, 4.f };
+    std::vector<char> mem_a(mesh::GetMemSize(p)), mem_b(mesh::GetMemSize(p));
+    mesh a(p, mem_a.data()), b(p, mem_b.data());
+    CHECK(a.GetKernel() == mesh::kKernelNodes);
+    b.SetKernel(mesh::kKernelStencil);
+    for (mesh *m : { &a, &b }) {
+        m->ApplyMask(Geometries::CircularMembrane(50.f));
+        m->SetAttenuation(0.001f);
+        m->SetSource(30.f, 55.f);
+        m->SetPickup(70.f, 65.f);
+        m->ClampRegion(62.f, 35.f, 7.f);
+        m->DampRegion(40.f, 30.f, 8.f, 0.2f);
+    }
+    CHECK(a.GetGeometryHash() == b.GetGeometryHash());
+
+    // Impulse, then noise, with glides, a release and the input gone;
+    // tension modulation at the end hands back to the nodes kernel
+    unsigned int seed = 1;
+    auto noise = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.f - 0.5f;
+    };
+    float max_diff = 0, max_out = 0;
+    for (unsigned int n = 0; n < 3000; n++) {
+        for (mesh *m : { &a, &b }) {
+            if (n == 500) {
+                m->GlideSource(55.f, 50.f, 700);
+                m->GlidePickup(60.f, 47.f, 900);
+            } else if (n == 1500) {
+                m->ReleaseRegion(62.f, 35.f, 7.f);
+            } else if (n == 2500) {
+                m->SetTensionModulation(5.f, 1.2f);
+            }
+        }
+        bool present = n < 2000;
+        float in = (n == 0) ? 1.f : (n < 1000) ? 0.1f * noise() : 0.f;
+        float out_a = a.ProcessSample(present, in);
+        float out_b = b.ProcessSample(present, in);
+        max_diff = std::max(max_diff, std::abs(out_a - out_b));
+        max_out = std::max(max_out, std::abs(out_a));
+    }
+    CHECK(max_out > 0.f);
+    CHECK(max_diff <= 1e-5f * max_out);
+}
+
+
+TEST_CASE( "Mesh kernel cost", "[.][benchmark][Triangular2DMesh]" ) {
+
+    for (float res__mm : { 4.f, 2.f, 1.f }) {
+        mesh::Properties p { 300.f, 300.f, res__mm };
+        std::vector<char> mem(mesh::GetMemSize(p));
+        mesh m(p, mem.data());
+        m.ApplyMask(Geometries::CircularMembrane(150.f));
+        m.SetSource(110.f, 130.f);
+        m.SetPickup(170.f, 190.f);
+        for (mesh::Kernel kernel :
+            { mesh::kKernelNodes, mesh::kKernelStencil }) {
+            m.SetKernel(kernel);
+            m.Reset();
+            volatile float sink = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int n = 0; n < 4410; n++) {
+                sink = sink + m.ProcessSample(true, (n == 0) ? 1.f : 0.f);
+            }
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            printf("%u nodes, %s kernel: %.2fx real time\n",
+                mesh::GetNodeCount(p),
+                (kernel == mesh::kKernelNodes) ? "nodes" : "stencil",
+                0.1 / elapsed.count());
+        }
+    }
+}
+
+
+TEST_CASE( "Coupled meshes", "[CoupledMeshSystem]" ) {
+
+    // Two heads, a smaller resonant one
+    mesh::Properties p_batter { 60.f, 60.f, 5.f };
+    mesh::Properties p_reso { 50.f, 50.f, 5.f };
+    std::vector<char> mem_batter(mesh::GetMemSize(p_batter));
+    std::vector<char> mem_reso(mesh::GetMemSize(p_reso));
+    std::vector<char> mem_ref(mesh::GetMemSize(p_batter));
+    mesh batter(p_batter, mem_batter.data());
+    mesh reso(p_reso, mem_reso.data());
+    mesh ref(p_batter, mem_ref.data());
+    for (mesh *m : { &batter, &ref }) {
+        m->SetSource(22.f, 31.f);
+        m->SetPickup(41.f, 26.f);
+        m->SetAttenuation(0.001f);
+    }
+    reso.SetPickup(30.f, 18.f);
+    reso.SetAttenuation(0.001f);
+
+    mesh *meshes[] = { &batter, &reso };
+    std::vector<char> mem_sys(coupledmeshes::GetMemSize(2, 2));
+    coupledmeshes sys(meshes, 2, 2, mem_sys.data());
+
+    const unsigned int block = 64;
+    const unsigned int n_blocks = 64;
+    std::vector<float> in(block * n_blocks, 0.f);
+    in[0] = 1.f;
+    std::vector<float> out_batter(in.size()), out_reso(in.size());
+    auto run = [&](std::vector<float> &ob, std::vector<float> &orr) {
+        sys.Reset();
+        for (unsigned int b = 0; b < n_blocks; b++) {
+            const float *ins[] = { &in[b * block], nullptr };
+            float *outs[] = { &ob[b * block], &orr[b * block] };
+            sys.ProcessBlock(ins, outs, block);
+        }
+    };
+
+    SECTION( "Zero admittance leaves the meshes alone" ) {
+        coupledmeshes::Coupling c { 0, 30.f, 30.f, 1, 25.f, 25.f, 0.f, 0.f };
+        REQUIRE(sys.AddCoupling(c));
+        run(out_batter, out_reso);
+        for (unsigned int n = 0; n < in.size(); n++) {
+            REQUIRE(out_batter[n] == ref.ProcessSample(true, in[n]));
+            REQUIRE(out_reso[n] == 0.f);
+        }
+    }
+
+    SECTION( "Energy goes across, and the system stays passive" ) {
+        coupledmeshes::Coupling c { 0, 30.f, 30.f, 1, 25.f, 25.f, 2.f, 0.f };
+        REQUIRE(sys.AddCoupling(c));
+        // Second coupling point, at a fractional position
+        c.x_a = 13.3f; c.y_a = 44.1f; c.x_b = 37.7f; c.y_b = 11.9f;
+        REQUIRE(sys.AddCoupling(c));
+        CHECK_FALSE(sys.AddCoupling(c));  // Out of couplings
+        run(out_batter, out_reso);
+        float max_reso = 0;
+        float max_early = 0, max_late = 0;
+        for (unsigned int n = 0; n < in.size(); n++) {
+            REQUIRE(std::isfinite(out_batter[n]));
+            max_reso = std::max(max_reso, std::fabs(out_reso[n]));
+            float &max = (n < in.size() / 2) ? max_early : max_late;
+            max = std::max(max, std::fabs(out_batter[n]) +
+                std::fabs(out_reso[n]));
+        }
+        CHECK(max_reso > 1e-3f);
+        CHECK(max_late <= max_early);
+
+        // One thread per mesh: same numbers
+        std::vector<float> th_batter(in.size()), th_reso(in.size());
+        sys.StartThreads();
+        REQUIRE(sys.IsThreaded());
+        run(th_batter, th_reso);
+        sys.StopThreads();
+        CHECK(th_batter == out_batter);
+        CHECK(th_reso == out_reso);
+    }
+
+    SECTION( "Positions are checked" ) {
+        coupledmeshes::Coupling c { 0, 30.f, 30.f, 1, 55.f, 25.f, 1.f, 0.f };
+        CHECK_FALSE(sys.AddCoupling(c));
+        c.mesh_b = 2;
+        CHECK_FALSE(sys.AddCoupling(c));
+        coupledmeshes::Lump l { 1, 55.f, 25.f, 1.f, 0.f, 1.f, 0.f };
+        CHECK_FALSE(sys.AddLump(l));
+        l.mesh = 2;
+        CHECK_FALSE(sys.AddLump(l));
+    }
+
+    SECTION( "A matched damper takes everything in" ) {
+        // Resistance equal to the port's admittance: nothing comes back,
+        // as from a port left open
+        coupledmeshes::Lump l { 0, 30.f, 30.f, 2.f, 0.f, 2.f, 0.f };
+        REQUIRE(sys.AddLump(l));
+        ref.AddPort(30.f, 30.f, 2.f);
+        run(out_batter, out_reso);
+        for (unsigned int n = 0; n < in.size(); n++) {
+            REQUIRE(out_batter[n] == ref.ProcessSample(true, in[n]));
+        }
+    }
+
+    SECTION( "Lumps stay passive" ) {
+        // The shell's air as a spring under the batter head, and a mass
+        // on a spring on the resonant one, alongside a coupling
+        coupledmeshes::Lump spring { 0, 30.f, 30.f, 2.f, 0.f, 0.05f, 0.3f };
+        coupledmeshes::Lump mass { 1, 20.f, 28.f, 1.f, 4.f, 0.1f, 0.5f };
+        coupledmeshes::Coupling c { 0, 13.3f, 44.1f, 1, 37.7f, 11.9f, 2.f,
+            0.f };
+        REQUIRE(sys.AddLump(spring));
+        REQUIRE(sys.AddCoupling(c));
+        REQUIRE(sys.AddLump(mass));
+        CHECK_FALSE(sys.AddLump(mass));  // Out of room
+        run(out_batter, out_reso);
+        float max_early = 0, max_late = 0, diff = 0;
+        for (unsigned int n = 0; n < in.size(); n++) {
+            REQUIRE(std::isfinite(out_batter[n]));
+            REQUIRE(std::isfinite(out_reso[n]));
+            float &max = (n < in.size() / 2) ? max_early : max_late;
+            max = std::max(max, std::fabs(out_batter[n]) +
+                std::fabs(out_reso[n]));
+            diff = std::max(diff, std::fabs(out_batter[n] -
+                ref.ProcessSample(true, in[n])));
+        }
+        CHECK(max_late <= max_early);
+        CHECK(diff > 1e-3f);
+
+        std::vector<float> th_batter(in.size()), th_reso(in.size());
+        sys.StartThreads();
+        run(th_batter, th_reso);
+        sys.StopThreads();
+        CHECK(th_batter == out_batter);
+        CHECK(th_reso == out_reso);
+    }
+}
+
+
+TEST_CASE( "3D mesh box fundamental", "[Rectilinear3DMesh]" ) {
+
+    // 10 x 8 x 6 nodes
+    mesh3d::Properties p { 100.f, 80.f, 60.f, 10.f };
+    REQUIRE(mesh3d::GetNodeCount(p) == 10 * 8 * 6);
+    std::vector<char> mem(mesh3d::GetMemSize(p));
+    mesh3d m(p, mem.data());
+    m.SetSource(45.f, 35.f, 25.f);
+    m.SetPickup(32.f, 51.f, 33.f);
+    CHECK_FALSE(m.IsInside(100.f, 0.f, 0.f));
+    CHECK_FALSE(m.IsInside(0.f, -1.f, 0.f));
+
+    const unsigned int n_samples = 8192;
+    std::vector<float> out(n_samples);
+    for (unsigned int n = 0; n < n_samples; n++) {
+        out[n] = m.ProcessSample(true, (n == 0) ? 1.f : 0.f);
+    }
+
+    // Fixed ends one spacing past the last nodes: the (1, 1, 1) mode of
+    // the scheme is exactly
+    const float pi = 3.14159265f;
+    float expected = std::acos((std::cos(pi / 11.f) + std::cos(pi / 9.f) +
+        std::cos(pi / 7.f)) / 3.f);
+    // Strongest peak below the next mode, (2, 1, 1) at 0.465 rad/sample
+    float peak_omega = 0, peak = 0;
+    for (float omega = 0.25f; omega < 0.42f; omega += 0.0002f) {
+        double re = 0, im = 0;
+        for (unsigned int n = 0; n < n_samples; n++) {
+            double w = 0.5 - 0.5 * std::cos(2. * pi * n / n_samples);
+            re += w * out[n] * std::cos(omega * n);
+            im += w * out[n] * std::sin(omega * n);
+        }
+        if (re * re + im * im > peak) {
+            peak = re * re + im * im;
+            peak_omega = omega;
+        }
+    }
+    CHECK(peak_omega == Approx(expected).epsilon(0.005));
+}
+
+
+TEST_CASE( "3D mesh bands on threads", "[Rectilinear3DMesh]" ) {
+
+    // Air in a drum shell
+    mesh3d::Properties p { 80.f, 80.f, 50.f, 5.f };
+    std::vector<char> mem_single(mesh3d::GetMemSize(p));
+    std::vector<char> mem_bands(mesh3d::GetMemSize(p));
+    mesh3d single(p, mem_single.data());
+    mesh3d bands(p, mem_bands.data());
+    for (mesh3d *m : { &single, &bands }) {
+        m->ApplyMask(Geometries::CylindricalCavity(40.f));
+        m->SetSource(35.f, 42.f, 12.f);
+        m->SetPickup(51.f, 30.f, 41.f);  // Different band
+        m->SetAttenuation(0.001f);
+    }
+    CHECK_FALSE(single.IsInside(2.f, 2.f, 20.f));  // Corner of the box
+    CHECK(single.IsInside(40.f, 40.f, 49.f));
+
+    const unsigned int block = 32;
+    std::vector<float> in(block * 16, 0.f);
+    in[0] = 1.f;
+    in[37] = -0.5f;
+    std::vector<float> out_single(in.size()), out_bands(in);
+    single.ProcessBlock(in.data(), out_single.data(), in.size());
+    bands.StartThreads(3);
+    REQUIRE(bands.IsThreaded());
+    for (unsigned int b = 0; b < in.size(); b += block) {
+        // In place
+        bands.ProcessBlock(&out_bands[b], &out_bands[b], block);
+    }
+    bands.StopThreads();
+    CHECK(out_bands == out_single);
+    float max = 0;
+    for (float x : out_single) {
+        max = std::max(max, std::fabs(x));
+    }
+    CHECK(max > 0.f);
+}
+
+
+TEST_CASE( "Large mesh sizes", "[Rectilinear3DMesh]" ) {
+
+    // Past 32 bits, in bytes and (for the 3D mesh) in floats per plane
+    mesh::Properties p2 { 20000.f, 20000.f, 1.f };
+    mesh::Properties_internal_ pi2;
+    mesh::GetInternalProperties(p2, pi2);
+    REQUIRE(pi2.total_size_ck == static_cast<unsigned int>(40001) * 11548);
+    CHECK(mesh::GetMemSize(p2) ==
+        pi2.plane_size * mesh::kNMeshes * 4 + DSP::Dispatch::kMaxAlignment);
+    mesh3d::Properties p3 { 2000.f, 2000.f, 1100.f, 1.f };
+    CHECK(mesh3d::GetNodeCount(p3) == static_cast<size_t>(4400000000ull));
+    CHECK(mesh3d::GetMemSize(p3) > 3 * mesh3d::GetNodeCount(p3) * 4);
+}
+
+
+TEST_CASE( "3D mesh on huge pages, first touched by bands",
+        "[Rectilinear3DMesh]" ) {
+
+    mesh3d::Properties p { 60.f, 50.f, 70.f, 5.f };
+    size_t memsize = mesh3d::GetMemSize(p);
+    void *mem_large = largealloc::Allocate(memsize,
+        largealloc::kTransparentHugePages);
+    REQUIRE(mem_large != nullptr);
+    std::vector<char> mem_ref(memsize);
+    {
+        mesh3d large(p, mem_large, 4);
+        mesh3d ref(p, mem_ref.data());
+        REQUIRE(large.IsThreaded());
+        for (mesh3d *m : { &large, &ref }) {
+            m->SetSource(12.f, 20.f, 8.f);
+            m->SetPickup(41.f, 33.f, 62.f);
+        }
+        std::vector<float> in(256, 0.f), out_large(256), out_ref(256);
+        in[0] = 1.f;
+        large.ProcessBlock(in.data(), out_large.data(), in.size());
+        ref.ProcessBlock(in.data(), out_ref.data(), in.size());
+        CHECK(out_large == out_ref);
+    }
+    largealloc::Free(mem_large, memsize);
+}
+
+
+TEST_CASE( "Simply supported plate modes", "[KirchhoffPlate]" ) {
+
+    // 10 x 8 nodes
+    plate::Properties p { 200.f, 160.f, 20.f };
+    REQUIRE(plate::GetNodeCount(p) == 10 * 8);
+    std::vector<char> mem(plate::GetMemSize(p));
+    plate m(p, mem.data());
+    m.SetBoundaryCondition(plate::kSimplySupported);
+    m.SetStiffness(0.25f);
+    m.SetSource(45.f, 65.f);
+    m.SetPickup(125.f, 85.f);
+
+    const unsigned int n_samples = 8192;
+    std::vector<float> out(n_samples);
+    for (unsigned int n = 0; n < n_samples; n++) {
+        out[n] = m.ProcessSample(true, (n == 0) ? 1.f : 0.f);
+    }
+
+    // Edges one spacing past the last nodes: modes are sines, and the
+    // scheme's (p, q) mode is exactly at 2 - 2 cos(w) = mu^2 lambda^2
+    const float pi = 3.14159265f;
+    auto mode_omega = [&](float p_, float q_) {
+        float lambda = 4.f * std::pow(std::sin(p_ * pi / 22.f), 2) +
+            4.f * std::pow(std::sin(q_ * pi / 18.f), 2);
+        return std::acos(1.f - 0.5f * 0.0625f * lambda * lambda);
+    };
+    float expected = mode_omega(1, 1);
+    // Stiff: the next mode is more than twice as high (a membrane's would
+    // be 1.5 times)
+    CHECK(mode_omega(1, 2) > 2.f * expected);
+    float peak_omega = 0, peak = 0;
+    for (float omega = 0.5f * expected; omega < 1.5f * expected;
+            omega += 0.0001f) {
+        double re = 0, im = 0;
+        for (unsigned int n = 0; n < n_samples; n++) {
+            double w = 0.5 - 0.5 * std::cos(2. * pi * n / n_samples);
+            re += w * out[n] * std::cos(omega * n);
+            im += w * out[n] * std::sin(omega * n);
+        }
+        if (re * re + im * im > peak) {
+            peak = re * re + im * im;
+            peak_omega = omega;
+        }
+    }
+    CHECK(peak_omega == Approx(expected).epsilon(0.01));
+}
+
+
+TEST_CASE( "Plate boundaries on a round plate", "[KirchhoffPlate]" ) {
+
+    plate::Properties p { 300.f, 300.f, 20.f };
+    std::vector<char> mem(plate::GetMemSize(p));
+    plate m(p, mem.data());
+    m.ApplyMask(Geometries::CircularMembrane(150.f));
+    CHECK_FALSE(m.IsInside(5.f, 5.f));
+    m.SetSource(110.f, 130.f);
+    m.SetPickup(170.f, 190.f);
+
+    const unsigned int n_samples = 20000;
+    for (plate::BoundaryCondition bc :
+            { plate::kClamped, plate::kSimplySupported, plate::kFree }) {
+        m.SetBoundaryCondition(bc);
+        // A free plate that's hit flies off: only losses keep it put
+        m.SetAttenuation((bc == plate::kFree) ? 0.0001f : 0.f);
+        m.Reset();
+        float max_early = 0, max_late = 0;
+        for (unsigned int n = 0; n < n_samples; n++) {
+            float out = m.ProcessSample(true, (n == 0) ? 1.f : 0.f);
+            REQUIRE(std::isfinite(out));
+            float &max = (n < n_samples / 2) ? max_early : max_late;
+            max = std::max(max, std::fabs(out));
+        }
+        CHECK(max_early > 0.f);
+        CHECK(max_late < 1.5f * max_early);
+    }
+}
+
+
+TEST_CASE( "Plate real-time capacity", "[.][benchmark][KirchhoffPlate]" ) {
+
+    // 300 mm steel plates at 44.1 kHz: kappa = 4.32 m^2/s per mm of
+    // thickness. Thinner plates need finer grids.
+    const float fs = 44100.f;
+    for (float thickness__mm : { 1.f, 0.5f, 0.25f }) {
+        float kappa = 4.32f * thickness__mm;
+        float h = plate::GetMinResolution(kappa, fs);
+        plate::Properties p { 300.f, 300.f, h };
+        std::vector<char> mem(plate::GetMemSize(p));
+        plate m(p, mem.data());
+        m.ApplyMask(Geometries::CircularMembrane(150.f));
+        m.SetBoundaryCondition(plate::kFree);
+        m.SetStiffness(std::min(plate::kMaxStiffnessNumber,
+            plate::GetStiffnessNumber(kappa, fs, h)));
+        m.SetAttenuation(0.0001f);
+        m.SetSource(110.f, 130.f);
+        m.SetPickup(170.f, 190.f);
+        volatile float sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int n = 0; n < fs; n++) {
+            sink = sink + m.ProcessSample(true, (n == 0) ? 1.f : 0.f);
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        printf("%.2f mm plate, h = %.1f mm, %u nodes: %.1fx real time\n",
+            thickness__mm, h, plate::GetNodeCount(p), 1. / elapsed.count());
+        CHECK(elapsed.count() < 1.);
+    }
+}
+
+
+TEST_CASE( "Autotuner picks the fastest variant and remembers it",
+        "[MeshAutotuner]" ) {
+
+    const std::string path = "autotuner_test.cache";
+    std::remove(path.c_str());
+    {
+        autotuner t(path);
+        CHECK(t.GetSize() == 0);
+        CHECK(!autotuner::GetCPUModel().empty());
+
+        // Variant 2 does a tenth of the work of the others
+        unsigned int prepared = 0, runs = 0;
+        volatile float sink = 0;
+        auto prepare = [&](unsigned int v) { prepared = v; };
+        auto run = [&]() {
+            runs++;
+            unsigned int n = (prepared == 2) ? 20000 : 200000;
+            for (unsigned int i = 0; i < n; i++) {
+                sink = sink + 1.f;
+            }
+        };
+        CHECK(t.Select(0x1234, 4, prepare, run) == 2);
+        CHECK(runs == 4 * (1 + autotuner::kTimedRuns));
+
+        // 3D mesh: whatever wins is left running
+        mesh3d::Properties p { 40.f, 40.f, 80.f, 5.f };
+        std::vector<char> mem(mesh3d::GetMemSize(p));
+        mesh3d m(p, mem.data());
+        unsigned int n_bands = t.TuneBands(m, 4, 32);
+        CHECK((n_bands == 1 || n_bands == 2 || n_bands == 4));
+        CHECK(m.GetNumBands() == n_bands);
+        CHECK(m.IsThreaded() == (n_bands > 1));
+        CHECK(t.GetSize() == 2);
+        REQUIRE(t.Save());
+
+        // Another geometry is another decision
+        m.ApplyMask(Geometries::CylindricalCavity(20.f));
+        t.TuneBands(m, 4, 32);
+        CHECK(t.GetSize() == 3);
+
+        // 2D mesh: whichever kernel wins is left set, and remembered
+        mesh::Properties p2 { 100.f, 100.f, 4.f };
+        std::vector<char> mem2(mesh::GetMemSize(p2));
+        mesh m2(p2, mem2.data());
+        m2.ApplyMask(Geometries::CircularMembrane(50.f));
+        mesh::Kernel kernel = t.TuneKernel(m2, 32);
+        CHECK(m2.GetKernel() == kernel);
+        CHECK(t.GetSize() == 4);
+        m2.SetKernel((kernel == mesh::kKernelNodes) ?
+            mesh::kKernelStencil : mesh::kKernelNodes);
+        CHECK(t.TuneKernel(m2, 32) == kernel);
+        CHECK(m2.GetKernel() == kernel);
+        CHECK(t.GetSize() == 4);
+        // Only the nodes kernel runs tension modulation: no race
+        m2.SetTensionModulation(1.f, 1.2f);
+        CHECK(t.TuneKernel(m2, 32) == mesh::kKernelNodes);
+        CHECK(m2.GetKernel() == mesh::kKernelNodes);
+        CHECK(t.GetSize() == 4);
+    }
+    {
+        // Reloaded: no more timing
+        autotuner t(path);
+        CHECK(t.GetSize() == 2);
+        unsigned int runs = 0;
+        CHECK(t.Select(0x1234, 4, [](unsigned int) {},
+            [&]() { runs++; }) == 2);
+        CHECK(runs == 0);
+    }
+    std::remove(path.c_str());
+}
+
+
+TEST_CASE( "Graph mesh runs as the lattice it came from", "[GraphMesh]" ) {
+
+    mesh::Properties p { 100.f, 100.f, 5.f };
+    std::vector<char> mem(mesh::GetMemSize(p));
+    mesh lattice(p, mem.data());
+    lattice.ApplyMask(Geometries::CircularMembrane(50.f));
+    lattice.SetAttenuation(0.001f);
+    // Source and pickup right on nodes
+    float xs, ys, xp, yp;
+    lattice.CKtoXY_(10, 6, xs, ys);
+    lattice.CKtoXY_(13, 12, xp, yp);
+    lattice.SetSource(xs, ys);
+    lattice.SetPickup(xp, yp);
+
+    graphmesh::Graph g = graphmesh::FromLattice(lattice);
+    // Only the circle is stored
+    CHECK(g.x.size() < 0.85f * mesh::GetNodeCount(p));
+    CHECK(g.row_start.size() == g.x.size() + 1);
+    CHECK(g.neighbour.size() == g.row_start.back());
+    std::vector<char> graph_mem(graphmesh::GetMemSize(g));
+    graphmesh m(g, graph_mem.data());
+    CHECK(m.GetNodeCount() == g.x.size());
+    m.SetSource(xs, ys);
+    m.SetPickup(xp, yp);
+    m.SetAttenuation(0.001f);
+
+    float max_error = 0, max_out = 0;
+    for (unsigned int n = 0; n < 2000; n++) {
+        float in = (n < 3) ? 1.f : 0.f;
+        float a = lattice.ProcessSample(true, in);
+        float b = m.ProcessSample(true, in);
+        max_error = std::max(max_error, std::abs(a - b));
+        max_out = std::max(max_out, std::abs(a));
+    }
+    CHECK(max_out > 0.01f);
+    CHECK(max_error < 1e-4f * max_out);
+}
+
+
+TEST_CASE( "Graph mesh on a scattered point set", "[GraphMesh]" ) {
+
+    // Jittered square grid over a disc: irregular degrees and lengths
+    std::vector<float> x, y;
+    uint32_t seed = 0x9e3779b9;
+    auto jitter = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (static_cast<float>(seed >> 8) / 16777216.f - 0.5f) * 1.5f;
+    };
+    for (unsigned int j = 0; j < 40; j++) {
+        for (unsigned int i = 0; i < 40; i++) {
+            float px = i * 5.f + jitter();
+            float py = j * 5.f + jitter();
+            if ((px - 97.5f) * (px - 97.5f) + (py - 97.5f) * (py - 97.5f) <
+                    95.f * 95.f) {
+                x.push_back(px);
+                y.push_back(py);
+            }
+        }
+    }
+    graphmesh::Graph g = graphmesh::FromPoints(x.data(), y.data(), x.size(),
+        7.5f);
+    REQUIRE(g.x.size() == x.size());
+    // Links both ways, rows sorted
+    bool symmetric = true;
+    for (unsigned int i = 0; i < g.x.size(); i++) {
+        for (unsigned int e = g.row_start[i]; e < g.row_start[i + 1]; e++) {
+            unsigned int j = g.neighbour[e];
+            symmetric &= j != i && std::binary_search(
+                g.neighbour.begin() + g.row_start[j],
+                g.neighbour.begin() + g.row_start[j + 1], i);
+        }
+    }
+    CHECK(symmetric);
+    // Morton order: linked nodes are numbered close together (random
+    // numbering would put them about a third of the mesh apart)
+    double spread = 0;
+    for (unsigned int i = 0; i < g.x.size(); i++) {
+        for (unsigned int e = g.row_start[i]; e < g.row_start[i + 1]; e++) {
+            spread += std::abs(static_cast<double>(g.neighbour[e]) - i);
+        }
+    }
+    spread /= g.neighbour.size();
+    INFO("Mean index distance " << spread);
+    CHECK(spread < g.x.size() / 20.);
+
+    // Lossless: an impulse rings on without growing
+    std::vector<char> graph_mem(graphmesh::GetMemSize(g));
+    graphmesh m(g, graph_mem.data());
+    m.SetSource(60.f, 80.f);
+    m.SetPickup(130.f, 110.f);
+    float early = 0, late = 0;
+    for (unsigned int n = 0; n < 8000; n++) {
+        float out = m.ProcessSample(n == 0, 1.f);
+        if (n < 4000) {
+            early = std::max(early, std::abs(out));
+        } else {
+            late = std::max(late, std::abs(out));
+        }
+    }
+    CHECK(early > 0.f);
+    CHECK(late > 0.f);
+    CHECK(late <= early * 1.5f);
+}
+
+
+// Every layout and form of an n-channel cascade against a plain scalar
+// DF2, channel by channel
+template <unsigned int n_channels>
+static void CheckBiquadLayouts() {
+
+    const unsigned int n_sections = 3;
+    const unsigned int n_samples = 300;
+    biquadcoeffs c[n_sections];
+    filterdesigner::ResonantLowpass(&c[0], 44100.f, 3000.f, 2.f, 1.f);
+    filterdesigner::ResonantHighpass(&c[1], 44100.f, 40.f, 0.7f, 1.f);
+    filterdesigner::ResonantLowpass(&c[2], 44100.f, 200.f, 5.f, 0.5f);
+
+    std::vector<float> x(n_samples * n_channels);
+    uint32_t seed = 0x2545f491 + n_channels;
+    for (float &v : x) {
+        seed = seed * 1664525u + 1013904223u;
+        v = static_cast<float>(seed >> 8) / 16777216.f - 0.5f;
+    }
+    std::vector<float> ref(x);
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        for (unsigned int n = 0; n < n_sections; n++) {
+            float z1 = 0, z2 = 0;
+            for (unsigned int k = 0; k < n_samples; k++) {
+                float &v = ref[k * n_channels + ch];
+                float w = v - c[n].a1 * z1 - c[n].a2 * z2;
+                v = c[n].b0 * w + c[n].b1 * z1 + c[n].b2 * z2;
+                z2 = z1;
+                z1 = w;
+            }
+        }
+    }
+
+    typename DSP::Biquad<n_channels>::State s[n_sections];
+    DSP::Biquad<n_channels> f(n_sections, c, s);
+    auto max_error = [&](const std::vector<float> &y) {
+        float e = 0;
+        for (unsigned int n = 0; n < y.size(); n++) {
+            e = std::max(e, std::abs(y[n] - ref[n]));
+        }
+        return e;
+    };
+
+    // Interleaved, in two blocks
+    std::vector<float> y(x);
+    f.ProcessBuffer(y.data(), 100);
+    f.ProcessBuffer(y.data() + 100 * n_channels, n_samples - 100);
+    CHECK(max_error(y) < 1e-5f);
+    // Frame by frame
+    f.Reset();
+    y = x;
+    for (unsigned int k = 0; k < n_samples; k++) {
+        f.ProcessFrame(y.data() + k * n_channels);
+    }
+    CHECK(max_error(y) < 1e-5f);
+    // Planar, across chunk boundaries
+    f.Reset();
+    std::vector<float> planar(n_samples * n_channels);
+    float *buffers[n_channels];
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        buffers[ch] = planar.data() + ch * n_samples;
+        for (unsigned int k = 0; k < n_samples; k++) {
+            buffers[ch][k] = x[k * n_channels + ch];
+        }
+    }
+    f.ProcessBufferPlanar(buffers, n_samples);
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        for (unsigned int k = 0; k < n_samples; k++) {
+            y[k * n_channels + ch] = buffers[ch][k];
+        }
+    }
+    CHECK(max_error(y) < 1e-5f);
+    // Transposed: same filter, different roundoff
+    f.SetForm(DSP::Biquad<n_channels>::kTDF2);
+    y = x;
+    f.ProcessBuffer(y.data(), n_samples);
+    CHECK(max_error(y) < 1e-4f);
+}
+
+
+TEST_CASE( "Biquad layouts and forms", "[Biquad]" ) {
+    // Accelerometer axes, whole vectors, vectors plus leftovers
+    CheckBiquadLayouts<1>();
+    CheckBiquadLayouts<3>();
+    CheckBiquadLayouts<8>();
+    CheckBiquadLayouts<6>();
+}
+
+
+TEST_CASE( "Pipelined mono cascade", "[Biquad]" ) {
+
+    // A full group of sections plus a part-filled one
+    const unsigned int n_sections = 6;
+    const unsigned int n_samples = 400;
+    biquadcoeffs c[n_sections];
+    for (unsigned int n = 0; n < n_sections; n += 2) {
+        filterdesigner::ResonantLowpass(&c[n], 44100.f, 2000.f * (n + 1),
+            0.6f + n, 1.f);
+        filterdesigner::ResonantHighpass(&c[n + 1], 44100.f, 30.f * (n + 1),
+            0.7f, 1.f);
+    }
+    std::vector<float> x(n_samples);
+    uint32_t seed = 0x9e3779b9;
+    for (float &v : x) {
+        seed = seed * 1664525u + 1013904223u;
+        v = static_cast<float>(seed >> 8) / 16777216.f - 0.5f;
+    }
+    std::vector<float> ref(x);
+    for (unsigned int n = 0; n < n_sections; n++) {
+        float z1 = 0, z2 = 0;
+        for (float &v : ref) {
+            float w = v - c[n].a1 * z1 - c[n].a2 * z2;
+            v = c[n].b0 * w + c[n].b1 * z1 + c[n].b2 * z2;
+            z2 = z1;
+            z1 = w;
+        }
+    }
+
+    DSP::Biquad<1>::State s[n_sections];
+    DSP::Biquad<1> f(n_sections, c, s);
+    // Blocks shorter than the pipeline, and state carried across them
+    const unsigned int blocks[] = { 1, 2, 3, 5, 64, 25 };
+    for (unsigned int form = 0; form < 2; form++) {
+        f.SetForm(form ? DSP::Biquad<1>::kTDF2 : DSP::Biquad<1>::kDF2);
+        std::vector<float> y(x);
+        unsigned int start = 0;
+        for (unsigned int b = 0; start < n_samples; b = (b + 1) % 6) {
+            unsigned int n = std::min(blocks[b], n_samples - start);
+            f.ProcessBuffer(y.data() + start, n);
+            start += n;
+        }
+        float e = 0;
+        for (unsigned int k = 0; k < n_samples; k++) {
+            e = std::max(e, std::abs(y[k] - ref[k]));
+        }
+        CHECK(e < 1e-4f);
+    }
+}
+
+
+// Frequency response of a cascade at f
+static std::complex<double> CascadeResponse(const biquadcoeffs *c,
+        unsigned int n_sections, float fs, float f) {
+    std::complex<double> z1 = std::polar(1., -2. * M_PI * f / fs);
+    std::complex<double> z2 = z1 * z1;
+    std::complex<double> h = 1.;
+    for (unsigned int n = 0; n < n_sections; n++) {
+        h *= (double(c[n].b0) + double(c[n].b1) * z1 +
+            double(c[n].b2) * z2) /
+            (1. + double(c[n].a1) * z1 + double(c[n].a2) * z2);
+    }
+    return h;
+}
+
+
+TEST_CASE( "Higher-order and crossover designs", "[FilterDesigner]" ) {
+
+    const float fs = 48000.f;
+    const float f_cut = 1000.f;
+    biquadcoeffs lpf[filterdesigner::kMaxOrder];
+    biquadcoeffs hpf[filterdesigner::kMaxOrder];
+
+    for (unsigned int order = 1; order <= filterdesigner::kMaxOrder;
+            order++) {
+        INFO("Order " << order);
+        // Butterworth: flat passbands, -3 dB at cutoff, roll-off
+        unsigned int n = filterdesigner::Lowpass(lpf,
+            filterdesigner::kButterworth, order, fs, f_cut);
+        REQUIRE(n == (order + 1) / 2);
+        REQUIRE(filterdesigner::Highpass(hpf, filterdesigner::kButterworth,
+            order, fs, f_cut) == n);
+        CHECK(std::abs(CascadeResponse(lpf, n, fs, 0.f)) == Approx(1.));
+        CHECK(std::abs(CascadeResponse(hpf, n, fs, fs / 2)) == Approx(1.));
+        CHECK(std::abs(CascadeResponse(lpf, n, fs, f_cut)) ==
+            Approx(std::sqrt(0.5)).epsilon(1e-4));
+        CHECK(std::abs(CascadeResponse(hpf, n, fs, f_cut)) ==
+            Approx(std::sqrt(0.5)).epsilon(1e-4));
+        // An octave up, the slope is already close to 6 dB per order
+        CHECK(20. * std::log10(std::abs(CascadeResponse(lpf, n, fs,
+            4 * f_cut))) < -11.5 * order);
+
+        // Bessel: far above cutoff, a Butterworth's asymptote (in the
+        // analog domain: cutoff well below fs)
+        const float f_low = 100.f;
+        n = filterdesigner::Lowpass(lpf, filterdesigner::kBessel, order,
+            fs, f_low);
+        filterdesigner::Lowpass(hpf, filterdesigner::kButterworth, order,
+            fs, f_low);
+        CHECK(std::abs(CascadeResponse(lpf, n, fs, 40 * f_low)) ==
+            Approx(std::abs(CascadeResponse(hpf, n, fs, 40 * f_low)))
+            .epsilon(0.02));
+        // (float coefficients, with poles this close to z = 1)
+        CHECK(std::abs(CascadeResponse(lpf, n, fs, 0.f)) ==
+            Approx(1.).epsilon(1e-3));
+        // Flat group delay well into the passband
+        auto delay = [&](float f) {
+            const float df = 0.01f;
+            return -std::arg(CascadeResponse(lpf, n, fs, f + df) /
+                CascadeResponse(lpf, n, fs, f)) / (2. * M_PI * df);
+        };
+        if (order > 2) {
+            CHECK(delay(f_low / 3) == Approx(delay(1.f)).epsilon(0.01));
+        }
+
+        // Linkwitz-Riley: -6 dB at cutoff, bands sum to an allpass
+        if (order % 2 == 0) {
+            n = filterdesigner::Crossover(lpf, hpf,
+                filterdesigner::kLinkwitzRiley, order, fs, f_cut);
+            REQUIRE(n == filterdesigner::GetNumSections(
+                filterdesigner::kLinkwitzRiley, order));
+            CHECK(std::abs(CascadeResponse(lpf, n, fs, f_cut)) ==
+                Approx(0.5).epsilon(1e-4));
+            for (float f = 20.f; f < fs / 2; f *= 1.5f) {
+                std::complex<double> sum = CascadeResponse(lpf, n, fs, f) +
+                    CascadeResponse(hpf, n, fs, f);
+                CHECK(std::abs(sum) == Approx(1.).epsilon(1e-4));
+            }
+        }
+    }
+}
+
+
+TEST_CASE( "Interpolated coefficient tables", "[FilterDesigner]" ) {
+
+    const float fs = 48000.f;
+    const unsigned int order = 4;
+    const unsigned int n_sections = 2;
+    // 20 Hz to 20 kHz, 6 points per octave
+    const unsigned int n_points = 61;
+    std::vector<char> mem(biquadtable::GetMemSize(n_sections, n_points));
+    biquadtable table(n_sections, n_points, 20.f, 20480.f, mem.data());
+    CHECK(!table.Fill(filterdesigner::kButterworth, false, 5, fs));
+    REQUIRE(table.Fill(filterdesigner::kButterworth, false, order, fs));
+    CHECK(table.GetCutoff(0) == Approx(20.f));
+    CHECK(table.GetCutoff(n_points - 1) == Approx(20480.f));
+
+    biquadcoeffs c[n_sections];
+    biquadcoeffs ref[n_sections];
+    // On the grid, the designs themselves
+    table.Lookup(table.GetCutoff(30), c);
+    filterdesigner::Lowpass(ref, filterdesigner::kButterworth, order, fs,
+        table.GetCutoff(30));
+    for (unsigned int k = 0; k < n_sections; k++) {
+        CHECK(c[k].b0 == Approx(ref[k].b0).epsilon(1e-4));
+        CHECK(c[k].a1 == Approx(ref[k].a1).epsilon(1e-4));
+        CHECK(c[k].a2 == Approx(ref[k].a2).epsilon(1e-4));
+    }
+    // In between, close to the exact design (within 0.5 dB up to an
+    // octave above cutoff)
+    float worst = 0;
+    for (float f_cut = 25.f; f_cut < 15000.f; f_cut *= 1.13f) {
+        table.Lookup(f_cut, c);
+        filterdesigner::Lowpass(ref, filterdesigner::kButterworth, order,
+            fs, f_cut);
+        for (float f = f_cut / 8; f < 2 * f_cut && f < fs / 2; f *= 1.2f) {
+            double e = 20. * std::log10(
+                std::abs(CascadeResponse(c, n_sections, fs, f)) /
+                std::abs(CascadeResponse(ref, n_sections, fs, f)));
+            worst = std::max(worst, static_cast<float>(std::abs(e)));
+        }
+    }
+    CHECK(worst < 0.5f);
+    // Outside the range, clamped
+    table.Lookup(1.f, c);
+    table.Lookup(table.GetCutoff(0), ref);
+    CHECK(c[0].a1 == ref[0].a1);
+    table.Lookup(1e6f, c);
+    table.Lookup(table.GetCutoff(n_points - 1), ref);
+    CHECK(c[1].a2 == Approx(ref[1].a2));
+
+    // Any design, e.g. a resonant lowpass
+    biquadtable resonant(1, n_points, 20.f, 20480.f, mem.data());
+    resonant.Fill([fs](biquadcoeffs *c, float f_cut) {
+        filterdesigner::ResonantLowpass(c, fs, f_cut, 2.f, 1.f);
+    });
+    resonant.Lookup(resonant.GetCutoff(10), c);
+    filterdesigner::ResonantLowpass(ref, fs, resonant.GetCutoff(10), 2.f,
+        1.f);
+    CHECK(c[0].a1 == Approx(ref[0].a1));
+}
+
+
+TEST_CASE( "State-variable filter bank", "[SVF]" ) {
+
+    const float fs = 48000.f;
+    const unsigned int n_samples = 256;
+    const unsigned int n_channels = 5;  // A vector and some
+    std::vector<float> x(n_samples * n_channels, 0.f);
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        x[ch] = 1.f;  // Impulses
+    }
+    std::vector<float> lp(x.size()), bp(x.size()), hp(x.size());
+
+    // At Q = 1 / sqrt(2), the designer's second-order Butterworth
+    DSP::SVF<n_channels>::State s;
+    DSP::SVF<n_channels> f(fs, &s);
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        f.SetParameters(ch, 500.f * (ch + 1), M_SQRT1_2);
+    }
+    f.ProcessBuffer(x.data(), lp.data(), bp.data(), hp.data(), n_samples);
+    float e_lp = 0, e_hp = 0, e_sum = 0;
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+        biquadcoeffs c[2];
+        filterdesigner::Lowpass(&c[0], filterdesigner::kButterworth, 2, fs,
+            500.f * (ch + 1));
+        filterdesigner::Highpass(&c[1], filterdesigner::kButterworth, 2,
+            fs, 500.f * (ch + 1));
+        DSP::Biquad<1>::State s_lp[1], s_hp[1];
+        DSP::Biquad<1> ref_lp(1, &c[0], s_lp);
+        DSP::Biquad<1> ref_hp(1, &c[1], s_hp);
+        for (unsigned int n = 0; n < n_samples; n++) {
+            float y_lp = x[n * n_channels + ch];
+            float y_hp = y_lp;
+            ref_lp.ProcessFrame(&y_lp);
+            ref_hp.ProcessFrame(&y_hp);
+            unsigned int k = n * n_channels + ch;
+            e_lp = std::max(e_lp, std::abs(lp[k] - y_lp));
+            e_hp = std::max(e_hp, std::abs(hp[k] - y_hp));
+            // The outputs add back up to the input
+            e_sum = std::max(e_sum, std::abs(lp[k] + std::sqrt(2.f) * bp[k] +
+                hp[k] - x[k]));
+        }
+    }
+    CHECK(e_lp < 1e-5f);
+    CHECK(e_hp < 1e-5f);
+    CHECK(e_sum < 1e-5f);
+
+    // Held parameters, modulated: the same up to FastTan()
+    std::vector<float> cutoff(x.size()), lp_mod(x.size());
+    for (unsigned int k = 0; k < x.size(); k++) {
+        cutoff[k] = 500.f * (k % n_channels + 1);
+    }
+    f.Reset();
+    f.ProcessBufferModulated(x.data(), cutoff.data(), nullptr,
+        lp_mod.data(), nullptr, nullptr, n_samples);
+    float e_mod = 0;
+    for (unsigned int k = 0; k < x.size(); k++) {
+        e_mod = std::max(e_mod, std::abs(lp_mod[k] - lp[k]));
+    }
+    CHECK(e_mod < 1e-5f);
+
+    // FastTan() across its range
+    using V = DSP::SIMD;
+    float e_tan = 0;
+    for (float w = 0.f; w < 1.54f; w += 0.001f) {
+        float t[V::kWidth];
+        V::StoreU(t, DSP::SVF<1>::FastTan(V::Set1(w)));
+        e_tan = std::max(e_tan, std::abs(t[0] / std::tan(w) - 1.f));
+    }
+    CHECK(e_tan < 1e-5f);
+
+    // Swept at audio rate with high resonance, in place: stays bounded
+    DSP::SVF<1>::State s_mono;
+    DSP::SVF<1> mono(fs, &s_mono);
+    const unsigned int n_sweep = 48000;
+    std::vector<float> y(n_sweep), sweep(n_sweep), q(n_sweep);
+    for (unsigned int n = 0; n < n_sweep; n++) {
+        y[n] = std::sin(0.05f * n);
+        sweep[n] = 1000.f * (1.f + 0.99f * std::sin(0.02f * n)) * 10.f;
+        q[n] = 1.f + 19.f * (n % 1000 < 500);
+    }
+    mono.ProcessBufferModulated(y.data(), sweep.data(), q.data(), nullptr,
+        y.data(), nullptr, n_sweep);
+    float peak = 0;
+    for (unsigned int n = 0; n < n_sweep; n++) {
+        peak = std::max(peak, std::abs(y[n]));
+    }
+    CHECK(std::isfinite(peak));
+    CHECK(peak < 40.f);
+}
+
+
+TEST_CASE( "Cutoff modulation cost", "[.][benchmark][SVF]" ) {
+
+    const float fs = 48000.f;
+    const unsigned int n_samples = 48000;
+    std::vector<float> x(n_samples * 8, 0.1f), cutoff(n_samples * 8);
+    for (unsigned int k = 0; k < cutoff.size(); k++) {
+        cutoff[k] = 2000.f + 1000.f * std::sin(0.001f * k);
+    }
+
+    // A Biquad redesigned every sample
+    biquadcoeffs c;
+    DSP::Biquad<1>::State s[1];
+    DSP::Biquad<1> biquad(1, &c, s);
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int n = 0; n < n_samples; n++) {
+        filterdesigner::ResonantLowpass(&c, fs, cutoff[n], 2.f, 1.f);
+        biquad.ProcessFrame(&x[n]);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("Biquad, redesigned per sample: %.2f ns per sample\n",
+        1e9 * elapsed.count() / n_samples);
+
+    DSP::SVF<1>::State s_mono;
+    DSP::SVF<1> mono(fs, &s_mono);
+    start = std::chrono::steady_clock::now();
+    mono.ProcessBufferModulated(x.data(), cutoff.data(), nullptr, x.data(),
+        nullptr, nullptr, n_samples);
+    elapsed = std::chrono::steady_clock::now() - start;
+    printf("SVF, modulated: %.2f ns per sample\n",
+        1e9 * elapsed.count() / n_samples);
+
+    DSP::SVF<8>::State s_bank;
+    DSP::SVF<8> bank(fs, &s_bank);
+    start = std::chrono::steady_clock::now();
+    bank.ProcessBufferModulated(x.data(), cutoff.data(), nullptr, x.data(),
+        nullptr, nullptr, n_samples);
+    elapsed = std::chrono::steady_clock::now() - start;
+    printf("SVF bank of 8, modulated: %.2f ns per frame\n",
+        1e9 * elapsed.count() / n_samples);
+    CHECK(elapsed.count() < 1.);
+}
+
+
+// Squares whole vectors
+struct SquareFn {
+    DSP::SIMD::Vec operator()(DSP::SIMD::Vec x) { return DSP::SIMD::Mul(x, x); }
+};
+
+
+static float Halve(float x) { return 0.5f * x; }
+
+
+TEST_CASE( "Block kernels, any length and alignment", "[Block]" ) {
+
+    using V = DSP::SIMD;
+    const unsigned int max_n = 3 * V::kWidth + 3;
+    std::vector<float> mem_a(max_n + 2 * V::kWidth);
+    std::vector<float> mem_b(max_n + 2 * V::kWidth);
+    float *a0 = V::Align<float>(mem_a.data());
+    float *b0 = V::Align<float>(mem_b.data());
+    bool all_match = true;
+    bool tail_untouched = true;
+
+    for (unsigned int offset = 0; offset < 2; offset++) {
+        for (unsigned int n = 0; n <= max_n; n++) {
+            float *a = a0 + offset;
+            float *b = b0 + offset;
+            auto fill = [&]() {
+                for (unsigned int k = 0; k < max_n + 1; k++) {
+                    a[k] = 0.25f * k + 1.f;
+                    b[k] = 3.f - 0.5f * k;
+                }
+            };
+            // Every kernel against its scalar definition
+            auto check = [&](std::function<float(float, float)> expected) {
+                for (unsigned int k = 0; k < n; k++) {
+                    float x = 0.25f * k + 1.f;
+                    float y = 3.f - 0.5f * k;
+                    all_match &= std::abs(a[k] - expected(x, y)) < 1e-5f;
+                }
+                tail_untouched &= a[n] == 0.25f * n + 1.f;
+            };
+            fill();
+            block::Gain(a, 2.f, 1, n);
+            check([](float x, float) { return 2.f * x; });
+            fill();
+            block::Accum(a, b, 1, n);
+            check([](float x, float y) { return x + y; });
+            fill();
+            block::Subtract(a, b, 1, n);
+            check([](float x, float y) { return x - y; });
+            fill();
+            block::AccumGain(a, b, 0.5f, 1, n);
+            check([](float x, float y) { return x + 0.5f * y; });
+            fill();
+            block::Mix(a, b, 0.25f, 2.f, 1, n);
+            check([](float x, float y) { return 0.25f * x + 2.f * y; });
+            fill();
+            block::ApplyFn(a, SquareFn(), 1, n);
+            check([](float x, float) { return x * x; });
+            fill();
+            block::ApplyFn(a, Halve, 1, n);
+            check([](float x, float) { return 0.5f * x; });
+        }
+    }
+    CHECK(all_match);
+    CHECK(tail_untouched);
+}
+
+
+TEST_CASE( "Fused block expressions", "[Block]" ) {
+
+    using V = DSP::SIMD;
+    const unsigned int max_n = 3 * V::kWidth + 3;
+    std::vector<float> a(max_n + 1), b(max_n + 1), c(max_n + 1);
+    std::vector<float> out(max_n + 1), ref(max_n + 1);
+    for (unsigned int k = 0; k <= max_n; k++) {
+        a[k] = 0.25f * k - 1.f;
+        b[k] = 3.f - 0.5f * k;
+        c[k] = std::sin(0.7f * k);
+    }
+    float e = 0;
+    bool tail_untouched = true;
+    auto compare = [&](unsigned int n) {
+        for (unsigned int k = 0; k < n; k++) {
+            e = std::max(e, std::abs(out[k] - ref[k]));
+        }
+        tail_untouched &= out[n] == -7.f;
+    };
+
+    for (unsigned int n = 0; n <= max_n; n++) {
+        // Against the passes it fuses
+        std::fill(out.begin(), out.end(), -7.f);
+        std::copy(a.begin(), a.begin() + n, ref.begin());
+        std::vector<float> tmp(b);
+        block::Mix(ref.data(), tmp.data(), 0.5f, 2.f, 1, n);
+        block::Accum(ref.data(), c.data(), 1, n);
+        blockout(out.data(), 1, n) =
+            blockin(a.data()) * 0.5f + 2.0 * blockin(b.data()) +
+            blockin(c.data());
+        compare(n);
+
+        // In place, every operator
+        std::copy(a.begin(), a.begin() + n, out.begin());
+        for (unsigned int k = 0; k < n; k++) {
+            float x = std::min(std::abs(a[k] - b[k]), 2.f);
+            ref[k] = std::max(a[k] - 0.5f * x, -c[k]) * 0.25f;
+        }
+        blockout o(out.data(), 1, n);
+        o -= 0.5f * Min(Abs(blockin(a.data()) - blockin(b.data())), 2.f);
+        o = Max(o, -blockin(c.data()));
+        o *= 0.25f;
+        compare(n);
+
+        // Constant and copy
+        blockout(out.data(), 1, n) = 1.5f;
+        std::fill(ref.begin(), ref.begin() + n, 1.5f);
+        compare(n);
+        blockout(ref.data(), 1, n) = blockout(c.data(), 1, n);
+        std::copy(c.begin(), c.begin() + n, out.begin());
+        compare(n);
+    }
+    CHECK(e < 1e-5f);
+    CHECK(tail_untouched);
+}
+
+
+TEST_CASE( "Fused block expressions against passes",
+        "[.][benchmark][Block]" ) {
+
+    const unsigned int n = 1 << 16;
+    const unsigned int n_runs = 200;
+    std::vector<float> a(n, 0.1f), b(n, 0.2f), c(n, 0.3f), out(n);
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < n_runs; r++) {
+        std::copy(a.begin(), a.end(), out.begin());
+        block::Mix(out.data(), b.data(), 0.5f, 0.25f, 1, n);
+        block::Accum(out.data(), c.data(), 1, n);
+    }
+    std::chrono::duration<double> passes =
+        std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < n_runs; r++) {
+        blockout(out.data(), 1, n) = blockin(a.data()) * 0.5f +
+            blockin(b.data()) * 0.25f + blockin(c.data());
+    }
+    std::chrono::duration<double> fused =
+        std::chrono::steady_clock::now() - start;
+    printf("a * g1 + b * g2 + c: %.3f ns per float in passes, "
+        "%.3f fused\n", 1e9 * passes.count() / (n * n_runs),
+        1e9 * fused.count() / (n * n_runs));
+    CHECK(out[n - 1] == Approx(0.1f * 0.5f + 0.2f * 0.25f + 0.3f));
+}
+
+
+TEST_CASE( "Block transcendentals", "[Math]" ) {
+
+    // Odd length, for the tail
+    const unsigned int n = 1001;
+    std::vector<float> x(n), y(n), z(n);
+
+    SECTION( "Both tiers match the standard library" ) {
+        const dspmath::Accuracy tiers[2] = { dspmath::kFast,
+            dspmath::kPrecise };
+        const float max_rel[2] = { 0.06f, 1e-5f };
+        const float max_abs[2] = { 0.06f, 1e-5f };
+        const float max_db[2] = { 0.35f, 1e-4f };
+        for (unsigned int t = 0; t < 2; t++) {
+            float e_pow2 = 0, e_exp = 0, e_log2 = 0, e_ln = 0, e_db = 0;
+            for (unsigned int k = 0; k < n; k++) {
+                x[k] = -80.f + 160.f * k / (n - 1);
+            }
+            dspmath::FastPow2Block(x.data(), y.data(), n, tiers[t]);
+            dspmath::FastExpBlock(x.data(), z.data(), n, tiers[t]);
+            for (unsigned int k = 0; k < n; k++) {
+                e_pow2 = std::max(e_pow2, std::abs(y[k] /
+                    std::exp2(x[k]) - 1.f));
+                e_exp = std::max(e_exp, std::abs(z[k] /
+                    std::exp(x[k]) - 1.f));
+            }
+            for (unsigned int k = 0; k < n; k++) {
+                x[k] = std::exp2(-120.f + 240.f * k / (n - 1));
+            }
+            dspmath::FastLog2Block(x.data(), y.data(), n, tiers[t]);
+            dspmath::FastLnBlock(x.data(), z.data(), n, tiers[t]);
+            for (unsigned int k = 0; k < n; k++) {
+                e_log2 = std::max(e_log2, std::abs(y[k] - std::log2(x[k])));
+                e_ln = std::max(e_ln, std::abs(z[k] - std::log(x[k])));
+            }
+            // dB round trip
+            for (unsigned int k = 0; k < n; k++) {
+                x[k] = -100.f + 120.f * k / (n - 1);
+            }
+            dspmath::dBToLinBlock(x.data(), y.data(), n, tiers[t]);
+            dspmath::LinTodBBlock(y.data(), z.data(), n, tiers[t]);
+            for (unsigned int k = 0; k < n; k++) {
+                e_db = std::max(e_db, std::abs(20.f * std::log10(y[k]) -
+                    x[k]));
+            }
+            CHECK(e_pow2 < max_rel[t]);
+            CHECK(e_exp < max_rel[t]);
+            CHECK(e_log2 < max_abs[t]);
+            CHECK(e_ln < max_abs[t]);
+            CHECK(e_db < max_db[t]);
+            // Each tier's scalar and block versions agree
+            for (unsigned int k = 0; k < n; k++) {
+                REQUIRE(z[k] == Approx(dspmath::LinTodB(y[k], tiers[t]))
+                    .margin(1e-4));
+            }
+        }
+        // The one-argument functions are the fast tier
+        CHECK(dspmath::FastLog2(3.f, dspmath::kFast) ==
+            dspmath::FastLog2(3.f));
+        CHECK(dspmath::FastPow10(1.f, dspmath::kFast) ==
+            Approx(dspmath::FastPow10(1.f)));
+    }
+
+    SECTION( "Any input gives a normal, finite output" ) {
+        const float odd[] = { 0.f, -0.f, -1.f, 1e-42f, -1e-42f,
+            INFINITY, -INFINITY, 1e30f, -1e30f, 1.f };
+        const unsigned int n_odd = sizeof(odd) / sizeof(odd[0]);
+        for (unsigned int t = 0; t < 2; t++) {
+            dspmath::Accuracy tier = static_cast<dspmath::Accuracy>(t);
+            float out[n_odd];
+            dspmath::FastLog2Block(odd, out, n_odd, tier);
+            for (unsigned int k = 0; k < n_odd; k++) {
+                CHECK(std::isfinite(out[k]));
+                CHECK(out[k] >= -126.1f);
+            }
+            dspmath::FastExpBlock(odd, out, n_odd, tier);
+            for (unsigned int k = 0; k < n_odd; k++) {
+                CHECK(std::isnormal(out[k]));
+            }
+            // Below -90 dB or so the amp mutes: still nothing denormal
+            CHECK(std::isnormal(dspmath::dBToLin(-1000.f, tier)));
+        }
+    }
+
+    SECTION( "In place, any length" ) {
+        for (unsigned int len = 0; len < 20; len++) {
+            for (unsigned int k = 0; k < len; k++) {
+                x[k] = 0.25f * k;
+                y[k] = x[k];
+            }
+            y[len] = -7.f;
+            dspmath::FastPow10Block(y.data(), y.data(), len, dspmath::kPrecise);
+            dspmath::FastLog10Block(y.data(), y.data(), len,
+                dspmath::kPrecise);
+            for (unsigned int k = 0; k < len; k++) {
+                REQUIRE(y[k] == Approx(x[k]).margin(1e-5));
+            }
+            REQUIRE(y[len] == -7.f);
+        }
+    }
+}
+
+
+TEST_CASE( "Transcendentals against the standard library",
+        "[.][benchmark][Math]" ) {
+
+    const unsigned int n = 1 << 16;
+    const unsigned int n_runs = 100;
+    std::vector<float> x(n), y(n);
+    for (unsigned int k = 0; k < n; k++) {
+        x[k] = -60.f + 60.f * k / n;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < n_runs; r++) {
+        for (unsigned int k = 0; k < n; k++) {
+            y[k] = powf(10.f, x[k] * 0.05f);
+        }
+    }
+    std::chrono::duration<double> libm =
+        std::chrono::steady_clock::now() - start;
+    float check = y[n / 2];
+    start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < n_runs; r++) {
+        dspmath::dBToLinBlock(x.data(), y.data(), n, dspmath::kFast);
+    }
+    std::chrono::duration<double> fast =
+        std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < n_runs; r++) {
+        dspmath::dBToLinBlock(x.data(), y.data(), n, dspmath::kPrecise);
+    }
+    std::chrono::duration<double> precise =
+        std::chrono::steady_clock::now() - start;
+    printf("dB to linear: %.3f ns per float with powf, %.3f fast, "
+        "%.3f precise\n", 1e9 * libm.count() / (n * n_runs),
+        1e9 * fast.count() / (n * n_runs),
+        1e9 * precise.count() / (n * n_runs));
+    CHECK(y[n / 2] == Approx(check));
+}
+
+
+// Amplitude of the component at frequency w (rad/sample) in x, over a
+// whole number of periods of w
+static float ToneAmplitude(const float *x, unsigned int n, double w) {
+    double re = 0, im = 0;
+    for (unsigned int k = 0; k < n; k++) {
+        re += x[k] * std::cos(w * k);
+        im += x[k] * std::sin(w * k);
+    }
+    return 2. * std::sqrt(re * re + im * im) / n;
+}
+
+
+TEST_CASE( "Oversampled waveshaping", "[Waveshaper]" ) {
+
+    const float fs = 48000.f;
+    const unsigned int max_block = 100;
+    const unsigned int n = 4800;
+    std::vector<float> x(n), y(n);
+
+    SECTION( "Oversampling alone is a delay" ) {
+        // The default table is a straight line
+        const double w = 2. * M_PI * 1000. / fs;
+        for (unsigned int k = 0; k < n; k++) {
+            x[k] = 0.5f * std::sin(w * k);
+        }
+        for (unsigned int os = 1; os <= 4; os *= 2) {
+            std::vector<char> mem(waveshaper::GetMemSize(os, max_block));
+            waveshaper ws(os, max_block, mem.data());
+            ws.SetShape(waveshaper::kTable);
+            CHECK(ws.GetOversampling() == os);
+            for (unsigned int k = 0; k < n; k += max_block) {
+                ws.Process(x.data() + k, y.data() + k, max_block);
+            }
+            float e = 0;
+            for (unsigned int k = 200; k < n; k++) {
+                e = std::max(e, std::abs(y[k] - 0.5f * static_cast<float>(
+                    std::sin(w * (k - ws.GetLatency())))));
+            }
+            CHECK(e < 1e-3f);
+        }
+    }
+
+    SECTION( "Harmonics don't alias" ) {
+        // A full-scale sine through T5 is all 5th harmonic: from 7.2 kHz,
+        // 36 kHz folds back to 12 kHz at the base rate
+        const double w = 2. * M_PI * 7200. / fs;
+        const double w_alias = 2. * M_PI * 12000. / fs;
+        for (unsigned int k = 0; k < n; k++) {
+            x[k] = std::cos(w * k);
+        }
+        for (unsigned int os = 1; os <= 4; os *= 2) {
+            std::vector<char> mem(waveshaper::GetMemSize(os, max_block));
+            waveshaper ws(os, max_block, mem.data());
+            ws.SetShape(waveshaper::kChebyshev5);
+            for (unsigned int k = 0; k < n; k += max_block) {
+                ws.Process(x.data() + k, y.data() + k, max_block);
+            }
+            float alias = ToneAmplitude(y.data() + 800, 4000, w_alias);
+            if (os == 1) {
+                CHECK(alias == Approx(1.f).margin(1e-3));
+            } else {
+                CHECK(alias < 1e-3f);
+            }
+        }
+    }
+
+    SECTION( "Shapes" ) {
+        std::vector<char> mem(waveshaper::GetMemSize(1, n));
+        waveshaper ws(1, n, mem.data());
+        for (unsigned int k = 0; k < n; k++) {
+            x[k] = -2.f + 4.f * k / (n - 1);
+        }
+        // Sigmoid: odd, rising, saturating
+        ws.SetDrive(2.f);
+        ws.Process(x.data(), y.data(), n);
+        for (unsigned int k = 1; k < n; k++) {
+            REQUIRE(y[k] >= y[k - 1] - 1e-6f);
+            REQUIRE(std::abs(y[k]) <= 1.f + 1e-6f);
+            REQUIRE(y[k] == Approx(-y[n - 1 - k]).margin(1e-6));
+        }
+        CHECK(y[n - 1] == 1.f);
+        CHECK(y[n / 2] == Approx(std::tanh(2.f * x[n / 2])).margin(0.03));
+        // Remainder: the crushed signal plus its error, scaled
+        ws.SetShape(waveshaper::kRemainder);
+        ws.SetDrive(1.f);
+        ws.SetRemainder(4, 1.f);
+        ws.Process(x.data(), y.data(), n);
+        for (unsigned int k = 0; k < n; k++) {
+            REQUIRE(y[k] == Approx(x[k]).margin(1e-6));
+        }
+        ws.SetRemainder(4, 0.f);
+        ws.Process(x.data(), y.data(), n);
+        for (unsigned int k = 0; k < n; k++) {
+            REQUIRE(std::abs(y[k] - x[k]) <= 0.0625f + 1e-6f);
+            REQUIRE(y[k] * 8.f == std::round(y[k] * 8.f));
+        }
+        // Table: clamped to its ends
+        ws.SetShape(waveshaper::kTable);
+        ws.SetTable([](float v) { return v * v; });
+        ws.Process(x.data(), y.data(), n);
+        for (unsigned int k = 0; k < n; k++) {
+            float v = std::min(std::max(x[k], -1.f), 1.f);
+            REQUIRE(y[k] == Approx(v * v).margin(1e-4));
+        }
+    }
+
+    SECTION( "Any block size, in place" ) {
+        for (unsigned int k = 0; k < n; k++) {
+            x[k] = 0.8f * std::sin(0.01f * k) + 0.3f * std::sin(0.37f * k);
+        }
+        std::vector<char> mem_a(waveshaper::GetMemSize(4, n));
+        std::vector<char> mem_b(waveshaper::GetMemSize(4, 17));
+        waveshaper a(4, n, mem_a.data()), b(4, 17, mem_b.data());
+        // (A continuous shape: vector and scalar tails round differently)
+        a.SetDrive(3.f);
+        b.SetDrive(3.f);
+        a.Process(x.data(), y.data(), n);
+        for (unsigned int k = 0, len = 1; k < n; k += len, len = len % 17 + 1) {
+            len = std::min(len, n - k);
+            b.Process(x.data() + k, x.data() + k, len);
+        }
+        for (unsigned int k = 0; k < n; k++) {
+            REQUIRE(x[k] == Approx(y[k]).margin(1e-5));
+        }
+    }
+}
+
+
+TEST_CASE( "Waveshaper cost", "[.][benchmark][Waveshaper]" ) {
+
+    const unsigned int block = 128;
+    const unsigned int n_blocks = 4000;
+    std::vector<float> x(block), y(block);
+    for (unsigned int k = 0; k < block; k++) {
+        x[k] = std::sin(0.05f * k);
+    }
+    for (unsigned int os = 1; os <= 4; os *= 2) {
+        std::vector<char> mem(waveshaper::GetMemSize(os, block));
+        waveshaper ws(os, block, mem.data());
+        ws.SetShape(waveshaper::kChebyshev5);
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int b = 0; b < n_blocks; b++) {
+            ws.Process(x.data(), y.data(), block);
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        printf("Chebyshev-5, %ux: %.2f ns per sample\n", os,
+            1e9 * elapsed.count() / (block * n_blocks));
+        CHECK(std::isfinite(y[0]));
+    }
+}
+
+
+TEST_CASE( "Every instruction set's kernels match the build's", "[Dispatch]" ) {
+
+    const dispatch::ISA best = dispatch::GetISA();
+    REQUIRE(dispatch::IsAvailable(best));
+    CHECK(dispatch::IsAvailable(dispatch::kBaseline));
+    CHECK(!dispatch::SetISA(dispatch::kNumISAs));
+
+    const unsigned int n_samples = 203;  // Whole vectors and a tail
+    const unsigned int n_sections = 5;
+    biquadcoeffs c[n_sections];
+    for (unsigned int n = 0; n < n_sections; n++) {
+        filterdesigner::ResonantLowpass(&c[n], 44100.f, 1500.f * (n + 1),
+            0.8f, 1.f);
+    }
+    std::vector<float> x(3 * n_samples);
+    for (unsigned int k = 0; k < x.size(); k++) {
+        x[k] = std::sin(0.37f * k) + ((k % 17 == 0) ? 1.f : 0.f);
+    }
+
+    // Everything each instruction set runs, as one vector
+    auto run_all = [&]() {
+        std::vector<float> out;
+        std::vector<float> y(x.begin(), x.begin() + n_samples);
+        block::Mix(y.data(), x.data() + 1, 0.5f, 2.f, 1, n_samples);
+        block::AccumGain(y.data() + 1, x.data(), 0.25f, 1, n_samples - 1);
+        out.insert(out.end(), y.begin(), y.end());
+        DSP::Biquad<1>::State s1[n_sections];
+        DSP::Biquad<1> mono(n_sections, c, s1);
+        y.assign(x.begin(), x.begin() + n_samples);
+        mono.ProcessBuffer(y.data(), n_samples);
+        out.insert(out.end(), y.begin(), y.end());
+        DSP::Biquad<3>::State s3[n_sections];
+        DSP::Biquad<3> axes(n_sections, c, s3);
+        axes.SetForm(DSP::Biquad<3>::kTDF2);
+        y = x;
+        axes.ProcessBuffer(y.data(), n_samples);
+        out.insert(out.end(), y.begin(), y.end());
+        // The mesh binds its stencil kernel when set up
+        mesh::Properties p { 60.f, 45.f, 3.f };
+        std::vector<char> mem(mesh::GetMemSize(p));
+        mesh m(p, mem.data());
+        m.SetKernel(mesh::kKernelStencil);
+        m.ApplyMask(Geometries::CircularMembrane(22.f));
+        m.DampRegion(20.f, 25.f, 6.f, 0.3f);
+        m.SetSource(25.f, 20.f);
+        m.SetPickup(38.f, 27.f);
+        y.resize(4 * n_samples);
+        m.RenderImpulseResponse(y.data(), y.size());
+        out.insert(out.end(), y.begin(), y.end());
+        return out;
+    };
+
+    REQUIRE(dispatch::SetISA(dispatch::kBaseline));
+    std::vector<float> ref = run_all();
+    for (int i = dispatch::kBaseline + 1; i < dispatch::kNumISAs; i++) {
+        dispatch::ISA isa = static_cast<dispatch::ISA>(i);
+        if (!dispatch::SetISA(isa)) {
+            continue;
+        }
+        INFO(dispatch::GetISAName(isa));
+        std::vector<float> out = run_all();
+        // Fused multiply-adds round differently
+        float e = 0;
+        for (unsigned int k = 0; k < out.size(); k++) {
+            e = std::max(e, std::abs(out[k] - ref[k]));
+        }
+        CHECK(e < 1e-4f);
+    }
+    dispatch::SetISA(best);
+}
+
+
+TEST_CASE( "Biquad throughput", "[.][benchmark][Biquad]" ) {
+
+    const unsigned int n_sections = 4;
+    const unsigned int n_samples = 44100;
+    biquadcoeffs c[n_sections];
+    for (unsigned int n = 0; n < n_sections; n++) {
+        filterdesigner::ResonantLowpass(&c[n], 44100.f, 1000.f * (n + 1),
+            0.7f, 1.f);
+    }
+    DSP::Biquad<8>::State s[n_sections];
+    DSP::Biquad<8> f(n_sections, c, s);
+    std::vector<float> x(n_samples * 8, 0.1f);
+    auto start = std::chrono::steady_clock::now();
+    f.ProcessBuffer(x.data(), n_samples);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("8 channels, %u sections: %.2f ns per frame\n", n_sections,
+        1e9 * elapsed.count() / n_samples);
+    CHECK(elapsed.count() < 1.);
+
+    // Mono: sections pipelined across lanes
+    DSP::Biquad<1>::State s_mono[n_sections];
+    DSP::Biquad<1> mono(n_sections, c, s_mono);
+    start = std::chrono::steady_clock::now();
+    mono.ProcessBuffer(x.data(), n_samples);
+    elapsed = std::chrono::steady_clock::now() - start;
+    printf("Mono, %u sections: %.2f ns per sample\n", n_sections,
+        1e9 * elapsed.count() / n_samples);
+    CHECK(elapsed.count() < 1.);
+}
+
+
 TEST_CASE("Just check filter's doing something", "[ARSmoother]") {
     unsigned int n;
 
@@ -191,6 +2801,106 @@ TEST_CASE("Just check filter's doing something", "[ARSmoother]") {
 }
 
 
+TEST_CASE( "Block and multichannel smoothing", "[ARSmoother]" ) {
+
+    const float fs = 48000.f;
+    const unsigned int n = 2000;
+    std::vector<float> x(n);
+    for (unsigned int k = 0; k < n; k++) {
+        x[k] = std::abs(std::sin(0.003f * k)) * (k % 700 < 300);
+    }
+
+    SECTION( "Time constants" ) {
+        CHECK(arsmoother::GetAlpha(0.f, fs) == 1.f);
+        arsmoother smoother(1.f, 1.f);
+        smoother.SetTimes(1.f, 10.f, fs);
+        // 48 samples of attack, 480 of release, to 1 - 1/e of a step
+        float y = 0;
+        for (unsigned int k = 0; k < 48; k++) {
+            y = smoother.ProcessSample(1.f);
+        }
+        CHECK(y == Approx(1.f - std::exp(-1.f)).margin(1e-3));
+        for (unsigned int k = 0; k < 480; k++) {
+            y = smoother.ProcessSample(0.f);
+        }
+        CHECK(y == Approx((1.f - std::exp(-1.f)) * std::exp(-1.f))
+            .margin(1e-3));
+    }
+
+    SECTION( "Buffers match samples" ) {
+        arsmoother a(0.1f, 0.01f), b(0.1f, 0.01f);
+        std::vector<float> y(x);
+        b.ProcessBuffer(y.data(), y.data(), n);
+        for (unsigned int k = 0; k < n; k++) {
+            REQUIRE(y[k] == a.ProcessSample(x[k]));
+        }
+    }
+
+    SECTION( "Every channel matches its own smoother" ) {
+        // Whole vectors and leftovers, any width
+        const unsigned int n_ch = 19;
+        std::vector<arsmoother> mono;
+        DSP::ARSmootherBank<n_ch>::State s;
+        DSP::ARSmootherBank<n_ch> bank(0.1f, 0.01f, &s);
+        std::vector<float> frames(n * n_ch), expected(n * n_ch);
+        for (unsigned int ch = 0; ch < n_ch; ch++) {
+            mono.push_back(arsmoother(1.f, 1.f));
+            mono[ch].SetTimes(0.5f + ch, 5.f + 3.f * ch, fs);
+            bank.SetTimes(ch, 0.5f + ch, 5.f + 3.f * ch, fs);
+            for (unsigned int k = 0; k < n; k++) {
+                frames[k * n_ch + ch] = x[(k + 37 * ch) % n];
+                expected[k * n_ch + ch] =
+                    mono[ch].ProcessSample(frames[k * n_ch + ch]);
+            }
+        }
+        // Half a buffer in place, then frame by frame
+        bank.ProcessBuffer(frames.data(), frames.data(), n / 2);
+        for (unsigned int k = n / 2; k < n; k++) {
+            bank.ProcessFrame(&frames[k * n_ch]);
+        }
+        for (unsigned int k = 0; k < n * n_ch; k++) {
+            REQUIRE(frames[k] == Approx(expected[k]).margin(1e-6));
+        }
+        bank.Reset();
+        float zero[n_ch] = { 0 };
+        bank.ProcessFrame(zero);
+        CHECK(zero[n_ch - 1] == 0.f);
+    }
+}
+
+
+TEST_CASE( "Envelope bank cost", "[.][benchmark][ARSmoother]" ) {
+
+    const unsigned int n_ch = 16;
+    const unsigned int n_samples = 48000;
+    std::vector<float> x(n_samples * n_ch);
+    for (unsigned int k = 0; k < x.size(); k++) {
+        x[k] = std::abs(std::sin(0.001f * k));
+    }
+    std::vector<float> y(x);
+    std::vector<arsmoother> mono(n_ch, arsmoother(0.01f, 0.001f));
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int k = 0; k < n_samples; k++) {
+        for (unsigned int ch = 0; ch < n_ch; ch++) {
+            y[k * n_ch + ch] = mono[ch].ProcessSample(x[k * n_ch + ch]);
+        }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("%u ARSmoothers: %.2f ns per frame\n", n_ch,
+        1e9 * elapsed.count() / n_samples);
+
+    DSP::ARSmootherBank<n_ch>::State s;
+    DSP::ARSmootherBank<n_ch> bank(0.01f, 0.001f, &s);
+    start = std::chrono::steady_clock::now();
+    bank.ProcessBuffer(x.data(), x.data(), n_samples);
+    elapsed = std::chrono::steady_clock::now() - start;
+    printf("ARSmootherBank of %u: %.2f ns per frame\n", n_ch,
+        1e9 * elapsed.count() / n_samples);
+    CHECK(x.back() == Approx(y.back()).margin(1e-5));
+}
+
+
 #endif  // defined(CATCH2_TEST)
 
 #endif  // !defined(PYTHON_WRAPPER)
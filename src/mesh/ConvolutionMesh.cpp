@@ -0,0 +1,218 @@
+/**
+ * @file ConvolutionMesh.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-28
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "ConvolutionMesh.hpp"
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+
+const std::vector<float> *MeshIRCache::Find(uint64_t key) {
+    auto it = irs_.find(key);
+    return (it == irs_.end()) ? nullptr : &it->second;
+}
+
+
+const std::vector<float> &MeshIRCache::Store(uint64_t key, const float *ir,
+        unsigned int length) {
+    std::vector<float> &stored = irs_[key];
+    stored.assign(ir, ir + length);
+    return stored;
+}
+
+
+void MeshIRCache::Clear() {
+    irs_.clear();
+}
+
+
+size_t ConvolutionMesh::GetMemSize(Triangular2DMesh::Properties p,
+        Settings s) {
+    return Triangular2DMesh::GetMemSize(p)
+        + DSP::PartitionedConvolver::GetMemSize(s.block_size, s.max_ir_length)
+        + (s.max_ir_length + s.block_size) * sizeof(float);
+}
+
+
+ConvolutionMesh::ConvolutionMesh(Triangular2DMesh &mesh, MeshIRCache &cache,
+        Settings s, void *mem) :
+        mesh_(mesh),
+        cache_(cache),
+        s_(s),
+        capture_mesh_(mesh.GetProperties(), mem),
+        convolver_(s.block_size, s.max_ir_length,
+            reinterpret_cast<char *>(mem)
+            + Triangular2DMesh::GetMemSize(mesh.GetProperties())) {
+
+    char *base = reinterpret_cast<char *>(mem)
+        + Triangular2DMesh::GetMemSize(mesh.GetProperties())
+        + DSP::PartitionedConvolver::GetMemSize(s.block_size,
+            s.max_ir_length);
+    scratch_ = reinterpret_cast<float *>(base);
+    block_ = scratch_ + s.max_ir_length;
+
+    // Nothing set through this class yet: first setter always counts
+    source_x_ = source_y_ = std::numeric_limits<float>::quiet_NaN();
+    pickup_x_ = pickup_y_ = std::numeric_limits<float>::quiet_NaN();
+    mu_ = std::numeric_limits<float>::quiet_NaN();
+
+    Reset();
+}
+
+
+void ConvolutionMesh::Reset() {
+    mesh_.Reset();
+    convolver_.Reset();
+    mode_ = kLive;
+    mesh_tail_left_ = 0;
+    conv_tail_left_ = 0;
+    blocks_since_change_ = 0;
+}
+
+
+void ConvolutionMesh::Changed_() {
+    if (mode_ == kConvolving) {
+        // Convolver rings out what it has been fed, the mesh takes over
+        // (it may still be ringing itself, which is fine: it's live now)
+        mode_ = kLive;
+        conv_tail_left_ = convolver_.GetLength();
+        mesh_tail_left_ = 0;
+    }
+    blocks_since_change_ = 0;
+}
+
+
+void ConvolutionMesh::SetSource(float x, float y) {
+    if (x != source_x_ || y != source_y_) {
+        mesh_.SetSource(x, y);
+        source_x_ = x;
+        source_y_ = y;
+        Changed_();
+    }
+}
+
+
+void ConvolutionMesh::SetPickup(float x, float y) {
+    if (x != pickup_x_ || y != pickup_y_) {
+        mesh_.SetPickup(x, y);
+        pickup_x_ = x;
+        pickup_y_ = y;
+        Changed_();
+    }
+}
+
+
+void ConvolutionMesh::SetAttenuation(float mu) {
+    if (mu != mu_) {
+        mesh_.SetAttenuation(mu);
+        mu_ = mu;
+        Changed_();
+    }
+}
+
+
+void ConvolutionMesh::NotifyConfigurationChanged() {
+    Changed_();
+}
+
+
+bool ConvolutionMesh::Update() {
+
+    if (mode_ == kConvolving) {
+        return true;
+    }
+    // Wait for parameters to settle, and for the convolver to be done
+    // with the previous response's tail
+    if (blocks_since_change_ < s_.settle_blocks || conv_tail_left_ > 0) {
+        return false;
+    }
+    // A nonlinear mesh has no impulse response to stand in for it
+    if (!mesh_.IsLinear()) {
+        return false;
+    }
+
+    capture_mesh_.CopyConfiguration(mesh_);
+    uint64_t key = capture_mesh_.GetConfigurationHash();
+    const std::vector<float> *ir = cache_.Find(key);
+    if (ir == nullptr) {
+        capture_mesh_.RenderImpulseResponse(scratch_, s_.max_ir_length);
+        unsigned int length = TruncateByEnergy(scratch_, s_.max_ir_length,
+            s_.energy_threshold);
+        ir = &cache_.Store(key, scratch_, length);
+    }
+
+    convolver_.SetImpulseResponse(ir->data(), ir->size());
+    convolver_.Reset();
+    mode_ = kConvolving;
+    // Mesh rings out for as long as the response is considered audible
+    mesh_tail_left_ = ir->size();
+
+    return true;
+}
+
+
+void ConvolutionMesh::ProcessBlock(const float *in, float *out) {
+
+    const unsigned int n_samples = s_.block_size;
+
+    if (mode_ == kLive) {
+        for (unsigned int n = 0; n < n_samples; n++) {
+            out[n] = mesh_.ProcessSample(true, in[n]);
+        }
+        if (conv_tail_left_ > 0) {
+            memset(block_, 0, sizeof(float) * n_samples);
+            convolver_.ProcessBlock(block_, block_);
+            for (unsigned int n = 0; n < n_samples; n++) {
+                out[n] += block_[n];
+            }
+            conv_tail_left_ = (conv_tail_left_ > n_samples) ?
+                conv_tail_left_ - n_samples : 0;
+        }
+        if (blocks_since_change_ < s_.settle_blocks) {
+            blocks_since_change_++;
+        }
+    } else {
+        convolver_.ProcessBlock(in, out);
+        if (mesh_tail_left_ > 0) {
+            for (unsigned int n = 0; n < n_samples; n++) {
+                out[n] += mesh_.ProcessSample(true, 0);
+            }
+            mesh_tail_left_ = (mesh_tail_left_ > n_samples) ?
+                mesh_tail_left_ - n_samples : 0;
+            if (mesh_tail_left_ == 0) {
+                // Whatever is left is below the truncation threshold
+                mesh_.Reset();
+            }
+        }
+    }
+}
+
+
+unsigned int ConvolutionMesh::TruncateByEnergy(const float *ir,
+        unsigned int length, float threshold) {
+
+    double total = 0;
+    for (unsigned int n = 0; n < length; n++) {
+        total += static_cast<double>(ir[n]) * ir[n];
+    }
+    const double allowed = threshold * total;
+    double tail = 0;
+    unsigned int cut = length;
+    while (cut > 1) {
+        double next = tail + static_cast<double>(ir[cut - 1]) * ir[cut - 1];
+        if (next > allowed) {
+            break;
+        }
+        tail = next;
+        cut--;
+    }
+    return cut;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file ConvolutionMesh.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-28
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __CONVOLUTION_MESH_HPP__
+#define __CONVOLUTION_MESH_HPP__
+
+#include <map>
+#include <vector>
+#include "Triangular2DMesh.hpp"
+#include "PartitionedConvolver.hpp"
+
+
+/**
+ * @brief Impulse responses of mesh configurations, keyed by
+ * Triangular2DMesh::GetConfigurationHash(). Heap-allocated: fill it
+ * outside the audio thread.
+ */
+class MeshIRCache {
+
+ public:
+    const std::vector<float> *Find(uint64_t key);
+    const std::vector<float> &Store(uint64_t key, const float *ir,
+        unsigned int length);
+    void Clear();
+    size_t GetSize() { return irs_.size(); }
+
+ protected:
+    std::map<uint64_t, std::vector<float>> irs_;
+};
+
+
+/**
+ * @brief Runs a mesh as a convolution with its own impulse response
+ * whenever its configuration is standing still.
+ *
+ * With source, pickup, mask and attenuation fixed, the mesh is just an
+ * LTI filter: once the parameters settle, Update() renders the impulse
+ * response (on a private copy of the mesh, so the live one keeps ringing),
+ * truncates it by energy, caches it, and hands over to a partitioned FFT
+ * convolver. Changing a parameter hands back to the live mesh.
+ *
+ * Hand-overs are click-free: the engine that is switched off stops
+ * receiving input but keeps ringing until its tail (bounded by the
+ * impulse response length) has run out.
+ *
+ * ProcessBlock() and the setters are real-time safe. Update() isn't: call
+ * it from the same thread between blocks (e.g. once per block when the
+ * host allows, or from setup), never concurrently with ProcessBlock().
+ */
+class ConvolutionMesh {
+
+ public:
+
+    struct Settings {
+        unsigned int block_size;  // Fixed host block size (power of 2)
+        unsigned int max_ir_length;  // Samples
+        float energy_threshold;  // Tail energy dropped, relative to total
+        unsigned int settle_blocks;  // Blocks without changes before Update()
+    };
+
+    enum Mode {
+        kLive,
+        kConvolving,
+    };
+
+    /**
+     * @brief Memory needed on top of the live mesh's
+     *
+     * @param p Properties of the live mesh
+     * @param s Engine settings
+     * @return size_t Bytes
+     */
+    static size_t GetMemSize(Triangular2DMesh::Properties p, Settings s);
+    /**
+     * @brief Construct a new ConvolutionMesh around a live mesh
+     *
+     * @param mesh Live mesh, already configured
+     * @param cache Impulse response cache (can be shared)
+     * @param s Engine settings
+     * @param mem Memory of GetMemSize() bytes. Allocate externally.
+     */
+    ConvolutionMesh(Triangular2DMesh &mesh, MeshIRCache &cache, Settings s,
+        void *mem);
+    void Reset();
+    void SetSource(float x, float y);
+    void SetPickup(float x, float y);
+    void SetAttenuation(float mu);
+    /**
+     * @brief Call after changing the live mesh's mask (or anything else
+     * not covered by the setters here) directly. A mesh with tension
+     * modulation on is never convolved.
+     *
+     */
+    void NotifyConfigurationChanged();
+    /**
+     * @brief Capture the impulse response and switch to convolution, if
+     * parameters have settled. Not real-time safe.
+     *
+     * @return true if the engine is (now) convolving
+     */
+    bool Update();
+    /**
+     * @brief Process one block of block_size samples (in-place allowed)
+     *
+     */
+    void ProcessBlock(const float *in, float *out);
+    Mode GetMode() { return mode_; }
+
+    /**
+     * @brief Shortest length that leaves at most threshold * (total energy)
+     * in the discarded tail
+     *
+     */
+    static unsigned int TruncateByEnergy(const float *ir, unsigned int length,
+        float threshold);
+
+ protected:
+
+    Triangular2DMesh &mesh_;
+    MeshIRCache &cache_;
+    Settings s_;
+    Triangular2DMesh capture_mesh_;
+    DSP::PartitionedConvolver convolver_;
+    float *scratch_;  // max_ir_length, for rendering
+    float *block_;  // block_size, silence or tail output
+    Mode mode_;
+    unsigned int mesh_tail_left_;
+    unsigned int conv_tail_left_;
+    unsigned int blocks_since_change_;
+    float source_x_;
+    float source_y_;
+    float pickup_x_;
+    float pickup_y_;
+    float mu_;
+
+    void Changed_();
+};
+
+
+#endif  // __CONVOLUTION_MESH_HPP__
@@ -0,0 +1,238 @@
+/**
+ * @file CoupledMeshSystem.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-19
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "CoupledMeshSystem.hpp"
+#include <cassert>
+#include <cstring>
+
+
+size_t CoupledMeshSystem::GetMemSize(unsigned int n_meshes,
+        unsigned int max_couplings) {
+    return n_meshes * sizeof(Triangular2DMesh *)
+        + 2 * max_couplings * sizeof(End_)
+        + n_meshes * sizeof(MeshEnds_)
+        + 2 * (2 * max_couplings) * sizeof(float);
+}
+
+
+CoupledMeshSystem::CoupledMeshSystem(Triangular2DMesh *const *meshes,
+        unsigned int n_meshes, unsigned int max_couplings, void *mem) :
+        n_meshes_(n_meshes),
+        max_ends_(2 * max_couplings),
+        n_ends_(0),
+        barrier_(n_meshes) {
+
+    assert(n_meshes > 0);
+    char *base = reinterpret_cast<char *>(mem);
+    meshes_ = reinterpret_cast<Triangular2DMesh **>(base);
+    base += n_meshes * sizeof(Triangular2DMesh *);
+    ends_ = reinterpret_cast<End_ *>(base);
+    base += max_ends_ * sizeof(End_);
+    mesh_ends_ = reinterpret_cast<MeshEnds_ *>(base);
+    base += n_meshes * sizeof(MeshEnds_);
+    waves_[0] = reinterpret_cast<float *>(base);
+    waves_[1] = waves_[0] + max_ends_;
+
+    for (unsigned int m = 0; m < n_meshes; m++) {
+        meshes_[m] = meshes[m];
+        assert(meshes_[m]->GetNumPorts() == 0);
+        mesh_ends_[m].n = 0;
+    }
+    Reset();
+}
+
+
+CoupledMeshSystem::~CoupledMeshSystem() {
+    StopThreads();
+}
+
+
+bool CoupledMeshSystem::AddCoupling(const Coupling &coupling) {
+
+    assert(!IsThreaded());
+    assert(coupling.mu >= 0.f);
+    assert(coupling.mu < 1.f);
+    if (n_ends_ + 2 > max_ends_ ||
+            coupling.mesh_a >= n_meshes_ || coupling.mesh_b >= n_meshes_) {
+        return false;
+    }
+    Triangular2DMesh &a = *meshes_[coupling.mesh_a];
+    Triangular2DMesh &b = *meshes_[coupling.mesh_b];
+    unsigned int ports_needed_a = (&a == &b) ? 2 : 1;
+    if (a.GetNumPorts() + ports_needed_a > Triangular2DMesh::kMaxPorts ||
+            b.GetNumPorts() + 1 > Triangular2DMesh::kMaxPorts ||
+            !a.IsInside(coupling.x_a, coupling.y_a) ||
+            !b.IsInside(coupling.x_b, coupling.y_b)) {
+        return false;
+    }
+
+    unsigned int e_a = AddEnd_(coupling.mesh_a, coupling.x_a, coupling.y_a,
+        coupling.admittance);
+    unsigned int e_b = AddEnd_(coupling.mesh_b, coupling.x_b, coupling.y_b,
+        coupling.admittance);
+    ends_[e_a].other_end = e_b;
+    ends_[e_a].gain = 1.f - coupling.mu;
+    ends_[e_b].other_end = e_a;
+    ends_[e_b].gain = 1.f - coupling.mu;
+
+    return true;
+}
+
+
+bool CoupledMeshSystem::AddLump(const Lump &lump) {
+
+    assert(!IsThreaded());
+    assert(lump.admittance > 0.f);
+    assert(lump.mass >= 0.f && lump.resistance >= 0.f &&
+        lump.stiffness >= 0.f);
+    if (n_ends_ + 1 > max_ends_ || lump.mesh >= n_meshes_) {
+        return false;
+    }
+    Triangular2DMesh &mesh = *meshes_[lump.mesh];
+    if (mesh.GetNumPorts() + 1 > Triangular2DMesh::kMaxPorts ||
+            !mesh.IsInside(lump.x, lump.y)) {
+        return false;
+    }
+
+    unsigned int e = AddEnd_(lump.mesh, lump.x, lump.y, lump.admittance);
+    End_ &end = ends_[e];
+    end.other_end = e;
+    end.gain = 1.f;
+    end.lump = true;
+    // Reflectance (Y - Z) / (Y + Z): times s, it's a ratio of quadratics
+    // in s, each term mapped by s = 2 (1 - z^-1) / (1 + z^-1)
+    const float k2 = 4.f * lump.mass;
+    const float k1_num = 2.f * (lump.resistance - lump.admittance);
+    const float k1_den = 2.f * (lump.resistance + lump.admittance);
+    const float k0 = lump.stiffness;
+    const float a0 = k2 + k1_den + k0;
+    end.reflectance.b0 = -(k2 + k1_num + k0) / a0;
+    end.reflectance.b1 = -(2.f * k0 - 2.f * k2) / a0;
+    end.reflectance.b2 = -(k2 - k1_num + k0) / a0;
+    end.reflectance.a1 = (2.f * k0 - 2.f * k2) / a0;
+    end.reflectance.a2 = (k2 - k1_den + k0) / a0;
+
+    return true;
+}
+
+
+unsigned int CoupledMeshSystem::AddEnd_(unsigned int m, float x, float y,
+        float admittance) {
+
+    unsigned int e = n_ends_++;
+    End_ &end = ends_[e];
+    end.mesh = m;
+    end.port = meshes_[m]->AddPort(x, y, admittance);
+    end.lump = false;
+    end.s1 = end.s2 = 0;
+    waves_[0][e] = waves_[1][e] = 0;
+    MeshEnds_ &mine = mesh_ends_[m];
+    mine.end[mine.n++] = e;
+    return e;
+}
+
+
+void CoupledMeshSystem::Reset() {
+    for (unsigned int m = 0; m < n_meshes_; m++) {
+        meshes_[m]->Reset();
+    }
+    memset(waves_[0], 0, 2 * max_ends_ * sizeof(float));
+    for (unsigned int e = 0; e < n_ends_; e++) {
+        ends_[e].s1 = ends_[e].s2 = 0;
+    }
+    parity_ = 0;
+}
+
+
+void CoupledMeshSystem::StartThreads() {
+
+    if (IsThreaded() || n_meshes_ < 2) {
+        return;
+    }
+    workers_.Start(n_meshes_ - 1, this, &CoupledMeshSystem::RunMesh_);
+}
+
+
+void CoupledMeshSystem::StopThreads() {
+
+    if (!IsThreaded()) {
+        return;
+    }
+    workers_.Stop();
+}
+
+
+void CoupledMeshSystem::ProcessBlock(const float *const *in,
+        float *const *out, unsigned int n_samples) {
+
+    if (!IsThreaded()) {
+        // All meshes, sample by sample
+        for (unsigned int n = 0; n < n_samples; n++) {
+            for (unsigned int m = 0; m < n_meshes_; m++) {
+                Step_(m, parity_, in[m], out[m], n);
+            }
+            parity_ ^= 1;
+        }
+        return;
+    }
+
+    block_in_ = in;
+    block_out_ = out;
+    block_n_samples_ = n_samples;
+    workers_.Post();
+    RunMesh_(0);
+    // Everyone is past the last barrier, so past reading parity_ too
+    parity_ ^= (n_samples & 0x1);
+}
+
+
+void CoupledMeshSystem::Step_(unsigned int m, unsigned int parity,
+        const float *in, float *out, unsigned int n) {
+
+    Triangular2DMesh &mesh = *meshes_[m];
+    const float *arriving = waves_[parity ^ 1];
+    float *leaving = waves_[parity];
+
+    const MeshEnds_ &mine = mesh_ends_[m];
+
+    for (unsigned int i = 0; i < mine.n; i++) {
+        End_ &end = ends_[mine.end[i]];
+        float wave = end.gain * arriving[end.other_end];
+        if (end.lump) {
+            // What left the port last sample, reflected
+            const DSP::BiquadCoeffs &c = end.reflectance;
+            float back = c.b0 * wave + end.s1;
+            end.s1 = c.b1 * wave - c.a1 * back + end.s2;
+            end.s2 = c.b2 * wave - c.a2 * back;
+            wave = back;
+        }
+        mesh.SetPortInput(end.port, wave);
+    }
+    float y = mesh.ProcessSample(in != nullptr, (in != nullptr) ? in[n] : 0);
+    if (out != nullptr) {
+        out[n] = y;
+    }
+    for (unsigned int i = 0; i < mine.n; i++) {
+        leaving[mine.end[i]] = mesh.GetPortOutput(ends_[mine.end[i]].port);
+    }
+}
+
+
+void CoupledMeshSystem::RunMesh_(unsigned int m) {
+
+    unsigned int parity = parity_;
+    for (unsigned int n = 0; n < block_n_samples_; n++) {
+        Step_(m, parity, block_in_[m], block_out_[m], n);
+        parity ^= 1;
+        // Nobody reads this sample's waves before everyone has written them
+        barrier_.Wait();
+    }
+}
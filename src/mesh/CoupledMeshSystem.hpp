@@ -0,0 +1,175 @@
+/**
+ * @file CoupledMeshSystem.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-19
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __COUPLED_MESH_SYSTEM_HPP__
+#define __COUPLED_MESH_SYSTEM_HPP__
+
+#include <cstddef>
+#include "Triangular2DMesh.hpp"
+#include "BiquadKernel.hpp"
+#include "SpinBarrier.hpp"
+
+
+/**
+ * @brief Several meshes coupled through lumped elements (e.g. the batter
+ * and resonant heads of a drum, through the air in the shell), updated
+ * together one sample at a time.
+ *
+ * Each coupling is a short lossy waveguide between a point on one mesh
+ * and a point on another (or the same one), declared in mm like
+ * SetSource(): the meshes open a port there (see
+ * Triangular2DMesh::AddPort()) and the waveguide carries waves between
+ * them with one sample of delay each way, so within a sample the meshes
+ * don't depend on each other. That's what lets them run on separate
+ * cores, with a barrier at the end of each sample: see StartThreads().
+ * Threaded and single-threaded runs give identical results.
+ *
+ * A lump is a one-port on a single mesh instead: a mass, a damper and a
+ * spring in series (the air in a closed shell is a spring, a Helmholtz
+ * resonator a mass on one), reflecting the port's waves back into the
+ * mesh one sample later.
+ *
+ * Meshes are set up (mask, source, pickup...) by the caller and owned by
+ * it; couplings and lumps are added once, before processing. Memory is
+ * allocated externally (see GetMemSize()).
+ */
+class CoupledMeshSystem {
+
+ public:
+
+    struct Coupling {
+        unsigned int mesh_a;
+        float x_a;  // mm
+        float y_a;
+        unsigned int mesh_b;
+        float x_b;
+        float y_b;
+        float admittance;  // Relative to a mesh waveguide's
+        float mu;  // Attenuation of the coupling waveguide, in [0, 1)
+    };
+
+    /**
+     * @brief Lumped element: impedance mass * s + resistance + stiffness
+     * / s, with s in rad/sample (bilinear transform), relative to a mesh
+     * waveguide's admittance like the port's
+     *
+     */
+    struct Lump {
+        unsigned int mesh;
+        float x;  // mm
+        float y;
+        float admittance;  // Of the port
+        float mass;
+        float resistance;
+        float stiffness;
+    };
+
+    /**
+     * @brief Memory needed for a system of n_meshes meshes and up to
+     * max_couplings couplings (a lump takes half a coupling's room)
+     *
+     */
+    static size_t GetMemSize(unsigned int n_meshes,
+        unsigned int max_couplings);
+    /**
+     * @brief Construct a new CoupledMeshSystem
+     *
+     * @param meshes Array of n_meshes meshes, with no ports open
+     * @param n_meshes Number of meshes
+     * @param max_couplings Maximum number of couplings
+     * @param mem Memory of GetMemSize(n_meshes, max_couplings) bytes.
+     * Allocate externally.
+     */
+    CoupledMeshSystem(Triangular2DMesh *const *meshes, unsigned int n_meshes,
+        unsigned int max_couplings, void *mem);
+    ~CoupledMeshSystem();
+    /**
+     * @brief Couple two meshes. Not real-time safe, nor allowed while
+     * threads are running.
+     *
+     * @return false if out of couplings or ports
+     */
+    bool AddCoupling(const Coupling &coupling);
+    /**
+     * @brief Load a mesh with a lumped element. Same rules as
+     * AddCoupling().
+     *
+     * @return false if out of couplings or ports
+     */
+    bool AddLump(const Lump &lump);
+    void Reset();
+    /**
+     * @brief Run one thread per mesh after the first one (which runs on
+     * the caller's thread). Only worth it for large meshes: the threads
+     * spin on each other once per sample. Not real-time safe.
+     *
+     */
+    void StartThreads();
+    void StopThreads();
+    bool IsThreaded() { return workers_.IsRunning(); }
+    /**
+     * @brief Run all meshes over a block
+     *
+     * @param in One input buffer per mesh (nullptr: no input)
+     * @param out One output buffer per mesh (nullptr: discard)
+     * @param n_samples Samples in the block
+     */
+    void ProcessBlock(const float *const *in, float *const *out,
+        unsigned int n_samples);
+    Triangular2DMesh &GetMesh(unsigned int m) { return *meshes_[m]; }
+    unsigned int GetNumMeshes() { return n_meshes_; }
+
+ protected:
+
+    // One end of a coupling, or a lump
+    struct End_ {
+        unsigned int mesh;
+        unsigned int port;
+        unsigned int other_end;  // Index of the opposite End_ (a lump's own)
+        float gain;  // 1 - mu (1 for a lump)
+        bool lump;
+        DSP::BiquadCoeffs reflectance;  // Lump: wave back from wave in
+        float s1;  // Lump: filter state (transposed direct form II)
+        float s2;
+    };
+
+    // Ends on one mesh, so that each mesh only visits its own
+    struct MeshEnds_ {
+        unsigned int n;
+        unsigned int end[Triangular2DMesh::kMaxPorts];
+    };
+
+    unsigned int n_meshes_;
+    unsigned int max_ends_;
+    unsigned int n_ends_;
+    Triangular2DMesh **meshes_;
+    End_ *ends_;
+    MeshEnds_ *mesh_ends_;
+    // Waves leaving each end, double-buffered on sample parity: a sample
+    // reads what the previous one wrote
+    float *waves_[2];
+    unsigned int parity_;
+
+    // Block handed to the threads
+    const float *const *block_in_;
+    float *const *block_out_;
+    unsigned int block_n_samples_;
+    DSP::SpinWorkers workers_;
+    DSP::SpinBarrier barrier_;
+
+    void Step_(unsigned int m, unsigned int parity, const float *in,
+        float *out, unsigned int n);
+    void RunMesh_(unsigned int m);
+    unsigned int AddEnd_(unsigned int m, float x, float y, float admittance);
+};
+
+
+#endif  // __COUPLED_MESH_SYSTEM_HPP__
@@ -28,4 +28,15 @@ std::function<bool (float, float)> CircularMembrane(
 }
 
 
+std::function<bool (float, float, float)> CylindricalCavity(
+    float radius
+) {
+    auto section = CircularMembrane(radius);
+    return [=](float x, float y, float z) {
+        (void) z;
+        return section(x, y);
+    };
+}
+
+
 }
@@ -24,6 +24,15 @@ std::function<bool (float, float)> CircularMembrane(
     float radius
 );
 
+/**
+ * @brief Inside of a cylindrical shell (e.g. the air in a drum), axis
+ * along z, for Rectilinear3DMesh::ApplyMask()
+ *
+ */
+std::function<bool (float, float, float)> CylindricalCavity(
+    float radius
+);
+
 
 }
 
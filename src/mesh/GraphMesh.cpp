@@ -0,0 +1,326 @@
+/**
+ * @file GraphMesh.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-29
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "GraphMesh.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include "SIMD.hpp"
+
+
+GraphMesh::Graph GraphMesh::FromLattice(Triangular2DMesh &mesh) {
+
+    // Lattice node -> graph node, for junctions with any waveguide
+    const uint32_t kNone = ~0u;
+    std::vector<uint32_t> index(
+        Triangular2DMesh::GetNodeCount(mesh.GetProperties()), kNone);
+    std::vector<float> x, y;
+    mesh.ForEachJunction([&](unsigned int node, float x_, float y_,
+        const unsigned int *, unsigned int) {
+        index[node] = x.size();
+        x.push_back(x_);
+        y.push_back(y_);
+    });
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    mesh.ForEachJunction([&](unsigned int node, float, float,
+        const unsigned int *neighbours, unsigned int n_neighbours) {
+        for (unsigned int n = 0; n < n_neighbours; n++) {
+            // Each link once
+            if (neighbours[n] > node) {
+                links.emplace_back(index[node], index[neighbours[n]]);
+            }
+        }
+    });
+    return FromLinks(x, y, links);
+}
+
+
+GraphMesh::Graph GraphMesh::FromPoints(const float *x, const float *y,
+    unsigned int n_points, float link_radius__mm) {
+
+    assert(link_radius__mm > 0);
+    std::vector<float> xs(x, x + n_points), ys(y, y + n_points);
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    if (n_points == 0) {
+        return FromLinks(xs, ys, links);
+    }
+
+    // Buckets one radius wide: neighbours are in the 3x3 around a point
+    float x_min = *std::min_element(xs.begin(), xs.end());
+    float y_min = *std::min_element(ys.begin(), ys.end());
+    float x_max = *std::max_element(xs.begin(), xs.end());
+    float y_max = *std::max_element(ys.begin(), ys.end());
+    const float inv_r = 1.f / link_radius__mm;
+    const unsigned int nx = static_cast<unsigned int>((x_max - x_min) * inv_r)
+        + 1;
+    const unsigned int ny = static_cast<unsigned int>((y_max - y_min) * inv_r)
+        + 1;
+    auto bucket_of = [&](unsigned int i, unsigned int &bx, unsigned int &by) {
+        bx = std::min(nx - 1,
+            static_cast<unsigned int>((xs[i] - x_min) * inv_r));
+        by = std::min(ny - 1,
+            static_cast<unsigned int>((ys[i] - y_min) * inv_r));
+    };
+    std::vector<uint32_t> bucket_start(nx * ny + 1, 0);
+    std::vector<uint32_t> by_bucket(n_points);
+    for (unsigned int i = 0; i < n_points; i++) {
+        unsigned int bx, by;
+        bucket_of(i, bx, by);
+        bucket_start[by * nx + bx + 1]++;
+    }
+    std::partial_sum(bucket_start.begin(), bucket_start.end(),
+        bucket_start.begin());
+    std::vector<uint32_t> fill(bucket_start.begin(), bucket_start.end() - 1);
+    for (unsigned int i = 0; i < n_points; i++) {
+        unsigned int bx, by;
+        bucket_of(i, bx, by);
+        by_bucket[fill[by * nx + bx]++] = i;
+    }
+
+    const float r2 = link_radius__mm * link_radius__mm;
+    for (unsigned int i = 0; i < n_points; i++) {
+        unsigned int bx, by;
+        bucket_of(i, bx, by);
+        for (unsigned int cy = (by > 0) ? by - 1 : 0;
+                cy <= std::min(ny - 1, by + 1); cy++) {
+            for (unsigned int cx = (bx > 0) ? bx - 1 : 0;
+                    cx <= std::min(nx - 1, bx + 1); cx++) {
+                unsigned int b = cy * nx + cx;
+                for (unsigned int n = bucket_start[b];
+                        n < bucket_start[b + 1]; n++) {
+                    unsigned int j = by_bucket[n];
+                    float dx = xs[j] - xs[i];
+                    float dy = ys[j] - ys[i];
+                    if (j > i && dx * dx + dy * dy < r2) {
+                        links.emplace_back(i, j);
+                    }
+                }
+            }
+        }
+    }
+    return FromLinks(xs, ys, links);
+}
+
+
+uint32_t GraphMesh::Morton_(uint32_t x, uint32_t y) {
+
+    auto spread = [](uint32_t v) {
+        v &= 0xffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+
+GraphMesh::Graph GraphMesh::FromLinks(const std::vector<float> &x,
+    const std::vector<float> &y,
+    const std::vector<std::pair<uint32_t, uint32_t>> &links) {
+
+    assert(x.size() == y.size());
+    const unsigned int n_nodes = x.size();
+    Graph g;
+    g.row_start.assign(n_nodes + 1, 0);
+    if (n_nodes == 0) {
+        return g;
+    }
+
+    // Number nodes along a Z-order curve over the bounding box
+    float x_min = *std::min_element(x.begin(), x.end());
+    float y_min = *std::min_element(y.begin(), y.end());
+    float extent = std::max(*std::max_element(x.begin(), x.end()) - x_min,
+        *std::max_element(y.begin(), y.end()) - y_min);
+    float scale = (extent > 0) ? 65535.f / extent : 0.f;
+    std::vector<uint32_t> code(n_nodes);
+    for (unsigned int i = 0; i < n_nodes; i++) {
+        code[i] = Morton_(static_cast<uint32_t>((x[i] - x_min) * scale),
+            static_cast<uint32_t>((y[i] - y_min) * scale));
+    }
+    std::vector<uint32_t> order(n_nodes);  // New -> old
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&code](uint32_t a, uint32_t b) { return code[a] < code[b]; });
+    std::vector<uint32_t> renumber(n_nodes);  // Old -> new
+    g.x.resize(n_nodes);
+    g.y.resize(n_nodes);
+    for (unsigned int i = 0; i < n_nodes; i++) {
+        renumber[order[i]] = i;
+        g.x[i] = x[order[i]];
+        g.y[i] = y[order[i]];
+    }
+
+    // Rows: count, prefix sum, fill, sort
+    for (auto &l : links) {
+        assert(l.first != l.second);  // No self-links
+        assert(l.first < n_nodes && l.second < n_nodes);
+        g.row_start[renumber[l.first] + 1]++;
+        g.row_start[renumber[l.second] + 1]++;
+    }
+    std::partial_sum(g.row_start.begin(), g.row_start.end(),
+        g.row_start.begin());
+    g.neighbour.resize(g.row_start[n_nodes]);
+    std::vector<uint32_t> fill(g.row_start.begin(), g.row_start.end() - 1);
+    for (auto &l : links) {
+        uint32_t a = renumber[l.first];
+        uint32_t b = renumber[l.second];
+        g.neighbour[fill[a]++] = b;
+        g.neighbour[fill[b]++] = a;
+    }
+    for (unsigned int i = 0; i < n_nodes; i++) {
+        std::sort(g.neighbour.begin() + g.row_start[i],
+            g.neighbour.begin() + g.row_start[i + 1]);
+    }
+    return g;
+}
+
+
+size_t GraphMesh::GetMemSize(const Graph &g) {
+
+    const size_t n_nodes = g.x.size();
+    const size_t n_links = DSP::SIMD::PadToWidth(g.neighbour.size());
+    // Waves (2 planes), junction velocity, coefficient, position (x, y)
+    return (2 * n_links + 4 * n_nodes) * sizeof(float)
+        // Rows, neighbours, reverse link ends
+        + (n_nodes + 1 + 2 * n_links) * sizeof(uint32_t)
+        + DSP::SIMD::kAlignment;
+}
+
+
+GraphMesh::GraphMesh(const Graph &g, void *mem) {
+
+    assert(g.row_start.size() == g.x.size() + 1);
+    n_nodes_ = g.x.size();
+    n_links_ = g.neighbour.size();
+    const unsigned int n_links_padded = DSP::SIMD::PadToWidth(n_links_);
+
+    // Vector-accessed planes first, all multiples of the vector width
+    wave_curr_ = DSP::SIMD::Align<float>(mem);
+    wave_next_ = wave_curr_ + n_links_padded;
+    junc_v_ = wave_next_ + n_links_padded;
+    coef_ = junc_v_ + n_nodes_;
+    x_ = coef_ + n_nodes_;
+    y_ = x_ + n_nodes_;
+    row_start_ = reinterpret_cast<uint32_t *>(y_ + n_nodes_);
+    neighbour_ = row_start_ + n_nodes_ + 1;
+    reverse_ = neighbour_ + n_links_padded;
+
+    std::copy(g.x.begin(), g.x.end(), x_);
+    std::copy(g.y.begin(), g.y.end(), y_);
+    std::copy(g.row_start.begin(), g.row_start.end(), row_start_);
+    std::copy(g.neighbour.begin(), g.neighbour.end(), neighbour_);
+    for (unsigned int i = 0; i < n_nodes_; i++) {
+        unsigned int n = row_start_[i + 1] - row_start_[i];
+        coef_[i] = (n > 0) ? 2.f / n : 0.f;
+        // Link end i <- j is reversed by j <- i, in j's (sorted) row
+        for (unsigned int e = row_start_[i]; e < row_start_[i + 1]; e++) {
+            unsigned int j = neighbour_[e];
+            const uint32_t *row_begin = neighbour_ + row_start_[j];
+            const uint32_t *row_end = neighbour_ + row_start_[j + 1];
+            const uint32_t *back = std::lower_bound(row_begin, row_end, i);
+            assert(back != row_end && *back == i);  // Links go both ways
+            reverse_[e] = back - neighbour_;
+        }
+    }
+    // Padding lanes gather from (valid) link end 0 and go nowhere
+    for (unsigned int e = n_links_; e < n_links_padded; e++) {
+        neighbour_[e] = 0;
+        reverse_[e] = 0;
+    }
+
+    source_ = pickup_ = 0;
+    SetAttenuation(0);
+    Reset();
+}
+
+
+void GraphMesh::Reset() {
+    const unsigned int n_links_padded = DSP::SIMD::PadToWidth(n_links_);
+    memset(wave_curr_, 0, sizeof(float) * n_links_padded);
+    memset(wave_next_, 0, sizeof(float) * n_links_padded);
+    memset(junc_v_, 0, sizeof(float) * n_nodes_);
+}
+
+
+unsigned int GraphMesh::FindNearest_(float x, float y) {
+
+    assert(n_nodes_ > 0);
+    unsigned int nearest = 0;
+    float nearest_d2 = INFINITY;
+    for (unsigned int i = 0; i < n_nodes_; i++) {
+        float dx = x_[i] - x;
+        float dy = y_[i] - y;
+        float d2 = dx * dx + dy * dy;
+        if (d2 < nearest_d2) {
+            nearest = i;
+            nearest_d2 = d2;
+        }
+    }
+    return nearest;
+}
+
+
+void GraphMesh::SetSource(float x, float y) {
+    source_ = FindNearest_(x, y);
+}
+
+
+void GraphMesh::SetPickup(float x, float y) {
+    pickup_ = FindNearest_(x, y);
+}
+
+
+void GraphMesh::SetAttenuation(float mu) {
+    assert(mu >= 0.f);
+    assert(mu < 1.f);
+    alpha_ = 1 - mu;
+}
+
+
+float GraphMesh::ProcessSample(bool input_present, float input) {
+
+    // Junctions: each row of incoming waves is contiguous
+    for (unsigned int i = 0; i < n_nodes_; i++) {
+        float sum = 0;
+        for (unsigned int e = row_start_[i]; e < row_start_[i + 1]; e++) {
+            sum += wave_curr_[e];
+        }
+        junc_v_[i] = sum * coef_[i] * alpha_;
+    }
+    if (input_present && n_nodes_ > 0) {
+        // The source is one more port on its junction, as on the lattice
+        unsigned int i = source_;
+        float sum = input;
+        for (unsigned int e = row_start_[i]; e < row_start_[i + 1]; e++) {
+            sum += wave_curr_[e];
+        }
+        junc_v_[i] = sum * (2.f / (row_start_[i + 1] - row_start_[i] + 1))
+            * alpha_;
+    }
+
+    // Waves arriving next sample: what the neighbour scattered, minus
+    // what it received from us
+    using V = DSP::SIMD;
+    const unsigned int n_links_padded = V::PadToWidth(n_links_);
+    for (unsigned int e = 0; e < n_links_padded; e += V::kWidth) {
+        V::Store(wave_next_ + e, V::Sub(V::Gather(junc_v_, neighbour_ + e),
+            V::Gather(wave_curr_, reverse_ + e)));
+    }
+    float *tmp = wave_next_;
+    wave_next_ = wave_curr_;
+    wave_curr_ = tmp;
+
+    return (n_nodes_ > 0) ? junc_v_[pickup_] : 0.f;
+}
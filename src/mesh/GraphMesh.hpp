@@ -0,0 +1,135 @@
+/**
+ * @file GraphMesh.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-29
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __GRAPH_MESH_HPP__
+#define __GRAPH_MESH_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Triangular2DMesh.hpp"
+
+
+/**
+ * @brief Waveguide mesh over an arbitrary graph of junctions: any shape,
+ * any connectivity, and no memory spent on nodes a mask would leave out.
+ *
+ * Each link is a pair of unit waveguides of equal admittance, so a
+ * junction with N links scatters as in Triangular2DMesh:
+ *
+ *     v_J = 2/N * sum(incoming), outgoing = v_J - incoming
+ *
+ * which is lossless on any graph (the mesh can't blow up, however
+ * irregular). Links are stored in compressed sparse rows, one row of
+ * incoming waves per junction, and nodes are numbered along a Morton
+ * (Z-order) curve so that linked junctions sit close in memory. Each
+ * sample is two passes: junction velocities, summing each row, then all
+ * outgoing waves at once, gathering velocities and reverse waves by index
+ * in SIMD vectors.
+ *
+ * Graphs are built at setup (see Graph and the importers), then copied
+ * into memory allocated externally (see GetMemSize()).
+ */
+class GraphMesh {
+
+ public:
+
+    /**
+     * @brief Junction graph, in compressed sparse rows: the neighbours
+     * of node i are neighbour[row_start[i]] to neighbour[row_start[i + 1]
+     * - 1]. Links go both ways. Heap-allocated: build it at setup.
+     *
+     */
+    struct Graph {
+        std::vector<float> x;  // mm
+        std::vector<float> y;
+        std::vector<uint32_t> row_start;  // Nodes + 1 entries
+        std::vector<uint32_t> neighbour;  // One entry per link end
+    };
+
+    /**
+     * @brief Graph of a lattice mesh as masked, junctions with no
+     * waveguide left out (runs exactly as the lattice mesh does)
+     *
+     */
+    static Graph FromLattice(Triangular2DMesh &mesh);
+    /**
+     * @brief Graph over a 2D point set, linking every pair of points
+     * closer than link_radius__mm (e.g. a jittered grid, with a radius a
+     * bit larger than its spacing)
+     *
+     */
+    static Graph FromPoints(const float *x, const float *y,
+        unsigned int n_points, float link_radius__mm);
+    /**
+     * @brief Graph from node positions and a list of links, each given
+     * once as a pair of node indices. Nodes are renumbered in Morton order
+     * and rows sorted, as all importers do.
+     *
+     */
+    static Graph FromLinks(const std::vector<float> &x,
+        const std::vector<float> &y,
+        const std::vector<std::pair<uint32_t, uint32_t>> &links);
+
+    static size_t GetMemSize(const Graph &g);
+    /**
+     * @brief Construct a new GraphMesh
+     *
+     * @param g Graph, copied in
+     * @param mem Memory of GetMemSize(g) bytes. Allocate externally.
+     */
+    GraphMesh(const Graph &g, void *mem);
+    void Reset();
+    float ProcessSample(bool input_present, float input);
+    /**
+     * @brief Put the source on the node nearest to (x, y). Searches all
+     * nodes: not for the audio thread.
+     *
+     */
+    void SetSource(float x, float y);
+    /**
+     * @brief Put the pickup on the node nearest to (x, y). Searches all
+     * nodes: not for the audio thread.
+     *
+     */
+    void SetPickup(float x, float y);
+    void SetAttenuation(float mu);
+    unsigned int GetNodeCount() { return n_nodes_; }
+    unsigned int GetLinkCount() { return n_links_; }
+
+ protected:
+
+    unsigned int n_nodes_;
+    unsigned int n_links_;  // Link ends: twice the number of links
+    float *x_;
+    float *y_;
+    uint32_t *row_start_;
+    uint32_t *neighbour_;  // Node each link end's wave comes from
+    uint32_t *reverse_;  // Link end going the other way
+    float *coef_;  // 2 / N, per node
+    float *junc_v_;
+    float *wave_curr_;  // Incoming waves, per link end
+    float *wave_next_;
+    unsigned int source_;
+    unsigned int pickup_;
+    float alpha_;
+
+    unsigned int FindNearest_(float x, float y);
+    /**
+     * @brief Interleave the bits of two 16-bit coordinates
+     *
+     */
+    static uint32_t Morton_(uint32_t x, uint32_t y);
+};
+
+
+#endif  // __GRAPH_MESH_HPP__
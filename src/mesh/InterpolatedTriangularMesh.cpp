@@ -0,0 +1,253 @@
+/**
+ * @file InterpolatedTriangularMesh.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-05
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "InterpolatedTriangularMesh.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "MeshBounds.hpp"
+#include "SIMD.hpp"
+
+
+float InterpolatedTriangularMesh::kSqrt3Over2 = std::sqrt(3.f) / 2.f;
+
+
+void InterpolatedTriangularMesh::GetInternalProperties(
+    Properties &p, Properties_internal_ &pi) {
+
+    // Same lattice as Triangular2DMesh for the same properties
+    unsigned int x_size = std::ceil(2.f * p.x__mm / (p.spatial_res__mm));
+    unsigned int y_size = std::ceil(2.f * p.y__mm /
+        (std::sqrt(3.f) * p.spatial_res__mm));
+    x_size = x_size + !(x_size & 0x1);
+    y_size = y_size + (y_size & 0x1);
+    pi.c_size = y_size;
+    pi.k_size_even = (x_size >> 1) + 1;
+    pi.k_size_odd = (x_size >> 1);
+    pi.total_size_ck = (pi.k_size_even + pi.k_size_odd) * (pi.c_size >> 1);
+    // Rows are processed in whole vectors: the lanes past the end of a
+    // row are masked out, and the halo keeps every stencil read in bounds
+    pi.k_padded = DSP::SIMD::PadToWidth(pi.k_size_even);
+    pi.stride = DSP::SIMD::PadToWidth(pi.k_padded + 2 * kHalo);
+    pi.plane_size = (pi.c_size + 2 * kHalo) * pi.stride;
+}
+
+
+size_t InterpolatedTriangularMesh::GetMemSize(Properties p) {
+
+    Properties_internal_ pi;
+    GetInternalProperties(p, pi);
+    // Current, previous, mask
+    return 3 * pi.plane_size * sizeof(float) + DSP::SIMD::kAlignment;
+}
+
+
+unsigned int InterpolatedTriangularMesh::GetNodeCount(Properties p) {
+
+    Properties_internal_ pi;
+    GetInternalProperties(p, pi);
+    return pi.total_size_ck;
+}
+
+
+InterpolatedTriangularMesh::InterpolatedTriangularMesh(Properties p,
+    void *mem) {
+
+    p_ = p;
+    GetInternalProperties(p, pi_);
+    u_curr_ = DSP::SIMD::Align<float>(mem);
+    u_prev_ = u_curr_ + pi_.plane_size;
+    mask_ = u_prev_ + pi_.plane_size;
+    // Halo and padding lanes stay outside for good
+    memset(mask_, 0, sizeof(float) * pi_.plane_size);
+    ApplyMask([&](float x_, float y_) {
+        return static_cast<bool>((x_ >= 0 && x_ < p_.x__mm) &&
+            (y_ >= 0 && y_ < p_.y__mm));
+    });
+    SetSource(p.x__mm * 0.5, p.y__mm * 0.5);
+    SetPickup(0, 0);
+    SetAttenuation(0);
+    Reset();
+}
+
+
+void InterpolatedTriangularMesh::Reset() {
+    memset(u_curr_, 0, sizeof(float) * pi_.plane_size);
+    memset(u_prev_, 0, sizeof(float) * pi_.plane_size);
+}
+
+
+unsigned int InterpolatedTriangularMesh::XYtoIndex_(float x, float y) {
+
+    unsigned int c = y / (kSqrt3Over2 * p_.spatial_res__mm);
+    unsigned int k = (x - p_.spatial_res__mm * 0.5f * (c & 0x1)) /
+        p_.spatial_res__mm;
+    assert(IsInLattice_(c, k));
+    return Index_(c, k);
+}
+
+
+void InterpolatedTriangularMesh::SetSource(float x, float y) {
+    unsigned int source = XYtoIndex_(x, y);
+    assert(mask_[source] != 0);  // Is source point outside mesh mask?
+    source_ = source;
+}
+
+
+void InterpolatedTriangularMesh::SetPickup(float x, float y) {
+    unsigned int pickup = XYtoIndex_(x, y);
+    assert(mask_[pickup] != 0);  // Is pickup point outside mesh mask?
+    pickup_ = pickup;
+}
+
+
+void InterpolatedTriangularMesh::SetAttenuation(float mu) {
+    assert(mu >= 0.f);
+    assert(mu < 1.f);
+    alpha_ = 1 - mu;
+}
+
+
+bool InterpolatedTriangularMesh::IsInside(float x, float y) {
+
+    if (!IsWithinExtent(x, p_.x__mm, p_.spatial_res__mm) ||
+        !IsWithinExtent(y, p_.y__mm, p_.spatial_res__mm)) {
+        return false;
+    }
+    unsigned int c = y / (kSqrt3Over2 * p_.spatial_res__mm);
+    unsigned int k = (x - p_.spatial_res__mm * 0.5f * (c & 0x1)) /
+        p_.spatial_res__mm;
+    return IsInLattice_(c, k) && mask_[Index_(c, k)] != 0;
+}
+
+
+float InterpolatedTriangularMesh::ProcessSample(bool input_present,
+    float input) {
+
+    using V = DSP::SIMD;
+    const V::Vec a0 = V::Set1(kA0);
+    const V::Vec a1 = V::Set1(kA1);
+    const V::Vec a2 = V::Set1(kA2);
+    const V::Vec alpha = V::Set1(alpha_);
+    const unsigned int s = pi_.stride;
+
+    for (unsigned int c = 0; c < pi_.c_size; c++) {
+        // Odd rows sit half a spacing to the right, so the rows above and
+        // below are read one node further along
+        unsigned int odd = c & 0x1;
+        const float *u = u_curr_ + Index_(c, 0);
+        const float *up = u - s + odd;
+        const float *down = u + s + odd;
+        const float *up2 = u - 2 * s;
+        const float *down2 = u + 2 * s;
+        const float *m = mask_ + Index_(c, 0);
+        float *next = u_prev_ + Index_(c, 0);  // Overwrites u[n-1]
+
+        for (unsigned int k = 0; k < pi_.k_padded; k += V::kWidth) {
+            // Nearest neighbours: W, E, NW, NE, SW, SE
+            V::Vec ring1 = V::Add(
+                V::Add(V::LoadU(u + k - 1), V::LoadU(u + k + 1)),
+                V::Add(
+                    V::Add(V::LoadU(up + k - 1), V::LoadU(up + k)),
+                    V::Add(V::LoadU(down + k - 1), V::LoadU(down + k))));
+            // Next-nearest: N, S and the four at +/-30 degrees
+            V::Vec ring2 = V::Add(
+                V::Add(V::LoadU(up2 + k), V::LoadU(down2 + k)),
+                V::Add(
+                    V::Add(V::LoadU(up + k - 2), V::LoadU(up + k + 1)),
+                    V::Add(V::LoadU(down + k - 2), V::LoadU(down + k + 1))));
+            V::Vec acc = V::MulAdd(a0, V::LoadU(u + k),
+                V::MulAdd(a1, ring1, V::Mul(a2, ring2)));
+            acc = V::Sub(acc, V::LoadU(next + k));
+            acc = V::Mul(V::Mul(acc, alpha), V::LoadU(m + k));
+            V::StoreU(next + k, acc);
+        }
+    }
+
+    if (input_present) {
+        u_prev_[source_] += input;
+    }
+    float output = u_prev_[pickup_];
+
+    // Swap buffers (next->current)
+    float *tmp = u_prev_;
+    u_prev_ = u_curr_;
+    u_curr_ = tmp;
+
+    return output;
+}
+
+
+float InterpolatedTriangularMesh::EquivalentResolution(float dwm_res__mm) {
+    // Wave speed is Courant number * resolution * sample rate
+    return dwm_res__mm * (1.f / std::sqrt(2.f)) / kCourantNumber;
+}
+
+
+float InterpolatedTriangularMesh::GetMeshFrequency(float kappa, float theta) {
+
+    // Plane wave through the stencil: cos(omega) is half the spatial
+    // part, each ring contributing one cosine per pair of opposite nodes
+    const double pi = 3.14159265358979323846;
+    double ring1 = 0;
+    double ring2 = 0;
+    for (unsigned int j = 0; j < 3; j++) {
+        ring1 += std::cos(kappa * std::cos(theta - j * pi / 3.));
+        ring2 += std::cos(std::sqrt(3.) * kappa *
+            std::cos(theta - pi / 6. - j * pi / 3.));
+    }
+    double cos_omega = 0.5 * (kA0 + 2. * kA1 * ring1 + 2. * kA2 * ring2);
+    if (cos_omega > 1. || cos_omega < -1.) {
+        return -1.f;
+    }
+    return std::acos(cos_omega);
+}
+
+
+float InterpolatedTriangularMesh::CompensateFrequency(float omega) {
+
+    if (omega <= 0.f || omega >= kMaxCompensatedOmega) {
+        return omega;
+    }
+    // The relation is symmetric every 30 degrees: average over one sector
+    const unsigned int kNDirections = 7;
+    const float kSector = 3.14159265f / 6.f;
+    auto mean_omega = [&](float kappa) {
+        float sum = 0;
+        for (unsigned int n = 0; n < kNDirections; n++) {
+            sum += GetMeshFrequency(kappa,
+                kSector * n / (kNDirections - 1));
+        }
+        return sum / kNDirections;
+    };
+    // The averaged curve is monotonic up to kappa ~ 3.85, well past
+    // kMaxCompensatedOmega: bisect for the wavenumber, then return the
+    // frequency an ideal membrane has for it
+    float lo = 0.f;
+    float hi = 3.8f;
+    for (unsigned int it = 0; it < 32; it++) {
+        float mid = 0.5f * (lo + hi);
+        if (mean_omega(mid) < omega) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return kCourantNumber * 0.5f * (lo + hi);
+}
+
+
+void InterpolatedTriangularMesh::CompensateModes(
+    DSP::ModalBank::Mode *modes, unsigned int n_modes) {
+    for (unsigned int n = 0; n < n_modes; n++) {
+        modes[n].omega = CompensateFrequency(modes[n].omega);
+    }
+}
@@ -0,0 +1,181 @@
+/**
+ * @file InterpolatedTriangularMesh.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-05
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __INTERPOLATED_TRIANGULAR_MESH_HPP__
+#define __INTERPOLATED_TRIANGULAR_MESH_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include "Triangular2DMesh.hpp"
+#include "ModalBank.hpp"
+
+
+/**
+ * @brief Dispersion-reduced alternative to Triangular2DMesh.
+ *
+ * Same triangular lattice and (C, K) coordinates, but updated as a
+ * finite-difference scheme on node displacements with an interpolated
+ * two-ring stencil: the six nearest neighbours (distance h) plus the six
+ * next-nearest (distance sqrt(3) h), with weights
+ *
+ *     u[n+1] = a0 u + a1 * sum(ring 1) + a2 * sum(ring 2) - u[n-1]
+ *     a0 = 6/5, a1 = 3/20, a2 = -1/60
+ *
+ * The negative outer ring makes the Laplacian fourth-order accurate, which
+ * lets the scheme run at Courant number sqrt(0.15) (against 1/sqrt(2) for
+ * the waveguide mesh) with less pitch error: up to 0.678 rad/sample
+ * (4.8 kHz at 44.1 kHz), partials are within 0.55% in every direction,
+ * where the waveguide mesh is off by up to 1%. For the same wave speed and
+ * sample rate the grid is 1.83 times coarser, i.e. 3.3 times fewer nodes
+ * (see EquivalentResolution()), and the update is three planes of plain
+ * arithmetic instead of fourteen planes of scattering.
+ *
+ * The price is bandwidth: nothing propagates above about 1.15 rad/sample,
+ * so use it where the upper partials were out of tune anyway. The
+ * dispersion that is left is mostly direction-independent, and below
+ * kMaxCompensatedOmega it can be undone by warping output frequencies
+ * with the inverse of the mean dispersion curve (CompensateFrequency()),
+ * e.g. on the modes of a DSP::ModalBank extracted from this mesh.
+ *
+ * Boundaries are fixed (nodes outside the mask are held at zero).
+ * Memory is allocated externally (see GetMemSize()).
+ */
+class InterpolatedTriangularMesh {
+
+ public:
+
+    typedef Triangular2DMesh::Properties Properties;
+
+    static size_t GetMemSize(Properties p);
+    static unsigned int GetNodeCount(Properties p);
+    InterpolatedTriangularMesh(Properties p, void *mem);
+    void Reset();
+    template <typename MaskFnT>
+    void ApplyMask(MaskFnT mask_fn);
+    float ProcessSample(bool input_present, float input);
+    void SetSource(float x, float y);
+    void SetPickup(float x, float y);
+    void SetAttenuation(float mu);
+    bool IsInside(float x, float y);
+
+    /**
+     * @brief Spatial resolution giving the same wave speed as a
+     * Triangular2DMesh of resolution dwm_res__mm at the same sample rate
+     * (same pitch for the same dimensions)
+     *
+     */
+    static float EquivalentResolution(float dwm_res__mm);
+    /**
+     * @brief Frequency of a plane wave on the lattice, from the scheme's
+     * dispersion relation
+     *
+     * @param kappa Wavenumber times spatial resolution (rad per spacing)
+     * @param theta Direction of propagation (rad)
+     * @return float Frequency (rad/sample), or a negative number where
+     * the relation has no real solution
+     */
+    static float GetMeshFrequency(float kappa, float theta);
+    /**
+     * @brief Frequency an ideal membrane would have for the wave that
+     * sounds at omega on the mesh (inverse of the direction-averaged
+     * dispersion curve). Not for the audio thread.
+     *
+     * @param omega Frequency on the mesh (rad/sample)
+     * @return float Compensated frequency (rad/sample). Frequencies past
+     * the end of the curve (kMaxCompensatedOmega) are returned unchanged.
+     */
+    static float CompensateFrequency(float omega);
+    /**
+     * @brief Apply CompensateFrequency() to a set of modes
+     *
+     */
+    static void CompensateModes(DSP::ModalBank::Mode *modes,
+        unsigned int n_modes);
+
+    /**
+     * @brief Highest mesh frequency (rad/sample) CompensateFrequency()
+     * warps: the averaged curve is monotonic and isotropic enough below it
+     *
+     */
+    static constexpr float kMaxCompensatedOmega = 1.f;
+
+ protected:
+
+    // Stencil weights (see class description)
+    static constexpr float kA0 = 6.f / 5.f;
+    static constexpr float kA1 = 3.f / 20.f;
+    static constexpr float kA2 = -1.f / 60.f;
+    // Waves travel sqrt(3/2 a1 + 9/2 a2) spacings per sample
+    static constexpr float kCourantNumber = 0.38729833f;
+    // Halo of zeros around the lattice, wide enough for the second ring
+    static constexpr unsigned int kHalo = 2;
+    static float kSqrt3Over2;
+
+    struct Properties_internal_ {
+        unsigned int c_size;
+        unsigned int k_size_even;
+        unsigned int k_size_odd;
+        unsigned int k_padded;  // Nodes processed per row (whole vectors)
+        unsigned int stride;  // Floats per row, including halo
+        unsigned int plane_size;  // Floats per plane, including halo
+        unsigned int total_size_ck;
+    };
+
+    Properties p_;
+    Properties_internal_ pi_;
+    float *u_curr_;
+    float *u_prev_;
+    float *mask_;  // 1 inside, 0 outside
+    unsigned int source_;  // Plane index
+    unsigned int pickup_;
+    float alpha_;
+
+    static void GetInternalProperties(Properties &p,
+        Properties_internal_ &pi);
+
+    __attribute__((always_inline)) unsigned int Index_(unsigned int c,
+        unsigned int k) {
+        return (c + kHalo) * pi_.stride + k + kHalo;
+    }
+
+    __attribute__((always_inline)) bool IsInLattice_(unsigned int c,
+        unsigned int k) {
+        return c < pi_.c_size && k < (pi_.k_size_odd + !(c & 0x1));
+    }
+
+    __attribute__((always_inline)) void CKtoXY_(unsigned int c,
+        unsigned int k, float &x, float &y) {
+        y = static_cast<float>(c) * kSqrt3Over2 * p_.spatial_res__mm;
+        x = static_cast<float>(k) * p_.spatial_res__mm +
+            (p_.spatial_res__mm * 0.5f) * static_cast<float>(c & 0x1);
+    }
+
+    unsigned int XYtoIndex_(float x, float y);
+};
+
+template <typename MaskFnT>
+void InterpolatedTriangularMesh::ApplyMask(MaskFnT mask_fn) {
+
+    float x, y;
+    for (unsigned int c = 0; c < pi_.c_size; c++) {
+        for (unsigned int k = 0; k < pi_.k_padded; k++) {
+            bool inside = false;
+            if (IsInLattice_(c, k)) {
+                CKtoXY_(c, k, x, y);
+                inside = static_cast<bool>(mask_fn(x, y));
+            }
+            mask_[Index_(c, k)] = inside ? 1.f : 0.f;
+        }
+    }
+}
+
+
+#endif  // __INTERPOLATED_TRIANGULAR_MESH_HPP__
@@ -0,0 +1,338 @@
+/**
+ * @file KirchhoffPlate.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-26
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "KirchhoffPlate.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "MeshBounds.hpp"
+#include "SIMD.hpp"
+
+
+constexpr float KirchhoffPlate::kMaxStiffnessNumber;
+
+// Node; four nearest; four diagonals; four two spacings away
+const int KirchhoffPlate::kStencilX[kNStencil] = {
+    0, 1, -1, 0, 0, 1, -1, 1, -1, 2, -2, 0, 0 };
+const int KirchhoffPlate::kStencilY[kNStencil] = {
+    0, 0, 0, 1, -1, 1, 1, -1, -1, 0, 0, 2, -2 };
+const float KirchhoffPlate::kStencilWeight[kNStencil] = {
+    20.f, -8.f, -8.f, -8.f, -8.f, 2.f, 2.f, 2.f, 2.f, 1.f, 1.f, 1.f, 1.f };
+
+
+void KirchhoffPlate::GetInternalProperties(Properties &p,
+    Properties_internal_ &pi) {
+
+    pi.x_size = std::ceil(p.x__mm / p.spatial_res__mm);
+    pi.y_size = std::ceil(p.y__mm / p.spatial_res__mm);
+    // Rows are processed in whole vectors: the lanes past the end of a
+    // row are masked out. The halo before each row is at least two
+    // columns, rounded up so that rows (and north/south reads) stay
+    // aligned.
+    pi.x_padded = DSP::SIMD::PadToWidth(pi.x_size);
+    pi.x_halo = DSP::SIMD::PadToWidth(2);
+    pi.stride = pi.x_halo + DSP::SIMD::PadToWidth(pi.x_padded + 2);
+    pi.plane_size = (pi.y_size + 4) * pi.stride;
+}
+
+
+size_t KirchhoffPlate::GetMemSize(Properties p) {
+
+    Properties_internal_ pi;
+    GetInternalProperties(p, pi);
+    // Current, previous, mask, and room for every node to be a boundary
+    // node (any mask goes)
+    return 3 * pi.plane_size * sizeof(float)
+        + pi.x_size * pi.y_size * sizeof(BoundaryNode_)
+        + DSP::SIMD::kAlignment;
+}
+
+
+unsigned int KirchhoffPlate::GetNodeCount(Properties p) {
+
+    Properties_internal_ pi;
+    GetInternalProperties(p, pi);
+    return pi.x_size * pi.y_size;
+}
+
+
+KirchhoffPlate::KirchhoffPlate(Properties p, void *mem) {
+
+    p_ = p;
+    GetInternalProperties(p, pi_);
+    u_curr_ = DSP::SIMD::Align<float>(mem);
+    u_prev_ = u_curr_ + pi_.plane_size;
+    mask_ = u_prev_ + pi_.plane_size;
+    boundary_ = reinterpret_cast<BoundaryNode_ *>(mask_ + pi_.plane_size);
+    for (unsigned int j = 0; j < kNStencil; j++) {
+        stencil_offset_[j] = kStencilX[j] +
+            kStencilY[j] * static_cast<int>(pi_.stride);
+    }
+    bc_ = kClamped;
+    // Halo and padding lanes stay outside for good
+    memset(mask_, 0, sizeof(float) * pi_.plane_size);
+    ApplyMask([&](float x_, float y_) {
+        return static_cast<bool>(x_ < p_.x__mm && y_ < p_.y__mm);
+    });
+    SetSource(p.x__mm * 0.5f, p.y__mm * 0.5f);
+    SetPickup(0, 0);
+    SetAttenuation(0);
+    SetStiffness(kMaxStiffnessNumber);
+    Reset();
+}
+
+
+void KirchhoffPlate::Reset() {
+    memset(u_curr_, 0, sizeof(float) * pi_.plane_size);
+    memset(u_prev_, 0, sizeof(float) * pi_.plane_size);
+}
+
+
+void KirchhoffPlate::SetBoundaryCondition(BoundaryCondition bc) {
+    bc_ = bc;
+    BuildBoundary_();
+}
+
+
+void KirchhoffPlate::AddNode_(int dx, int dy, float w, float *weight) {
+    for (unsigned int j = 0; j < kNStencil; j++) {
+        if (kStencilX[j] == dx && kStencilY[j] == dy) {
+            weight[j] += w;
+            return;
+        }
+    }
+    assert(false);  // Ghost point resolved outside the stencil?
+}
+
+
+void KirchhoffPlate::AddGhost_(int x, int y, int dx, int dy, float w,
+    float *weight) {
+
+    if (IsNodeInside_(x + dx, y + dy)) {
+        AddNode_(dx, dy, w, weight);
+        return;
+    }
+    // The first nodes outside are the edge, where the plate is held at
+    // zero. Past the edge, the node across it is mirrored: evenly for no
+    // slope, oddly for no curvature.
+    bool axis = (dx == 0 || dy == 0);
+    int ux = (dx > 0) - (dx < 0);
+    int uy = (dy > 0) - (dy < 0);
+    if (axis && std::abs(dx + dy) == 2 && !IsNodeInside_(x + ux, y + uy)) {
+        AddNode_(0, 0, (bc_ == kClamped) ? w : -w, weight);
+    }
+}
+
+
+void KirchhoffPlate::AddFreeEdge_(int x, int y, float *weight) {
+
+    // D4 is the gradient of the bending energy, (with no Poisson effect)
+    //
+    //     1/2 sum(dxx(u)^2) + 1/2 sum(dyy(u)^2) + sum(dxy(u)^2)
+    //
+    // summed over every three nodes in a row or column and every square
+    // of four. Away from the edges that is the plain stencil; on a free
+    // plate the sums just stop where the plate does, so the operator
+    // stays symmetric and no stiffer than the plain one (stable up to the
+    // same stiffness number), whatever the shape.
+    static const float kSecond[3] = { 1.f, -2.f, 1.f };
+    for (int axis = 0; axis < 2; axis++) {
+        int ax = (axis == 0), ay = (axis == 1);
+        // Three nodes centred on P - 1, P, P + 1
+        for (int c = -1; c <= 1; c++) {
+            bool inside = true;
+            for (int t = -1; t <= 1; t++) {
+                inside &= IsNodeInside_(x + (c + t) * ax, y + (c + t) * ay);
+            }
+            if (!inside) {
+                continue;
+            }
+            float coef_p = kSecond[1 - c];  // P sits at t = -c
+            for (int t = -1; t <= 1; t++) {
+                AddNode_((c + t) * ax, (c + t) * ay,
+                    coef_p * kSecond[t + 1], weight);
+            }
+        }
+    }
+    // Squares with P in a corner: (sx, sy) is the opposite corner
+    for (int sx = -1; sx <= 1; sx += 2) {
+        for (int sy = -1; sy <= 1; sy += 2) {
+            if (!IsNodeInside_(x + sx, y) || !IsNodeInside_(x, y + sy) ||
+                !IsNodeInside_(x + sx, y + sy)) {
+                continue;
+            }
+            AddNode_(0, 0, 2.f, weight);
+            AddNode_(sx, 0, -2.f, weight);
+            AddNode_(0, sy, -2.f, weight);
+            AddNode_(sx, sy, 2.f, weight);
+        }
+    }
+}
+
+
+void KirchhoffPlate::BuildBoundary_() {
+
+    n_boundary_ = 0;
+    for (unsigned int y = 0; y < pi_.y_size; y++) {
+        for (unsigned int x = 0; x < pi_.x_size; x++) {
+            if (!IsNodeInside_(x, y)) {
+                continue;
+            }
+            bool near_edge = false;
+            for (unsigned int j = 1; j < kNStencil; j++) {
+                near_edge |= !IsNodeInside_(x + kStencilX[j],
+                    y + kStencilY[j]);
+            }
+            if (!near_edge) {
+                continue;
+            }
+            BoundaryNode_ &node = boundary_[n_boundary_++];
+            node.index = Index_(x, y);
+            for (unsigned int j = 0; j < kNStencil; j++) {
+                node.weight[j] = 0;
+            }
+            if (bc_ == kFree) {
+                AddFreeEdge_(x, y, node.weight);
+                continue;
+            }
+            // Clamped or simply supported
+            for (unsigned int j = 0; j < kNStencil; j++) {
+                AddGhost_(x, y, kStencilX[j], kStencilY[j],
+                    kStencilWeight[j], node.weight);
+            }
+        }
+    }
+}
+
+
+unsigned int KirchhoffPlate::XYtoIndex_(float x, float y) {
+    assert(IsInside(x, y));
+    unsigned int i = x / p_.spatial_res__mm;
+    unsigned int j = y / p_.spatial_res__mm;
+    return Index_(i, j);
+}
+
+
+bool KirchhoffPlate::IsInside(float x, float y) {
+
+    if (!IsWithinExtent(x, p_.x__mm, p_.spatial_res__mm) ||
+        !IsWithinExtent(y, p_.y__mm, p_.spatial_res__mm)) {
+        return false;
+    }
+    unsigned int i = x / p_.spatial_res__mm;
+    unsigned int j = y / p_.spatial_res__mm;
+    return i < pi_.x_size && j < pi_.y_size && IsNodeInside_(i, j);
+}
+
+
+void KirchhoffPlate::SetSource(float x, float y) {
+    source_ = XYtoIndex_(x, y);  // Asserts it's inside the mask
+}
+
+
+void KirchhoffPlate::SetPickup(float x, float y) {
+    pickup_ = XYtoIndex_(x, y);  // Asserts it's inside the mask
+}
+
+
+void KirchhoffPlate::SetAttenuation(float mu) {
+    assert(mu >= 0.f);
+    assert(mu < 1.f);
+    alpha_ = 1 - mu;
+}
+
+
+void KirchhoffPlate::SetStiffness(float mu) {
+    assert(mu > 0.f);
+    assert(mu <= kMaxStiffnessNumber);
+    mu2_ = mu * mu;
+}
+
+
+float KirchhoffPlate::ProcessSample(bool input_present, float input) {
+
+    using V = DSP::SIMD;
+    const V::Vec two = V::Set1(2.f);
+    const V::Vec eight = V::Set1(8.f);
+    const V::Vec twenty = V::Set1(20.f);
+    const V::Vec mu2 = V::Set1(mu2_);
+    const V::Vec alpha = V::Set1(alpha_);
+    const unsigned int s = pi_.stride;
+
+    // Edge nodes first, while their u[n-1] is still there
+    for (unsigned int b = 0; b < n_boundary_; b++) {
+        BoundaryNode_ &node = boundary_[b];
+        const float *u = u_curr_ + node.index;
+        float d4 = 0;
+        for (unsigned int j = 0; j < kNStencil; j++) {
+            d4 += node.weight[j] * u[stencil_offset_[j]];
+        }
+        node.next = 2.f * u[0] - mu2_ * d4 - u_prev_[node.index];
+    }
+
+    // Everything with the plain stencil
+    for (unsigned int y = 0; y < pi_.y_size; y++) {
+        const unsigned int row = Index_(0, y);
+        const float *u = u_curr_ + row;
+        const float *m = mask_ + row;
+        float *u_next = u_prev_ + row;  // Overwrites u[n-1]
+
+        for (unsigned int x = 0; x < pi_.x_padded; x += V::kWidth) {
+            const float *c = u + x;
+            V::Vec centre = V::Load(c);
+            V::Vec near = V::Add(
+                V::Add(V::LoadU(c - 1), V::LoadU(c + 1)),
+                V::Add(V::Load(c - s), V::Load(c + s)));
+            V::Vec diagonal = V::Add(
+                V::Add(V::LoadU(c - s - 1), V::LoadU(c - s + 1)),
+                V::Add(V::LoadU(c + s - 1), V::LoadU(c + s + 1)));
+            V::Vec far = V::Add(
+                V::Add(V::LoadU(c - 2), V::LoadU(c + 2)),
+                V::Add(V::Load(c - 2 * s), V::Load(c + 2 * s)));
+            V::Vec d4 = V::MulAdd(twenty, centre,
+                V::MulAdd(two, diagonal, V::Sub(far, V::Mul(eight, near))));
+            V::Vec acc = V::Sub(V::Sub(V::Mul(two, centre), V::Mul(mu2, d4)),
+                V::Load(u_next + x));
+            acc = V::Mul(V::Mul(acc, alpha), V::Load(m + x));
+            V::Store(u_next + x, acc);
+        }
+    }
+
+    for (unsigned int b = 0; b < n_boundary_; b++) {
+        u_prev_[boundary_[b].index] = alpha_ * boundary_[b].next;
+    }
+
+    if (input_present) {
+        u_prev_[source_] += input;
+    }
+    float output = u_prev_[pickup_];
+
+    // Swap buffers (next->current)
+    float *tmp = u_prev_;
+    u_prev_ = u_curr_;
+    u_curr_ = tmp;
+
+    return output;
+}
+
+
+float KirchhoffPlate::GetStiffnessNumber(float kappa__m2_s,
+    float sample_rate, float spatial_res__mm) {
+    float h = spatial_res__mm * 1e-3f;
+    return kappa__m2_s / (sample_rate * h * h);
+}
+
+
+float KirchhoffPlate::GetMinResolution(float kappa__m2_s,
+    float sample_rate) {
+    // mu = 1/4: h = 2 sqrt(kappa T)
+    return 2.f * std::sqrt(kappa__m2_s / sample_rate) * 1e3f;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file KirchhoffPlate.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-26
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __KIRCHHOFF_PLATE_HPP__
+#define __KIRCHHOFF_PLATE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include "Triangular2DMesh.hpp"
+
+
+/**
+ * @brief Thin stiff plate (cymbals, gongs, plate reverbs...), which a
+ * membrane mesh can't do: waves are dispersive, high partials travel
+ * faster than low ones.
+ *
+ * Kirchhoff plate equation, explicit finite differences on a square grid:
+ *
+ *     u[n+1] = 2 u - mu^2 * D4(u) - u[n-1]
+ *
+ * with D4 the 13-point biharmonic stencil (20 on the node, -8 on the four
+ * nearest, 2 on the diagonals, 1 on the four two spacings away) and
+ * mu = kappa T / h^2 the stiffness number, stable up to 1/4 (see
+ * GetStiffnessNumber()).
+ *
+ * State is two padded, aligned planes (the update overwrites u[n-1] in
+ * place) plus a mask, with two rows and a vector's worth of columns of
+ * halo all round, so the whole grid runs through one SIMD kernel with the
+ * plain stencil. Nodes whose stencil reaches outside the mask then get
+ * their own stencil in a short scalar pass: for clamped and simply
+ * supported edges the values outside are replaced by mirror images (ghost
+ * points), and free edges come from the bending energy of the plate as
+ * masked (see AddFreeEdge_()). Either way, the stencil stays stable up to
+ * the same stiffness number on any shape.
+ *
+ * Memory is allocated externally (see GetMemSize()).
+ */
+class KirchhoffPlate {
+
+ public:
+
+    typedef Triangular2DMesh::Properties Properties;
+
+    enum BoundaryCondition {
+        kClamped,  // No displacement, no slope
+        kSimplySupported,  // No displacement, no bending moment
+        kFree,  // No bending moment, no shear force
+    };
+
+    static size_t GetMemSize(Properties p);
+    static unsigned int GetNodeCount(Properties p);
+    KirchhoffPlate(Properties p, void *mem);
+    void Reset();
+    template <typename MaskFnT>
+    void ApplyMask(MaskFnT mask_fn);
+    void SetBoundaryCondition(BoundaryCondition bc);
+    float ProcessSample(bool input_present, float input);
+    void SetSource(float x, float y);
+    void SetPickup(float x, float y);
+    void SetAttenuation(float mu);
+    /**
+     * @brief Set the stiffness, as a stiffness number
+     *
+     * @param mu kappa T / h^2, in (0, 0.25]
+     */
+    void SetStiffness(float mu);
+    bool IsInside(float x, float y);
+    Properties GetProperties() { return p_; }
+
+    /**
+     * @brief Stiffness number of a plate on a grid
+     *
+     * @param kappa__m2_s Stiffness, sqrt(E H^2 / (12 rho (1 - nu^2)))
+     * for thickness H (m^2/s)
+     * @param sample_rate Hz
+     * @param spatial_res__mm Grid spacing
+     */
+    static float GetStiffnessNumber(float kappa__m2_s, float sample_rate,
+        float spatial_res__mm);
+    /**
+     * @brief Finest stable grid spacing for a plate (stiffness number
+     * 1/4). Coarser grids are cheaper, but cut off below Nyquist.
+     *
+     */
+    static float GetMinResolution(float kappa__m2_s, float sample_rate);
+
+    static constexpr float kMaxStiffnessNumber = 0.25f;
+
+ protected:
+
+    static constexpr unsigned int kNStencil = 13;
+    // Stencil points and their D4 weights; 0 is the node itself
+    static const int kStencilX[kNStencil];
+    static const int kStencilY[kNStencil];
+    static const float kStencilWeight[kNStencil];
+
+    struct Properties_internal_ {
+        unsigned int x_size;
+        unsigned int y_size;
+        unsigned int x_padded;  // Nodes processed per row (whole vectors)
+        unsigned int x_halo;  // Columns of halo before each row
+        unsigned int stride;  // Floats per row, including halo
+        unsigned int plane_size;  // Floats per plane, including halo
+    };
+
+    // A node next to the boundary, with its own D4 stencil
+    struct BoundaryNode_ {
+        unsigned int index;
+        float weight[kNStencil];
+        float next;  // u[n+1], until the SIMD pass is done
+    };
+
+    Properties p_;
+    Properties_internal_ pi_;
+    float *u_curr_;
+    float *u_prev_;
+    float *mask_;  // 1 inside, 0 outside
+    BoundaryNode_ *boundary_;
+    unsigned int n_boundary_;
+    int stencil_offset_[kNStencil];  // Plane index offsets
+    BoundaryCondition bc_;
+    unsigned int source_;  // Plane index
+    unsigned int pickup_;
+    float alpha_;
+    float mu2_;  // Stiffness number squared
+
+    static void GetInternalProperties(Properties &p,
+        Properties_internal_ &pi);
+
+    __attribute__((always_inline)) unsigned int Index_(unsigned int x,
+        unsigned int y) {
+        return (y + 2) * pi_.stride + pi_.x_halo + x;
+    }
+
+    __attribute__((always_inline)) bool IsNodeInside_(int x, int y) {
+        // Halo is outside, and never further than two nodes away
+        return mask_[Index_(x, y)] != 0;
+    }
+
+    unsigned int XYtoIndex_(float x, float y);
+    void BuildBoundary_();
+    void AddGhost_(int x, int y, int dx, int dy, float w, float *weight);
+    void AddNode_(int dx, int dy, float w, float *weight);
+    void AddFreeEdge_(int x, int y, float *weight);
+};
+
+template <typename MaskFnT>
+void KirchhoffPlate::ApplyMask(MaskFnT mask_fn) {
+
+    const float h = p_.spatial_res__mm;
+    for (unsigned int y = 0; y < pi_.y_size; y++) {
+        for (unsigned int x = 0; x < pi_.x_size; x++) {
+            mask_[Index_(x, y)] = mask_fn(x * h, y * h) ? 1.f : 0.f;
+        }
+    }
+    BuildBoundary_();
+}
+
+
+#endif  // __KIRCHHOFF_PLATE_HPP__
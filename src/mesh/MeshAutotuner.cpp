@@ -0,0 +1,177 @@
+/**
+ * @file MeshAutotuner.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-28
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "MeshAutotuner.hpp"
+#include <cassert>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+MeshAutotuner::MeshAutotuner(const std::string &cache_path) :
+        cache_path_(cache_path) {
+    std::string model = GetCPUModel();
+    cpu_hash_ = HashBytes(kHashSeed, model.data(), model.size());
+    Load_();
+}
+
+
+std::string MeshAutotuner::GetCPUModel() {
+
+    std::string model = "unknown";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f == nullptr) {
+        return model;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        // x86 says "model name", ARM says "Hardware" or "CPU part"
+        if (strncmp(line, "model name", 10) == 0 ||
+            strncmp(line, "Hardware", 8) == 0 ||
+            strncmp(line, "CPU part", 8) == 0) {
+            const char *value = strchr(line, ':');
+            if (value != nullptr) {
+                model = value + 1;
+                model.erase(0, model.find_first_not_of(" \t"));
+                model.erase(model.find_last_not_of(" \t\n") + 1);
+                break;
+            }
+        }
+    }
+    fclose(f);
+    return model;
+}
+
+
+void MeshAutotuner::Load_() {
+
+    if (cache_path_.empty()) {
+        return;
+    }
+    FILE *f = fopen(cache_path_.c_str(), "r");
+    if (f == nullptr) {
+        return;
+    }
+    // One decision per line: CPU hash, geometry hash, variant. Anything
+    // else (e.g. a truncated last line) is skipped.
+    char line[128];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        uint64_t cpu, geometry;
+        unsigned int variant;
+        if (sscanf(line, "%" SCNx64 " %" SCNx64 " %u", &cpu, &geometry,
+            &variant) == 3) {
+            decisions_[std::make_pair(cpu, geometry)] = variant;
+        }
+    }
+    fclose(f);
+}
+
+
+bool MeshAutotuner::Save() {
+
+    if (cache_path_.empty()) {
+        return false;
+    }
+    FILE *f = fopen(cache_path_.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+    bool ok = true;
+    for (auto &d : decisions_) {
+        ok &= fprintf(f, "%016" PRIx64 " %016" PRIx64 " %u\n", d.first.first,
+            d.first.second, d.second) > 0;
+    }
+    ok &= fclose(f) == 0;
+    return ok;
+}
+
+
+bool MeshAutotuner::Find(uint64_t geometry_hash, unsigned int &variant) {
+    auto it = decisions_.find(std::make_pair(cpu_hash_, geometry_hash));
+    if (it == decisions_.end()) {
+        return false;
+    }
+    variant = it->second;
+    return true;
+}
+
+
+void MeshAutotuner::Store(uint64_t geometry_hash, unsigned int variant) {
+    decisions_[std::make_pair(cpu_hash_, geometry_hash)] = variant;
+}
+
+
+void MeshAutotuner::Clear() {
+    decisions_.clear();
+}
+
+
+unsigned int MeshAutotuner::TuneBands(Rectilinear3DMesh &mesh,
+    unsigned int max_bands, unsigned int block_size) {
+
+    assert(max_bands >= 1);
+    assert(block_size > 0);
+    unsigned int n_variants = 1;
+    while ((2u << (n_variants - 1)) <= max_bands) {
+        n_variants++;
+    }
+
+    // The winner also depends on how much work a block hands out
+    uint64_t key = mesh.GetGeometryHash();
+    key = HashBytes(key, &max_bands, sizeof(max_bands));
+    key = HashBytes(key, &block_size, sizeof(block_size));
+
+    std::vector<float> out(block_size);
+    auto prepare = [&](unsigned int v) {
+        mesh.StopThreads();
+        mesh.StartThreads(1u << v);
+    };
+    auto run = [&]() {
+        mesh.ProcessBlock(nullptr, out.data(), block_size);
+    };
+    unsigned int best = Select(key, n_variants, prepare, run);
+
+    prepare(best);
+    mesh.Reset();
+    return mesh.GetNumBands();
+}
+
+
+Triangular2DMesh::Kernel MeshAutotuner::TuneKernel(Triangular2DMesh &mesh,
+    unsigned int block_size) {
+
+    assert(block_size > 0);
+    if (!mesh.IsLinear() || mesh.GetNumPorts() > 0) {
+        // Both kernels would time the nodes kernel: nothing to learn
+        mesh.SetKernel(Triangular2DMesh::kKernelNodes);
+        mesh.Reset();
+        return mesh.GetKernel();
+    }
+    uint64_t key = mesh.GetGeometryHash();
+    key = HashBytes(key, &block_size, sizeof(block_size));
+
+    volatile float sink = 0;
+    auto prepare = [&](unsigned int v) {
+        mesh.SetKernel(static_cast<Triangular2DMesh::Kernel>(v));
+    };
+    auto run = [&]() {
+        for (unsigned int n = 0; n < block_size; n++) {
+            sink = sink + mesh.ProcessSample(true, 0.f);
+        }
+    };
+    unsigned int best = Select(key, Triangular2DMesh::kKernelStencil + 1,
+        prepare, run);
+
+    prepare(best);
+    mesh.Reset();
+    return mesh.GetKernel();
+}
@@ -0,0 +1,149 @@
+/**
+ * @file MeshAutotuner.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-28
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __MESH_AUTOTUNER_HPP__
+#define __MESH_AUTOTUNER_HPP__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include "MeshCalibration.hpp"
+#include "MeshHash.hpp"
+#include "Rectilinear3DMesh.hpp"
+#include "Triangular2DMesh.hpp"
+
+
+/**
+ * @brief Pick the fastest of several ways to run the same mesh (kernel
+ * variant, layout, thread count...) by timing each of them on the machine
+ * it'll run on, and remember the winner.
+ *
+ * Decisions are keyed by CPU model and a hash of the geometry, and can be
+ * persisted to a small text file, so later instances on the same machine
+ * skip the search. Entries from other CPUs are kept: the file can live in
+ * a home directory shared between machines.
+ *
+ * Heap-allocated, and timing runs the meshes for real: call it from
+ * setup()/instantiate(), never from the audio thread.
+ */
+class MeshAutotuner {
+
+ public:
+
+    /**
+     * @brief Construct a new MeshAutotuner
+     *
+     * @param cache_path File to load decisions from and Save() them to
+     * (empty: don't persist)
+     */
+    explicit MeshAutotuner(const std::string &cache_path);
+    /**
+     * @brief Write all decisions to the cache file
+     *
+     * @return false if there's no file or it can't be written
+     */
+    bool Save();
+    /**
+     * @brief Decision for a geometry on this CPU
+     *
+     * @return false if there's none yet
+     */
+    bool Find(uint64_t geometry_hash, unsigned int &variant);
+    void Store(uint64_t geometry_hash, unsigned int variant);
+    void Clear();
+    size_t GetSize() { return decisions_.size(); }
+
+    /**
+     * @brief Cached decision for geometry_hash, or else the fastest of
+     * n_variants candidates (stored, not saved).
+     *
+     * Each candidate is set up by prepare(v), untimed, then run() is
+     * called once to warm up and kTimedRuns times against the clock: the
+     * fastest run counts.
+     *
+     * @param geometry_hash Whatever the decision depends on
+     * @param n_variants Number of candidates
+     * @param prepare Functor void(unsigned int variant)
+     * @param run Functor void(), running the prepared candidate
+     * @return unsigned int Winning variant
+     */
+    template <typename PrepareFnT, typename RunFnT>
+    unsigned int Select(uint64_t geometry_hash, unsigned int n_variants,
+        PrepareFnT prepare, RunFnT run);
+
+    /**
+     * @brief Pick the number of bands (see Rectilinear3DMesh::StartThreads())
+     * out of 1, 2, 4... up to max_bands, and leave the mesh running with
+     * it. Mesh state is reset.
+     *
+     * @param mesh Mesh with its final mask
+     * @param max_bands Most threads to use (e.g. the number of cores)
+     * @param block_size Host block size
+     * @return unsigned int Number of bands running
+     */
+    unsigned int TuneBands(Rectilinear3DMesh &mesh, unsigned int max_bands,
+        unsigned int block_size);
+    /**
+     * @brief Pick the kernel of a plain 2D mesh (see
+     * Triangular2DMesh::Kernel) and leave it set. Mesh state is reset.
+     * With tension modulation or ports, it's kKernelNodes, untimed.
+     *
+     * @param mesh Mesh with its final mask
+     * @param block_size Host block size
+     * @return Triangular2DMesh::Kernel Kernel set
+     */
+    Triangular2DMesh::Kernel TuneKernel(Triangular2DMesh &mesh,
+        unsigned int block_size);
+
+    /**
+     * @brief CPU model (from /proc/cpuinfo where available)
+     *
+     */
+    static std::string GetCPUModel();
+
+    static constexpr unsigned int kTimedRuns = 3;
+
+ protected:
+
+    std::string cache_path_;
+    uint64_t cpu_hash_;
+    // (CPU hash, geometry hash) -> variant
+    std::map<std::pair<uint64_t, uint64_t>, unsigned int> decisions_;
+
+    void Load_();
+};
+
+template <typename PrepareFnT, typename RunFnT>
+unsigned int MeshAutotuner::Select(uint64_t geometry_hash,
+    unsigned int n_variants, PrepareFnT prepare, RunFnT run) {
+
+    unsigned int best = 0;
+    if (Find(geometry_hash, best) && best < n_variants) {
+        return best;
+    }
+
+    float best_time = 0;
+    for (unsigned int v = 0; v < n_variants; v++) {
+        prepare(v);
+        run();
+        float time = MeshCalibration::TimeFastestRun(kTimedRuns, run);
+        if (v == 0 || time < best_time) {
+            best_time = time;
+            best = v;
+        }
+    }
+    Store(geometry_hash, best);
+    return best;
+}
+
+
+#endif  // __MESH_AUTOTUNER_HPP__
@@ -0,0 +1,31 @@
+/**
+ * @file MeshBounds.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-14
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __MESH_BOUNDS_HPP__
+#define __MESH_BOUNDS_HPP__
+
+
+/**
+ * @brief Whether a coordinate is within a mesh's extent, the last node
+ * being up to one spatial resolution past it. Check before converting to
+ * a node index: out-of-range floats don't convert to unsigned. Also
+ * rejects NaN.
+ *
+ * @param v Coordinate (mm)
+ * @param extent__mm Size of the mesh along that axis
+ * @param res__mm Spatial resolution
+ */
+inline bool IsWithinExtent(float v, float extent__mm, float res__mm) {
+    return v >= 0.f && v < extent__mm + res__mm;
+}
+
+
+#endif  // __MESH_BOUNDS_HPP__
@@ -0,0 +1,144 @@
+/**
+ * @file MeshCalibration.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-14
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "MeshCalibration.hpp"
+#include <cassert>
+#include <vector>
+
+
+float MeshCalibration::MeasureSampleCost(Triangular2DMesh::Properties p,
+    unsigned int n_samples) {
+
+    std::vector<char> mem(Triangular2DMesh::GetMemSize(p));
+    Triangular2DMesh mesh(p, mem.data());
+
+    // Cheap LCG noise keeps the mesh busy with non-trivial values
+    // (a silent mesh would time a best case that never happens)
+    uint32_t seed = 0x12345678;
+    auto noise = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) * (1.f / 16777216.f) - 0.5f;
+    };
+
+    // Warm up caches and branch predictors before timing
+    float sink = 0;
+    for (unsigned int n = 0; n < (n_samples >> 2) + 1; n++) {
+        sink += mesh.ProcessSample(true, noise());
+    }
+
+    float best = TimeFastestRun(kTimedRuns, [&]() {
+        for (unsigned int n = 0; n < n_samples; n++) {
+            sink += mesh.ProcessSample(true, noise());
+        }
+    });
+
+    // Make sure the loop above doesn't get optimised out
+    volatile float keep = sink;
+    (void) keep;
+
+    return best / static_cast<float>(n_samples);
+}
+
+
+Triangular2DMesh::Properties MeshCalibration::MakeProperties_(Budget &b,
+    float res__mm) {
+    return Triangular2DMesh::Properties { b.x__mm, b.y__mm, res__mm };
+}
+
+
+MeshCalibration::Selection MeshCalibration::Evaluate(Budget b,
+    float res__mm, float cost_per_sample) {
+    Selection s;
+    s.p = MakeProperties_(b, res__mm);
+    s.block_cost__s = cost_per_sample * b.block_size;
+    s.cpu_fraction = cost_per_sample * b.sample_rate;
+    s.within_budget = cost_per_sample <= b.cpu_fraction / b.sample_rate;
+    return s;
+}
+
+
+MeshCalibration::Selection MeshCalibration::SelectResolution(Budget b) {
+
+    assert(b.sample_rate > 0);
+    assert(b.cpu_fraction > 0);
+    assert(b.min_res__mm > 0 && b.min_res__mm <= b.max_res__mm);
+
+    const float budget_per_sample = b.cpu_fraction / b.sample_rate;
+
+    // Coarsest mesh first: if even that doesn't fit, there's nothing
+    // to choose from
+    float res_coarse = b.max_res__mm;
+    float nodes_coarse = Triangular2DMesh::GetNodeCount(
+        MakeProperties_(b, res_coarse));
+    float cost_coarse = MeasureSampleCost(MakeProperties_(b, res_coarse),
+        kProbeSamples);
+    if (cost_coarse > budget_per_sample) {
+        return Evaluate(b, res_coarse, cost_coarse);
+    }
+
+    // Cost model: cost = fixed + per_node * nodes. Start by assuming
+    // all of the coarse mesh's cost is per-node, refine with each probe.
+    float per_node = cost_coarse / nodes_coarse;
+    float fixed = 0;
+
+    // Finest resolution whose node count fits the model (node count is
+    // monotonically non-increasing with resolution, so bisect)
+    auto res_for_budget = [&]() {
+        float target_nodes = (budget_per_sample - fixed) / per_node;
+        float lo = b.min_res__mm;
+        float hi = b.max_res__mm;
+        if (Triangular2DMesh::GetNodeCount(MakeProperties_(b, lo))
+                <= target_nodes) {
+            return lo;
+        }
+        for (unsigned int n = 0; n < 32; n++) {
+            float mid = 0.5f * (lo + hi);
+            if (Triangular2DMesh::GetNodeCount(MakeProperties_(b, mid))
+                    <= target_nodes) {
+                hi = mid;
+            } else {
+                lo = mid;
+            }
+        }
+        return hi;
+    };
+
+    float res = res_for_budget();
+    float best_res = res_coarse;
+    float best_cost = cost_coarse;
+    for (unsigned int n = 0; n < kMaxRefinements; n++) {
+        if (res >= res_coarse) {
+            break;
+        }
+        float nodes = Triangular2DMesh::GetNodeCount(MakeProperties_(b, res));
+        float cost = MeasureSampleCost(MakeProperties_(b, res),
+            kProbeSamples);
+        if (cost <= budget_per_sample) {
+            best_res = res;
+            best_cost = cost;
+            break;
+        }
+        // Overshot: refit the model through the two probes and never
+        // step finer than the resolution that just failed
+        if (nodes > nodes_coarse) {
+            per_node = (cost - cost_coarse) / (nodes - nodes_coarse);
+            fixed = cost - per_node * nodes;
+            if (per_node <= 0 || fixed < 0) {
+                per_node = cost / nodes;
+                fixed = 0;
+            }
+        }
+        float refit = res_for_budget();
+        res = (refit > res * kCoarsenFactor) ? refit : res * kCoarsenFactor;
+    }
+
+    return Evaluate(b, best_res, best_cost);
+}
@@ -0,0 +1,143 @@
+/**
+ * @file MeshCalibration.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-14
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __MESH_CALIBRATION_HPP__
+#define __MESH_CALIBRATION_HPP__
+
+#include <chrono>
+#include "Triangular2DMesh.hpp"
+
+
+/**
+ * @brief Pick the mesh spatial resolution from a CPU budget rather than
+ * by hand, by timing the mesh kernel on the machine it'll run on.
+ *
+ * Calibration allocates and runs throwaway meshes, so call it from
+ * setup()/instantiate(), never from the audio thread.
+ */
+class MeshCalibration {
+
+ public:
+
+    /**
+     * @brief What the caller can afford, and the size of the membrane.
+     *
+     */
+    struct Budget {
+        float x__mm;
+        float y__mm;
+        float sample_rate;
+        unsigned int block_size;
+        float cpu_fraction;  // Of one core, for a single mesh instance
+        float min_res__mm;  // Finest resolution worth trying
+        float max_res__mm;  // Coarsest resolution acceptable
+    };
+
+    /**
+     * @brief Outcome of the calibration.
+     *
+     */
+    struct Selection {
+        Triangular2DMesh::Properties p;
+        float block_cost__s;  // Predicted time to process one block
+        float cpu_fraction;  // Predicted share of the CPU
+        bool within_budget;  // False if even max_res__mm is too expensive
+    };
+
+    /**
+     * @brief Time the mesh kernel and choose the finest resolution
+     * that keeps one mesh instance within budget.
+     *
+     * @param b CPU budget and membrane size
+     * @return Selection Chosen properties and predicted cost
+     */
+    static Selection SelectResolution(Budget b);
+
+    /**
+     * @brief Predicted cost and budget verdict for a resolution, given its
+     * measured cost per sample.
+     *
+     * @param b CPU budget and membrane size
+     * @param res__mm Spatial resolution
+     * @param cost_per_sample Seconds per sample (see MeasureSampleCost())
+     * @return Selection Properties, predicted cost and verdict
+     */
+    static Selection Evaluate(Budget b, float res__mm,
+        float cost_per_sample);
+
+    /**
+     * @brief Measure the average time ProcessSample() takes for a given
+     * mesh, with the source being excited (fastest of kTimedRuns runs).
+     *
+     * @param p Mesh properties
+     * @param n_samples Number of samples to time
+     * @return float Seconds per sample
+     */
+    static float MeasureSampleCost(Triangular2DMesh::Properties p,
+        unsigned int n_samples);
+
+    /**
+     * @brief Time run() n_runs times and keep the fastest: a preemption or
+     * an interrupt only ever adds time
+     *
+     * @param n_runs Number of timed runs
+     * @param run Functor void()
+     * @return float Seconds taken by the fastest run
+     */
+    template <typename RunFnT>
+    static float TimeFastestRun(unsigned int n_runs, RunFnT run);
+
+ protected:
+
+    /**
+     * @brief Number of samples timed for each probe mesh
+     *
+     */
+    static constexpr unsigned int kProbeSamples = 512;
+    /**
+     * @brief Number of timed runs per measurement; the fastest one counts
+     *
+     */
+    static constexpr unsigned int kTimedRuns = 3;
+    /**
+     * @brief Number of times the chosen resolution gets re-measured
+     * (and coarsened) before giving up on the prediction
+     *
+     */
+    static constexpr unsigned int kMaxRefinements = 8;
+    /**
+     * @brief Resolution step when the measured cost overshoots the budget
+     *
+     */
+    static constexpr float kCoarsenFactor = 1.05f;
+
+    static Triangular2DMesh::Properties MakeProperties_(Budget &b,
+        float res__mm);
+};
+
+template <typename RunFnT>
+float MeshCalibration::TimeFastestRun(unsigned int n_runs, RunFnT run) {
+
+    float best = 0;
+    for (unsigned int r = 0; r < n_runs; r++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto stop = std::chrono::steady_clock::now();
+        std::chrono::duration<float> elapsed = stop - start;
+        if (r == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+
+#endif  // __MESH_CALIBRATION_HPP__
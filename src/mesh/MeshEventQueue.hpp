@@ -0,0 +1,211 @@
+/**
+ * @file MeshEventQueue.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-12
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __MESH_EVENT_QUEUE_HPP__
+#define __MESH_EVENT_QUEUE_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "MeshBounds.hpp"
+#include "SPSCQueue.hpp"
+
+
+/**
+ * @brief Sample-accurate parameter changes for a mesh.
+ *
+ * Changes of source, pickup and attenuation are timestamped in samples
+ * and queued from one (control) thread; the audio thread runs the mesh
+ * through ProcessSample() or ProcessBuffer() here instead of directly,
+ * and each change lands exactly on its sample, however the host splits
+ * its blocks.
+ *
+ * Positions off the mesh's extent, attenuations outside [0, 1),
+ * non-finite values, and timestamps earlier than the previous event are
+ * refused when pushed. Positions are checked against the mesh mask on the
+ * audio thread, which owns the mask (it may be edited there, e.g. by
+ * clamping), when the event is due: those outside are dropped rather
+ * than asserted on, and counted (see GetRejected()). Events whose time
+ * has already passed are applied on the next sample.
+ *
+ * Works with any mesh with SetSource(), SetPickup(), SetAttenuation(),
+ * IsInside(), GetProperties() and ProcessSample(). Memory is allocated
+ * externally (see GetMemSize()).
+ */
+template <typename MeshT_>
+class MeshEventQueue {
+
+ public:
+
+    enum EventType {
+        kSource,
+        kPickup,
+        kAttenuation,
+    };
+
+    struct Event {
+        uint64_t time;  // Samples since construction or Reset()
+        EventType type;
+        float a;  // x, or attenuation
+        float b;  // y
+    };
+
+    /**
+     * @brief Memory needed for a queue of up to capacity events
+     *
+     */
+    static size_t GetMemSize(unsigned int capacity) {
+        return DSP::SPSCQueue<Event>::GetMemSize(capacity);
+    }
+    /**
+     * @brief Construct a new MeshEventQueue around a mesh
+     *
+     * @param mesh Mesh the events are applied to
+     * @param capacity Maximum number of pending events (power of 2)
+     * @param mem Memory of GetMemSize(capacity) bytes. Allocate externally.
+     */
+    MeshEventQueue(MeshT_ &mesh, unsigned int capacity, void *mem) :
+            mesh_(mesh),
+            p_(mesh.GetProperties()),
+            queue_(capacity, mem),
+            now_(0),
+            rejected_(0),
+            last_time_(0) {}
+
+    /**
+     * @brief Restart the sample clock. Call with no events pending and
+     * nothing pushing (e.g. from activate()).
+     *
+     */
+    void Reset() {
+        Event e;
+        while (queue_.Pop(e)) {}
+        now_.store(0, std::memory_order_relaxed);
+        last_time_ = 0;
+    }
+
+    /**
+     * @name Producer
+     * Call from one thread at a time (may be the audio thread itself).
+     * Each returns false, leaving the queue untouched, if the event is
+     * out of range or the queue is full.
+     */
+    ///@{
+    bool PushSource(uint64_t time, float x, float y) {
+        return IsOnMesh_(x, y) && Push_({ time, kSource, x, y });
+    }
+    bool PushPickup(uint64_t time, float x, float y) {
+        return IsOnMesh_(x, y) && Push_({ time, kPickup, x, y });
+    }
+    bool PushAttenuation(uint64_t time, float mu) {
+        return (mu >= 0.f && mu < 1.f) &&
+            Push_({ time, kAttenuation, mu, 0.f });
+    }
+    /**
+     * @brief Current sample time, as last published by the audio thread
+     * (at the end of each sample or buffer)
+     *
+     */
+    uint64_t GetTime() { return now_.load(std::memory_order_acquire); }
+    /**
+     * @brief Events accepted by Push*() but dropped by the audio thread
+     * when due (position off the mask), so far
+     *
+     */
+    unsigned int GetRejected() {
+        return rejected_.load(std::memory_order_relaxed);
+    }
+    ///@}
+
+    /**
+     * @name Consumer
+     * Audio thread only.
+     */
+    ///@{
+    /**
+     * @brief Apply the events due at this sample, then run the mesh
+     *
+     */
+    float ProcessSample(bool input_present, float input) {
+        uint64_t now = now_.load(std::memory_order_relaxed);
+        ApplyDue_(now);
+        float out = mesh_.ProcessSample(input_present, input);
+        now_.store(now + 1, std::memory_order_release);
+        return out;
+    }
+    /**
+     * @brief Run the mesh over a buffer, applying each event at its sample
+     * (in-place allowed)
+     *
+     */
+    void ProcessBuffer(const float *in, float *out, unsigned int n_samples) {
+        uint64_t now = now_.load(std::memory_order_relaxed);
+        for (unsigned int n = 0; n < n_samples; n++) {
+            ApplyDue_(now + n);
+            out[n] = mesh_.ProcessSample(true, in[n]);
+        }
+        now_.store(now + n_samples, std::memory_order_release);
+    }
+    ///@}
+
+ protected:
+
+    MeshT_ &mesh_;
+    const typename MeshT_::Properties p_;  // Copy for the producer
+    DSP::SPSCQueue<Event> queue_;
+    std::atomic<uint64_t> now_;
+    std::atomic<unsigned int> rejected_;  // Consumer side
+    uint64_t last_time_;  // Producer side
+
+    // Extent only: the mask is the audio thread's
+    bool IsOnMesh_(float x, float y) {
+        return IsWithinExtent(x, p_.x__mm, p_.spatial_res__mm) &&
+            IsWithinExtent(y, p_.y__mm, p_.spatial_res__mm);
+    }
+
+    bool Push_(const Event &e) {
+        if (e.time < last_time_ || !queue_.Push(e)) {
+            return false;
+        }
+        last_time_ = e.time;
+        return true;
+    }
+
+    __attribute__((always_inline)) void ApplyDue_(uint64_t now) {
+        const Event *e;
+        while ((e = queue_.Front()) != nullptr && e->time <= now) {
+            // Positions off the mask are dropped rather than asserted on
+            switch (e->type) {
+            case kSource:
+                if (mesh_.IsInside(e->a, e->b)) {
+                    mesh_.SetSource(e->a, e->b);
+                } else {
+                    rejected_.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            case kPickup:
+                if (mesh_.IsInside(e->a, e->b)) {
+                    mesh_.SetPickup(e->a, e->b);
+                } else {
+                    rejected_.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            case kAttenuation:
+                mesh_.SetAttenuation(e->a);
+                break;
+            }
+            queue_.Pop();
+        }
+    }
+};
+
+
+#endif  // __MESH_EVENT_QUEUE_HPP__
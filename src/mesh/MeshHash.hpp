@@ -0,0 +1,44 @@
+/**
+ * @file MeshHash.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-28
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __MESH_HASH_HPP__
+#define __MESH_HASH_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief Hash of nothing (FNV-1a offset basis): start from here
+ *
+ */
+constexpr uint64_t kHashSeed = 0xcbf29ce484222325ull;
+
+/**
+ * @brief Fold bytes into an FNV-1a hash, e.g. of what shapes a mesh, to
+ * key caches and decisions on
+ *
+ * @param hash Hash so far (kHashSeed to start)
+ * @param data Bytes to add
+ * @param n_bytes Number of bytes
+ * @return uint64_t Updated hash
+ */
+inline uint64_t HashBytes(uint64_t hash, const void *data, size_t n_bytes) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t n = 0; n < n_bytes; n++) {
+        hash ^= bytes[n];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+
+#endif  // __MESH_HASH_HPP__
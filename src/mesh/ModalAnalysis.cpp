@@ -0,0 +1,263 @@
+/**
+ * @file ModalAnalysis.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-21
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "ModalAnalysis.hpp"
+#include "FFT.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+
+unsigned int ModalAnalysis::ExtractModes(Triangular2DMesh &mesh,
+    Settings s, DSP::ModalBank::Mode *modes) {
+
+    const unsigned int length = s.ir_length;
+    assert(length >= 8);
+    assert((length & (length - 1)) == 0);  // Power of 2 only
+    assert(mesh.IsLinear());  // Modes only make sense for a linear mesh
+
+    // Driving-point and transfer impulse responses
+    std::vector<float> ir_ss(length);
+    std::vector<float> ir_sp(length);
+    mesh.SetSource(s.source_x, s.source_y);
+    mesh.SetPickup(s.source_x, s.source_y);
+    mesh.RenderImpulseResponse(ir_ss.data(), length);
+    mesh.SetPickup(s.pickup_x, s.pickup_y);
+    mesh.RenderImpulseResponse(ir_sp.data(), length);
+
+    // Frequencies and decays
+    std::vector<float> omega(s.n_modes);
+    unsigned int n_modes = FindPeaks_(ir_sp.data(), length, s.n_modes,
+        omega.data());
+    std::vector<float> radius(n_modes);
+    for (unsigned int m = 0; m < n_modes; m++) {
+        radius[m] = EstimateRadius_(ir_sp.data(), length, omega[m]);
+    }
+
+    // Amplitudes
+    std::vector<double> coef_sp(2 * n_modes);
+    std::vector<double> coef_ss(2 * n_modes);
+    if (n_modes == 0 || !FitAmplitudes_(ir_sp.data(), ir_ss.data(), length,
+            omega.data(), radius.data(), n_modes,
+            coef_sp.data(), coef_ss.data())) {
+        return 0;
+    }
+
+    // Split amplitudes into source/pickup gains: at the driving point
+    // each mode contributes gain_source^2
+    std::vector<DSP::ModalBank::Mode> found(n_modes);
+    std::vector<float> energy(n_modes);
+    for (unsigned int m = 0; m < n_modes; m++) {
+        double amp_sp = std::hypot(coef_sp[2 * m], coef_sp[2 * m + 1]);
+        double amp_ss = std::hypot(coef_ss[2 * m], coef_ss[2 * m + 1]);
+        double gain_source = std::sqrt(amp_ss);
+        double gain_pickup = amp_sp;
+        if (gain_source > 1e-12) {
+            gain_pickup /= gain_source;
+        } else {
+            gain_source = 1.;
+        }
+        found[m].omega = omega[m];
+        found[m].radius = radius[m];
+        found[m].gain_source = static_cast<float>(gain_source);
+        found[m].gain_pickup = static_cast<float>(gain_pickup);
+        found[m].phase = static_cast<float>(
+            std::atan2(-coef_sp[2 * m + 1], coef_sp[2 * m]));
+        // Energy of the damped sinusoid at the pickup
+        energy[m] = static_cast<float>(amp_sp * amp_sp /
+            (1. - static_cast<double>(radius[m]) * radius[m]));
+    }
+
+    // Strongest first
+    std::vector<unsigned int> order(n_modes);
+    for (unsigned int m = 0; m < n_modes; m++) {
+        order[m] = m;
+    }
+    std::sort(order.begin(), order.end(),
+        [&](unsigned int a, unsigned int b) { return energy[a] > energy[b]; });
+    for (unsigned int m = 0; m < n_modes; m++) {
+        modes[m] = found[order[m]];
+    }
+
+    return n_modes;
+}
+
+
+unsigned int ModalAnalysis::FindPeaks_(const float *ir, unsigned int length,
+    unsigned int max_peaks, float *omega) {
+
+    // Hann-windowed magnitude spectrum
+    std::vector<char> fft_mem(DSP::FFT::GetMemSize(length));
+    DSP::FFT fft(length, fft_mem.data());
+    std::vector<float> windowed(length);
+    std::vector<float> spectrum(length + 2);
+    for (unsigned int n = 0; n < length; n++) {
+        float w = 0.5f - 0.5f * std::cos(2.f * M_PI * n / length);
+        windowed[n] = ir[n] * w;
+    }
+    fft.ForwardReal(windowed.data(), spectrum.data());
+    const unsigned int n_bins = (length >> 1) + 1;
+    std::vector<float> mag(n_bins);
+    for (unsigned int k = 0; k < n_bins; k++) {
+        mag[k] = std::hypot(spectrum[2 * k], spectrum[2 * k + 1]);
+    }
+
+    // Local maxima, loudest first
+    std::vector<unsigned int> peaks;
+    for (unsigned int k = 1; k < n_bins - 1; k++) {
+        if (mag[k] > mag[k - 1] && mag[k] >= mag[k + 1] && mag[k] > 0) {
+            peaks.push_back(k);
+        }
+    }
+    std::sort(peaks.begin(), peaks.end(),
+        [&](unsigned int a, unsigned int b) { return mag[a] > mag[b]; });
+    unsigned int n_peaks = std::min<unsigned int>(max_peaks, peaks.size());
+
+    // Refine with a parabola through the log-magnitudes around each peak
+    for (unsigned int p = 0; p < n_peaks; p++) {
+        unsigned int k = peaks[p];
+        float alpha = std::log(mag[k - 1] + 1e-30f);
+        float beta = std::log(mag[k]);
+        float gamma = std::log(mag[k + 1] + 1e-30f);
+        float denom = alpha - 2.f * beta + gamma;
+        float delta = (denom < 0) ? 0.5f * (alpha - gamma) / denom : 0;
+        omega[p] = 2.f * M_PI * (static_cast<float>(k) + delta) / length;
+    }
+
+    return n_peaks;
+}
+
+
+float ModalAnalysis::EstimateRadius_(const float *ir, unsigned int length,
+    float omega) {
+
+    // Windowed DFT at omega over overlapping frames: a damped sinusoid's
+    // log-magnitude falls by log(radius) per sample, so regress on it
+    const unsigned int frame = length >> 2;
+    const unsigned int hop = frame >> 1;
+    const unsigned int n_frames = (length - frame) / hop + 1;
+    double sum_t = 0, sum_l = 0, sum_tt = 0, sum_tl = 0;
+    for (unsigned int f = 0; f < n_frames; f++) {
+        const float *x = ir + f * hop;
+        double re = 0, im = 0;
+        for (unsigned int n = 0; n < frame; n++) {
+            double w = 0.5 - 0.5 * std::cos(2. * M_PI * n / frame);
+            double phase = omega * static_cast<double>(n);
+            re += x[n] * w * std::cos(phase);
+            im -= x[n] * w * std::sin(phase);
+        }
+        double t = static_cast<double>(f * hop);
+        double l = std::log(std::hypot(re, im) + 1e-30);
+        sum_t += t;
+        sum_l += l;
+        sum_tt += t * t;
+        sum_tl += t * l;
+    }
+    double slope = (n_frames * sum_tl - sum_t * sum_l) /
+        (n_frames * sum_tt - sum_t * sum_t);
+    double r = std::exp(slope);
+    return static_cast<float>(std::min<double>(r, kMaxRadius));
+}
+
+
+bool ModalAnalysis::FitAmplitudes_(const float *ir_sp, const float *ir_ss,
+    unsigned int length, const float *omega, const float *radius,
+    unsigned int n_modes, double *coef_sp, double *coef_ss) {
+
+    // Least squares on the basis r^n cos(wn), r^n sin(wn) of every mode:
+    // build the normal equations G x = rhs for both responses at once
+    const unsigned int n_basis = 2 * n_modes;
+    std::vector<double> gram(n_basis * n_basis, 0.);
+    std::vector<double> rhs_sp(n_basis, 0.);
+    std::vector<double> rhs_ss(n_basis, 0.);
+    std::vector<double> basis(n_basis);
+    std::vector<double> step_re(n_modes);
+    std::vector<double> step_im(n_modes);
+    for (unsigned int m = 0; m < n_modes; m++) {
+        // Basis generated by complex rotation, start at r^0 e^0
+        basis[2 * m] = 1.;
+        basis[2 * m + 1] = 0.;
+        step_re[m] = radius[m] * std::cos(static_cast<double>(omega[m]));
+        step_im[m] = radius[m] * std::sin(static_cast<double>(omega[m]));
+    }
+    for (unsigned int n = 0; n < length; n++) {
+        for (unsigned int i = 0; i < n_basis; i++) {
+            double bi = basis[i];
+            rhs_sp[i] += bi * ir_sp[n];
+            rhs_ss[i] += bi * ir_ss[n];
+            double *row = &gram[i * n_basis];
+            for (unsigned int j = i; j < n_basis; j++) {
+                row[j] += bi * basis[j];
+            }
+        }
+        for (unsigned int m = 0; m < n_modes; m++) {
+            double re = basis[2 * m];
+            double im = basis[2 * m + 1];
+            basis[2 * m] = re * step_re[m] - im * step_im[m];
+            basis[2 * m + 1] = re * step_im[m] + im * step_re[m];
+        }
+    }
+
+    // Mirror upper triangle, regularise (close modes make G ill-posed)
+    double max_diag = 0;
+    for (unsigned int i = 0; i < n_basis; i++) {
+        max_diag = std::max(max_diag, gram[i * n_basis + i]);
+        for (unsigned int j = 0; j < i; j++) {
+            gram[i * n_basis + j] = gram[j * n_basis + i];
+        }
+    }
+    for (unsigned int i = 0; i < n_basis; i++) {
+        gram[i * n_basis + i] += 1e-9 * max_diag;
+    }
+
+    // Cholesky, in place (lower triangle)
+    for (unsigned int j = 0; j < n_basis; j++) {
+        double d = gram[j * n_basis + j];
+        for (unsigned int k = 0; k < j; k++) {
+            d -= gram[j * n_basis + k] * gram[j * n_basis + k];
+        }
+        if (d <= 0) {
+            return false;
+        }
+        d = std::sqrt(d);
+        gram[j * n_basis + j] = d;
+        for (unsigned int i = j + 1; i < n_basis; i++) {
+            double v = gram[i * n_basis + j];
+            for (unsigned int k = 0; k < j; k++) {
+                v -= gram[i * n_basis + k] * gram[j * n_basis + k];
+            }
+            gram[i * n_basis + j] = v / d;
+        }
+    }
+
+    // Forward and back substitution for both right-hand sides
+    double *rhs[2] = { rhs_sp.data(), rhs_ss.data() };
+    double *coef[2] = { coef_sp, coef_ss };
+    for (unsigned int r = 0; r < 2; r++) {
+        double *y = rhs[r];
+        for (unsigned int i = 0; i < n_basis; i++) {
+            for (unsigned int k = 0; k < i; k++) {
+                y[i] -= gram[i * n_basis + k] * y[k];
+            }
+            y[i] /= gram[i * n_basis + i];
+        }
+        for (unsigned int i = n_basis; i-- > 0;) {
+            for (unsigned int k = i + 1; k < n_basis; k++) {
+                y[i] -= gram[k * n_basis + i] * y[k];
+            }
+            y[i] /= gram[i * n_basis + i];
+            coef[r][i] = y[i];
+        }
+    }
+
+    return true;
+}
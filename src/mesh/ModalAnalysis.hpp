@@ -0,0 +1,81 @@
+/**
+ * @file ModalAnalysis.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-09-21
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __MODAL_ANALYSIS_HPP__
+#define __MODAL_ANALYSIS_HPP__
+
+#include "Triangular2DMesh.hpp"
+#include "ModalBank.hpp"
+
+
+/**
+ * @brief Offline extraction of the dominant modes of a mesh, so that a
+ * DSP::ModalBank can stand in for it when geometry, boundary and
+ * attenuation are fixed.
+ *
+ * The mesh is linear and time-invariant, so each mode is estimated from
+ * impulse responses: peaks of the source->pickup spectrum give the
+ * frequencies, a straight line fitted to each mode's log-magnitude over
+ * overlapping frames (windowed DFT at its frequency) gives the radii, and
+ * a least-squares fit of damped sinusoids gives the amplitudes. A second,
+ * driving-point response (source->source) splits each amplitude into
+ * source and pickup gains.
+ *
+ * Allocates, and runs the mesh for a few thousand samples: not for the
+ * audio thread.
+ */
+class ModalAnalysis {
+
+ public:
+
+    struct Settings {
+        float source_x;
+        float source_y;
+        float pickup_x;
+        float pickup_y;
+        unsigned int n_modes;  // Modes wanted (fewer if there aren't)
+        unsigned int ir_length;  // Samples analysed (power of 2)
+    };
+
+    /**
+     * @brief Extract the strongest modes of a mesh configuration.
+     * The mesh is left reset, with source and pickup at the analysed
+     * positions.
+     *
+     * @param mesh Mesh, with mask and attenuation already applied
+     * @param s Analysis settings
+     * @param modes Output array, at least s.n_modes long, sorted by
+     * decreasing energy
+     * @return unsigned int Number of modes found
+     */
+    static unsigned int ExtractModes(Triangular2DMesh &mesh, Settings s,
+        DSP::ModalBank::Mode *modes);
+
+ protected:
+
+    /**
+     * @brief Largest pole radius assigned to a mode: keeps resonators
+     * of a lossless mesh bounded
+     *
+     */
+    static constexpr float kMaxRadius = 0.99999f;
+
+    static unsigned int FindPeaks_(const float *ir, unsigned int length,
+        unsigned int max_peaks, float *omega);
+    static float EstimateRadius_(const float *ir, unsigned int length,
+        float omega);
+    static bool FitAmplitudes_(const float *ir_sp, const float *ir_ss,
+        unsigned int length, const float *omega, const float *radius,
+        unsigned int n_modes, double *coef_sp, double *coef_ss);
+};
+
+
+#endif  // __MODAL_ANALYSIS_HPP__
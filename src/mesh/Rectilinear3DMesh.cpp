@@ -0,0 +1,333 @@
+/**
+ * @file Rectilinear3DMesh.cpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-22
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "Rectilinear3DMesh.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include "MeshBounds.hpp"
+#include "MeshHash.hpp"
+#include "SIMD.hpp"
+
+
+void Rectilinear3DMesh::GetInternalProperties(Properties &p,
+    Properties_internal_ &pi) {
+
+    pi.x_size = std::ceil(p.x__mm / p.spatial_res__mm);
+    pi.y_size = std::ceil(p.y__mm / p.spatial_res__mm);
+    pi.z_size = std::ceil(p.z__mm / p.spatial_res__mm);
+    // Rows are processed in whole vectors: the lanes past the end of a
+    // row are masked out. A vector of halo before each row keeps the rows
+    // (and so the north/south/up/down reads) aligned.
+    pi.x_padded = DSP::SIMD::PadToWidth(pi.x_size);
+    pi.x_halo = DSP::SIMD::kWidth;
+    pi.stride = pi.x_halo + DSP::SIMD::PadToWidth(pi.x_padded + 1);
+    pi.slice_size = static_cast<size_t>(pi.y_size + 2) * pi.stride;
+    pi.volume_size = (pi.z_size + 2) * pi.slice_size;
+}
+
+
+size_t Rectilinear3DMesh::GetMemSize(Properties p) {
+
+    Properties_internal_ pi;
+    GetInternalProperties(p, pi);
+    // Current, previous, mask
+    return 3 * pi.volume_size * sizeof(float) + DSP::SIMD::kAlignment;
+}
+
+
+size_t Rectilinear3DMesh::GetNodeCount(Properties p) {
+
+    Properties_internal_ pi;
+    GetInternalProperties(p, pi);
+    return static_cast<size_t>(pi.x_size) * pi.y_size * pi.z_size;
+}
+
+
+Rectilinear3DMesh::Rectilinear3DMesh(Properties p, void *mem,
+    unsigned int n_bands) :
+        barrier_(1) {
+
+    p_ = p;
+    GetInternalProperties(p, pi_);
+    u_curr_ = DSP::SIMD::Align<float>(mem);
+    u_prev_ = u_curr_ + pi_.volume_size;
+    mask_ = u_prev_ + pi_.volume_size;
+    SetBands_(1);
+    // Bands first touch their own memory, before the mask and Reset()
+    // below write to all of it (that doesn't move pages once placed)
+    StartThreads(n_bands);
+    // Halo and padding lanes stay outside for good
+    memset(mask_, 0, sizeof(float) * pi_.volume_size);
+    ApplyMask([&](float x_, float y_, float z_) {
+        return static_cast<bool>(x_ < p_.x__mm && y_ < p_.y__mm &&
+            z_ < p_.z__mm);
+    });
+    SetSource(p.x__mm * 0.5f, p.y__mm * 0.5f, p.z__mm * 0.5f);
+    SetPickup(0, 0, 0);
+    SetAttenuation(0);
+    Reset();
+}
+
+
+Rectilinear3DMesh::~Rectilinear3DMesh() {
+    StopThreads();
+}
+
+
+void Rectilinear3DMesh::Reset() {
+    memset(u_curr_, 0, sizeof(float) * pi_.volume_size);
+    memset(u_prev_, 0, sizeof(float) * pi_.volume_size);
+}
+
+
+uint64_t Rectilinear3DMesh::GetGeometryHash() {
+
+    uint64_t hash = kHashSeed;
+    auto hash_bytes = [&hash](const void *data, size_t n_bytes) {
+        hash = HashBytes(hash, data, n_bytes);
+    };
+    hash_bytes(&p_.x__mm, sizeof(p_.x__mm));
+    hash_bytes(&p_.y__mm, sizeof(p_.y__mm));
+    hash_bytes(&p_.z__mm, sizeof(p_.z__mm));
+    hash_bytes(&p_.spatial_res__mm, sizeof(p_.spatial_res__mm));
+    for (unsigned int z = 0; z < pi_.z_size; z++) {
+        for (unsigned int y = 0; y < pi_.y_size; y++) {
+            hash_bytes(mask_ + Index_(0, y, z), sizeof(float) * pi_.x_size);
+        }
+    }
+    return hash;
+}
+
+
+void Rectilinear3DMesh::XYZtoNode_(float x, float y, float z,
+    unsigned int &i, unsigned int &j, unsigned int &l) {
+    const float inv_res = 1.f / p_.spatial_res__mm;
+    i = x * inv_res;
+    j = y * inv_res;
+    l = z * inv_res;
+}
+
+
+bool Rectilinear3DMesh::IsInside(float x, float y, float z) {
+
+    if (!IsWithinExtent(x, p_.x__mm, p_.spatial_res__mm) ||
+        !IsWithinExtent(y, p_.y__mm, p_.spatial_res__mm) ||
+        !IsWithinExtent(z, p_.z__mm, p_.spatial_res__mm)) {
+        return false;
+    }
+    unsigned int i, j, l;
+    XYZtoNode_(x, y, z, i, j, l);
+    return i < pi_.x_size && j < pi_.y_size && l < pi_.z_size &&
+        mask_[Index_(i, j, l)] != 0;
+}
+
+
+void Rectilinear3DMesh::SetSource(float x, float y, float z) {
+    assert(IsInside(x, y, z));  // Is source point outside mesh mask?
+    unsigned int i, j, l;
+    XYZtoNode_(x, y, z, i, j, l);
+    source_ = Index_(i, j, l);
+}
+
+
+void Rectilinear3DMesh::SetPickup(float x, float y, float z) {
+    assert(IsInside(x, y, z));  // Is pickup point outside mesh mask?
+    unsigned int i, j, l;
+    XYZtoNode_(x, y, z, i, j, l);
+    pickup_ = Index_(i, j, l);
+}
+
+
+void Rectilinear3DMesh::SetAttenuation(float mu) {
+    assert(mu >= 0.f);
+    assert(mu < 1.f);
+    alpha_ = 1 - mu;
+}
+
+
+void Rectilinear3DMesh::UpdateSlices_(const float *curr, float *next,
+    unsigned int z_begin, unsigned int z_end) {
+
+    using V = DSP::SIMD;
+    const V::Vec third = V::Set1(kOneThird);
+    const V::Vec alpha = V::Set1(alpha_);
+    const size_t s = pi_.stride;
+    const size_t sl = pi_.slice_size;
+
+    for (unsigned int z = z_begin; z < z_end; z++) {
+        for (unsigned int y = 0; y < pi_.y_size; y++) {
+            const size_t row = Index_(0, y, z);
+            const float *u = curr + row;
+            const float *m = mask_ + row;
+            float *u_next = next + row;  // Overwrites u[n-1]
+
+            for (unsigned int x = 0; x < pi_.x_padded; x += V::kWidth) {
+                // Only west and east are off the vector grid
+                V::Vec sum = V::Add(
+                    V::Add(V::LoadU(u + x - 1), V::LoadU(u + x + 1)),
+                    V::Add(
+                        V::Add(V::Load(u + x - s), V::Load(u + x + s)),
+                        V::Add(V::Load(u + x - sl), V::Load(u + x + sl))));
+                V::Vec acc = V::Sub(V::Mul(third, sum), V::Load(u_next + x));
+                acc = V::Mul(V::Mul(acc, alpha), V::Load(m + x));
+                V::Store(u_next + x, acc);
+            }
+        }
+    }
+}
+
+
+float Rectilinear3DMesh::ProcessSample(bool input_present, float input) {
+
+    UpdateSlices_(u_curr_, u_prev_, 0, pi_.z_size);
+    if (input_present) {
+        u_prev_[source_] += input;
+    }
+    float output = u_prev_[pickup_];
+
+    // Swap buffers (next->current)
+    float *tmp = u_prev_;
+    u_prev_ = u_curr_;
+    u_curr_ = tmp;
+
+    return output;
+}
+
+
+void Rectilinear3DMesh::ProcessBlock(const float *in, float *out,
+    unsigned int n_samples) {
+
+    if (!IsThreaded()) {
+        for (unsigned int n = 0; n < n_samples; n++) {
+            out[n] = ProcessSample(in != nullptr, (in != nullptr) ? in[n] : 0);
+        }
+        return;
+    }
+
+    block_in_ = in;
+    block_out_ = out;
+    block_n_samples_ = n_samples;
+    workers_.Post();
+    RunBand_(0);
+    // Everyone is past the last barrier, so past reading the planes'
+    // pointers too
+    if (n_samples & 0x1) {
+        float *tmp = u_prev_;
+        u_prev_ = u_curr_;
+        u_curr_ = tmp;
+    }
+}
+
+
+void Rectilinear3DMesh::RunBand_(unsigned int band) {
+
+    const unsigned int z_begin = band_start_[band];
+    const unsigned int z_end = band_start_[band + 1];
+    const size_t source_z = source_ / pi_.slice_size - 1;
+    const size_t pickup_z = pickup_ / pi_.slice_size - 1;
+    const bool has_source = block_in_ != nullptr &&
+        source_z >= z_begin && source_z < z_end;
+    const bool has_pickup = pickup_z >= z_begin && pickup_z < z_end;
+    float *curr = u_curr_;
+    float *next = u_prev_;
+
+    for (unsigned int n = 0; n < block_n_samples_; n++) {
+        UpdateSlices_(curr, next, z_begin, z_end);
+        if (has_source) {
+            next[source_] += block_in_[n];
+        }
+        // Nobody reads this sample's slices before everyone has written
+        // them
+        barrier_.Wait();
+        // Output after the barrier: with in-place buffers, input n has
+        // been read by now. The pickup's slice is this band's, so nobody
+        // else writes it in the meantime.
+        if (has_pickup) {
+            block_out_[n] = next[pickup_];
+        }
+        float *tmp = next;
+        next = curr;
+        curr = tmp;
+    }
+    // Last output is in before ProcessBlock() returns
+    barrier_.Wait();
+}
+
+
+void Rectilinear3DMesh::SetBands_(unsigned int n_bands) {
+    n_bands_ = n_bands;
+    for (unsigned int b = 0; b <= n_bands; b++) {
+        band_start_[b] = (pi_.z_size * b) / n_bands;
+    }
+}
+
+
+void Rectilinear3DMesh::StartThreads(unsigned int n_bands) {
+
+    assert(n_bands <= kMaxBands);
+    if (IsThreaded()) {
+        return;
+    }
+    // At least one slice per band
+    if (n_bands > pi_.z_size) {
+        n_bands = pi_.z_size;
+    }
+    if (n_bands < 2) {
+        return;
+    }
+    SetBands_(n_bands);
+    barrier_.SetThreadCount(n_bands);
+    workers_.Start(n_bands - 1, this, &Rectilinear3DMesh::RunBand_,
+        &Rectilinear3DMesh::StartBand_);
+    TouchBand_(0);
+    // Everyone's pages are placed
+    barrier_.Wait();
+}
+
+
+void Rectilinear3DMesh::TouchBand_(unsigned int band) {
+
+    // Band's slices, plus the halo slice on the outer side of the first
+    // and last band
+    size_t begin = (band == 0) ? 0 : band_start_[band] + 1;
+    size_t end = (band == n_bands_ - 1) ?
+        pi_.z_size + 2 : band_start_[band + 1] + 1;
+    begin *= pi_.slice_size;
+    end *= pi_.slice_size;
+    // One write per (small) page is enough to place it. Values are kept:
+    // the mesh may have been running already.
+    const size_t kPageFloats = 4096 / sizeof(float);
+    for (float *plane : { u_curr_, u_prev_, mask_ }) {
+        volatile float *p = plane;
+        for (size_t i = begin; i < end; i += kPageFloats) {
+            p[i] = p[i];
+        }
+    }
+}
+
+
+void Rectilinear3DMesh::StopThreads() {
+
+    if (!IsThreaded()) {
+        return;
+    }
+    workers_.Stop();
+    SetBands_(1);
+    barrier_.SetThreadCount(1);
+}
+
+
+void Rectilinear3DMesh::StartBand_(unsigned int band) {
+    TouchBand_(band);
+    barrier_.Wait();
+}
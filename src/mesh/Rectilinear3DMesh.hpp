@@ -0,0 +1,176 @@
+/**
+ * @file Rectilinear3DMesh.hpp
+ * @author Andrea Martelloni (a.martelloni@qmul.ac.uk)
+ * @brief
+ * @version 0.1
+ * @date 2020-10-22
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef __RECTILINEAR_3D_MESH_HPP__
+#define __RECTILINEAR_3D_MESH_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include "SpinBarrier.hpp"
+
+
+/**
+ * @brief Waveguide mesh of a volume (air in a box, a shell...), on a
+ * cubic rectilinear lattice.
+ *
+ * Each node has six neighbours. The mesh is run in its equivalent
+ * finite-difference form, on node values only:
+ *
+ *     u[n+1] = 1/3 * sum(neighbours) - u[n-1]
+ *
+ * so waves travel 1/sqrt(3) spacings per sample. That is two planes of
+ * state (the update overwrites u[n-1] in place) plus a mask plane, laid
+ * out x-fastest with rows padded to whole vectors and a halo of zeros all
+ * round: every row is a straight run of SIMD loads with no edge cases,
+ * and nodes outside the mask are held at zero (fixed boundaries).
+ *
+ * Node counts grow with the cube of the resolution, so the volume can be
+ * split into bands of z slices, each run on its own thread with a barrier
+ * once per sample (see StartThreads() and ProcessBlock()). Threaded and
+ * single-threaded runs give identical results.
+ *
+ * Memory is allocated externally (see GetMemSize()).
+ */
+class Rectilinear3DMesh {
+
+ public:
+
+    struct Properties {
+        float x__mm;
+        float y__mm;
+        float z__mm;
+        float spatial_res__mm;
+    };
+
+    static size_t GetMemSize(Properties p);
+    static size_t GetNodeCount(Properties p);
+    /**
+     * @brief Construct a new Rectilinear3DMesh
+     *
+     * @param p Properties of the mesh
+     * @param mem Memory of GetMemSize(p) bytes. Allocate externally.
+     * @param n_bands If more than 1, StartThreads(n_bands) before anything
+     * else touches mem: for very large meshes on fresh pages (see
+     * DSP::LargeAlloc), each band's memory then lands on its thread's
+     * NUMA node.
+     */
+    Rectilinear3DMesh(Properties p, void *mem, unsigned int n_bands = 1);
+    ~Rectilinear3DMesh();
+    void Reset();
+    /**
+     * @brief Set the shape of the volume
+     *
+     * @param mask_fn Predicate on (x, y, z) in mm: true inside
+     */
+    template <typename MaskFnT>
+    void ApplyMask(MaskFnT mask_fn);
+    float ProcessSample(bool input_present, float input);
+    /**
+     * @brief Run the mesh over a block, on all bands' threads if running
+     *
+     * @param in Input (nullptr: no input)
+     * @param out Output (in-place allowed)
+     */
+    void ProcessBlock(const float *in, float *out, unsigned int n_samples);
+    void SetSource(float x, float y, float z);
+    void SetPickup(float x, float y, float z);
+    void SetAttenuation(float mu);
+    bool IsInside(float x, float y, float z);
+    /**
+     * @brief Split the volume into n_bands bands of z slices, the first
+     * run by the caller of ProcessBlock() and each other one on a thread
+     * of its own. Each thread touches its band's pages before returning
+     * (so that pages no one has touched yet are placed on its NUMA node).
+     * Not real-time safe.
+     *
+     */
+    void StartThreads(unsigned int n_bands);
+    void StopThreads();
+    bool IsThreaded() { return workers_.IsRunning(); }
+    unsigned int GetNumBands() { return n_bands_; }
+    /**
+     * @brief Hash of the size, resolution and mask: meshes with the same
+     * hash run the same amount of work
+     *
+     */
+    uint64_t GetGeometryHash();
+    Properties GetProperties() { return p_; }
+
+ protected:
+
+    static constexpr float kOneThird = 1.f / 3.f;
+    static constexpr unsigned int kMaxBands = 64;
+
+    struct Properties_internal_ {
+        unsigned int x_size;
+        unsigned int y_size;
+        unsigned int z_size;
+        unsigned int x_padded;  // Nodes processed per row (whole vectors)
+        unsigned int x_halo;  // Zeros before each row (one vector)
+        unsigned int stride;  // Floats per row, including halo
+        size_t slice_size;  // Floats per z slice, including halo
+        size_t volume_size;  // Floats per plane, including halo
+    };
+
+    Properties p_;
+    Properties_internal_ pi_;
+    float *u_curr_;
+    float *u_prev_;
+    float *mask_;  // 1 inside, 0 outside
+    size_t source_;  // Plane index
+    size_t pickup_;
+    float alpha_;
+
+    // Bands of z slices: band b is [band_start_[b], band_start_[b + 1])
+    unsigned int n_bands_;
+    unsigned int band_start_[kMaxBands + 1];
+    // Block handed to the threads
+    const float *block_in_;
+    float *block_out_;
+    unsigned int block_n_samples_;
+    DSP::SpinWorkers workers_;
+    DSP::SpinBarrier barrier_;
+
+    static void GetInternalProperties(Properties &p,
+        Properties_internal_ &pi);
+
+    __attribute__((always_inline)) size_t Index_(unsigned int x,
+        unsigned int y, unsigned int z) {
+        return (z + 1) * pi_.slice_size
+            + static_cast<size_t>(y + 1) * pi_.stride + pi_.x_halo + x;
+    }
+
+    void XYZtoNode_(float x, float y, float z, unsigned int &i,
+        unsigned int &j, unsigned int &l);
+    void SetBands_(unsigned int n_bands);
+    void UpdateSlices_(const float *curr, float *next, unsigned int z_begin,
+        unsigned int z_end);
+    void RunBand_(unsigned int band);
+    void TouchBand_(unsigned int band);
+    void StartBand_(unsigned int band);
+};
+
+template <typename MaskFnT>
+void Rectilinear3DMesh::ApplyMask(MaskFnT mask_fn) {
+
+    const float h = p_.spatial_res__mm;
+    for (unsigned int z = 0; z < pi_.z_size; z++) {
+        for (unsigned int y = 0; y < pi_.y_size; y++) {
+            for (unsigned int x = 0; x < pi_.x_size; x++) {
+                mask_[Index_(x, y, z)] = mask_fn(x * h, y * h, z * h) ?
+                    1.f : 0.f;
+            }
+        }
+    }
+}
+
+
+#endif  // __RECTILINEAR_3D_MESH_HPP__
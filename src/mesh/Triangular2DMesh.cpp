@@ -10,7 +10,13 @@
  */
 
 #include "Triangular2DMesh.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <initializer_list>
+#include "Dispatch.hpp"
+#include "MeshBounds.hpp"
+#include "MeshHash.hpp"
 
 
 float Triangular2DMesh::kSqrt3Over2 = std::sqrt(3.f) / 2.f;
@@ -25,7 +31,6 @@ void Triangular2DMesh::GetInternalProperties(
     // Make sure X is odd, Y is even
     pi_.x_size = x_size + !(x_size & 0x1);
     pi_.y_size = y_size + (y_size & 0x1);
-    pi_.total_size = pi_.x_size * pi_.y_size;
     // C and K are columns and rows respectively: rows are interleaved,
     // columns aren't.
     pi_.c_size = pi_.y_size;
@@ -35,6 +40,12 @@ void Triangular2DMesh::GetInternalProperties(
     pi_.n_odd_k = pi_.c_size >> 1;
     pi_.total_size_ck = pi_.k_size_even * pi_.n_even_k
         + pi_.k_size_odd * pi_.n_odd_k;
+    // Planes hold the nodes packed (see NodeIndex_()), padded to whole
+    // vectors of any instruction set (the stencil kernel is dispatched),
+    // between halos as deep as a neighbour's offset
+    pi_.halo = PadPlane_((pi_.x_size >> 1) + 1);
+    pi_.plane_size = 2 * static_cast<size_t>(pi_.halo) +
+        PadPlane_(pi_.total_size_ck);
 }
 
 
@@ -43,10 +54,22 @@ size_t Triangular2DMesh::GetMemSize(
 
     Properties_internal_ pi;
     GetInternalProperties(p, pi);
-    // Multiply by number of meshes needed
-    unsigned int num_size_by_meshes = pi.total_size * kNMeshes;
-    // Return number of bytes
-    return num_size_by_meshes * sizeof(float);
+    // Multiply by number of meshes needed (in size_t: large meshes
+    // overflow 32 bits here well before their planes do)
+    size_t num_size_by_meshes = pi.plane_size * kNMeshes;
+    // Return number of bytes, and room to align the planes
+    return num_size_by_meshes * sizeof(float) +
+        DSP::Dispatch::kMaxAlignment;
+}
+
+
+unsigned int Triangular2DMesh::GetNodeCount(
+    Triangular2DMesh::Properties p) {
+
+    Properties_internal_ pi;
+    GetInternalProperties(p, pi);
+    // Junctions actually visited by ProcessSample (C, K space)
+    return pi.total_size_ck;
 }
 
 
@@ -60,25 +83,48 @@ void Triangular2DMesh::Init_(Properties p, void *mem) {
 
     p_ = p;
     GetInternalProperties(p, pi_);
-    // Stagger the mesh pointers:
+    // Halos and padding stay zero from here on
+    uintptr_t base = reinterpret_cast<uintptr_t>(mem);
+    constexpr uintptr_t kAlignMask = DSP::Dispatch::kMaxAlignment - 1;
+    float *plane = reinterpret_cast<float *>((base + kAlignMask) &
+        ~kAlignMask);
+    memset(plane, 0, pi_.plane_size * kNMeshes * sizeof(float));
+    // Each mesh pointer skips its plane's halo
+    auto next_plane = [&]() {
+        float *v = plane + pi_.halo;
+        plane += pi_.plane_size;
+        return v;
+    };
     for (unsigned int n = 0; n < kNWaveguides; n++) {
-        // First one pointing at the first element
-        travelling_v_1_[n] = reinterpret_cast<float *>(mem) + (n) * pi_.total_size;
-        // Second one pointing at the second element
-        travelling_v_2_[n] = travelling_v_1_[n] + 1;
+        travelling_v_1_[n] = next_plane();
+        travelling_v_2_[n] = next_plane();
     }
     // Junction mesh and mask mesh
-    junc_v_ = travelling_v_1_[kNWaveguides - 1] + pi_.total_size;
-    mesh_mask_ = reinterpret_cast<uint32_t *>(junc_v_ + 1);
+    junc_v_ = next_plane();
+    mesh_mask_ = reinterpret_cast<uint32_t *>(next_plane());
+    // Self-loops (tension modulation)
+    self_v_ = next_plane();
+    // Stencil kernel
+    coef_ = next_plane();
+    damp_ = next_plane();
+    for (unsigned int n = 0; n < kNWaveguides; n++) {
+        link_[n] = next_plane();
+    }
+    SetKernel(kKernelNodes);
     // Apply default mask: all points inside the mesh
     ApplyMask([&](float x_, float y_) {
         return static_cast<bool>((x_ >= 0 && x_ < p_.x__mm) &&
             (y_ >= 0 && y_ < p_.y__mm));
     });
+    inv_res_ = 1.f / p_.spatial_res__mm;
+    inv_row_pitch_ = 1.f / (kSqrt3Over2 * p_.spatial_res__mm);
     // Apply initial state
     SetSource(p.x__mm * 0.5, p.y__mm * 0.5);
     SetPickup(0, 0);
     SetAttenuation(0);
+    SetTensionModulation(0, 1);
+    ClearPorts();
+    SetVisualisation(nullptr, 1, 1);
     Reset();
 }
 
@@ -97,7 +143,13 @@ void Triangular2DMesh::Reset() {
             SetM_(travelling_v_2_[n], c, k, 0.f);
         }
         SetM_(junc_v_, c, k, 0.f);
+        SetM_(self_v_, c, k, 0.f);
     });
+    self_loop_y_ = self_loop_y0_;
+    self_loop_sqrt_y_ = std::sqrt(self_loop_y0_);
+    for (unsigned int p = 0; p < n_ports_; p++) {
+        ports_[p].in = ports_[p].out = 0;
+    }
 }
 
 
@@ -106,11 +158,13 @@ void Triangular2DMesh::SetSource(float x, float y) {
     CKCoords_ source = XYtoCK_(x, y);
     assert(source.c < pi_.c_size);
     assert(source.k < (source.c & 0x1) ? pi_.k_size_odd : pi_.k_size_even);
-    // Get mask and assert it's in a point that exists and receives signal
-    __attribute__((unused))  // Bela compiler moans assertions aren't "use"
-    unsigned int source_mask = GetM_(mesh_mask_, source.c, source.k);
-    assert(source_mask != 0);  // Is source point outside mesh mask?
+    // Assert it's in a point that exists and receives signal (not masked
+    // out or clamped)
+    assert(IsLive_(source.c, source.k));  // Is source point outside mesh mask?
     source_ = source;
+    source_interp_.glide_left = 0;
+    source_interp_.dx = source_interp_.dy = 0;
+    Locate_(source_interp_, x, y);
 }
 
 
@@ -119,17 +173,373 @@ void Triangular2DMesh::SetPickup(float x, float y) {
     CKCoords_ pickup = XYtoCK_(x, y);
     assert(pickup.c < pi_.c_size);
     assert(pickup.k < (pickup.c & 0x1) ? pi_.k_size_odd : pi_.k_size_even);
-    // Get mask and assert it's in a point that exists and receives signal
-    __attribute__((unused))  // Bela compiler moans assertions aren't "used"
-    unsigned int pickup_mask = GetM_(mesh_mask_, pickup.c, pickup.k);
-    assert(pickup_mask != 0);  // Is pickup point outside mesh mask?
+    // Assert it's in a point that exists and receives signal (not masked
+    // out or clamped)
+    assert(IsLive_(pickup.c, pickup.k));  // Is pickup point outside mesh mask?
+    pickup_ = pickup;
+    pickup_interp_.glide_left = 0;
+    pickup_interp_.dx = pickup_interp_.dy = 0;
+    Locate_(pickup_interp_, x, y);
+}
+
+
+void Triangular2DMesh::GlideSource(float x, float y, unsigned int n_samples) {
+    
+    CKCoords_ source = XYtoCK_(x, y);
+    assert(IsInLattice_(source.c, source.k));
+    assert(IsLive_(source.c, source.k));
+    source_ = source;
+    StartGlide_(source_interp_, x, y, n_samples);
+}
+
+
+void Triangular2DMesh::GlidePickup(float x, float y, unsigned int n_samples) {
+    
+    CKCoords_ pickup = XYtoCK_(x, y);
+    assert(IsInLattice_(pickup.c, pickup.k));
+    assert(IsLive_(pickup.c, pickup.k));
     pickup_ = pickup;
+    StartGlide_(pickup_interp_, x, y, n_samples);
+}
+
+
+void Triangular2DMesh::StartGlide_(Interpolation_ &p, float x, float y,
+    unsigned int n_samples) {
+
+    p.target_x = x;
+    p.target_y = y;
+    p.glide_left = n_samples;
+    if (n_samples == 0) {
+        p.dx = p.dy = 0;
+        Locate_(p, x, y);
+        return;
+    }
+    // The only division of the whole glide
+    float inv_n = 1.f / static_cast<float>(n_samples);
+    p.dx = (x - p.x) * inv_n;
+    p.dy = (y - p.y) * inv_n;
+    // Same triangle, but the weight increments need the new direction
+    Locate_(p, p.x, p.y);
+}
+
+
+void Triangular2DMesh::Locate_(Interpolation_ &p, float x, float y) {
+
+    p.x = x;
+    p.y = y;
+    // Within the strip between rows c0 and c0 + 1, shear x so that the
+    // upper row lines up with the lower one: the strip becomes a row of
+    // unit squares in (s, t), each split into two triangles along the
+    // diagonal s + t = 1. Barycentric weights are affine in (s, t).
+    float t_abs = y * inv_row_pitch_;
+    int c0 = static_cast<int>(std::floor(t_abs));
+    float t = t_abs - c0;
+    float s_abs = x * inv_res_ - 0.5f * (c0 & 0x1) - 0.5f * t;
+    int i = static_cast<int>(std::floor(s_abs));
+    float s = s_abs - i;
+    // Upper row index of the node above lower node i
+    int i_up = i + (c0 & 0x1);
+    float dt = p.dy * inv_row_pitch_;
+    float ds = p.dx * inv_res_ - 0.5f * dt;
+
+    int c[3], k[3];
+    if (s + t < 1.f) {
+        // Pointing up: (c0, i), (c0, i + 1), (c0 + 1, i_up)
+        c[0] = c0; k[0] = i; p.w[0] = 1.f - s - t; p.dw[0] = -ds - dt;
+        c[1] = c0; k[1] = i + 1; p.w[1] = s; p.dw[1] = ds;
+        c[2] = c0 + 1; k[2] = i_up; p.w[2] = t; p.dw[2] = dt;
+    } else {
+        // Pointing down: (c0, i + 1), (c0 + 1, i_up), (c0 + 1, i_up + 1)
+        c[0] = c0; k[0] = i + 1; p.w[0] = 1.f - t; p.dw[0] = -dt;
+        c[1] = c0 + 1; k[1] = i_up; p.w[1] = 1.f - s; p.dw[1] = -ds;
+        c[2] = c0 + 1; k[2] = i_up + 1; p.w[2] = s + t - 1.f;
+        p.dw[2] = ds + dt;
+    }
+    // Nodes off the lattice, outside the mask or clamped contribute
+    // nothing, but keep their weight so that edge crossings are still
+    // detected
+    for (unsigned int n = 0; n < 3; n++) {
+        if (IsInLattice_(c[n], k[n]) && IsLive_(c[n], k[n])) {
+            p.c[n] = c[n];
+            p.k[n] = k[n];
+        } else {
+            p.c[n] = p.k[n] = kNoNode;
+        }
+    }
+}
+
+
+unsigned int Triangular2DMesh::AddPort(float x, float y, float admittance) {
+
+    assert(n_ports_ < kMaxPorts);
+    assert(IsInside(x, y));  // Is port point outside mesh mask?
+    assert(admittance >= 0.f);
+    Port_ &port = ports_[n_ports_];
+    port.at.glide_left = 0;
+    port.at.dx = port.at.dy = 0;
+    Locate_(port.at, x, y);
+    port.y = admittance;
+    port.in = port.out = 0;
+    return n_ports_++;
+}
+
+
+void Triangular2DMesh::ClampRegion(float x, float y, float radius) {
+    EditRegion_(x, y, radius, 0, kClampedBit);
+}
+
+
+void Triangular2DMesh::DampRegion(float x, float y, float radius,
+    float amount) {
+    assert(amount >= 0.f && amount <= 1.f);
+    uint32_t level = static_cast<uint32_t>(amount * 255.f + 0.5f);
+    EditRegion_(x, y, radius, kDampBits, level << kDampShift);
+}
+
+
+void Triangular2DMesh::ReleaseRegion(float x, float y, float radius) {
+    EditRegion_(x, y, radius, kClampedBit | kDampBits, 0);
+}
+
+
+void Triangular2DMesh::EditRegion_(float x, float y, float radius,
+    uint32_t clear, uint32_t set) {
+
+    assert(radius >= 0.f);
+    // Bounding box of the disc, plus a node all round: links from the
+    // nodes just outside into the disc change too
+    auto clamp_index = [](float v, unsigned int size) {
+        return (v < 0.f) ? 0u : (v >= static_cast<float>(size)) ?
+            size - 1 : static_cast<unsigned int>(v);
+    };
+    unsigned int c_lo = clamp_index((y - radius) * inv_row_pitch_ - 1.f,
+        pi_.c_size);
+    unsigned int c_hi = clamp_index((y + radius) * inv_row_pitch_ + 2.f,
+        pi_.c_size);
+    unsigned int k_lo = clamp_index((x - radius) * inv_res_ - 1.f,
+        pi_.k_size_even);
+    unsigned int k_hi = clamp_index((x + radius) * inv_res_ + 2.f,
+        pi_.k_size_even);
+
+    const float r2 = radius * radius;
+    for (unsigned int c = c_lo; c <= c_hi; c++) {
+        unsigned int k_end = std::min(k_hi + 1, pi_.k_size_odd + !(c & 0x1));
+        for (unsigned int k = k_lo; k < k_end; k++) {
+            uint32_t word = GetM_(mesh_mask_, c, k);
+            float xn, yn;
+            CKtoXY_(c, k, xn, yn);
+            // Outside the mask stays all zeros
+            if (word != 0 &&
+                (xn - x) * (xn - x) + (yn - y) * (yn - y) <= r2) {
+                SetM_(mesh_mask_, c, k, (word & ~clear) | set);
+            }
+        }
+    }
+    for (unsigned int c = c_lo; c <= c_hi; c++) {
+        unsigned int k_end = std::min(k_hi + 1, pi_.k_size_odd + !(c & 0x1));
+        for (unsigned int k = k_lo; k < k_end; k++) {
+            Relink_(c, k);
+        }
+    }
+    // Whatever reads or feeds the mesh lets go of clamped nodes (and
+    // picks released ones back up)
+    Locate_(source_interp_, source_interp_.x, source_interp_.y);
+    Locate_(pickup_interp_, pickup_interp_.x, pickup_interp_.y);
+    for (unsigned int p = 0; p < n_ports_; p++) {
+        Locate_(ports_[p].at, ports_[p].at.x, ports_[p].at.y);
+    }
+}
+
+
+void Triangular2DMesh::Relink_(unsigned int c, unsigned int k) {
+
+    uint32_t word = GetM_(mesh_mask_, c, k);
+    if (word == 0) {
+        return;
+    }
+    // A link runs if the mask gave it and neither end is clamped
+    uint32_t links = 0;
+    if (!(word & kClampedBit)) {
+        unsigned int column_is_even = !(c & 0x1);
+        const CKCoords_ neighbour[kNWaveguides] = {
+            { kNE_C_K }, { kE_C_K }, { kSE_C_K },
+            { kSW_C_K }, { kW_C_K }, { kNW_C_K },
+        };
+        const uint32_t base = (word >> kBaseLinkShift) & kLinkBits;
+        for (unsigned int d = 0; d < kNWaveguides; d++) {
+            if ((base & (1u << d)) && !(GetM_(mesh_mask_, neighbour[d].c,
+                neighbour[d].k) & kClampedBit)) {
+                links |= 1u << d;
+            }
+        }
+    }
+    // Waves on links that come and go are dropped, so nothing stale comes
+    // back on release
+    uint32_t changed = (word & kLinkBits) ^ links;
+    for (unsigned int d = 0; d < kNWaveguides; d++) {
+        if (changed & (1u << d)) {
+            SetM_(travelling_v_1_[d], c, k, 0.f);
+            SetM_(travelling_v_2_[d], c, k, 0.f);
+        }
+    }
+    if (links == 0) {
+        SetM_(junc_v_, c, k, 0.f);
+        SetM_(self_v_, c, k, 0.f);
+    }
+    SetM_(mesh_mask_, c, k, (word & ~kLinkBits) | links);
+    UpdateStencil_(c, k);
+}
+
+
+void Triangular2DMesh::SetNode_(unsigned int c, unsigned int k,
+    uint32_t word) {
+
+    SetM_(mesh_mask_, c, k, word);
+    // Nothing travels on waveguides the node doesn't have (the stencil
+    // kernel sums them all)
+    std::bitset<kNWaveguides> links(word & kLinkBits);
+    for (unsigned int d = 0; d < kNWaveguides; d++) {
+        if (!links.test(d)) {
+            SetM_(travelling_v_1_[d], c, k, 0.f);
+            SetM_(travelling_v_2_[d], c, k, 0.f);
+        }
+    }
+    if (links.none()) {
+        SetM_(junc_v_, c, k, 0.f);
+        SetM_(self_v_, c, k, 0.f);
+    }
+    UpdateStencil_(c, k);
+}
+
+
+void Triangular2DMesh::UpdateStencil_(unsigned int c, unsigned int k) {
+
+    uint32_t word = GetM_(mesh_mask_, c, k);
+    std::bitset<kNWaveguides> links(word & kLinkBits);
+    SetM_(coef_, c, k, links.any() ? 2.f / links.count() : 0.f);
+    SetM_(damp_, c, k, 1.f -
+        static_cast<float>(word >> kDampShift) * kDampStep);
+    for (unsigned int d = 0; d < kNWaveguides; d++) {
+        SetM_(link_[d], c, k, links.test(d) ? 1.f : 0.f);
+    }
+}
+
+
+void Triangular2DMesh::ClearPorts() {
+    n_ports_ = 0;
+}
+
+
+void Triangular2DMesh::SetKernel(Kernel kernel) {
+
+    kernel_ = kernel;
+    const DSP::KernelTable &t = DSP::Dispatch::GetKernels();
+    scatter_ = t.mesh_scatter;
+    propagate_ = t.mesh_propagate;
+}
+
+
+bool Triangular2DMesh::IsInside(float x, float y) {
+
+    if (!IsWithinExtent(x, p_.x__mm, p_.spatial_res__mm) ||
+        !IsWithinExtent(y, p_.y__mm, p_.spatial_res__mm)) {
+        return false;
+    }
+    CKCoords_ point = XYtoCK_(x, y);
+    return IsInLattice_(point.c, point.k) && IsLive_(point.c, point.k);
 }
 
 
 float Triangular2DMesh::ProcessSample(bool input_present, float input) {
+    // The plain mesh doesn't pay for the self-loop, the energy sum or
+    // the ports
+    float output;
+    if (kernel_ == kKernelStencil && tension_depth_ == 0.f &&
+        n_ports_ == 0) {
+        output = ProcessSampleStencil_(input_present, input);
+    } else if (tension_depth_ > 0.f) {
+        output = (n_ports_ > 0) ?
+            ProcessSample_<true, true>(input_present, input) :
+            ProcessSample_<true, false>(input_present, input);
+    } else {
+        output = (n_ports_ > 0) ?
+            ProcessSample_<false, true>(input_present, input) :
+            ProcessSample_<false, false>(input_present, input);
+    }
+    if (vis_ring_ != nullptr && --vis_countdown_ == 0) {
+        vis_countdown_ = vis_period_;
+        WriteVisualisationFrame_();
+    }
+    return output;
+}
+
+
+unsigned int Triangular2DMesh::GetVisualisationFrameSize(
+    unsigned int decimation) {
+
+    assert(decimation > 0);
+    unsigned int size = 0;
+    for (unsigned int c = 0; c < pi_.c_size; c += decimation) {
+        unsigned int k_count = pi_.k_size_odd + !(c & 0x1);
+        size += (k_count + decimation - 1) / decimation;
+    }
+    return size;
+}
+
+
+void Triangular2DMesh::GetVisualisationCoordinates(unsigned int decimation,
+    float *xy) {
+
+    assert(decimation > 0);
+    for (unsigned int c = 0; c < pi_.c_size; c += decimation) {
+        unsigned int k_count = pi_.k_size_odd + !(c & 0x1);
+        for (unsigned int k = 0; k < k_count; k += decimation) {
+            CKtoXY_(c, k, xy[0], xy[1]);
+            xy += 2;
+        }
+    }
+}
+
+
+void Triangular2DMesh::SetVisualisation(DSP::FrameRing *ring,
+    unsigned int period, unsigned int decimation) {
+
+    assert(period > 0);
+    assert(decimation > 0);
+    assert(ring == nullptr ||
+        ring->GetFrameSize() == GetVisualisationFrameSize(decimation));
+    vis_ring_ = ring;
+    vis_period_ = period;
+    vis_countdown_ = period;
+    vis_decimation_ = decimation;
+}
+
+
+void Triangular2DMesh::WriteVisualisationFrame_() {
+
+    float *frame = vis_ring_->BeginWrite();
+    if (frame == nullptr) {
+        return;  // Reader is behind: it'll see the next one
+    }
+    for (unsigned int c = 0; c < pi_.c_size; c += vis_decimation_) {
+        unsigned int k_count = pi_.k_size_odd + !(c & 0x1);
+        for (unsigned int k = 0; k < k_count; k += vis_decimation_) {
+            *frame++ = GetM_(junc_v_, c, k);
+        }
+    }
+    vis_ring_->CommitWrite();
+}
+
+
+template <bool kTensionModulation, bool kPorts>
+float Triangular2DMesh::ProcessSample_(bool input_present, float input) {
 
     float output = 0;
+    float energy = 0;
+    const float self_y = self_loop_y_;
+    const float self_sqrt_y = self_loop_sqrt_y_;
+    // Interpolated junction velocity under each port
+    float port_v[kMaxPorts] = { 0 };
 
 // Bit of X-Macro'ing: This will expand a macro that defines X for all
 // adjacent points. (thank you preprocessor!)
@@ -138,12 +548,22 @@ float Triangular2DMesh::ProcessSample(bool input_present, float input) {
     // FOREACH_MESH_POINT expanded by hand (fights with the X-Macros below)
     for (unsigned int c = 0; c < pi_.c_size; c++) {
         unsigned int column_is_even = !(c & 0x1);
+        // Source and pickup each touch at most two rows
+        bool source_row = input_present && IsInRows_(source_interp_, c);
+        bool pickup_row = IsInRows_(pickup_interp_, c);
+        unsigned int port_rows = 0;  // Bit p: port p touches this row
+        if (kPorts) {
+            for (unsigned int p = 0; p < n_ports_; p++) {
+                port_rows |= IsInRows_(ports_[p].at, c) << p;
+            }
+        }
         for (unsigned int k = 0;
             k < ((pi_.k_size_odd) + column_is_even);
             k++) {
 
             // Get mask
-            std::bitset<kNWaveguides> mask(GetM_(mesh_mask_, c, k));
+            uint32_t node_word = GetM_(mesh_mask_, c, k);
+            std::bitset<kNWaveguides> mask(node_word & kLinkBits);
             unsigned int n_junction_points = mask.count();
             if (n_junction_points == 0) {
                 // No waveguides to see here, move along...
@@ -153,7 +573,7 @@ float Triangular2DMesh::ProcessSample(bool input_present, float input) {
             // Point source
             float source_v = 0;
             float source_point_coef = 0;
-            if (input_present && c == source_.c && k == source_.k) {
+            if (source_row) {
                 // Source point - use input
             //#define INJECT_SOURCE(POINT)    \
             //    if (mask.test( k##POINT )) {    \
@@ -166,14 +586,37 @@ float Triangular2DMesh::ProcessSample(bool input_present, float input) {
 
             //#undef X
             //#undef INJECT_SOURCE
-                source_v = input;
-                source_point_coef = 1.0f;
+                // The source is one more port on each node of its
+                // triangle, with its interpolation weight as admittance
+                // (1 on a node, 0 away from it)
+                source_point_coef = GetWeight_(source_interp_, c, k);
+                source_v = source_point_coef * input;
             }
 
             // Scattering equation
-            float scatter_coeff = 2.f / (static_cast<float>(n_junction_points)
-                + source_point_coef);
+            float scatter_load = static_cast<float>(n_junction_points)
+                + source_point_coef;
             float scatter_sum = 0;
+            if (kTensionModulation) {
+                // Self-loop: one more port, fed back through a unit delay,
+                // with the (shared) admittance that sets the wave speed.
+                // Its wave is power-normalised (scaled by sqrt(Y)), so the
+                // junction stays lossless however fast Y changes.
+                scatter_load += self_y;
+                scatter_sum += self_sqrt_y * GetM_(self_v_, c, k);
+            }
+            float port_w[kMaxPorts];
+            if (kPorts && port_rows != 0) {
+                // Ports are spread over their triangle like the source,
+                // each node taking its share of the port's admittance
+                for (unsigned int p = 0; p < n_ports_; p++) {
+                    port_w[p] = (port_rows & (1u << p)) ?
+                        GetWeight_(ports_[p].at, c, k) : 0.f;
+                    scatter_load += port_w[p] * ports_[p].y;
+                    scatter_sum += port_w[p] * ports_[p].y * ports_[p].in;
+                }
+            }
+            float scatter_coeff = 2.f / scatter_load;
 
         #define ADD_TO_SCATTER_SUM(POINT)    \
             if (mask.test( k##POINT )) {     \
@@ -188,7 +631,21 @@ float Triangular2DMesh::ProcessSample(bool input_present, float input) {
             scatter_sum += source_v;
             scatter_sum *= scatter_coeff;
             scatter_sum *= alpha_;
+            if (node_word & kDampBits) {
+                scatter_sum *= 1.f -
+                    static_cast<float>(node_word >> kDampShift) * kDampStep;
+            }
             SetM_(junc_v_, c, k, scatter_sum);
+            if (kTensionModulation) {
+                SetM_(self_v_, c, k,
+                    self_sqrt_y * scatter_sum - GetM_(self_v_, c, k));
+                energy += scatter_sum * scatter_sum;
+            }
+            if (kPorts && port_rows != 0) {
+                for (unsigned int p = 0; p < n_ports_; p++) {
+                    port_v[p] += port_w[p] * scatter_sum;
+                }
+            }
 
             // Junction output (in-place replacement)
         #define COMPUTE_OUTGOING_WAVE(POINT)    \
@@ -219,8 +676,8 @@ float Triangular2DMesh::ProcessSample(bool input_present, float input) {
         #undef DELAY_STEP
 
             // If listener, store output
-            if (c == pickup_.c && k == pickup_.k) {
-                output = scatter_sum;
+            if (pickup_row) {
+                output += GetWeight_(pickup_interp_, c, k) * scatter_sum;
             }
 
         }  // for k
@@ -233,11 +690,192 @@ float Triangular2DMesh::ProcessSample(bool input_present, float input) {
     v_next_ = v_curr_;
     v_curr_ = tmp;
 
+    Advance_(source_interp_);
+    Advance_(pickup_interp_);
+
+    if (kPorts) {
+        // Outgoing wave from the interpolated junction. Averaging the
+        // three nodes' outgoing waves can only lose power, never make it
+        for (unsigned int p = 0; p < n_ports_; p++) {
+            ports_[p].out = port_v[p] - ports_[p].in;
+        }
+    }
+
+    if (kTensionModulation) {
+        // Kirchhoff-Carrier: c^2 grows with energy, c^2 / c0^2 = 1 + d E.
+        // Wave speed on a junction with N ports and a self-loop of
+        // admittance Y goes as sqrt(N / (N + Y)), so (interior, N = 6)
+        // Y = (6 + Y0) / (1 + d E) - 6, floored at 0 (full speed)
+        float y = (kNWaveguides + self_loop_y0_) /
+            (1.f + tension_depth_ * energy) - kNWaveguides;
+        self_loop_y_ = (y > 0.f) ? y : 0.f;
+        self_loop_sqrt_y_ = std::sqrt(self_loop_y_);
+    }
+
+    return output;
+}
+
+float Triangular2DMesh::ProcessSampleStencil_(bool input_present,
+    float input) {
+
+    const unsigned int n_nodes = PadPlane_(pi_.total_size_ck);
+
+    // Junctions, all at once: waveguides a node doesn't have carry zeros,
+    // and nodes without any have a zero coefficient
+    scatter_(junc_v_, v_curr_, coef_, damp_, alpha_, n_nodes);
+    if (input_present) {
+        // The source loads the nodes of its triangle, as in the nodes
+        // kernel
+        const Interpolation_ &s = source_interp_;
+        for (unsigned int n = 0; n < 3; n++) {
+            if (s.c[n] == kNoNode) {
+                continue;
+            }
+            uint32_t word = GetM_(mesh_mask_, s.c[n], s.k[n]);
+            std::bitset<kNWaveguides> links(word & kLinkBits);
+            float sum = 0;
+            for (unsigned int d = 0; d < kNWaveguides; d++) {
+                if (links.test(d)) {
+                    sum += GetM_(v_curr_[d], s.c[n], s.k[n]);
+                }
+            }
+            sum += s.w[n] * input;
+            sum *= 2.f / (static_cast<float>(links.count()) + s.w[n]);
+            sum *= alpha_;
+            sum *= GetM_(damp_, s.c[n], s.k[n]);
+            SetM_(junc_v_, s.c[n], s.k[n], sum);
+        }
+    }
+
+    // Waves arriving next sample: what the neighbour scattered, minus
+    // what it received from us
+    int offset[kNWaveguides];
+    for (unsigned int d = 0; d < kNWaveguides; d++) {
+        offset[d] = NodeOffset_(d);
+    }
+    propagate_(v_next_, v_curr_, junc_v_, link_, offset, n_nodes);
+
+    float output = 0;
+    for (unsigned int n = 0; n < 3; n++) {
+        if (pickup_interp_.c[n] != kNoNode) {
+            output += pickup_interp_.w[n] *
+                GetM_(junc_v_, pickup_interp_.c[n], pickup_interp_.k[n]);
+        }
+    }
+
+    // Swap buffers (next->current)
+    float **tmp = v_next_;
+    v_next_ = v_curr_;
+    v_curr_ = tmp;
+
+    Advance_(source_interp_);
+    Advance_(pickup_interp_);
+
     return output;
 }
 
+
+void Triangular2DMesh::RenderImpulseResponse(float *ir,
+    unsigned int n_samples) {
+
+    // Input stays "present" with zeros after the impulse, like a host
+    // feeding the mesh continuously, so the source junction is loaded
+    // the same way it would be at run time
+    Reset();
+    for (unsigned int n = 0; n < n_samples; n++) {
+        ir[n] = ProcessSample(true, (n == 0) ? 1.f : 0.f);
+    }
+    Reset();
+}
+
+
+void Triangular2DMesh::SetTensionModulation(float depth, float headroom) {
+    assert(depth >= 0.f);
+    assert(headroom >= 1.f);
+    tension_depth_ = depth;
+    // Speed at rest is 1 / headroom of the unloaded mesh's
+    self_loop_y0_ = (depth > 0.f) ?
+        kNWaveguides * (headroom * headroom - 1.f) : 0.f;
+    self_loop_y_ = self_loop_y0_;
+    self_loop_sqrt_y_ = std::sqrt(self_loop_y0_);
+}
+
+
 void Triangular2DMesh::SetAttenuation(float mu) {
     assert(mu >= 0.f);
     assert(mu < 1.f);
     alpha_ = 1 - mu;
 }
+
+
+uint64_t Triangular2DMesh::GetConfigurationHash() {
+
+    // Everything that shapes the impulse response
+    uint64_t hash = kHashSeed;
+    auto hash_bytes = [&hash](const void *data, size_t n_bytes) {
+        hash = HashBytes(hash, data, n_bytes);
+    };
+    hash_bytes(&p_.x__mm, sizeof(p_.x__mm));
+    hash_bytes(&p_.y__mm, sizeof(p_.y__mm));
+    hash_bytes(&p_.spatial_res__mm, sizeof(p_.spatial_res__mm));
+    for (const Interpolation_ *p : { &source_interp_, &pickup_interp_ }) {
+        hash_bytes(p->c, sizeof(p->c));
+        hash_bytes(p->k, sizeof(p->k));
+        hash_bytes(p->w, sizeof(p->w));
+    }
+    hash_bytes(&alpha_, sizeof(alpha_));
+    hash_bytes(&tension_depth_, sizeof(tension_depth_));
+    hash_bytes(&self_loop_y0_, sizeof(self_loop_y0_));
+    for (unsigned int p = 0; p < n_ports_; p++) {
+        hash_bytes(ports_[p].at.c, sizeof(ports_[p].at.c));
+        hash_bytes(ports_[p].at.k, sizeof(ports_[p].at.k));
+        hash_bytes(ports_[p].at.w, sizeof(ports_[p].at.w));
+        hash_bytes(&ports_[p].y, sizeof(ports_[p].y));
+    }
+    FOREACH_MESH_POINT({
+        uint32_t mask = GetM_(mesh_mask_, c, k);
+        hash_bytes(&mask, sizeof(mask));
+    });
+
+    return hash;
+}
+
+
+uint64_t Triangular2DMesh::GetGeometryHash() {
+
+    uint64_t hash = kHashSeed;
+    hash = HashBytes(hash, &p_.x__mm, sizeof(p_.x__mm));
+    hash = HashBytes(hash, &p_.y__mm, sizeof(p_.y__mm));
+    hash = HashBytes(hash, &p_.spatial_res__mm, sizeof(p_.spatial_res__mm));
+    // Nodes are contiguous
+    hash = HashBytes(hash, mesh_mask_,
+        sizeof(uint32_t) * pi_.total_size_ck);
+    return hash;
+}
+
+
+void Triangular2DMesh::CopyConfiguration(Triangular2DMesh &other) {
+
+    // Only meshes of the same size can share a mask
+    assert(other.pi_.c_size == pi_.c_size);
+    assert(other.pi_.k_size_even == pi_.k_size_even);
+
+    FOREACH_MESH_POINT({
+        SetNode_(c, k, other.GetM_(other.mesh_mask_, c, k));
+    });
+    source_ = other.source_;
+    pickup_ = other.pickup_;
+    source_interp_ = other.source_interp_;
+    pickup_interp_ = other.pickup_interp_;
+    alpha_ = other.alpha_;
+    tension_depth_ = other.tension_depth_;
+    self_loop_y0_ = other.self_loop_y0_;
+    self_loop_y_ = other.self_loop_y0_;
+    self_loop_sqrt_y_ = std::sqrt(other.self_loop_y0_);
+    // Ports come along unconnected (nothing coming in)
+    n_ports_ = other.n_ports_;
+    for (unsigned int p = 0; p < n_ports_; p++) {
+        ports_[p] = other.ports_[p];
+        ports_[p].in = ports_[p].out = 0;
+    }
+}
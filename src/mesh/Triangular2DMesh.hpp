@@ -17,13 +17,13 @@
 #include <cstdint>
 #include <cmath>
 #include <bitset>
+#include "Dispatch.hpp"
+#include "FrameRing.hpp"
 
 /*
  * TODO 29/6/2020
  * - Attenuation
  * - Air loading filter
- * - Arbitrary mesh geometry
- * - SIMD and revisit array allocations/mask
  */
 
 
@@ -68,15 +68,157 @@ class Triangular2DMesh {
         float spatial_res__mm;
     };
 
+    /**
+     * @brief Scattering kernels: kKernelNodes visits the junctions one by
+     * one and only runs the waveguides each one has; kKernelStencil runs
+     * every waveguide of every node with the CPU's widest vector
+     * instructions (see DSP::Dispatch), masking the missing ones, and
+     * only serves the plain mesh (no tension modulation, no ports: the
+     * nodes kernel takes over otherwise).
+     * Which one is faster depends on the mask and the CPU (see
+     * MeshAutotuner::TuneKernel()).
+     *
+     */
+    enum Kernel {
+        kKernelNodes,
+        kKernelStencil,
+    };
+
     static size_t GetMemSize(Properties p);
+    static unsigned int GetNodeCount(Properties p);
     Triangular2DMesh(Properties p, void *mem);
     void Reset();
     template <typename MaskFnT>
     void ApplyMask(MaskFnT mask_fn);
     float ProcessSample(bool input_present, float input);
+    void RenderImpulseResponse(float *ir, unsigned int n_samples);
     void SetSource(float x, float y);
     void SetPickup(float x, float y);
+    /**
+     * @brief Move the source to (x, y) in a straight line over n_samples
+     * calls to ProcessSample(). SetSource() cancels a glide.
+     *
+     */
+    void GlideSource(float x, float y, unsigned int n_samples);
+    /**
+     * @brief Move the pickup to (x, y) in a straight line over n_samples
+     * calls to ProcessSample(). SetPickup() cancels a glide.
+     *
+     */
+    void GlidePickup(float x, float y, unsigned int n_samples);
     void SetAttenuation(float mu);
+    /**
+     * @brief Global tension modulation: wave speed rises with the energy
+     * in the mesh (pitch glides down as a hit decays). The energy is
+     * summed in the scatter pass and sets the next sample's speed.
+     *
+     * To have room to speed up, the mesh at rest is slowed down by a
+     * self-loop on each junction: its pitch at rest is 1 / headroom of
+     * the plain mesh's (scale the resolution to compensate).
+     *
+     * @param depth Relative increase of squared wave speed per unit of
+     * energy (sum of squared junction velocities). 0 turns it off.
+     * @param headroom Maximum speed over speed at rest (>= 1)
+     */
+    void SetTensionModulation(float depth, float headroom);
+    bool IsLinear() { return tension_depth_ == 0.f; }
+    /**
+     * @brief Open a coupling port at (x, y): one more waveguide on the
+     * junctions of the enclosing triangle, through which the mesh
+     * exchanges waves with the outside (see CoupledMeshSystem).
+     *
+     * @param admittance Admittance of the outside waveguide, relative to
+     * one of the mesh's own (0 leaves the mesh untouched)
+     * @return unsigned int Port index (ports are numbered in order)
+     */
+    unsigned int AddPort(float x, float y, float admittance);
+    static constexpr unsigned int kMaxPorts = 4;
+    void ClearPorts();
+    unsigned int GetNumPorts() { return n_ports_; }
+    /**
+     * @brief Wave arriving at a port, used by the next ProcessSample()
+     *
+     */
+    void SetPortInput(unsigned int port, float v) { ports_[port].in = v; }
+    /**
+     * @brief Wave leaving a port, as of the last ProcessSample()
+     *
+     */
+    float GetPortOutput(unsigned int port) { return ports_[port].out; }
+    /**
+     * @brief Floats per visualisation frame: the junction velocities of
+     * every decimation-th row, and every decimation-th node along it
+     *
+     */
+    unsigned int GetVisualisationFrameSize(unsigned int decimation);
+    /**
+     * @brief Positions of the nodes in a visualisation frame, as (x, y)
+     * pairs in mm (2 * GetVisualisationFrameSize() floats)
+     *
+     */
+    void GetVisualisationCoordinates(unsigned int decimation, float *xy);
+    /**
+     * @brief Stream junction velocities to another thread (e.g. a UI):
+     * every period samples, ProcessSample() writes a frame into ring,
+     * or drops it if the ring is full. Real-time safe on the audio side.
+     *
+     * @param ring Frames of GetVisualisationFrameSize(decimation) floats
+     * (nullptr: off, which costs nothing but a pointer test)
+     * @param period Samples between frames
+     * @param decimation Rows and nodes skipped per node kept, plus one
+     */
+    void SetVisualisation(DSP::FrameRing *ring, unsigned int period,
+        unsigned int decimation);
+    /**
+     * @brief Hold the mesh still over a disc (a finger or stick pressed
+     * on the head): its junctions drop out, as if masked. Only the
+     * junctions around the disc are touched, so it's cheap enough for
+     * the audio thread, on any control update.
+     *
+     */
+    void ClampRegion(float x, float y, float radius);
+    /**
+     * @brief Damp the mesh over a disc (a finger resting lightly): each
+     * junction's velocity is scaled by 1 - amount every sample, on top of
+     * SetAttenuation(). Real-time safe, as ClampRegion().
+     *
+     * @param amount In [0, 1], quantised to 1/255 steps
+     */
+    void DampRegion(float x, float y, float radius, float amount);
+    /**
+     * @brief Undo ClampRegion() and DampRegion() over a disc. Real-time
+     * safe, as ClampRegion().
+     *
+     */
+    void ReleaseRegion(float x, float y, float radius);
+    /**
+     * @brief Visit every junction the mask leaves any waveguide on, in
+     * (c, k) order, with the junctions it's linked to (e.g. to export the
+     * mesh as a graph, see GraphMesh)
+     *
+     * @param fn Functor void(unsigned int node, float x, float y,
+     * const unsigned int *neighbours, unsigned int n_neighbours), with
+     * nodes numbered in (c, k) order from 0 to GetNodeCount() - 1
+     */
+    template <typename JunctionFnT>
+    void ForEachJunction(JunctionFnT fn);
+    bool IsInside(float x, float y);
+    /**
+     * @brief Also binds the stencil kernel for the instruction set in use
+     * (see DSP::Dispatch)
+     *
+     */
+    void SetKernel(Kernel kernel);
+    Kernel GetKernel() { return kernel_; }
+    uint64_t GetConfigurationHash();
+    /**
+     * @brief Hash of the size and the mask (region edits included): what
+     * decides which kernel is faster
+     *
+     */
+    uint64_t GetGeometryHash();
+    Properties GetProperties() { return p_; }
+    void CopyConfiguration(Triangular2DMesh &other);
 
  protected:
 
@@ -89,14 +231,19 @@ class Triangular2DMesh {
         kNW,
         kNWaveguides,
     };
-    static constexpr unsigned int kNVMeshes = kNWaveguides*2 + 1;  // + Junction
+    static constexpr unsigned int kNVMeshes = kNWaveguides*2 + 2;  // + Junction, self-loop
     static constexpr unsigned int kNMaskMeshes = 1;
-    static constexpr unsigned int kNMeshes = kNVMeshes + kNMaskMeshes;
+    // Stencil kernel: scatter coefficient, damping factor, and a 0/1 for
+    // each waveguide
+    static constexpr unsigned int kNStencilMeshes = kNWaveguides + 2;
+    static constexpr unsigned int kNMeshes = kNVMeshes + kNMaskMeshes
+        + kNStencilMeshes;
     static float kSqrt3Over2;
     struct Properties_internal_ {
         unsigned int x_size;
         unsigned int y_size;
-        unsigned int total_size;
+        unsigned int halo;  // Zeros on each side of a plane's nodes
+        size_t plane_size;  // Floats per plane: may not fit 32 bits
         unsigned int c_size;
         unsigned int k_size_even;
         unsigned int k_size_odd;
@@ -108,34 +255,121 @@ class Triangular2DMesh {
         unsigned int c;
         unsigned int k;
     };
+    /**
+     * @brief A point between lattice nodes: the three nodes of the
+     * enclosing triangle and their barycentric weights. Weights are
+     * affine in (x, y), so a straight glide just adds a constant to each
+     * of them every sample, until one goes negative (an edge was crossed)
+     * and the next triangle is looked up.
+     *
+     */
+    struct Interpolation_ {
+        unsigned int c[3];  // kNoNode if outside the lattice or mask
+        unsigned int k[3];
+        float w[3];
+        float dw[3];  // Per sample, while gliding
+        float x;
+        float y;
+        float dx;
+        float dy;
+        float target_x;
+        float target_y;
+        unsigned int glide_left;
+    };
+    static constexpr unsigned int kNoNode = ~0u;
+    // Node word (mesh_mask_): the links the kernel runs on in the low
+    // bits, as a bitset of WaveguideIndex_, then the links the mask gave
+    // and the region edits on top (see ClampRegion()). Nonzero only for
+    // nodes inside the mask.
+    static constexpr uint32_t kLinkBits = (1u << kNWaveguides) - 1;
+    static constexpr unsigned int kBaseLinkShift = 8;
+    static constexpr uint32_t kClampedBit = 1u << 14;
+    static constexpr unsigned int kDampShift = 16;
+    static constexpr uint32_t kDampBits = 0xffu << kDampShift;
+    static constexpr float kDampStep = 1.f / 255.f;
+    struct Port_ {
+        Interpolation_ at;
+        float y;  // Admittance
+        float in;
+        float out;
+    };
     Properties p_;
     Properties_internal_ pi_;
     float *travelling_v_1_[kNWaveguides];
     float *travelling_v_2_[kNWaveguides];
     float *junc_v_;
+    float *self_v_;
     uint32_t *mesh_mask_;
+    float *coef_;  // 2 / number of waveguides, 0 without any
+    float *damp_;  // 1 - DampRegion() amount
+    float *link_[kNWaveguides];  // 1 where the waveguide runs, else 0
     float ** v_curr_;
     float ** v_next_;
-    CKCoords_ source_;
+    CKCoords_ source_;  // Node the position truncates to
     CKCoords_ pickup_;
+    Interpolation_ source_interp_;
+    Interpolation_ pickup_interp_;
+    float inv_res_;  // 1 / spatial resolution
+    float inv_row_pitch_;  // 1 / distance between rows
     float alpha_;
+    float tension_depth_;
+    float self_loop_y0_;  // Self-loop admittance at rest
+    float self_loop_y_;  // Current self-loop admittance
+    float self_loop_sqrt_y_;
+    Port_ ports_[kMaxPorts];
+    unsigned int n_ports_;
+    DSP::FrameRing *vis_ring_;  // nullptr: off
+    unsigned int vis_period_;
+    unsigned int vis_countdown_;
+    unsigned int vis_decimation_;
+    Kernel kernel_;
+    DSP::KernelTable::MeshScatterFn scatter_;  // Stencil kernel
+    DSP::KernelTable::MeshPropagateFn propagate_;
 
     Triangular2DMesh() {};
 
+    template <bool kTensionModulation, bool kPorts>
+    float ProcessSample_(bool input_present, float input);
+    float ProcessSampleStencil_(bool input_present, float input);
+
     void Init_(Properties p, void *mem);
+    void WriteVisualisationFrame_();
     static void GetInternalProperties(Properties &p,
         Properties_internal_ &pi_);
 
+    static unsigned int PadPlane_(unsigned int n) {
+        return (n + DSP::Dispatch::kMaxWidth - 1) &
+            ~(DSP::Dispatch::kMaxWidth - 1);
+    }
+
+    // Nodes are packed row after row in each plane: an even row holds
+    // x_size / 2 + 1 of them, an odd row x_size / 2, so each neighbour
+    // sits at the same offset from every node (see NodeOffset_())
+    __attribute__((always_inline)) size_t NodeIndex_(unsigned int c,
+        unsigned int k) {
+        return ((static_cast<size_t>(c) * pi_.x_size + (c & 0x1)) >> 1) + k;
+    }
+
     template<typename T_>
     __attribute__((always_inline)) T_ GetM_(T_ *v,
         unsigned int c, unsigned int k) {
-        return v[c * pi_.x_size + 2 * k + (c & 0x1)];
+        return v[NodeIndex_(c, k)];
     }
 
     template<typename T_>
     __attribute__((always_inline)) void SetM_(T_ *v,
         unsigned int c, unsigned int k, T_ value) {
-        v[c * pi_.x_size + 2 * k + (c & 0x1)] = value;
+        v[NodeIndex_(c, k)] = value;
+    }
+
+    // Offset of a node's neighbour along waveguide d. Rows wrap into each
+    // other, and the first and last rows into the halo, but only where
+    // the waveguide is missing.
+    __attribute__((always_inline)) int NodeOffset_(unsigned int d) {
+        const int half = static_cast<int>(pi_.x_size >> 1);
+        const int offset[kNWaveguides] = {
+            -half, 1, half + 1, half, -1, -half - 1 };
+        return offset[d];
     }
 
     __attribute__((always_inline)) void CKtoXY_(unsigned int c,
@@ -145,6 +379,66 @@ class Triangular2DMesh {
             (p_.spatial_res__mm * 0.5f) * static_cast<float>(c & 0x1);
     }
 
+    __attribute__((always_inline)) unsigned int CKtoNode_(unsigned int c,
+        unsigned int k) {
+        // Even rows before c have one more node than odd ones
+        return ((c + 1) >> 1) * pi_.k_size_even + (c >> 1) * pi_.k_size_odd
+            + k;
+    }
+
+    __attribute__((always_inline)) bool IsInLattice_(unsigned int c,
+        unsigned int k) {
+        // Unsigned: c-1 and k-1 at the edges wrap around and fail too
+        return c < pi_.c_size && k < (pi_.k_size_odd + !(c & 0x1));
+    }
+
+    // Whether a node in the lattice runs: inside the mask, not clamped and
+    // with a neighbour to talk to
+    __attribute__((always_inline)) bool IsLive_(unsigned int c,
+        unsigned int k) {
+        return (GetM_(mesh_mask_, c, k) & kLinkBits) != 0;
+    }
+
+    void EditRegion_(float x, float y, float radius, uint32_t clear,
+        uint32_t set);
+    void Relink_(unsigned int c, unsigned int k);
+    void SetNode_(unsigned int c, unsigned int k, uint32_t word);
+    void UpdateStencil_(unsigned int c, unsigned int k);
+    void Locate_(Interpolation_ &p, float x, float y);
+    void StartGlide_(Interpolation_ &p, float x, float y,
+        unsigned int n_samples);
+
+    __attribute__((always_inline)) void Advance_(Interpolation_ &p) {
+        if (p.glide_left == 0) {
+            return;
+        }
+        if (--p.glide_left == 0) {
+            // Land exactly, whatever rounding built up on the way
+            Locate_(p, p.target_x, p.target_y);
+            return;
+        }
+        p.x += p.dx;
+        p.y += p.dy;
+        p.w[0] += p.dw[0];
+        p.w[1] += p.dw[1];
+        p.w[2] += p.dw[2];
+        if (p.w[0] < 0 || p.w[1] < 0 || p.w[2] < 0) {
+            Locate_(p, p.x, p.y);
+        }
+    }
+
+    __attribute__((always_inline)) float GetWeight_(const Interpolation_ &p,
+        unsigned int c, unsigned int k) {
+        return ((c == p.c[0] && k == p.k[0]) ? p.w[0] : 0.f) +
+            ((c == p.c[1] && k == p.k[1]) ? p.w[1] : 0.f) +
+            ((c == p.c[2] && k == p.k[2]) ? p.w[2] : 0.f);
+    }
+
+    __attribute__((always_inline)) bool IsInRows_(const Interpolation_ &p,
+        unsigned int c) {
+        return c == p.c[0] || c == p.c[1] || c == p.c[2];
+    }
+
     __attribute__((always_inline)) CKCoords_ XYtoCK_(float x, float y) {
         CKCoords_ out;
         out.c = y / (kSqrt3Over2 * p_.spatial_res__mm);
@@ -157,40 +451,72 @@ template <typename MaskFnT>
 void Triangular2DMesh::ApplyMask(MaskFnT mask_fn) {
 
     float x, y;
+    // A point is inside if it's both in the lattice and in the mask (the
+    // lattice check catches rounding on the far edges, where CKtoXY_ can
+    // land a hair inside the mask just past the last row/column)
+    auto is_inside = [&](unsigned int c_, unsigned int k_) {
+        if (!IsInLattice_(c_, k_)) {
+            return false;
+        }
+        CKtoXY_(c_, k_, x, y);
+        return static_cast<bool>(mask_fn(x, y));
+    };
 
     FOREACH_MESH_POINT({
-        CKtoXY_(c, k, x, y);
         // If point itself is outside the mask, then it shouldn't
         // receive any data
         std::bitset<kNWaveguides> result(0);
-        if (mask_fn(x, y)) {
+        if (is_inside(c, k)) {
             // Otherwise, choose correct boundary function based on
             // how many points in hexagon lie within the mask
             // And build a bitmask from it.
             // Bit 0: (c-1, k+1) for odd cols, (c-1, k) for even cols (top right)
-            CKtoXY_(kNE_C_K, x, y);
-            result.set(kNE, mask_fn(x, y));
+            result.set(kNE, is_inside(kNE_C_K));
             // Bit 1: c, k+1 (right)
-            CKtoXY_(kE_C_K, x, y);
-            result.set(kE, mask_fn(x, y));
+            result.set(kE, is_inside(kE_C_K));
             // Bit 2: (c+1, k+1) for odd cols, (c+1, k) for even cols  (bottom right)
-            CKtoXY_(kSE_C_K, x, y);
-            result.set(kSE, mask_fn(x, y));
+            result.set(kSE, is_inside(kSE_C_K));
             // Bit 3: (c+1, k) for odd cols, (c+1, k-1) for even cols (bottom left)
-            CKtoXY_(kSW_C_K, x, y);
-            result.set(kSW, mask_fn(x, y));
+            result.set(kSW, is_inside(kSW_C_K));
             // Bit 4: c, k-1 (left)
-            CKtoXY_(kW_C_K, x, y);
-            result.set(kW, mask_fn(x, y));
+            result.set(kW, is_inside(kW_C_K));
             // Bit 5: (c-1, k) for odd cols, (c-1, k-1) for even cols (top left)
-            CKtoXY_(kNW_C_K, x, y);
-            result.set(kNW, mask_fn(x, y));
+            result.set(kNW, is_inside(kNW_C_K));
         }
-        SetM_(mesh_mask_, c, k, static_cast<uint32_t>(result.to_ulong()));
+        // Region edits start afresh
+        uint32_t links = static_cast<uint32_t>(result.to_ulong());
+        SetNode_(c, k, links | (links << kBaseLinkShift));
     });
 }
 
 
+template <typename JunctionFnT>
+void Triangular2DMesh::ForEachJunction(JunctionFnT fn) {
+
+    for (unsigned int c = 0; c < pi_.c_size; c++) {
+        unsigned int column_is_even = !(c & 0x1);
+        for (unsigned int k = 0; k < pi_.k_size_odd + column_is_even; k++) {
+            std::bitset<kNWaveguides> mask(GetM_(mesh_mask_, c, k));
+            if (mask.none()) {
+                continue;
+            }
+            unsigned int neighbours[kNWaveguides];
+            unsigned int n = 0;
+            if (mask.test(kNE)) { neighbours[n++] = CKtoNode_(kNE_C_K); }
+            if (mask.test(kE)) { neighbours[n++] = CKtoNode_(kE_C_K); }
+            if (mask.test(kSE)) { neighbours[n++] = CKtoNode_(kSE_C_K); }
+            if (mask.test(kSW)) { neighbours[n++] = CKtoNode_(kSW_C_K); }
+            if (mask.test(kW)) { neighbours[n++] = CKtoNode_(kW_C_K); }
+            if (mask.test(kNW)) { neighbours[n++] = CKtoNode_(kNW_C_K); }
+            float x, y;
+            CKtoXY_(c, k, x, y);
+            fn(CKtoNode_(c, k), x, y, static_cast<const unsigned int *>(
+                neighbours), n);
+        }
+    }
+}
+
+
 // Instantiation of templates for mesh access with short-hand functions
 template float Triangular2DMesh::GetM_(float *v, unsigned int c, unsigned int k);
 template void Triangular2DMesh::SetM_(float *v, unsigned int c, unsigned int k, float value);